@@ -14,6 +14,7 @@
 #include "datareader.h"
 #include "net.h"
 #include "gpu.h"
+#include "profiler.h"
 
 #ifndef NCNN_SIMPLESTL
 #include <vector>
@@ -36,6 +37,7 @@ public:
 static int g_warmup_loop_count = 8;
 static int g_loop_count = 4;
 static bool g_enable_cooling_down = true;
+static bool g_enable_profile = false;
 
 static ncnn::UnlockedPoolAllocator g_blob_pool_allocator;
 static ncnn::PoolAllocator g_workspace_pool_allocator;
@@ -46,6 +48,64 @@ static ncnn::VkAllocator* g_blob_vkallocator = 0;
 static ncnn::VkAllocator* g_staging_vkallocator = 0;
 #endif // NCNN_VULKAN
 
+// print per layer time against the estimated work
+// low GFLOP/s with high GB/s hints a bandwidth bound layer
+static void profile(const ncnn::Net& net, const std::vector<ncnn::Mat>& _in)
+{
+    const std::vector<const char*>& input_names = net.input_names();
+    const std::vector<const char*>& output_names = net.output_names();
+
+    ncnn::TraceProfiler profiler;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_profiler(&profiler);
+
+        for (size_t j = 0; j < input_names.size(); ++j)
+        {
+            ncnn::Mat in = _in[j];
+            ex.input(input_names[j], in);
+        }
+
+        for (size_t j = 0; j < output_names.size(); ++j)
+        {
+            ncnn::Mat out;
+            ex.extract(output_names[j], out);
+        }
+    }
+
+    const size_t layer_count = net.layers().size();
+    std::vector<double> elapsed_ns(layer_count, 0.0);
+    std::vector<ncnn::LayerCost> costs(layer_count);
+    std::vector<int> counts(layer_count, 0);
+
+    for (int i = 0; i < profiler.count(); i++)
+    {
+        const ncnn::LayerProfile& lp = profiler.get(i);
+        elapsed_ns[lp.layer_index] += lp.elapsed_ns;
+        costs[lp.layer_index] = lp.cost;
+        counts[lp.layer_index] += 1;
+    }
+
+    fprintf(stderr, "%-24s %-24s %9s %10s %10s %10s %8s\n", "type", "name", "ms", "MFLOP", "MB", "GFLOP/s", "GB/s");
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        if (counts[i] == 0)
+            continue;
+
+        const ncnn::Layer* layer = net.layers()[i];
+        const ncnn::LayerCost& cost = costs[i];
+
+        const double ns = std::max(elapsed_ns[i] / counts[i], 1.0);
+        const double bytes = (double)(cost.weight_bytes + cost.read_bytes + cost.write_bytes);
+
+        fprintf(stderr, "%-24s %-24s %9.3f %10.2f %10.2f %10.2f %8.2f\n", layer->type.c_str(), layer->name.c_str(), ns / 1000000, cost.flops / 1000000.0, bytes / 1000000, cost.flops / ns, bytes / ns);
+    }
+
+    profiler.print_summary();
+}
+
 void benchmark(const char* comment, const std::vector<ncnn::Mat>& _in, const ncnn::Option& opt, bool fixed_path = true)
 {
     g_blob_pool_allocator.clear();
@@ -163,6 +223,11 @@ void benchmark(const char* comment, const std::vector<ncnn::Mat>& _in, const ncn
     time_avg /= g_loop_count;
 
     fprintf(stderr, "%20s  min = %7.2f  max = %7.2f  avg = %7.2f\n", comment, time_min, time_max, time_avg);
+
+    if (g_enable_profile)
+    {
+        profile(net, _in);
+    }
 }
 
 void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& opt, bool fixed_path = true)
@@ -177,6 +242,7 @@ void show_usage()
     fprintf(stderr, "Usage: benchncnn [loop count] [num threads] [powersave] [gpu device] [cooling down] [(key=value)...]\n");
     fprintf(stderr, "  param=model.param\n");
     fprintf(stderr, "  shape=[227,227,3],...\n");
+    fprintf(stderr, "  profile=1\n");
 }
 
 static std::vector<ncnn::Mat> parse_shape_list(char* s)
@@ -308,6 +374,8 @@ int main(int argc, char** argv)
             model = value;
         if (strcmp(key, "shape") == 0)
             inputs = parse_shape_list(value);
+        if (strcmp(key, "profile") == 0)
+            g_enable_profile = atoi(value) != 0;
     }
 
     if (model && inputs.empty())
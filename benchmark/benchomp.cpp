@@ -0,0 +1,138 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "platform.h"
+
+static int g_loop_count = 10000;
+
+static void show_usage()
+{
+    fprintf(stderr, "Usage: benchomp [loop count] [num threads] [blocktime]\n");
+}
+
+// many back to back parallel regions like the layers of one inference
+static void bench_fork_join(const char* comment, int num_threads, int work, std::vector<float>& data)
+{
+    const int n = (int)data.size();
+    float* ptr = data.data();
+
+    // warm up and wake the workers
+    for (int i = 0; i < 100; i++)
+    {
+        #pragma omp parallel for num_threads(num_threads)
+        for (int q = 0; q < num_threads; q++)
+        {
+            ptr[q] += 1.f;
+        }
+    }
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    // time batches of regions, a single empty region is below the timer resolution
+    const int batch = 100;
+    const int batch_count = std::max(g_loop_count / batch, 1);
+
+    for (int b = 0; b < batch_count; b++)
+    {
+        double start = ncnn::get_current_time();
+
+        for (int i = 0; i < batch; i++)
+        {
+            #pragma omp parallel for num_threads(num_threads)
+            for (int q = 0; q < work; q++)
+            {
+                float* p = ptr + (q * 16) % n;
+                for (int k = 0; k < 16; k++)
+                {
+                    p[k] = p[k] * 0.99f + 0.01f;
+                }
+            }
+        }
+
+        double end = ncnn::get_current_time();
+
+        // microseconds per region
+        double time = (end - start) * 1000 / batch;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= batch_count;
+
+    fprintf(stderr, "%24s  threads = %2d  min = %8.2f us  max = %8.2f us  avg = %8.2f us\n", comment, num_threads, time_min, time_max, time_avg);
+}
+
+int main(int argc, char** argv)
+{
+    int num_threads = ncnn::get_physical_big_cpu_count();
+    int blocktime = 20;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] == 'h')
+        {
+            show_usage();
+            return -1;
+        }
+
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            show_usage();
+            return -1;
+        }
+    }
+
+    if (argc >= 2)
+    {
+        g_loop_count = atoi(argv[1]);
+    }
+    if (argc >= 3)
+    {
+        num_threads = atoi(argv[2]);
+    }
+    if (argc >= 4)
+    {
+        blocktime = atoi(argv[3]);
+    }
+
+    ncnn::set_omp_dynamic(0);
+    ncnn::set_omp_num_threads(num_threads);
+    ncnn::set_kmp_blocktime(blocktime);
+
+#if NCNN_SIMPLEOMP
+    fprintf(stderr, "runtime = simpleomp\n");
+#else
+    fprintf(stderr, "runtime = openmp\n");
+#endif
+    fprintf(stderr, "loop_count = %d\n", g_loop_count);
+    fprintf(stderr, "num_threads = %d\n", num_threads);
+    fprintf(stderr, "blocktime = %d\n", ncnn::get_kmp_blocktime());
+
+    std::vector<float> data(64 * 1024, 1.f);
+
+    bench_fork_join("empty", num_threads, 0, data);
+    bench_fork_join("tiny", num_threads, num_threads, data);
+    bench_fork_join("small", num_threads, 256, data);
+    bench_fork_join("medium", num_threads, 4096, data);
+
+    // a team per size keeps the same workers busy
+    for (int t = 2; t < num_threads; t *= 2)
+    {
+        bench_fork_join("tiny", t, t, data);
+    }
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "datareader.h"
+#include "net.h"
+#include "netpipeline.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+static int g_frame_count = 50;
+static int g_crop_count = 4;
+
+static void show_usage()
+{
+    fprintf(stderr, "Usage: benchpipeline [frame count] [crops per frame]\n");
+}
+
+static int load_net(ncnn::Net& net, const char* model, int num_threads)
+{
+    net.opt.num_threads = num_threads;
+
+    char parampath[256];
+    sprintf(parampath, "%s.param", model);
+    int ret = net.load_param(parampath);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+// cut g_crop_count classifier inputs out of frame
+// the detector sees zero weights, fixed boxes stand in for what it did not find
+static void make_crops(const ncnn::Mat& frame, const ncnn::Mat& detections, std::vector<ncnn::Mat>& crops)
+{
+    for (int i = 0; i < g_crop_count; i++)
+    {
+        float x1 = 0.1f * (i % 4);
+        float y1 = 0.1f * (i % 4);
+        float x2 = x1 + 0.5f;
+        float y2 = y1 + 0.5f;
+
+        if (i < detections.h && detections.w == 6)
+        {
+            // label score xmin ymin xmax ymax
+            const float* det = detections.row(i);
+            x1 = std::max(det[2], 0.f);
+            y1 = std::max(det[3], 0.f);
+            x2 = std::min(det[4], 1.f);
+            y2 = std::min(det[5], 1.f);
+        }
+
+        const int left = (int)(x1 * frame.w);
+        const int top = (int)(y1 * frame.h);
+        const int right = frame.w - std::max((int)(x2 * frame.w), left + 1);
+        const int bottom = frame.h - std::max((int)(y2 * frame.h), top + 1);
+
+        ncnn::Mat roi;
+        copy_cut_border(frame, roi, top, bottom, left, right);
+
+        ncnn::Mat crop;
+        resize_bilinear(roi, crop, 227, 227);
+
+        crops.push_back(crop);
+    }
+}
+
+static int detect(ncnn::Extractor& ex, const std::vector<ncnn::Mat>& inputs, std::vector<std::vector<ncnn::Mat> >& outputs, void* /*userdata*/)
+{
+    ex.input("data", inputs[0]);
+
+    ncnn::Mat detections;
+    int ret = ex.extract("output", detections);
+    if (ret != 0)
+        return ret;
+
+    // every crop travels on as its own item
+    std::vector<ncnn::Mat> crops;
+    make_crops(inputs[0], detections, crops);
+
+    for (size_t i = 0; i < crops.size(); i++)
+    {
+        outputs.push_back(std::vector<ncnn::Mat>(1, crops[i]));
+    }
+
+    return 0;
+}
+
+static ncnn::Mat make_frame()
+{
+    ncnn::Mat frame(300, 300, 3);
+    frame.fill(0.01f);
+
+    return frame;
+}
+
+// detector then classifier on the caller thread, every layer uses all cpus
+static double bench_sequential(int num_threads)
+{
+    ncnn::Net detector;
+    ncnn::Net classifier;
+    load_net(detector, "mobilenet_ssd", num_threads);
+    load_net(classifier, "squeezenet", num_threads);
+
+    const ncnn::Mat frame = make_frame();
+
+    double start = 0.0;
+    for (int i = -2; i < g_frame_count; i++)
+    {
+        // the first runs warm up
+        if (i == 0)
+            start = ncnn::get_current_time();
+
+        ncnn::Mat detections;
+        {
+            ncnn::Extractor ex = detector.create_extractor();
+            ex.input("data", frame);
+            ex.extract("output", detections);
+        }
+
+        std::vector<ncnn::Mat> crops;
+        make_crops(frame, detections, crops);
+
+        for (size_t j = 0; j < crops.size(); j++)
+        {
+            ncnn::Extractor ex = classifier.create_extractor();
+            ex.input("data", crops[j]);
+
+            ncnn::Mat prob;
+            ex.extract("output", prob);
+        }
+    }
+
+    return ncnn::get_current_time() - start;
+}
+
+// detector and classifier overlap on their own half of the cpus
+static double bench_pipeline(const ncnn::CpuSet& cpus0, const ncnn::CpuSet& cpus1)
+{
+    ncnn::Net detector;
+    ncnn::Net classifier;
+    load_net(detector, "mobilenet_ssd", cpus0.num_enabled());
+    load_net(classifier, "squeezenet", cpus1.num_enabled());
+
+    ncnn::NetPipeline pipeline;
+    pipeline.add_stage(detector, cpus0, detect);
+    pipeline.add_stage(classifier, cpus1);
+
+    const std::vector<ncnn::Mat> inputs(1, make_frame());
+
+    // warm up
+    pipeline.push(inputs, -1);
+    for (int i = 0; i < g_crop_count; i++)
+    {
+        std::vector<ncnn::Mat> outputs;
+        pipeline.pop(outputs);
+    }
+
+    const double start = ncnn::get_current_time();
+
+    // keep a few frames in flight and collect in between
+    const int in_flight = 2;
+    int popped = 0;
+    for (int i = 0; i < g_frame_count; i++)
+    {
+        pipeline.push(inputs, i);
+
+        while (popped < (i + 1 - in_flight) * g_crop_count)
+        {
+            std::vector<ncnn::Mat> outputs;
+            pipeline.pop(outputs);
+            popped++;
+        }
+    }
+
+    pipeline.close();
+
+    std::vector<ncnn::Mat> outputs;
+    while (pipeline.pop(outputs) == 0)
+    {
+        popped++;
+    }
+
+    const double end = ncnn::get_current_time();
+
+    if (popped != g_frame_count * g_crop_count)
+        fprintf(stderr, "pipeline lost %d crops\n", g_frame_count * g_crop_count - popped);
+
+    return end - start;
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] == 'h')
+        {
+            show_usage();
+            return -1;
+        }
+
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            show_usage();
+            return -1;
+        }
+    }
+
+    if (argc >= 2)
+    {
+        g_frame_count = std::max(atoi(argv[1]), 1);
+    }
+    if (argc >= 3)
+    {
+        g_crop_count = std::max(atoi(argv[2]), 1);
+    }
+
+    // split the cpus in two halves, a single cpu is shared
+    const ncnn::CpuSet& all_cpus = ncnn::get_cpu_thread_affinity_mask(0);
+    const int cpu_count = all_cpus.num_enabled();
+
+    ncnn::CpuSet cpus0;
+    ncnn::CpuSet cpus1;
+    cpus0.disable_all();
+    cpus1.disable_all();
+    for (int i = 0, j = 0; i < ncnn::get_cpu_count(); i++)
+    {
+        if (!all_cpus.is_enabled(i))
+            continue;
+
+        if (cpu_count == 1 || j < (cpu_count + 1) / 2)
+            cpus0.enable(i);
+        if (cpu_count == 1 || j >= (cpu_count + 1) / 2)
+            cpus1.enable(i);
+        j++;
+    }
+
+    fprintf(stderr, "frame_count = %d\n", g_frame_count);
+    fprintf(stderr, "crop_count = %d\n", g_crop_count);
+    fprintf(stderr, "cpu_count = %d + %d\n", cpus0.num_enabled(), cpus1.num_enabled());
+
+    const double time_sequential = bench_sequential(cpu_count);
+    fprintf(stderr, "%20s  total = %8.2f ms  frame = %8.2f ms  fps = %8.2f\n", "sequential", time_sequential, time_sequential / g_frame_count, g_frame_count * 1000.0 / time_sequential);
+
+    const double time_pipeline = bench_pipeline(cpus0, cpus1);
+    fprintf(stderr, "%20s  total = %8.2f ms  frame = %8.2f ms  fps = %8.2f\n", "pipeline", time_pipeline, time_pipeline / g_frame_count, g_frame_count * 1000.0 / time_pipeline);
+
+    return 0;
+}
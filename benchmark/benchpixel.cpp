@@ -0,0 +1,341 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "benchmark.h"
+#include "cpu.h"
+#include "mat.h"
+
+static int g_loop_count = 10;
+
+// reuse the output buffers, otherwise page faults of fresh allocation dominate
+static ncnn::PoolAllocator g_blob_pool_allocator;
+
+static void show_usage()
+{
+    fprintf(stderr, "Usage: benchpixel [loop count] [num threads] [powersave]\n");
+}
+
+static void print_result(const char* comment, int w, int h, double time_min, double time_max, double time_avg)
+{
+    // mega pixels per second with the best run
+    double mpps = w * h / time_min / 1000;
+
+    fprintf(stderr, "%20s %4dx%-4d  min = %7.2f  max = %7.2f  avg = %7.2f  %8.1f MPix/s\n", comment, w, h, time_min, time_max, time_avg, mpps);
+}
+
+static void bench_from_pixels(const char* comment, const unsigned char* pixels, int type, int w, int h, int stride, const ncnn::Option& opt)
+{
+    // warm up
+    ncnn::Mat m = ncnn::Mat::from_pixels(pixels, type, w, h, stride, opt);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        m = ncnn::Mat::from_pixels(pixels, type, w, h, stride, opt);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, w, h, time_min, time_max, time_avg);
+}
+
+static void bench_to_pixels(const char* comment, const ncnn::Mat& m, unsigned char* pixels, int type, int stride, const ncnn::Option& opt)
+{
+    // warm up
+    m.to_pixels(pixels, type, stride, opt);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        m.to_pixels(pixels, type, stride, opt);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, m.w, m.h, time_min, time_max, time_avg);
+}
+
+static void bench_yuv420sp2rgb(const char* comment, const unsigned char* yuv, int w, int h, unsigned char* rgb)
+{
+    // warm up
+    ncnn::yuv420sp2rgb(yuv, w, h, rgb);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        ncnn::yuv420sp2rgb(yuv, w, h, rgb);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, w, h, time_min, time_max, time_avg);
+}
+
+static void bench_kanna_rotate(const char* comment, const unsigned char* pixels, int w, int h, unsigned char* out, int type, const ncnn::Option& opt)
+{
+    const int outw = type <= 4 ? w : h;
+    const int outh = type <= 4 ? h : w;
+
+    // warm up
+    ncnn::kanna_rotate_c3(pixels, w, h, w * 3, out, outw, outh, outw * 3, type, opt);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        ncnn::kanna_rotate_c3(pixels, w, h, w * 3, out, outw, outh, outw * 3, type, opt);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, w, h, time_min, time_max, time_avg);
+}
+
+static void bench_warpaffine(const char* comment, const unsigned char* pixels, int w, int h, unsigned char* out, const ncnn::Option& opt)
+{
+    float tm[6];
+    ncnn::get_rotation_matrix(30.f, 1.2f, w / 2, h / 2, tm);
+
+    // warm up
+    ncnn::warpaffine_bilinear_c3(pixels, w, h, w * 3, out, w, h, w * 3, tm, 0, 0, opt);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        ncnn::warpaffine_bilinear_c3(pixels, w, h, w * 3, out, w, h, w * 3, tm, 0, 0, opt);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, w, h, time_min, time_max, time_avg);
+}
+
+static void bench_resize(const char* comment, const unsigned char* pixels, int w, int h, int target_width, int target_height, int resize_type, const ncnn::Option& opt)
+{
+    // warm up
+    ncnn::Mat m = ncnn::Mat::from_pixels_resize(pixels, ncnn::Mat::PIXEL_RGB, w, h, w * 3, target_width, target_height, resize_type, opt);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        m = ncnn::Mat::from_pixels_resize(pixels, ncnn::Mat::PIXEL_RGB, w, h, w * 3, target_width, target_height, resize_type, opt);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, w, h, time_min, time_max, time_avg);
+}
+
+static void bench_from_yuv420sp(const char* comment, const unsigned char* yuv, int w, int h, int target_width, int target_height, const ncnn::Option& opt)
+{
+    const float mean_vals[3] = {104.f, 117.f, 123.f};
+    const float norm_vals[3] = {0.017f, 0.017f, 0.017f};
+
+    ncnn::PixelPreprocessOption ppopt;
+    ppopt.target_width = target_width;
+    ppopt.target_height = target_height;
+    ppopt.mean_vals = mean_vals;
+    ppopt.norm_vals = norm_vals;
+    ppopt.num_threads = opt.num_threads;
+
+    // warm up
+    ncnn::Mat m = ncnn::Mat::from_yuv420sp(yuv, w, h, ncnn::Mat::PIXEL_RGB, ppopt, opt.blob_allocator);
+
+    double time_min = DBL_MAX;
+    double time_max = -DBL_MAX;
+    double time_avg = 0;
+
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        m = ncnn::Mat::from_yuv420sp(yuv, w, h, ncnn::Mat::PIXEL_RGB, ppopt, opt.blob_allocator);
+
+        double end = ncnn::get_current_time();
+
+        double time = end - start;
+
+        time_min = std::min(time_min, time);
+        time_max = std::max(time_max, time);
+        time_avg += time;
+    }
+
+    time_avg /= g_loop_count;
+
+    print_result(comment, w, h, time_min, time_max, time_avg);
+}
+
+static void benchmark(int w, int h, const ncnn::Option& opt)
+{
+    // enough room for rgba
+    std::vector<unsigned char> pixels(w * h * 4);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        pixels[i] = (unsigned char)(i * 7 + (i >> 8));
+    }
+
+    std::vector<unsigned char> out(w * h * 4);
+
+    bench_from_pixels("from rgb", pixels.data(), ncnn::Mat::PIXEL_RGB, w, h, w * 3, opt);
+    bench_from_pixels("from bgr2rgb", pixels.data(), ncnn::Mat::PIXEL_BGR2RGB, w, h, w * 3, opt);
+    bench_from_pixels("from rgb2gray", pixels.data(), ncnn::Mat::PIXEL_RGB2GRAY, w, h, w * 3, opt);
+    bench_from_pixels("from rgba", pixels.data(), ncnn::Mat::PIXEL_RGBA, w, h, w * 4, opt);
+    bench_from_pixels("from rgba2bgr", pixels.data(), ncnn::Mat::PIXEL_RGBA2BGR, w, h, w * 4, opt);
+    bench_from_pixels("from gray", pixels.data(), ncnn::Mat::PIXEL_GRAY, w, h, w, opt);
+
+    ncnn::Mat rgb = ncnn::Mat::from_pixels(pixels.data(), ncnn::Mat::PIXEL_RGB, w, h, w * 3, opt);
+    ncnn::Mat rgba = ncnn::Mat::from_pixels(pixels.data(), ncnn::Mat::PIXEL_RGBA, w, h, w * 4, opt);
+
+    bench_to_pixels("to rgb", rgb, out.data(), ncnn::Mat::PIXEL_RGB, w * 3, opt);
+    bench_to_pixels("to bgr2rgb", rgb, out.data(), ncnn::Mat::PIXEL_BGR2RGB, w * 3, opt);
+    bench_to_pixels("to rgb2rgba", rgb, out.data(), ncnn::Mat::PIXEL_RGB2RGBA, w * 4, opt);
+    bench_to_pixels("to rgba", rgba, out.data(), ncnn::Mat::PIXEL_RGBA, w * 4, opt);
+
+    bench_yuv420sp2rgb("yuv420sp2rgb", pixels.data(), w, h, out.data());
+    bench_from_yuv420sp("from yuv420sp", pixels.data(), w, h, w, h, opt);
+    bench_from_yuv420sp("from yuv420sp 640", pixels.data(), w, h, 640, 640 * h / w, opt);
+
+    bench_kanna_rotate("rotate rgb 90", pixels.data(), w, h, out.data(), 6, opt);
+    bench_kanna_rotate("rotate rgb 180", pixels.data(), w, h, out.data(), 3, opt);
+    bench_warpaffine("warpaffine rgb", pixels.data(), w, h, out.data(), opt);
+
+    bench_resize("resize bilinear 320", pixels.data(), w, h, 320, 320 * h / w, ncnn::Mat::PIXEL_RESIZE_BILINEAR, opt);
+    bench_resize("resize area 320", pixels.data(), w, h, 320, 320 * h / w, ncnn::Mat::PIXEL_RESIZE_AREA, opt);
+    bench_resize("resize bicubic 320", pixels.data(), w, h, 320, 320 * h / w, ncnn::Mat::PIXEL_RESIZE_BICUBIC, opt);
+}
+
+int main(int argc, char** argv)
+{
+    int num_threads = ncnn::get_physical_big_cpu_count();
+    int powersave = 2;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] == 'h')
+        {
+            show_usage();
+            return -1;
+        }
+
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            show_usage();
+            return -1;
+        }
+    }
+
+    if (argc >= 2)
+    {
+        g_loop_count = atoi(argv[1]);
+    }
+    if (argc >= 3)
+    {
+        num_threads = atoi(argv[2]);
+    }
+    if (argc >= 4)
+    {
+        powersave = atoi(argv[3]);
+    }
+
+    ncnn::set_cpu_powersave(powersave);
+
+    ncnn::set_omp_dynamic(0);
+    ncnn::set_omp_num_threads(num_threads);
+
+    ncnn::Option opt;
+    opt.num_threads = num_threads;
+    opt.blob_allocator = &g_blob_pool_allocator;
+
+    fprintf(stderr, "loop_count = %d\n", g_loop_count);
+    fprintf(stderr, "num_threads = %d\n", num_threads);
+    fprintf(stderr, "powersave = %d\n", ncnn::get_cpu_powersave());
+
+    // 1080p and 4k frames
+    benchmark(1920, 1080, opt);
+    benchmark(3840, 2160, opt);
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "datareader.h"
+#include "net.h"
+#include "platform.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+static int g_loop_count = 20;
+static int g_num_threads = 1;
+static int g_noise_threads = 0;
+
+static void show_usage()
+{
+    fprintf(stderr, "Usage: benchschedule [loop count] [num threads] [noise threads]\n");
+}
+
+// busy threads competing for the cores like noisy neighbours on a shared host
+static volatile int g_noise_stop = 0;
+
+static void* noise_worker(void* /*args*/)
+{
+    volatile float v = 1.f;
+    while (!g_noise_stop)
+    {
+        for (int i = 0; i < 10000; i++)
+        {
+            v = v * 0.999f + 0.001f;
+        }
+    }
+
+    return 0;
+}
+
+static int load_net(ncnn::Net& net, const char* param_txt)
+{
+    net.opt.num_threads = g_num_threads;
+
+    // keep convolution on the im2col gemm path
+    net.opt.use_winograd_convolution = false;
+    net.opt.use_sgemm_convolution = true;
+
+    int ret = net.load_param_mem(param_txt);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+static void bench_schedule(const char* comment, ncnn::Net& net, const std::vector<ncnn::Mat>& inputs)
+{
+    static const char* schedule_names[4] = {"static", "dynamic", "guided", "work stealing"};
+
+    const std::vector<int>& input_indexes = net.input_indexes();
+    const std::vector<int>& output_indexes = net.output_indexes();
+
+    double time_static = 0.0;
+    for (int s = 0; s < 4; s++)
+    {
+        net.opt.parallel_schedule = s;
+
+        double time_min = DBL_MAX;
+        double time_max = -DBL_MAX;
+        double time_avg = 0;
+
+        for (int i = -2; i < g_loop_count; i++)
+        {
+            double start = ncnn::get_current_time();
+
+            ncnn::Extractor ex = net.create_extractor();
+            for (size_t j = 0; j < input_indexes.size(); j++)
+            {
+                ex.input(input_indexes[j], inputs[j]);
+            }
+
+            ncnn::Mat out;
+            ex.extract(output_indexes[0], out);
+
+            double end = ncnn::get_current_time();
+
+            // the first runs warm up
+            if (i < 0)
+                continue;
+
+            double time = end - start;
+
+            time_min = std::min(time_min, time);
+            time_max = std::max(time_max, time);
+            time_avg += time;
+        }
+
+        time_avg /= g_loop_count;
+
+        if (s == 0)
+            time_static = time_avg;
+
+        fprintf(stderr, "%20s  %14s  min = %8.2f  max = %8.2f  avg = %8.2f  vs static = %6.2f%%\n", comment, schedule_names[s], time_min, time_max, time_avg, (time_static - time_avg) * 100.0 / time_static);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    g_num_threads = ncnn::get_physical_big_cpu_count();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] == 'h')
+        {
+            show_usage();
+            return -1;
+        }
+
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            show_usage();
+            return -1;
+        }
+    }
+
+    if (argc >= 2)
+    {
+        g_loop_count = std::max(atoi(argv[1]), 1);
+    }
+    if (argc >= 3)
+    {
+        g_num_threads = atoi(argv[2]);
+    }
+    if (argc >= 4)
+    {
+        g_noise_threads = atoi(argv[3]);
+    }
+
+    fprintf(stderr, "loop_count = %d\n", g_loop_count);
+    fprintf(stderr, "num_threads = %d\n", g_num_threads);
+    fprintf(stderr, "noise_threads = %d\n", g_noise_threads);
+
+    std::vector<ncnn::Thread*> noise;
+    for (int i = 0; i < g_noise_threads; i++)
+    {
+        noise.push_back(new ncnn::Thread(noise_worker));
+    }
+
+    // ragged tail, 1000 rows do not split evenly into the gemm tiles
+    {
+        ncnn::Net net;
+        load_net(net, "7767517\n3 3\nInput a 0 1 a\nInput b 0 1 b\nGemm gemm 2 1 a b out\n");
+
+        std::vector<ncnn::Mat> inputs(2);
+        inputs[0].create(512, 1000);
+        inputs[1].create(768, 512);
+        inputs[0].fill(0.01f);
+        inputs[1].fill(0.01f);
+
+        bench_schedule("gemm 1000x512x768", net, inputs);
+    }
+
+    // im2col gemm convolution, 3x3 128 to 200 channels on 56x56
+    {
+        ncnn::Net net;
+        load_net(net, "7767517\n2 2\nInput data 0 1 data\nConvolution conv 1 1 data out 0=200 1=3 4=1 5=1 6=230400\n");
+
+        std::vector<ncnn::Mat> inputs(1);
+        inputs[0].create(56, 56, 128);
+        inputs[0].fill(0.01f);
+
+        bench_schedule("conv3x3 128-200 56", net, inputs);
+    }
+
+    g_noise_stop = 1;
+    for (size_t i = 0; i < noise.size(); i++)
+    {
+        noise[i]->join();
+        delete noise[i];
+    }
+
+    return 0;
+}
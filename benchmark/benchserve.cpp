@@ -0,0 +1,254 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "datareader.h"
+#include "net.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+static const char* g_model = "squeezenet";
+static int g_num_threads = 1;
+static int g_duration = 5000;
+static float g_deadline = 0.f;
+
+static void show_usage()
+{
+    fprintf(stderr, "Usage: benchserve [model] [num threads] [duration ms] [deadline ms]\n");
+}
+
+static int load_net(ncnn::Net& net)
+{
+    net.opt.num_threads = g_num_threads;
+
+    char parampath[256];
+    sprintf(parampath, "%s.param", g_model);
+    int ret = net.load_param(parampath);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+static void make_inputs(const ncnn::Net& net, std::vector<ncnn::Mat>& inputs)
+{
+    const std::vector<int>& input_indexes = net.input_indexes();
+
+    inputs.resize(input_indexes.size());
+    for (size_t i = 0; i < input_indexes.size(); i++)
+    {
+        // the shape hint in param, or a common image size
+        const ncnn::Mat& shape = net.blobs()[input_indexes[i]].shape;
+        if (shape.dims == 3)
+            inputs[i].create(shape.w, shape.h, shape.c);
+        else
+            inputs[i].create(224, 224, 3);
+
+        inputs[i].fill(0.01f);
+    }
+}
+
+// single request latency without queueing
+static double measure_service_time(const std::vector<ncnn::Mat>& inputs)
+{
+    ncnn::Net net;
+    load_net(net);
+
+    const std::vector<int>& input_indexes = net.input_indexes();
+    const std::vector<int>& output_indexes = net.output_indexes();
+
+    double time_min = DBL_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        ncnn::Extractor ex = net.create_extractor();
+        for (size_t j = 0; j < input_indexes.size(); j++)
+        {
+            ex.input(input_indexes[j], inputs[j]);
+        }
+        for (size_t j = 0; j < output_indexes.size(); j++)
+        {
+            ncnn::Mat out;
+            ex.extract(output_indexes[j], out);
+        }
+
+        double end = ncnn::get_current_time();
+
+        // the first runs warm up
+        if (i >= 2)
+            time_min = std::min(time_min, end - start);
+    }
+
+    return time_min;
+}
+
+struct request_slot
+{
+    double submit_time;
+    double latency;
+};
+
+static void on_done(ncnn::AsyncRequest* /*request*/, void* userdata)
+{
+    request_slot* slot = (request_slot*)userdata;
+    slot->latency = ncnn::get_current_time() - slot->submit_time;
+}
+
+// open loop arrivals at a fixed rate, the generator never waits for results
+static void bench_serve(const char* comment, const std::vector<ncnn::Mat>& inputs, double interval, int max_batch_size, float batch_window)
+{
+    ncnn::Net net;
+    net.set_async_batching(max_batch_size, batch_window);
+    load_net(net);
+
+    const int request_count = std::max((int)(g_duration / interval), 1);
+
+    ncnn::AsyncRequest* requests = new ncnn::AsyncRequest[request_count];
+    std::vector<request_slot> slots(request_count);
+
+    const double start = ncnn::get_current_time();
+
+    for (int i = 0; i < request_count; i++)
+    {
+        const double arrival = start + i * interval;
+        const double now = ncnn::get_current_time();
+        if (arrival - now >= 1.0)
+            ncnn::sleep((unsigned long long int)(arrival - now));
+
+        slots[i].submit_time = ncnn::get_current_time();
+        slots[i].latency = -1.0;
+        requests[i].set_deadline(g_deadline);
+        net.submit(inputs, requests[i], on_done, &slots[i]);
+    }
+
+    int drop_count = 0;
+    for (int i = 0; i < request_count; i++)
+    {
+        if (requests[i].wait() != 0)
+            drop_count++;
+    }
+
+    const double end = ncnn::get_current_time();
+
+    std::vector<double> latencies;
+    for (int i = 0; i < request_count; i++)
+    {
+        if (requests[i].outputs().empty())
+            continue;
+
+        latencies.push_back(slots[i].latency);
+    }
+
+    delete[] requests;
+
+    std::sort(latencies.begin(), latencies.end());
+
+    const int n = (int)latencies.size();
+    const double p50 = n ? latencies[n / 2] : 0.0;
+    const double p99 = n ? latencies[std::min(n * 99 / 100, n - 1)] : 0.0;
+    const double throughput = n * 1000.0 / (end - start);
+
+    fprintf(stderr, "%20s  offered = %8.2f/s  served = %8.2f/s  p50 = %8.2f ms  p99 = %8.2f ms  dropped = %d\n", comment, 1000.0 / interval, throughput, p50, p99, drop_count);
+}
+
+int main(int argc, char** argv)
+{
+    g_num_threads = ncnn::get_physical_big_cpu_count();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] == 'h')
+        {
+            show_usage();
+            return -1;
+        }
+
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            show_usage();
+            return -1;
+        }
+    }
+
+    if (argc >= 2)
+    {
+        g_model = argv[1];
+    }
+    if (argc >= 3)
+    {
+        g_num_threads = atoi(argv[2]);
+    }
+    if (argc >= 4)
+    {
+        g_duration = atoi(argv[3]);
+    }
+    if (argc >= 5)
+    {
+        g_deadline = (float)atof(argv[4]);
+    }
+
+    ncnn::Net net;
+    if (load_net(net) != 0)
+    {
+        fprintf(stderr, "load %s.param failed\n", g_model);
+        return -1;
+    }
+
+    std::vector<ncnn::Mat> inputs;
+    make_inputs(net, inputs);
+
+    const double service_time = measure_service_time(inputs);
+
+    fprintf(stderr, "model = %s\n", g_model);
+    fprintf(stderr, "num_threads = %d\n", g_num_threads);
+    fprintf(stderr, "duration = %d ms\n", g_duration);
+    fprintf(stderr, "deadline = %.2f ms\n", g_deadline);
+    fprintf(stderr, "service_time = %.2f ms\n", service_time);
+
+    // offered load relative to the unbatched capacity
+    const float loads[3] = {0.5f, 0.9f, 1.5f};
+
+    for (int i = 0; i < 3; i++)
+    {
+        const double interval = service_time / loads[i];
+
+        fprintf(stderr, "load = %.1f\n", loads[i]);
+
+        bench_serve("no batching", inputs, interval, 1, 0.f);
+
+        if (g_num_threads > 1)
+        {
+            bench_serve("batch window 0", inputs, interval, g_num_threads, 0.f);
+            bench_serve("batch window 1/2", inputs, interval, g_num_threads, (float)(service_time / 2));
+        }
+        else
+        {
+            bench_serve("batch window 1/2", inputs, interval, 4, (float)(service_time / 2));
+        }
+    }
+
+    return 0;
+}
@@ -220,31 +220,19 @@ static int detect_yolov7(const cv::Mat& bgr, std::vector<Object>& objects)
     int img_h = bgr.rows;
 
     // letterbox pad to multiple of MAX_STRIDE
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h)
-    {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
-    }
-    else
-    {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
-    }
+    // resize, pad and normalize in one pass
+    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
 
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, img_w, img_h, w, h);
+    ncnn::PixelPreprocessOption ppopt;
+    ppopt.set_letterbox(img_w, img_h, target_size, MAX_STRIDE);
+    ppopt.pad_value = 114.f;
+    ppopt.norm_vals = norm_vals;
 
-    int wpad = (w + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - w;
-    int hpad = (h + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
+    ncnn::Mat in_pad = ncnn::Mat::from_pixels_preprocess(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, img_w, img_h, img_w * 3, ppopt);
 
-    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-    in_pad.substract_mean_normalize(0, norm_vals);
+    const float scale = img_w > img_h ? (float)target_size / img_w : (float)target_size / img_h;
+    const int wpad = ppopt.pad_left + ppopt.pad_right;
+    const int hpad = ppopt.pad_top + ppopt.pad_bottom;
 
     ncnn::Extractor ex = yolov7.create_extractor();
 
@@ -178,6 +178,10 @@ static ncnn::CpuSet g_cpu_affinity_mask_all;
 static ncnn::CpuSet g_cpu_affinity_mask_little;
 static ncnn::CpuSet g_cpu_affinity_mask_big;
 
+// numa info, the kernel node id of each node
+static std::vector<ncnn::CpuSet> g_numa_node_affinity_masks;
+static std::vector<int> g_numa_node_ids;
+
 // isa info
 #if defined _WIN32
 #if __aarch64__
@@ -227,6 +231,7 @@ static int g_cpu_support_x86_avx512;
 static int g_cpu_support_x86_avx512_vnni;
 static int g_cpu_support_x86_avx512_bf16;
 static int g_cpu_support_x86_avx512_fp16;
+static int g_cpu_support_x86_hybrid;
 #endif // defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
 
 #if defined __ANDROID__ || defined __linux__
@@ -856,6 +861,19 @@ static int get_cpu_support_x86_avx512_fp16()
     return cpu_info[3] & (1u << 23);
 #endif
 }
+
+static int get_cpu_support_x86_hybrid()
+{
+    unsigned int cpu_info[4] = {0};
+    x86_cpuid(0, cpu_info);
+
+    int nIds = cpu_info[0];
+    if (nIds < 7)
+        return 0;
+
+    x86_cpuid_sublevel(7, 0, cpu_info);
+    return cpu_info[3] & (1u << 15);
+}
 #endif // defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
 
 static int get_cpucount()
@@ -1561,6 +1579,76 @@ static int set_sched_affinity(const ncnn::CpuSet& thread_affinity_mask)
 
     return 0;
 }
+
+#if defined(__i386__) || defined(__x86_64__)
+// core type of every cpu from cpuid leaf 0x1a on intel hybrid parts
+// 0x20 = atom(e-core), 0x40 = core(p-core), 0 = unknown
+// cpuid describes the core it runs on, so the probe thread visits every cpu it may run on
+static void* probe_x86_hybrid_core_types(void* args)
+{
+    std::vector<int>& core_types = *(std::vector<int>*)args;
+
+#if defined(__BIONIC__) && !defined(__OHOS__)
+    pid_t pid = gettid();
+#else
+    pid_t pid = syscall(SYS_gettid);
+#endif
+
+    // the probe thread inherits the affinity of its creator
+    ncnn::CpuSet old_mask;
+    if (syscall(__NR_sched_getaffinity, pid, sizeof(cpu_set_t), &old_mask.cpu_set) < 0)
+        return 0;
+
+    for (int i = 0; i < g_cpucount; i++)
+    {
+        if (!old_mask.is_enabled(i))
+            continue;
+
+        ncnn::CpuSet mask;
+        mask.disable_all();
+        mask.enable(i);
+        if (syscall(__NR_sched_setaffinity, pid, sizeof(cpu_set_t), &mask.cpu_set) != 0)
+            continue;
+
+        unsigned int cpu_info[4] = {0};
+        x86_cpuid_sublevel(0x1a, 0, cpu_info);
+        core_types[i] = (cpu_info[0] >> 24) & 0xff;
+    }
+
+    return 0;
+}
+
+// return 0 if the cpu is hybrid
+// cpus the probe could not run on keep type 0
+static int get_x86_hybrid_core_types(std::vector<int>& core_types)
+{
+#if NCNN_THREADS
+    unsigned int cpu_info[4] = {0};
+    x86_cpuid(0, cpu_info);
+
+    int nIds = cpu_info[0];
+    if (nIds < 0x1a)
+        return -1;
+
+    // check hybrid
+    x86_cpuid_sublevel(7, 0, cpu_info);
+    if (!(cpu_info[3] & (1u << 15)))
+        return -1;
+
+    core_types.resize(g_cpucount, 0);
+
+    // migrate a short-lived helper thread across the cpus instead of the caller
+    ncnn::Thread probe(probe_x86_hybrid_core_types, &core_types);
+    probe.join();
+
+    return 0;
+#else
+    // no helper thread to migrate, leave it to the max freq heuristic
+    (void)core_types;
+    return -1;
+#endif // NCNN_THREADS
+}
+#endif // defined(__i386__) || defined(__x86_64__)
 #endif // defined __ANDROID__ || defined __linux__
 
 #if __APPLE__
@@ -1749,6 +1837,13 @@ static void initialize_cpu_thread_affinity_mask(ncnn::CpuSet& mask_all, ncnn::Cp
         }
     }
 #elif defined __ANDROID__ || defined __linux__
+#if defined(__i386__) || defined(__x86_64__)
+    // p-core and e-core are told by cpuid rather than max freq, the turbo of e-core overlaps p-core
+    std::vector<int> core_types;
+    if (get_x86_hybrid_core_types(core_types) != 0)
+        core_types.clear();
+#endif // defined(__i386__) || defined(__x86_64__)
+
     int max_freq_khz_min = INT_MAX;
     int max_freq_khz_max = 0;
     std::vector<int> cpu_max_freq_khz(g_cpucount);
@@ -1767,15 +1862,27 @@ static void initialize_cpu_thread_affinity_mask(ncnn::CpuSet& mask_all, ncnn::Cp
     }
 
     int max_freq_khz_medium = (max_freq_khz_min + max_freq_khz_max) / 2;
-    if (max_freq_khz_medium == max_freq_khz_max)
-    {
-        mask_little.disable_all();
-        mask_big = mask_all;
-        return;
-    }
 
     for (int i = 0; i < g_cpucount; i++)
     {
+#if defined(__i386__) || defined(__x86_64__)
+        // cpus the probe could not run on fall back to max freq
+        if (!core_types.empty() && core_types[i] != 0)
+        {
+            if (core_types[i] == 0x20)
+                mask_little.enable(i);
+            else
+                mask_big.enable(i);
+            continue;
+        }
+#endif // defined(__i386__) || defined(__x86_64__)
+
+        if (max_freq_khz_medium == max_freq_khz_max)
+        {
+            mask_big.enable(i);
+            continue;
+        }
+
         if (is_smt_cpu(i))
         {
             // always treat smt core as big core
@@ -2132,6 +2239,101 @@ static int detect_cpu_is_arm_a53_a55()
 #endif // defined __ANDROID__ || defined __linux__
 
 // the initialization
+#if defined __ANDROID__ || defined __linux__
+// parse a sysfs list like 0-3,8-11
+static int read_sysfs_list(const char* path, std::vector<int>& list)
+{
+    list.clear();
+
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+
+    char line[4096];
+    char* s = fgets(line, sizeof(line), fp);
+    fclose(fp);
+    if (!s)
+        return -1;
+
+    const char* p = line;
+    while (*p)
+    {
+        char* end = 0;
+        long a = strtol(p, &end, 10);
+        if (end == p)
+            break;
+
+        long b = a;
+        p = end;
+        if (*p == '-')
+        {
+            b = strtol(p + 1, &end, 10);
+            p = end;
+        }
+
+        for (long i = a; i <= b; i++)
+        {
+            list.push_back((int)i);
+        }
+
+        if (*p != ',')
+            break;
+
+        p++;
+    }
+
+    return 0;
+}
+#endif // defined __ANDROID__ || defined __linux__
+
+static void initialize_numa_topology(const char* sysfs_node_root)
+{
+    g_numa_node_affinity_masks.clear();
+    g_numa_node_ids.clear();
+
+#if defined __ANDROID__ || defined __linux__
+    if (!sysfs_node_root)
+        sysfs_node_root = "/sys/devices/system/node";
+
+    char path[1024];
+    sprintf(path, "%.960s/online", sysfs_node_root);
+
+    std::vector<int> node_ids;
+    read_sysfs_list(path, node_ids);
+
+    for (size_t i = 0; i < node_ids.size(); i++)
+    {
+        sprintf(path, "%.960s/node%d/cpulist", sysfs_node_root, node_ids[i]);
+
+        std::vector<int> cpus;
+        read_sysfs_list(path, cpus);
+
+        ncnn::CpuSet mask;
+        for (size_t j = 0; j < cpus.size(); j++)
+        {
+            if (cpus[j] < CPU_SETSIZE)
+                mask.enable(cpus[j]);
+        }
+
+        // memory only node
+        if (mask.num_enabled() == 0)
+            continue;
+
+        g_numa_node_affinity_masks.push_back(mask);
+        g_numa_node_ids.push_back(node_ids[i]);
+    }
+#else
+    (void)sysfs_node_root;
+#endif
+
+    if (g_numa_node_ids.empty())
+    {
+        // no numa, one node with all cpus
+        g_numa_node_affinity_masks.push_back(g_cpu_affinity_mask_all);
+        g_numa_node_ids.push_back(0);
+    }
+}
+
 static void initialize_global_cpu_info()
 {
 #if defined(_OPENMP) && (__clang__ || defined(_OPENMP_LLVM_RUNTIME))
@@ -2224,6 +2426,7 @@ static void initialize_global_cpu_info()
     g_cpu_support_x86_avx512_vnni = get_cpu_support_x86_avx512_vnni();
     g_cpu_support_x86_avx512_bf16 = get_cpu_support_x86_avx512_bf16();
     g_cpu_support_x86_avx512_fp16 = get_cpu_support_x86_avx512_fp16();
+    g_cpu_support_x86_hybrid = get_cpu_support_x86_hybrid();
 #endif // defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
 
 #if defined __ANDROID__ || defined __linux__
@@ -2242,6 +2445,8 @@ static void initialize_global_cpu_info()
     g_cpu_is_arm_a53_a55 = detect_cpu_is_arm_a53_a55();
 #endif // __aarch64__
 #endif // defined __ANDROID__ || defined __linux__
+
+    initialize_numa_topology(0);
 }
 
 static int g_cpu_info_initialized = 0;
@@ -2782,6 +2987,16 @@ int cpu_support_x86_avx512_fp16()
 #endif
 }
 
+int cpu_support_x86_hybrid()
+{
+    try_initialize_global_cpu_info();
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    return g_cpu_support_x86_hybrid;
+#else
+    return 0;
+#endif
+}
+
 int cpu_support_mips_msa()
 {
     try_initialize_global_cpu_info();
@@ -3155,6 +3370,215 @@ int is_current_thread_running_on_a53_a55()
 #endif // defined __ANDROID__ || defined __linux__
 }
 
+int get_numa_node_count()
+{
+    try_initialize_global_cpu_info();
+    return (int)g_numa_node_ids.size();
+}
+
+const CpuSet& get_numa_node_affinity_mask(int node)
+{
+    try_initialize_global_cpu_info();
+    if (node < 0 || node >= (int)g_numa_node_ids.size())
+    {
+        NCNN_LOGE("numa node %d not available", node);
+
+        // fallback to all cores anyway
+        return g_cpu_affinity_mask_all;
+    }
+
+    return g_numa_node_affinity_masks[node];
+}
+
+int get_cpu_numa_node(int cpu)
+{
+    try_initialize_global_cpu_info();
+    for (size_t i = 0; i < g_numa_node_ids.size(); i++)
+    {
+        if (g_numa_node_affinity_masks[i].is_enabled(cpu))
+            return (int)i;
+    }
+
+    return -1;
+}
+
+int reload_numa_topology(const char* sysfs_node_root)
+{
+    try_initialize_global_cpu_info();
+    initialize_numa_topology(sysfs_node_root);
+    return 0;
+}
+
+#if (defined __ANDROID__ || defined __linux__) && defined(__NR_set_mempolicy)
+static int set_sched_mempolicy(int mode, const unsigned long* nodemask, unsigned long maxnode)
+{
+    int syscallret = syscall(__NR_set_mempolicy, mode, nodemask, maxnode);
+    if (syscallret)
+    {
+        NCNN_LOGE("syscall error %d", syscallret);
+        return -1;
+    }
+
+    return 0;
+}
+
+#if defined(__NR_get_mempolicy)
+// the policy a thread had before push_numa_memory_policy
+struct saved_mempolicy
+{
+    int mode;
+    unsigned long nodemask[1024 / (sizeof(unsigned long) * 8)];
+};
+
+static ncnn::ThreadLocalStorage tls_saved_mempolicy;
+
+static int save_sched_mempolicy()
+{
+    saved_mempolicy* saved = new saved_mempolicy;
+    memset(saved, 0, sizeof(saved_mempolicy));
+
+    int syscallret = syscall(__NR_get_mempolicy, &saved->mode, saved->nodemask, 1024, 0, 0);
+    if (syscallret)
+    {
+        NCNN_LOGE("syscall error %d", syscallret);
+        delete saved;
+        return -1;
+    }
+
+    delete (saved_mempolicy*)tls_saved_mempolicy.get();
+    tls_saved_mempolicy.set(saved);
+    return 0;
+}
+
+static int restore_sched_mempolicy()
+{
+    saved_mempolicy* saved = (saved_mempolicy*)tls_saved_mempolicy.get();
+    if (!saved)
+    {
+        // nothing saved on this thread
+        return set_sched_mempolicy(0, 0, 0);
+    }
+
+    tls_saved_mempolicy.set(0);
+
+    // the mode carries its MPOL_F_* flags, the default policy takes no nodemask
+    int ret = saved->mode == 0 ? set_sched_mempolicy(0, 0, 0) : set_sched_mempolicy(saved->mode, saved->nodemask, 1024);
+    delete saved;
+    return ret;
+}
+#endif // defined(__NR_get_mempolicy)
+#endif
+
+static int set_numa_memory_policy_team(int node, bool save)
+{
+    try_initialize_global_cpu_info();
+    if (node < -2 || node >= (int)g_numa_node_ids.size())
+    {
+        NCNN_LOGE("numa node %d not available", node);
+        return -1;
+    }
+
+#if (defined __ANDROID__ || defined __linux__) && defined(__NR_set_mempolicy)
+    // MPOL_DEFAULT = 0  MPOL_PREFERRED = 1  MPOL_INTERLEAVE = 3
+    int mode = 0;
+    unsigned long nodemask[1024 / (sizeof(unsigned long) * 8)] = {0};
+    const int bits = sizeof(unsigned long) * 8;
+
+    if (node >= 0)
+    {
+        const int id = g_numa_node_ids[node];
+        nodemask[id / bits] |= 1ul << (id % bits);
+        mode = 1;
+    }
+    if (node == -2)
+    {
+        for (size_t i = 0; i < g_numa_node_ids.size(); i++)
+        {
+            const int id = g_numa_node_ids[i];
+            nodemask[id / bits] |= 1ul << (id % bits);
+        }
+        mode = 3;
+    }
+
+    const unsigned long maxnode = mode == 0 ? 0 : 1024;
+
+#if defined(_OPENMP) && !NCNN_SIMPLEOMP
+    // the policy is per thread, apply it to each thread of the team like set_cpu_thread_affinity
+    int num_threads = omp_get_max_threads();
+    std::vector<int> smprets(num_threads, 0);
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+#if defined(__NR_get_mempolicy)
+        if (save && save_sched_mempolicy() != 0)
+        {
+            smprets[i] = -1;
+            continue;
+        }
+#endif
+        smprets[i] = set_sched_mempolicy(mode, mode == 0 ? 0 : nodemask, maxnode);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        if (smprets[i] != 0)
+            return -1;
+    }
+
+    return 0;
+#else
+#if defined(__NR_get_mempolicy)
+    if (save && save_sched_mempolicy() != 0)
+        return -1;
+#endif
+    return set_sched_mempolicy(mode, mode == 0 ? 0 : nodemask, maxnode);
+#endif
+#else
+    // single node
+    (void)save;
+    return 0;
+#endif
+}
+
+int set_numa_memory_policy(int node)
+{
+    return set_numa_memory_policy_team(node, false);
+}
+
+int push_numa_memory_policy(int node)
+{
+    return set_numa_memory_policy_team(node, true);
+}
+
+int pop_numa_memory_policy()
+{
+#if (defined __ANDROID__ || defined __linux__) && defined(__NR_set_mempolicy) && defined(__NR_get_mempolicy)
+#if defined(_OPENMP) && !NCNN_SIMPLEOMP
+    int num_threads = omp_get_max_threads();
+    std::vector<int> smprets(num_threads, 0);
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+        smprets[i] = restore_sched_mempolicy();
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        if (smprets[i] != 0)
+            return -1;
+    }
+
+    return 0;
+#else
+    return restore_sched_mempolicy();
+#endif
+#elif (defined __ANDROID__ || defined __linux__) && defined(__NR_set_mempolicy)
+    // no way to read the old policy, fall back to the default
+    return set_numa_memory_policy(-1);
+#else
+    // single node
+    return 0;
+#endif
+}
+
 int get_omp_num_threads()
 {
 #ifdef _OPENMP
@@ -3202,7 +3626,7 @@ int get_omp_thread_num()
 
 int get_kmp_blocktime()
 {
-#if defined(_OPENMP) && (__clang__ || defined(_OPENMP_LLVM_RUNTIME))
+#if defined(_OPENMP) && (__clang__ || defined(_OPENMP_LLVM_RUNTIME) || NCNN_SIMPLEOMP)
     return kmp_get_blocktime();
 #else
     return 0;
@@ -3211,7 +3635,7 @@ int get_kmp_blocktime()
 
 void set_kmp_blocktime(int time_ms)
 {
-#if defined(_OPENMP) && (__clang__ || defined(_OPENMP_LLVM_RUNTIME))
+#if defined(_OPENMP) && (__clang__ || defined(_OPENMP_LLVM_RUNTIME) || NCNN_SIMPLEOMP)
     kmp_set_blocktime(time_ms);
 #else
     (void)time_ms;
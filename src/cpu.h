@@ -96,6 +96,8 @@ NCNN_EXPORT int cpu_support_x86_avx512_vnni();
 NCNN_EXPORT int cpu_support_x86_avx512_bf16();
 // avx512_fp16 = x86 avx512 fp16
 NCNN_EXPORT int cpu_support_x86_avx512_fp16();
+// hybrid = x86 hybrid with p-core and e-core
+NCNN_EXPORT int cpu_support_x86_hybrid();
 
 // lsx = loongarch lsx
 NCNN_EXPORT int cpu_support_loongarch_lsx();
@@ -132,7 +134,7 @@ NCNN_EXPORT int get_cpu_level2_cache_size();
 NCNN_EXPORT int get_cpu_level3_cache_size();
 
 // bind all threads on little clusters if powersave enabled
-// affects HMP arch cpu like ARM big.LITTLE
+// affects HMP arch cpu like ARM big.LITTLE and x86 hybrid, where e-cores are the little ones
 // only implemented on android at the moment
 // switching powersave is expensive and not thread-safe
 // 0 = all cores enabled(default)
@@ -151,6 +153,25 @@ NCNN_EXPORT int set_cpu_thread_affinity(const CpuSet& thread_affinity_mask);
 // runtime thread affinity info
 NCNN_EXPORT int is_current_thread_running_on_a53_a55();
 
+// numa topology from /sys/devices/system/node, nodes without cpu are skipped
+// one node with all cpus on non-numa system
+NCNN_EXPORT int get_numa_node_count();
+// cpus of node 0 ~ get_numa_node_count()-1
+NCNN_EXPORT const CpuSet& get_numa_node_affinity_mask(int node);
+// the node of cpu, -1 for unknown cpu
+NCNN_EXPORT int get_cpu_numa_node(int cpu);
+// rescan the topology from another sysfs node directory, null for the system one
+// the directory holds online and node*/cpulist, a fake one emulates other machines
+NCNN_EXPORT int reload_numa_topology(const char* sysfs_node_root = 0);
+
+// where memory first touched by the calling thread and its openmp team is placed
+// node >= 0 prefers that node, -1 restores the default local placement, -2 interleaves across all nodes
+NCNN_EXPORT int set_numa_memory_policy(int node);
+// set_numa_memory_policy that keeps the policy every thread had before
+// pop_numa_memory_policy puts it back on the calling thread and its openmp team
+NCNN_EXPORT int push_numa_memory_policy(int node);
+NCNN_EXPORT int pop_numa_memory_policy();
+
 // misc function wrapper for openmp routines
 NCNN_EXPORT int get_omp_num_threads();
 NCNN_EXPORT void set_omp_num_threads(int num_threads);
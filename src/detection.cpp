@@ -0,0 +1,425 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "detection.h"
+
+#include <float.h>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+#endif // __SSE2__
+
+namespace ncnn {
+
+int threshold_scores(const float* scores, int n, int stride, float threshold, std::vector<int>& indexes)
+{
+    indexes.clear();
+
+    int i = 0;
+    if (stride == 1)
+    {
+        // most scores fall below threshold, test a whole vector before looking at lanes
+#if __AVX512F__
+        __m512 _threshold_avx512 = _mm512_set1_ps(threshold);
+        for (; i + 15 < n; i += 16)
+        {
+            int mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(scores + i), _threshold_avx512, _CMP_GT_OQ);
+            for (int k = 0; mask; k++, mask >>= 1)
+            {
+                if (mask & 1)
+                    indexes.push_back(i + k);
+            }
+        }
+#endif // __AVX512F__
+#if __AVX__
+        __m256 _threshold_avx = _mm256_set1_ps(threshold);
+        for (; i + 7 < n; i += 8)
+        {
+            int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + i), _threshold_avx, _CMP_GT_OQ));
+            for (int k = 0; mask; k++, mask >>= 1)
+            {
+                if (mask & 1)
+                    indexes.push_back(i + k);
+            }
+        }
+#endif // __AVX__
+#if __SSE2__
+        __m128 _threshold = _mm_set1_ps(threshold);
+        for (; i + 3 < n; i += 4)
+        {
+            int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), _threshold));
+            for (int k = 0; mask; k++, mask >>= 1)
+            {
+                if (mask & 1)
+                    indexes.push_back(i + k);
+            }
+        }
+#endif // __SSE2__
+#if __ARM_NEON
+        float32x4_t _threshold = vdupq_n_f32(threshold);
+        for (; i + 3 < n; i += 4)
+        {
+            uint32x4_t _mask = vcgtq_f32(vld1q_f32(scores + i), _threshold);
+            uint32x2_t _mask2 = vorr_u32(vget_low_u32(_mask), vget_high_u32(_mask));
+            if (vget_lane_u32(vpmax_u32(_mask2, _mask2), 0) == 0)
+                continue;
+
+            for (int k = 0; k < 4; k++)
+            {
+                if (scores[i + k] > threshold)
+                    indexes.push_back(i + k);
+            }
+        }
+#endif // __ARM_NEON
+    }
+    for (; i < n; i++)
+    {
+        if (scores[(size_t)i * stride] > threshold)
+            indexes.push_back(i);
+    }
+
+    return (int)indexes.size();
+}
+
+void argmax_scores(const float* scores, int num_class, size_t cstep, int n, int* labels, float* max_scores)
+{
+    // classes are planar, so compare a vector of positions against the running max
+    int j = 0;
+#if __AVX512F__
+    for (; j + 15 < n; j += 16)
+    {
+        __m512 _max = _mm512_set1_ps(-FLT_MAX);
+        __m512 _label = _mm512_setzero_ps();
+        for (int q = 0; q < num_class; q++)
+        {
+            __m512 _p = _mm512_loadu_ps(scores + q * cstep + j);
+            __mmask16 _mask = _mm512_cmp_ps_mask(_p, _max, _CMP_GT_OQ);
+            _max = _mm512_mask_blend_ps(_mask, _max, _p);
+            _label = _mm512_mask_blend_ps(_mask, _label, _mm512_set1_ps((float)q));
+        }
+        _mm512_storeu_si512((__m512i*)(labels + j), _mm512_cvttps_epi32(_label));
+        _mm512_storeu_ps(max_scores + j, _max);
+    }
+#endif // __AVX512F__
+#if __AVX__
+    for (; j + 7 < n; j += 8)
+    {
+        __m256 _max = _mm256_set1_ps(-FLT_MAX);
+        __m256 _label = _mm256_setzero_ps();
+        for (int q = 0; q < num_class; q++)
+        {
+            __m256 _p = _mm256_loadu_ps(scores + q * cstep + j);
+            __m256 _mask = _mm256_cmp_ps(_p, _max, _CMP_GT_OQ);
+            _max = _mm256_blendv_ps(_max, _p, _mask);
+            _label = _mm256_blendv_ps(_label, _mm256_set1_ps((float)q), _mask);
+        }
+        _mm256_storeu_si256((__m256i*)(labels + j), _mm256_cvttps_epi32(_label));
+        _mm256_storeu_ps(max_scores + j, _max);
+    }
+#endif // __AVX__
+#if __SSE2__
+    for (; j + 3 < n; j += 4)
+    {
+        __m128 _max = _mm_set1_ps(-FLT_MAX);
+        __m128 _label = _mm_setzero_ps();
+        for (int q = 0; q < num_class; q++)
+        {
+            __m128 _p = _mm_loadu_ps(scores + q * cstep + j);
+            __m128 _mask = _mm_cmpgt_ps(_p, _max);
+            _max = _mm_or_ps(_mm_and_ps(_mask, _p), _mm_andnot_ps(_mask, _max));
+            _label = _mm_or_ps(_mm_and_ps(_mask, _mm_set1_ps((float)q)), _mm_andnot_ps(_mask, _label));
+        }
+        _mm_storeu_si128((__m128i*)(labels + j), _mm_cvttps_epi32(_label));
+        _mm_storeu_ps(max_scores + j, _max);
+    }
+#endif // __SSE2__
+#if __ARM_NEON
+    for (; j + 3 < n; j += 4)
+    {
+        float32x4_t _max = vdupq_n_f32(-FLT_MAX);
+        uint32x4_t _label = vdupq_n_u32(0);
+        for (int q = 0; q < num_class; q++)
+        {
+            float32x4_t _p = vld1q_f32(scores + q * cstep + j);
+            uint32x4_t _mask = vcgtq_f32(_p, _max);
+            _max = vbslq_f32(_mask, _p, _max);
+            _label = vbslq_u32(_mask, vdupq_n_u32(q), _label);
+        }
+        vst1q_s32(labels + j, vreinterpretq_s32_u32(_label));
+        vst1q_f32(max_scores + j, _max);
+    }
+#endif // __ARM_NEON
+    for (; j < n; j++)
+    {
+        int label = 0;
+        float max_score = -FLT_MAX;
+        for (int q = 0; q < num_class; q++)
+        {
+            const float score = scores[q * cstep + j];
+            if (score > max_score)
+            {
+                label = q;
+                max_score = score;
+            }
+        }
+
+        labels[j] = label;
+        max_scores[j] = max_score;
+    }
+}
+
+void decode_center_size(const float* locations, const float* priors, const float* variances, int variance_step, int n, float* boxes)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const float* loc = locations + i * 4;
+        const float* pb = priors + i * 4;
+        const float* var = variances + i * variance_step;
+        float* bbox = boxes + i * 4;
+
+        float pb_w = pb[2] - pb[0];
+        float pb_h = pb[3] - pb[1];
+        float pb_cx = (pb[0] + pb[2]) * 0.5f;
+        float pb_cy = (pb[1] + pb[3]) * 0.5f;
+
+        float bbox_cx = var[0] * loc[0] * pb_w + pb_cx;
+        float bbox_cy = var[1] * loc[1] * pb_h + pb_cy;
+        float bbox_w = expf(var[2] * loc[2]) * pb_w;
+        float bbox_h = expf(var[3] * loc[3]) * pb_h;
+
+        bbox[0] = bbox_cx - bbox_w * 0.5f;
+        bbox[1] = bbox_cy - bbox_h * 0.5f;
+        bbox[2] = bbox_cx + bbox_w * 0.5f;
+        bbox[3] = bbox_cy + bbox_h * 0.5f;
+    }
+}
+
+// only the partitions overlapping [0, k) are sorted
+static void qsort_descent_inplace(std::vector<Detection>& objects, int left, int right, int k)
+{
+    if (left >= k)
+        return;
+
+    int i = left;
+    int j = right;
+    float p = objects[(left + right) / 2].score;
+
+    while (i <= j)
+    {
+        while (objects[i].score > p)
+            i++;
+
+        while (objects[j].score < p)
+            j--;
+
+        if (i <= j)
+        {
+            // swap
+            std::swap(objects[i], objects[j]);
+
+            i++;
+            j--;
+        }
+    }
+
+    if (left < j)
+        qsort_descent_inplace(objects, left, j, k);
+
+    if (i < right)
+        qsort_descent_inplace(objects, i, right, k);
+}
+
+void sort_detections(std::vector<Detection>& objects)
+{
+    if (objects.empty())
+        return;
+
+    qsort_descent_inplace(objects, 0, (int)objects.size() - 1, (int)objects.size());
+}
+
+void topk_detections(std::vector<Detection>& objects, int k)
+{
+    if (objects.empty())
+        return;
+
+    if (k < 0 || k > (int)objects.size())
+        k = (int)objects.size();
+
+    qsort_descent_inplace(objects, 0, (int)objects.size() - 1, k);
+
+    objects.resize(k);
+}
+
+void nms_sorted_detections(const std::vector<Detection>& objects, std::vector<int>& picked, float iou_threshold, int class_agnostic, int max_picked)
+{
+    picked.clear();
+
+    const int n = (int)objects.size();
+
+    // picked boxes in planar layout so that one candidate is tested against a tile of them at once
+    std::vector<float> px0(n);
+    std::vector<float> py0(n);
+    std::vector<float> px1(n);
+    std::vector<float> py1(n);
+    std::vector<float> pareas(n);
+    std::vector<float> plabels(n);
+    int np = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (max_picked > 0 && np == max_picked)
+            break;
+
+        const Detection& a = objects[i];
+        const float area = (a.xmax - a.xmin) * (a.ymax - a.ymin);
+        const float label = (float)a.label;
+
+        int keep = 1;
+        int j = 0;
+#if __AVX512F__
+        {
+            __m512 _ax0 = _mm512_set1_ps(a.xmin);
+            __m512 _ay0 = _mm512_set1_ps(a.ymin);
+            __m512 _ax1 = _mm512_set1_ps(a.xmax);
+            __m512 _ay1 = _mm512_set1_ps(a.ymax);
+            __m512 _area = _mm512_set1_ps(area);
+            __m512 _label = _mm512_set1_ps(label);
+            __m512 _threshold = _mm512_set1_ps(iou_threshold);
+            __m512 _zero = _mm512_setzero_ps();
+            for (; j + 15 < np; j += 16)
+            {
+                __m512 _w = _mm512_max_ps(_mm512_sub_ps(_mm512_min_ps(_ax1, _mm512_loadu_ps(&px1[j])), _mm512_max_ps(_ax0, _mm512_loadu_ps(&px0[j]))), _zero);
+                __m512 _h = _mm512_max_ps(_mm512_sub_ps(_mm512_min_ps(_ay1, _mm512_loadu_ps(&py1[j])), _mm512_max_ps(_ay0, _mm512_loadu_ps(&py0[j]))), _zero);
+                __m512 _inter = _mm512_mul_ps(_w, _h);
+                __m512 _union = _mm512_sub_ps(_mm512_add_ps(_area, _mm512_loadu_ps(&pareas[j])), _inter);
+                __mmask16 _mask = _mm512_cmp_ps_mask(_inter, _mm512_mul_ps(_threshold, _union), _CMP_GT_OQ);
+                if (!class_agnostic)
+                    _mask = _mm512_mask_cmp_ps_mask(_mask, _label, _mm512_loadu_ps(&plabels[j]), _CMP_EQ_OQ);
+                if (_mask)
+                {
+                    keep = 0;
+                    break;
+                }
+            }
+        }
+#endif // __AVX512F__
+#if __AVX__
+        if (keep)
+        {
+            __m256 _ax0 = _mm256_set1_ps(a.xmin);
+            __m256 _ay0 = _mm256_set1_ps(a.ymin);
+            __m256 _ax1 = _mm256_set1_ps(a.xmax);
+            __m256 _ay1 = _mm256_set1_ps(a.ymax);
+            __m256 _area = _mm256_set1_ps(area);
+            __m256 _label = _mm256_set1_ps(label);
+            __m256 _threshold = _mm256_set1_ps(iou_threshold);
+            __m256 _zero = _mm256_setzero_ps();
+            for (; j + 7 < np; j += 8)
+            {
+                __m256 _w = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(_ax1, _mm256_loadu_ps(&px1[j])), _mm256_max_ps(_ax0, _mm256_loadu_ps(&px0[j]))), _zero);
+                __m256 _h = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(_ay1, _mm256_loadu_ps(&py1[j])), _mm256_max_ps(_ay0, _mm256_loadu_ps(&py0[j]))), _zero);
+                __m256 _inter = _mm256_mul_ps(_w, _h);
+                __m256 _union = _mm256_sub_ps(_mm256_add_ps(_area, _mm256_loadu_ps(&pareas[j])), _inter);
+                __m256 _mask = _mm256_cmp_ps(_inter, _mm256_mul_ps(_threshold, _union), _CMP_GT_OQ);
+                if (!class_agnostic)
+                    _mask = _mm256_and_ps(_mask, _mm256_cmp_ps(_label, _mm256_loadu_ps(&plabels[j]), _CMP_EQ_OQ));
+                if (_mm256_movemask_ps(_mask))
+                {
+                    keep = 0;
+                    break;
+                }
+            }
+        }
+#endif // __AVX__
+#if __SSE2__
+        if (keep)
+        {
+            __m128 _ax0 = _mm_set1_ps(a.xmin);
+            __m128 _ay0 = _mm_set1_ps(a.ymin);
+            __m128 _ax1 = _mm_set1_ps(a.xmax);
+            __m128 _ay1 = _mm_set1_ps(a.ymax);
+            __m128 _area = _mm_set1_ps(area);
+            __m128 _label = _mm_set1_ps(label);
+            __m128 _threshold = _mm_set1_ps(iou_threshold);
+            __m128 _zero = _mm_setzero_ps();
+            for (; j + 3 < np; j += 4)
+            {
+                __m128 _w = _mm_max_ps(_mm_sub_ps(_mm_min_ps(_ax1, _mm_loadu_ps(&px1[j])), _mm_max_ps(_ax0, _mm_loadu_ps(&px0[j]))), _zero);
+                __m128 _h = _mm_max_ps(_mm_sub_ps(_mm_min_ps(_ay1, _mm_loadu_ps(&py1[j])), _mm_max_ps(_ay0, _mm_loadu_ps(&py0[j]))), _zero);
+                __m128 _inter = _mm_mul_ps(_w, _h);
+                __m128 _union = _mm_sub_ps(_mm_add_ps(_area, _mm_loadu_ps(&pareas[j])), _inter);
+                __m128 _mask = _mm_cmpgt_ps(_inter, _mm_mul_ps(_threshold, _union));
+                if (!class_agnostic)
+                    _mask = _mm_and_ps(_mask, _mm_cmpeq_ps(_label, _mm_loadu_ps(&plabels[j])));
+                if (_mm_movemask_ps(_mask))
+                {
+                    keep = 0;
+                    break;
+                }
+            }
+        }
+#endif // __SSE2__
+#if __ARM_NEON
+        {
+            float32x4_t _ax0 = vdupq_n_f32(a.xmin);
+            float32x4_t _ay0 = vdupq_n_f32(a.ymin);
+            float32x4_t _ax1 = vdupq_n_f32(a.xmax);
+            float32x4_t _ay1 = vdupq_n_f32(a.ymax);
+            float32x4_t _area = vdupq_n_f32(area);
+            float32x4_t _label = vdupq_n_f32(label);
+            float32x4_t _zero = vdupq_n_f32(0.f);
+            for (; j + 3 < np; j += 4)
+            {
+                float32x4_t _w = vmaxq_f32(vsubq_f32(vminq_f32(_ax1, vld1q_f32(&px1[j])), vmaxq_f32(_ax0, vld1q_f32(&px0[j]))), _zero);
+                float32x4_t _h = vmaxq_f32(vsubq_f32(vminq_f32(_ay1, vld1q_f32(&py1[j])), vmaxq_f32(_ay0, vld1q_f32(&py0[j]))), _zero);
+                float32x4_t _inter = vmulq_f32(_w, _h);
+                float32x4_t _union = vsubq_f32(vaddq_f32(_area, vld1q_f32(&pareas[j])), _inter);
+                uint32x4_t _mask = vcgtq_f32(_inter, vmulq_n_f32(_union, iou_threshold));
+                if (!class_agnostic)
+                    _mask = vandq_u32(_mask, vceqq_f32(_label, vld1q_f32(&plabels[j])));
+                uint32x2_t _mask2 = vorr_u32(vget_low_u32(_mask), vget_high_u32(_mask));
+                if (vget_lane_u32(vpmax_u32(_mask2, _mask2), 0))
+                {
+                    keep = 0;
+                    break;
+                }
+            }
+        }
+#endif // __ARM_NEON
+        for (; keep && j < np; j++)
+        {
+            if (!class_agnostic && plabels[j] != label)
+                continue;
+
+            // intersection over union
+            float inter_width = std::max(std::min(a.xmax, px1[j]) - std::max(a.xmin, px0[j]), 0.f);
+            float inter_height = std::max(std::min(a.ymax, py1[j]) - std::max(a.ymin, py0[j]), 0.f);
+            float inter_area = inter_width * inter_height;
+            float union_area = area + pareas[j] - inter_area;
+            // float IoU = inter_area / union_area
+            if (inter_area > iou_threshold * union_area)
+                keep = 0;
+        }
+
+        if (!keep)
+            continue;
+
+        px0[np] = a.xmin;
+        py0[np] = a.ymin;
+        px1[np] = a.xmax;
+        py1[np] = a.ymax;
+        pareas[np] = area;
+        plabels[np] = label;
+        np++;
+
+        picked.push_back(i);
+    }
+}
+
+} // namespace ncnn
@@ -0,0 +1,52 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NCNN_DETECTION_H
+#define NCNN_DETECTION_H
+
+#include <stddef.h>
+
+#include "platform.h"
+
+// post-processing helpers shared by the detection output layers and applications
+
+namespace ncnn {
+
+// one detected object
+struct Detection
+{
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+    float score;
+    int label;
+};
+
+// collect the indexes of scores greater than threshold, scores are read with stride
+// returns the number of collected indexes
+NCNN_EXPORT int threshold_scores(const float* scores, int n, int stride, float threshold, std::vector<int>& indexes);
+
+// find the max score and its class index on n positions, class q of position j lives at scores[q * cstep + j]
+// the first class wins on equal scores
+NCNN_EXPORT void argmax_scores(const float* scores, int num_class, size_t cstep, int n, int* labels, float* max_scores);
+
+// decode ssd style center-size offsets against corner form priors into corner form boxes
+// variance_step 0 applies the same four variances to all priors, 4 reads four variances per prior
+NCNN_EXPORT void decode_center_size(const float* locations, const float* priors, const float* variances, int variance_step, int n, float* boxes);
+
+// sort objects by score in descending order
+NCNN_EXPORT void sort_detections(std::vector<Detection>& objects);
+
+// keep the k highest scored objects sorted in descending order, cheaper than a full sort when k is small
+NCNN_EXPORT void topk_detections(std::vector<Detection>& objects, int k);
+
+// greedy non-maximum suppression on objects sorted by descending score
+// an object is dropped when its iou with any picked object is greater than iou_threshold
+// set class_agnostic 0 to only suppress objects of the same label, which runs nms on all classes in one batch
+// picked receives the indexes of kept objects, at most max_picked when max_picked is positive
+NCNN_EXPORT void nms_sorted_detections(const std::vector<Detection>& objects, std::vector<int>& picked, float iou_threshold, int class_agnostic = 1, int max_picked = 0);
+
+} // namespace ncnn
+
+#endif // NCNN_DETECTION_H
@@ -3,6 +3,9 @@
 
 #include "gru.h"
 
+#include "cpu.h"
+#include "spin_barrier.h"
+
 namespace ncnn {
 
 GRU::GRU()
@@ -59,110 +62,203 @@ int GRU::load_model(const ModelBin& mb)
     return 0;
 }
 
-static int gru(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
+// timestep t for the outputs [q0, q1)
+static void gru_step(const Mat& bottom_blob, Mat& top_blob, int reverse, int t, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& hidden_state, int q0, int q1)
 {
     int size = bottom_blob.w;
     int T = bottom_blob.h;
 
     int num_output = top_blob.w;
 
-    // 2 x num_output
-    Mat gates(2, num_output, 4u, opt.workspace_allocator);
-    if (gates.empty())
-        return -100;
+    int ti = reverse ? T - 1 - t : t;
 
-    // unroll
-    for (int t = 0; t < T; t++)
+    // h_{t-1} is the output of the previous timestep
+    const float* hidden_prev = t == 0 ? (const float*)hidden_state : (const float*)top_blob.row(reverse ? ti + 1 : ti - 1);
+
+    const float* x = bottom_blob.row(ti);
+    float* output_data = top_blob.row(ti);
+    for (int q = q0; q < q1; q++)
     {
-        int ti = reverse ? T - 1 - t : t;
+        // gate reset update
+        const float* bias_c_R = bias_c.row(0);
+        const float* bias_c_U = bias_c.row(1);
 
-        const float* x = bottom_blob.row(ti);
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q = 0; q < num_output; q++)
+        const float* weight_xc_R = weight_xc.row(num_output * 0 + q);
+        const float* weight_xc_U = weight_xc.row(num_output * 1 + q);
+        const float* weight_hc_R = weight_hc.row(num_output * 0 + q);
+        const float* weight_hc_U = weight_hc.row(num_output * 1 + q);
+
+        float R = bias_c_R[q];
+        float U = bias_c_U[q];
+
+        for (int i = 0; i < size; i++)
         {
-            float* gates_data = gates.row(q);
+            float xi = x[i];
 
-            // gate reset update
-            const float* bias_c_R = bias_c.row(0);
-            const float* bias_c_U = bias_c.row(1);
+            R += weight_xc_R[i] * xi;
+            U += weight_xc_U[i] * xi;
+        }
 
-            const float* weight_xc_R = weight_xc.row(num_output * 0 + q);
-            const float* weight_xc_U = weight_xc.row(num_output * 1 + q);
-            const float* weight_hc_R = weight_hc.row(num_output * 0 + q);
-            const float* weight_hc_U = weight_hc.row(num_output * 1 + q);
+        for (int i = 0; i < num_output; i++)
+        {
+            float h_cont = hidden_prev[i];
 
-            float R = bias_c_R[q];
-            float U = bias_c_U[q];
+            R += weight_hc_R[i] * h_cont;
+            U += weight_hc_U[i] * h_cont;
+        }
 
-            for (int i = 0; i < size; i++)
-            {
-                float xi = x[i];
+        // sigmoid(R)
+        // sigmoid(U)
+        R = 1.f / (1.f + expf(-R));
+        U = 1.f / (1.f + expf(-U));
 
-                R += weight_xc_R[i] * xi;
-                U += weight_xc_U[i] * xi;
-            }
+        // gate new
+        const float* bias_c_WN = bias_c.row(2);
+        const float* bias_c_BN = bias_c.row(3);
 
-            for (int i = 0; i < num_output; i++)
-            {
-                float h_cont = hidden_state[i];
+        const float* weight_xc_N = weight_xc.row(num_output * 2 + q);
+        const float* weight_hc_N = weight_hc.row(num_output * 2 + q);
 
-                R += weight_hc_R[i] * h_cont;
-                U += weight_hc_U[i] * h_cont;
-            }
+        float N = bias_c_BN[q];
 
-            // sigmoid(R)
-            // sigmoid(U)
-            R = 1.f / (1.f + expf(-R));
-            U = 1.f / (1.f + expf(-U));
+        for (int i = 0; i < num_output; i++)
+        {
+            float h_cont = hidden_prev[i];
 
-            // gate new
-            const float* bias_c_WN = bias_c.row(2);
-            const float* bias_c_BN = bias_c.row(3);
+            N += weight_hc_N[i] * h_cont;
+        }
 
-            const float* weight_xc_N = weight_xc.row(num_output * 2 + q);
-            const float* weight_hc_N = weight_hc.row(num_output * 2 + q);
+        N = bias_c_WN[q] + R * N;
 
-            float N = bias_c_BN[q];
+        for (int i = 0; i < size; i++)
+        {
+            float xi = x[i];
 
-            for (int i = 0; i < num_output; i++)
-            {
-                float h_cont = hidden_state[i];
+            N += weight_xc_N[i] * xi;
+        }
 
-                N += weight_hc_N[i] * h_cont;
-            }
+        // tanh(N)
+        N = tanhf(N);
 
-            N = bias_c_WN[q] + R * N;
+        // h_t := (1 - update) .* new + update .* h_{t-1}
+        float H = (1 - U) * N + U * hidden_prev[q];
 
-            for (int i = 0; i < size; i++)
-            {
-                float xi = x[i];
+        output_data[q] = H;
+    }
+}
 
-                N += weight_xc_N[i] * xi;
-            }
+// the hidden state of the last timestep for the outputs [q0, q1)
+static void gru_hidden_state(const Mat& top_blob, int reverse, Mat& hidden_state, int q0, int q1)
+{
+    int T = top_blob.h;
+    if (T == 0)
+        return;
 
-            // tanh(N)
-            N = tanhf(N);
+    const float* output_data = top_blob.row(reverse ? 0 : T - 1);
+    float* hidden_ptr = hidden_state;
 
-            gates_data[0] = U;
-            gates_data[1] = N;
-        }
+    for (int q = q0; q < q1; q++)
+    {
+        hidden_ptr[q] = output_data[q];
+    }
+}
 
-        // h_t := (1 - update) .* new + update .* h_{t-1}
-        float* output_data = top_blob.row(ti);
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q = 0; q < num_output; q++)
+// all timesteps on thread tid of a team of nT, the team meets at a spin barrier after each step
+static void gru_team(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, SpinBarrier& barrier, int tid, int nT)
+{
+    int T = bottom_blob.h;
+
+    int q0;
+    int q1;
+    get_thread_range(top_blob.w, 1, tid, nT, q0, q1);
+
+    for (int t = 0; t < T; t++)
+    {
+        gru_step(bottom_blob, top_blob, reverse, t, weight_xc, bias_c, weight_hc, hidden_state, q0, q1);
+
+        barrier.wait(nT);
+    }
+
+    gru_hidden_state(top_blob, reverse, hidden_state, q0, q1);
+}
+
+static int gru(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
+{
+#if NCNN_SIMPLEOMP
+    // simpleomp may run the team one after another, enter the parallel region per step instead
+    int T = bottom_blob.h;
+    for (int t = 0; t < T; t++)
+    {
+        #pragma omp parallel num_threads(opt.num_threads)
         {
-            const float* gates_data = gates.row(q);
+            int q0;
+            int q1;
+            get_thread_range(top_blob.w, 1, get_omp_thread_num(), get_omp_num_threads(), q0, q1);
 
-            float U = gates_data[0];
-            float N = gates_data[1];
+            gru_step(bottom_blob, top_blob, reverse, t, weight_xc, bias_c, weight_hc, hidden_state, q0, q1);
+        }
+    }
 
-            float H = (1 - U) * N + U * hidden_state[q];
+    gru_hidden_state(top_blob, reverse, hidden_state, 0, top_blob.w);
+#else  // NCNN_SIMPLEOMP
+    SpinBarrier barrier;
 
-            hidden_state[q] = H;
-            output_data[q] = H;
+    // one parallel region for the whole sequence
+    #pragma omp parallel num_threads(opt.num_threads)
+    {
+        gru_team(bottom_blob, top_blob, reverse, weight_xc, bias_c, weight_hc, hidden_state, barrier, get_omp_thread_num(), get_omp_num_threads());
+    }
+#endif // NCNN_SIMPLEOMP
+
+    return 0;
+}
+
+// both directions at once, each on one half of the team
+static int gru_bidirectional(const Mat& bottom_blob, Mat& top_blob_forward, Mat& top_blob_reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
+{
+    Mat hidden0 = hidden_state.row_range(0, 1);
+    Mat hidden1 = hidden_state.row_range(1, 1);
+
+#if NCNN_SIMPLEOMP
+    {
+        int ret = gru(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), hidden0, opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    {
+        int ret = gru(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), hidden1, opt);
+        if (ret != 0)
+            return ret;
+    }
+#else  // NCNN_SIMPLEOMP
+    SpinBarrier barrier0;
+    SpinBarrier barrier1;
+
+    #pragma omp parallel num_threads(opt.num_threads)
+    {
+        const int tid = get_omp_thread_num();
+        const int nT = get_omp_num_threads();
+
+        if (nT == 1)
+        {
+            gru_team(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), hidden0, barrier0, 0, 1);
+            gru_team(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), hidden1, barrier1, 0, 1);
+        }
+        else
+        {
+            const int nT0 = (nT + 1) / 2;
+            if (tid < nT0)
+            {
+                gru_team(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), hidden0, barrier0, tid, nT0);
+            }
+            else
+            {
+                gru_team(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), hidden1, barrier1, tid - nT0, nT - nT0);
+            }
         }
     }
+#endif // NCNN_SIMPLEOMP
 
     return 0;
 }
@@ -350,7 +446,7 @@ int GRU::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
     int num_directions = direction == 2 ? 2 : 1;
 
     // initial hidden state
-    Mat hidden(num_output, 4u, opt.workspace_allocator);
+    Mat hidden(num_output, num_directions, 4u, opt.workspace_allocator);
     if (hidden.empty())
         return -100;
     hidden.fill(0.f);
@@ -391,31 +487,20 @@ int GRU::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 #if NCNN_INT8
         if (int8_scale_term)
         {
-            int ret = gru_int8(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), weight_xc_data_int8_scales.row(0), bias_c_data.channel(0), weight_hc_data.channel(0), weight_hc_data_int8_scales.row(0), hidden, opt);
-            if (ret != 0)
-                return ret;
-        }
-        else
-#endif
-        {
-            int ret = gru(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), bias_c_data.channel(0), weight_hc_data.channel(0), hidden, opt);
+            Mat hidden0 = hidden.row_range(0, 1);
+            int ret = gru_int8(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), weight_xc_data_int8_scales.row(0), bias_c_data.channel(0), weight_hc_data.channel(0), weight_hc_data_int8_scales.row(0), hidden0, opt);
             if (ret != 0)
                 return ret;
-        }
 
-        hidden.fill(0.0f);
-
-#if NCNN_INT8
-        if (int8_scale_term)
-        {
-            int ret = gru_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden, opt);
+            Mat hidden1 = hidden.row_range(1, 1);
+            ret = gru_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden1, opt);
             if (ret != 0)
                 return ret;
         }
         else
 #endif
         {
-            int ret = gru(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), bias_c_data.channel(1), weight_hc_data.channel(1), hidden, opt);
+            int ret = gru_bidirectional(bottom_blob, top_blob_forward, top_blob_reverse, weight_xc_data, bias_c_data, weight_hc_data, hidden, opt);
             if (ret != 0)
                 return ret;
         }
@@ -489,34 +574,23 @@ int GRU::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blo
         if (top_blob_reverse.empty())
             return -100;
 
-        Mat hidden0 = hidden.row_range(0, 1);
 #if NCNN_INT8
         if (int8_scale_term)
         {
+            Mat hidden0 = hidden.row_range(0, 1);
             int ret = gru_int8(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), weight_xc_data_int8_scales.row(0), bias_c_data.channel(0), weight_hc_data.channel(0), weight_hc_data_int8_scales.row(0), hidden0, opt);
             if (ret != 0)
                 return ret;
-        }
-        else
-#endif
-        {
-            int ret = gru(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), bias_c_data.channel(0), weight_hc_data.channel(0), hidden0, opt);
-            if (ret != 0)
-                return ret;
-        }
 
-        Mat hidden1 = hidden.row_range(1, 1);
-#if NCNN_INT8
-        if (int8_scale_term)
-        {
-            int ret = gru_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden1, opt);
+            Mat hidden1 = hidden.row_range(1, 1);
+            ret = gru_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden1, opt);
             if (ret != 0)
                 return ret;
         }
         else
 #endif
         {
-            int ret = gru(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), bias_c_data.channel(1), weight_hc_data.channel(1), hidden1, opt);
+            int ret = gru_bidirectional(bottom_blob, top_blob_forward, top_blob_reverse, weight_xc_data, bias_c_data, weight_hc_data, hidden, opt);
             if (ret != 0)
                 return ret;
         }
@@ -3,6 +3,9 @@
 
 #include "rnn.h"
 
+#include "cpu.h"
+#include "spin_barrier.h"
+
 namespace ncnn {
 
 RNN::RNN()
@@ -59,57 +62,156 @@ int RNN::load_model(const ModelBin& mb)
     return 0;
 }
 
-static int rnn(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
+// timestep t for the outputs [q0, q1)
+static void rnn_step(const Mat& bottom_blob, Mat& top_blob, int reverse, int t, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& hidden_state, int q0, int q1)
 {
     int size = bottom_blob.w;
     int T = bottom_blob.h;
 
     int num_output = top_blob.w;
 
-    // num_output
-    Mat gates(num_output, 4u, opt.workspace_allocator);
-    if (gates.empty())
-        return -100;
+    int ti = reverse ? T - 1 - t : t;
 
-    // unroll
-    for (int t = 0; t < T; t++)
+    // h_{t-1} is the output of the previous timestep
+    const float* hidden_prev = t == 0 ? (const float*)hidden_state : (const float*)top_blob.row(reverse ? ti + 1 : ti - 1);
+
+    const float* x = bottom_blob.row(ti);
+    float* output_data = top_blob.row(ti);
+    for (int q = q0; q < q1; q++)
     {
-        int ti = reverse ? T - 1 - t : t;
+        const float* weight_xc_ptr = weight_xc.row(q);
+        const float* weight_hc_ptr = weight_hc.row(q);
 
-        const float* x = bottom_blob.row(ti);
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q = 0; q < num_output; q++)
+        float H = bias_c[q];
+
+        for (int i = 0; i < size; i++)
         {
-            const float* weight_xc_ptr = weight_xc.row(q);
-            const float* weight_hc_ptr = weight_hc.row(q);
+            H += weight_xc_ptr[i] * x[i];
+        }
 
-            float H = bias_c[q];
+        for (int i = 0; i < num_output; i++)
+        {
+            H += weight_hc_ptr[i] * hidden_prev[i];
+        }
 
-            for (int i = 0; i < size; i++)
-            {
-                H += weight_xc_ptr[i] * x[i];
-            }
+        H = tanhf(H);
 
-            for (int i = 0; i < num_output; i++)
-            {
-                H += weight_hc_ptr[i] * hidden_state[i];
-            }
+        output_data[q] = H;
+    }
+}
 
-            H = tanhf(H);
+// the hidden state of the last timestep for the outputs [q0, q1)
+static void rnn_hidden_state(const Mat& top_blob, int reverse, Mat& hidden_state, int q0, int q1)
+{
+    int T = top_blob.h;
+    if (T == 0)
+        return;
 
-            gates[q] = H;
-        }
+    const float* output_data = top_blob.row(reverse ? 0 : T - 1);
+    float* hidden_ptr = hidden_state;
 
-        float* output_data = top_blob.row(ti);
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q = 0; q < num_output; q++)
+    for (int q = q0; q < q1; q++)
+    {
+        hidden_ptr[q] = output_data[q];
+    }
+}
+
+// all timesteps on thread tid of a team of nT, the team meets at a spin barrier after each step
+static void rnn_team(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, SpinBarrier& barrier, int tid, int nT)
+{
+    int T = bottom_blob.h;
+
+    int q0;
+    int q1;
+    get_thread_range(top_blob.w, 1, tid, nT, q0, q1);
+
+    for (int t = 0; t < T; t++)
+    {
+        rnn_step(bottom_blob, top_blob, reverse, t, weight_xc, bias_c, weight_hc, hidden_state, q0, q1);
+
+        barrier.wait(nT);
+    }
+
+    rnn_hidden_state(top_blob, reverse, hidden_state, q0, q1);
+}
+
+static int rnn(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
+{
+#if NCNN_SIMPLEOMP
+    // simpleomp may run the team one after another, enter the parallel region per step instead
+    int T = bottom_blob.h;
+    for (int t = 0; t < T; t++)
+    {
+        #pragma omp parallel num_threads(opt.num_threads)
         {
-            float H = gates[q];
+            int q0;
+            int q1;
+            get_thread_range(top_blob.w, 1, get_omp_thread_num(), get_omp_num_threads(), q0, q1);
 
-            hidden_state[q] = H;
-            output_data[q] = H;
+            rnn_step(bottom_blob, top_blob, reverse, t, weight_xc, bias_c, weight_hc, hidden_state, q0, q1);
+        }
+    }
+
+    rnn_hidden_state(top_blob, reverse, hidden_state, 0, top_blob.w);
+#else  // NCNN_SIMPLEOMP
+    SpinBarrier barrier;
+
+    // one parallel region for the whole sequence
+    #pragma omp parallel num_threads(opt.num_threads)
+    {
+        rnn_team(bottom_blob, top_blob, reverse, weight_xc, bias_c, weight_hc, hidden_state, barrier, get_omp_thread_num(), get_omp_num_threads());
+    }
+#endif // NCNN_SIMPLEOMP
+
+    return 0;
+}
+
+// both directions at once, each on one half of the team
+static int rnn_bidirectional(const Mat& bottom_blob, Mat& top_blob_forward, Mat& top_blob_reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
+{
+    Mat hidden0 = hidden_state.row_range(0, 1);
+    Mat hidden1 = hidden_state.row_range(1, 1);
+
+#if NCNN_SIMPLEOMP
+    {
+        int ret = rnn(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), hidden0, opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    {
+        int ret = rnn(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), hidden1, opt);
+        if (ret != 0)
+            return ret;
+    }
+#else  // NCNN_SIMPLEOMP
+    SpinBarrier barrier0;
+    SpinBarrier barrier1;
+
+    #pragma omp parallel num_threads(opt.num_threads)
+    {
+        const int tid = get_omp_thread_num();
+        const int nT = get_omp_num_threads();
+
+        if (nT == 1)
+        {
+            rnn_team(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), hidden0, barrier0, 0, 1);
+            rnn_team(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), hidden1, barrier1, 0, 1);
+        }
+        else
+        {
+            const int nT0 = (nT + 1) / 2;
+            if (tid < nT0)
+            {
+                rnn_team(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), hidden0, barrier0, tid, nT0);
+            }
+            else
+            {
+                rnn_team(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), hidden1, barrier1, tid - nT0, nT - nT0);
+            }
         }
     }
+#endif // NCNN_SIMPLEOMP
 
     return 0;
 }
@@ -236,7 +338,7 @@ int RNN::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
     int num_directions = direction == 2 ? 2 : 1;
 
     // initial hidden state
-    Mat hidden(num_output, 4u, opt.workspace_allocator);
+    Mat hidden(num_output, num_directions, 4u, opt.workspace_allocator);
     if (hidden.empty())
         return -100;
     hidden.fill(0.f);
@@ -277,31 +379,20 @@ int RNN::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 #if NCNN_INT8
         if (int8_scale_term)
         {
-            int ret = rnn_int8(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), weight_xc_data_int8_scales.row(0), bias_c_data.channel(0), weight_hc_data.channel(0), weight_hc_data_int8_scales.row(0), hidden, opt);
-            if (ret != 0)
-                return ret;
-        }
-        else
-#endif
-        {
-            int ret = rnn(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), bias_c_data.channel(0), weight_hc_data.channel(0), hidden, opt);
+            Mat hidden0 = hidden.row_range(0, 1);
+            int ret = rnn_int8(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), weight_xc_data_int8_scales.row(0), bias_c_data.channel(0), weight_hc_data.channel(0), weight_hc_data_int8_scales.row(0), hidden0, opt);
             if (ret != 0)
                 return ret;
-        }
-
-        hidden.fill(0.0f);
 
-#if NCNN_INT8
-        if (int8_scale_term)
-        {
-            int ret = rnn_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden, opt);
+            Mat hidden1 = hidden.row_range(1, 1);
+            ret = rnn_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden1, opt);
             if (ret != 0)
                 return ret;
         }
         else
 #endif
         {
-            int ret = rnn(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), bias_c_data.channel(1), weight_hc_data.channel(1), hidden, opt);
+            int ret = rnn_bidirectional(bottom_blob, top_blob_forward, top_blob_reverse, weight_xc_data, bias_c_data, weight_hc_data, hidden, opt);
             if (ret != 0)
                 return ret;
         }
@@ -375,34 +466,23 @@ int RNN::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blo
         if (top_blob_reverse.empty())
             return -100;
 
-        Mat hidden0 = hidden.row_range(0, 1);
 #if NCNN_INT8
         if (int8_scale_term)
         {
+            Mat hidden0 = hidden.row_range(0, 1);
             int ret = rnn_int8(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), weight_xc_data_int8_scales.row(0), bias_c_data.channel(0), weight_hc_data.channel(0), weight_hc_data_int8_scales.row(0), hidden0, opt);
             if (ret != 0)
                 return ret;
-        }
-        else
-#endif
-        {
-            int ret = rnn(bottom_blob, top_blob_forward, 0, weight_xc_data.channel(0), bias_c_data.channel(0), weight_hc_data.channel(0), hidden0, opt);
-            if (ret != 0)
-                return ret;
-        }
 
-        Mat hidden1 = hidden.row_range(1, 1);
-#if NCNN_INT8
-        if (int8_scale_term)
-        {
-            int ret = rnn_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden1, opt);
+            Mat hidden1 = hidden.row_range(1, 1);
+            ret = rnn_int8(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), weight_xc_data_int8_scales.row(1), bias_c_data.channel(1), weight_hc_data.channel(1), weight_hc_data_int8_scales.row(1), hidden1, opt);
             if (ret != 0)
                 return ret;
         }
         else
 #endif
         {
-            int ret = rnn(bottom_blob, top_blob_reverse, 1, weight_xc_data.channel(1), bias_c_data.channel(1), weight_hc_data.channel(1), hidden1, opt);
+            int ret = rnn_bidirectional(bottom_blob, top_blob_forward, top_blob_reverse, weight_xc_data, bias_c_data, weight_hc_data, hidden, opt);
             if (ret != 0)
                 return ret;
         }
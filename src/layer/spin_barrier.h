@@ -0,0 +1,94 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LAYER_SPIN_BARRIER_H
+#define LAYER_SPIN_BARRIER_H
+
+#include "allocator.h"
+#include "platform.h"
+
+#if NCNN_THREADS && !defined _WIN32
+#include <sched.h>
+#endif
+
+namespace ncnn {
+
+// lightweight barrier for the threads of one persistent parallel region
+// much cheaper than leaving and entering a parallel region per step
+// all nT threads of the team must run concurrently, simpleomp may run them one after another
+//
+//     SpinBarrier barrier;
+//
+//     #pragma omp parallel num_threads(opt.num_threads)
+//     {
+//         const int tid = get_omp_thread_num();
+//         const int nT = get_omp_num_threads();
+//         for (int t = 0; t < T; t++)
+//         {
+//             ...
+//             barrier.wait(nT);
+//         }
+//     }
+class SpinBarrier
+{
+public:
+    SpinBarrier()
+        : arrived(0), generation(0)
+    {
+    }
+
+    // block until nT threads called wait
+    void wait(int nT)
+    {
+        if (nT <= 1)
+            return;
+
+        const int gen = NCNN_XADD(&generation, 0);
+
+        if (NCNN_XADD(&arrived, 1) == nT - 1)
+        {
+            // the last one opens the barrier for the next round
+            NCNN_XADD(&arrived, -nT);
+            NCNN_XADD(&generation, 1);
+            return;
+        }
+
+        int spin = 0;
+        while (*(volatile int*)&generation == gen)
+        {
+            spin++;
+            if (spin >= 1024)
+            {
+                // oversubscribed, let the late thread run
+#if NCNN_THREADS
+#if defined _WIN32
+                SwitchToThread();
+#else
+                sched_yield();
+#endif
+#endif // NCNN_THREADS
+            }
+        }
+
+        // acquire what the other threads wrote before the barrier
+        NCNN_XADD(&generation, 0);
+    }
+
+private:
+    int arrived;
+    int generation;
+};
+
+// the share [start, end) of thread tid when count items are split over nT threads
+// shares are multiples of elempack except the last one
+static inline void get_thread_range(int count, int elempack, int tid, int nT, int& start, int& end)
+{
+    const int nn = count / elempack;
+
+    start = nn * tid / nT * elempack;
+    end = tid == nT - 1 ? count : nn * (tid + 1) / nT * elempack;
+}
+
+} // namespace ncnn
+
+#endif // LAYER_SPIN_BARRIER_H
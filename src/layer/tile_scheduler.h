@@ -0,0 +1,165 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LAYER_TILE_SCHEDULER_H
+#define LAYER_TILE_SCHEDULER_H
+
+#include "allocator.h"
+#include "cpu.h"
+
+namespace ncnn {
+
+// hands out the tiles of one parallel loop to the threads of the team
+// schedule is opt.parallel_schedule, 0 = static, 1 = dynamic, 2 = guided, 3 = work stealing
+// tiles are claimed from shared counters, so a team smaller than nT still covers all of them
+//
+//     TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+//
+//     #pragma omp parallel num_threads(nT)
+//     for (TileCursor tile(scheduler); tile.valid(); tile.next())
+//     {
+//         const int ppi = tile.index();
+//         ...
+//     }
+class TileScheduler
+{
+public:
+    TileScheduler(int _count, int _nT, int _schedule)
+        : count(_count), nT(_nT < 1 ? 1 : _nT), schedule(_schedule), counter(0), nq(1)
+    {
+        if (schedule == 3)
+        {
+            // one contiguous block per thread like static, cache line apart
+            // a team wider than MAX_QUEUES shares the blocks
+            nq = nT < MAX_QUEUES ? nT : MAX_QUEUES;
+            for (int q = 0; q < nq; q++)
+            {
+                queues[q * QUEUE_STRIDE] = (int)((long long)count * q / nq);
+                queues[q * QUEUE_STRIDE + 1] = (int)((long long)count * (q + 1) / nq);
+            }
+        }
+    }
+
+    // claim the next tiles [begin, end) for thread tid
+    // return false once all tiles are taken
+    bool claim(int tid, int& begin, int& end)
+    {
+        if (schedule == 3)
+            return steal(tid, begin, end);
+
+        int chunk = (count + nT - 1) / nT;
+        if (schedule == 1)
+        {
+            chunk = 1;
+        }
+        if (schedule == 2)
+        {
+            const int remaining = count - NCNN_XADD(&counter, 0);
+            chunk = remaining / (nT * 2);
+            if (chunk < 1)
+                chunk = 1;
+        }
+
+        begin = NCNN_XADD(&counter, chunk);
+        if (begin >= count)
+            return false;
+
+        end = begin + chunk < count ? begin + chunk : count;
+        return true;
+    }
+
+private:
+    // drain the own block first in shrinking chunks, then take single tiles from the blocks of slower threads
+    // owner and thieves bump the same counter, every tile goes to exactly one of them
+    bool steal(int tid, int& begin, int& end)
+    {
+        const int home = tid % nq;
+        for (int i = 0; i < nq; i++)
+        {
+            int* queue = queues + (home + i) % nq * QUEUE_STRIDE;
+            const int queue_end = queue[1];
+
+            // skip drained blocks without touching the cache line
+            const int next = *(volatile int*)queue;
+            if (next >= queue_end)
+                continue;
+
+            // the owner takes a quarter of what is left, so thieves still find a tail
+            int chunk = 1;
+            if (i == 0)
+            {
+                chunk = (queue_end - next) / 4;
+                if (chunk < 1)
+                    chunk = 1;
+            }
+
+            const int tile = NCNN_XADD(queue, chunk);
+            if (tile < queue_end)
+            {
+                begin = tile;
+                end = tile + chunk < queue_end ? tile + chunk : queue_end;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    TileScheduler(const TileScheduler&);
+    TileScheduler& operator=(const TileScheduler&);
+
+    enum
+    {
+        QUEUE_STRIDE = 16,
+        MAX_QUEUES = 64
+    };
+
+    const int count;
+    const int nT;
+    const int schedule;
+    int counter;
+
+    // next and end tile of every thread block for work stealing
+    int nq;
+    int queues[MAX_QUEUES * QUEUE_STRIDE];
+};
+
+// the thread private position in a TileScheduler
+class TileCursor
+{
+public:
+    TileCursor(TileScheduler& _scheduler)
+        : scheduler(_scheduler), tid(get_omp_thread_num()), tile(0), end(0)
+    {
+        has_tile = scheduler.claim(tid, tile, end);
+    }
+
+    bool valid() const
+    {
+        return has_tile;
+    }
+
+    int index() const
+    {
+        return tile;
+    }
+
+    void next()
+    {
+        tile++;
+        if (tile >= end)
+            has_tile = scheduler.claim(tid, tile, end);
+    }
+
+private:
+    TileScheduler& scheduler;
+    const int tid;
+    int tile;
+    int end;
+    bool has_tile;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_TILE_SCHEDULER_H
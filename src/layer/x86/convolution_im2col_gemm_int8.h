@@ -4531,9 +4531,13 @@ static int convolution_im2col_gemm_int8(const Mat& bottom_blob, Mat& top_blob, c
     if (topT.empty())
         return -100;
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppj = 0; ppj < nn_M; ppj++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppj = tile.index();
+
         const int i = ppj * TILE_M;
 
         const int max_ii = std::min((M - i), TILE_M);
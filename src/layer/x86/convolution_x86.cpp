@@ -21,6 +21,7 @@
 #include "benchmark.h"
 #include "cpu.h"
 #include "layer_type.h"
+#include "tile_scheduler.h"
 
 namespace ncnn {
 
@@ -3,6 +3,7 @@
 
 #include "cpu.h"
 #include "mat.h"
+#include "tile_scheduler.h"
 #include "x86_usability.h"
 
 namespace ncnn {
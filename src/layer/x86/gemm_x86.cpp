@@ -17,6 +17,7 @@
 #include "x86_usability.h"
 
 #include "cpu.h"
+#include "tile_scheduler.h"
 
 namespace ncnn {
 
@@ -6898,9 +6899,13 @@ static int gemm_x86(const Mat& A, const Mat& B, const Mat& C, Mat& top_blob, int
             return -100;
     }
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         const int i = ppi * TILE_M;
 
         // shadowed variable for less openmp task args
@@ -7015,9 +7020,13 @@ static int gemm_AT_x86(const Mat& AT, const Mat& B, const Mat& C, Mat& top_blob,
             return -100;
     }
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         const int i = ppi * TILE_M;
 
         const int max_ii = std::min((M - i), TILE_M);
@@ -7088,9 +7097,13 @@ static int gemm_BT_x86(const Mat& A, const Mat& BT, const Mat& C, Mat& top_blob,
             return -100;
     }
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         const int i = ppi * TILE_M;
 
         // shadowed variable for less openmp task args
@@ -7171,9 +7184,13 @@ static int gemm_AT_BT_x86(const Mat& AT, const Mat& BT, const Mat& C, Mat& top_b
             return -100;
     }
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         const int i = ppi * TILE_M;
 
         const int max_ii = std::min((M - i), TILE_M);
@@ -7698,9 +7715,13 @@ static int gemm_x86_int8(const Mat& A, const Mat& B, const Mat& C, Mat& top_blob
 
     const struct gemm_x86_int8_omp_args args = {TILE_M, TILE_N, TILE_K, broadcast_type_C, transA, output_transpose, alpha, beta};
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         // shadowed variable for less openmp task args
         const int TILE_M = args.TILE_M;
         const int TILE_N = args.TILE_N;
@@ -7830,9 +7851,13 @@ static int gemm_AT_x86_int8(const Mat& AT, const Mat& A_int8_scales, const Mat&
 
     const struct gemm_x86_int8_omp_args args = {TILE_M, TILE_N, TILE_K, broadcast_type_C, 0, output_transpose, alpha, beta};
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         // shadowed variable for less openmp task args
         const int TILE_M = args.TILE_M;
         const int TILE_N = args.TILE_N;
@@ -7930,9 +7955,13 @@ static int gemm_BT_x86_int8(const Mat& A, const Mat& BT, float B_int8_scale, con
 
     const struct gemm_x86_int8_omp_args args = {TILE_M, TILE_N, TILE_K, broadcast_type_C, transA, output_transpose, alpha, beta};
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         // shadowed variable for less openmp task args
         const int TILE_M = args.TILE_M;
         const int TILE_N = args.TILE_N;
@@ -8027,9 +8056,13 @@ static int gemm_AT_BT_x86_int8(const Mat& AT, const Mat& A_int8_scales, const Ma
 
     const struct gemm_x86_int8_omp_args args = {TILE_M, TILE_N, TILE_K, broadcast_type_C, 0, output_transpose, alpha, beta};
 
-    #pragma omp parallel for num_threads(nT)
-    for (int ppi = 0; ppi < nn_M; ppi++)
+    TileScheduler scheduler(nn_M, nT, opt.parallel_schedule);
+
+    #pragma omp parallel num_threads(nT)
+    for (TileCursor tile(scheduler); tile.valid(); tile.next())
     {
+        const int ppi = tile.index();
+
         // shadowed variable for less openmp task args
         const int TILE_M = args.TILE_M;
         const int TILE_N = args.TILE_N;
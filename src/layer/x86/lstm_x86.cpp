@@ -19,6 +19,7 @@
 #include "x86_usability.h"
 
 #include "cpu.h"
+#include "spin_barrier.h"
 
 namespace ncnn {
 
@@ -195,7 +196,8 @@ int LSTM_x86::create_pipeline(const Option& opt)
     return 0;
 }
 
-static int lstm(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& weight_hr, Mat& hidden_state, Mat& cell_state, const Option& opt)
+// gates and cell update of timestep t for the hidden units [q0, q1)
+static void lstm_step(const Mat& bottom_blob, Mat& top_blob, int reverse, int t, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& hidden_state, Mat& cell_state, Mat& gates, Mat& tmp_hidden_state, int q0, int q1)
 {
     int size = bottom_blob.w;
     int T = bottom_blob.h;
@@ -203,360 +205,507 @@ static int lstm(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& w
     int num_output = top_blob.w;
     int hidden_size = cell_state.w;
 
-    // 4 x hidden_size
-    Mat gates(4, hidden_size, 4u, opt.workspace_allocator);
-    if (gates.empty())
-        return -100;
+    // clip hidden by continuation indicator
+    // h_cont_{t-1} = cont_t * h_{t-1}
+    // h_cont_{t-1} = h_{t-1} if cont_t == 1
+    //                0       otherwise
+    // calculate hidden
+    // gate_input_t := W_hc * h_conted_{t-1} + W_xc * x_t + b_c
 
-    Mat tmp_hidden_state;
-    if (num_output != hidden_size)
-    {
-        tmp_hidden_state.create(hidden_size, 4u, opt.workspace_allocator);
-        if (tmp_hidden_state.empty())
-            return -100;
-    }
+    int ti = reverse ? T - 1 - t : t;
 
-    // unroll
-    for (int t = 0; t < T; t++)
-    {
-        // clip hidden by continuation indicator
-        // h_cont_{t-1} = cont_t * h_{t-1}
-        // h_cont_{t-1} = h_{t-1} if cont_t == 1
-        //                0       otherwise
-        // calculate hidden
-        // gate_input_t := W_hc * h_conted_{t-1} + W_xc * x_t + b_c
-
-        int ti = reverse ? T - 1 - t : t;
+    // h_{t-1} is the output of the previous timestep
+    const float* hidden_prev = t == 0 ? (const float*)hidden_state : (const float*)top_blob.row(reverse ? ti + 1 : ti - 1);
 
+    int q = q0;
 #if __AVX__
-        int nn_hidden_size = hidden_size >> 1;
-        int remain_hidden_size_start = nn_hidden_size << 1;
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int qq = 0; qq < nn_hidden_size; qq++)
-        {
-            int q = qq * 2;
-
-            const float* bias_c_IFOG = (const float*)bias_c + q * 4;
+    for (; q + 1 < q1; q += 2)
+    {
+        const float* bias_c_IFOG = (const float*)bias_c + q * 4;
 
-            // gate I F O G
-            const float* weight_xc_IFOG = weight_xc.row(q / 2);
-            const float* weight_hc_IFOG = weight_hc.row(q / 2);
+        // gate I F O G
+        const float* weight_xc_IFOG = weight_xc.row(q / 2);
+        const float* weight_hc_IFOG = weight_hc.row(q / 2);
 
-            __m256 _IFOG = _mm256_loadu_ps(bias_c_IFOG);
-            __m256 _sum1 = _mm256_setzero_ps();
-            __m256 _sum2 = _mm256_setzero_ps();
-            __m256 _sum3 = _mm256_setzero_ps();
+        __m256 _IFOG = _mm256_loadu_ps(bias_c_IFOG);
+        __m256 _sum1 = _mm256_setzero_ps();
+        __m256 _sum2 = _mm256_setzero_ps();
+        __m256 _sum3 = _mm256_setzero_ps();
 
-            const float* x = bottom_blob.row(ti);
+        const float* x = bottom_blob.row(ti);
 
-            int i = 0;
-            for (; i + 3 < size; i += 4)
-            {
-                __m256 _xi0 = _mm256_broadcast_ss(x);
-                __m256 _xi1 = _mm256_broadcast_ss(x + 1);
-                __m256 _xi2 = _mm256_broadcast_ss(x + 2);
-                __m256 _xi3 = _mm256_broadcast_ss(x + 3);
-                __m256 _weight_xc_IFOG0 = _mm256_loadu_ps(weight_xc_IFOG);
-                __m256 _weight_xc_IFOG1 = _mm256_loadu_ps(weight_xc_IFOG + 8);
-                __m256 _weight_xc_IFOG2 = _mm256_loadu_ps(weight_xc_IFOG + 16);
-                __m256 _weight_xc_IFOG3 = _mm256_loadu_ps(weight_xc_IFOG + 24);
-                _IFOG = _mm256_comp_fmadd_ps(_weight_xc_IFOG0, _xi0, _IFOG);
-                _sum1 = _mm256_comp_fmadd_ps(_weight_xc_IFOG1, _xi1, _sum1);
-                _sum2 = _mm256_comp_fmadd_ps(_weight_xc_IFOG2, _xi2, _sum2);
-                _sum3 = _mm256_comp_fmadd_ps(_weight_xc_IFOG3, _xi3, _sum3);
-
-                x += 4;
-                weight_xc_IFOG += 32;
-            }
-            for (; i < size; i++)
-            {
-                __m256 _xi = _mm256_broadcast_ss(x);
-                __m256 _weight_xc_IFOG = _mm256_loadu_ps(weight_xc_IFOG);
-                _IFOG = _mm256_comp_fmadd_ps(_weight_xc_IFOG, _xi, _IFOG);
+        int i = 0;
+        for (; i + 3 < size; i += 4)
+        {
+            __m256 _xi0 = _mm256_broadcast_ss(x);
+            __m256 _xi1 = _mm256_broadcast_ss(x + 1);
+            __m256 _xi2 = _mm256_broadcast_ss(x + 2);
+            __m256 _xi3 = _mm256_broadcast_ss(x + 3);
+            __m256 _weight_xc_IFOG0 = _mm256_loadu_ps(weight_xc_IFOG);
+            __m256 _weight_xc_IFOG1 = _mm256_loadu_ps(weight_xc_IFOG + 8);
+            __m256 _weight_xc_IFOG2 = _mm256_loadu_ps(weight_xc_IFOG + 16);
+            __m256 _weight_xc_IFOG3 = _mm256_loadu_ps(weight_xc_IFOG + 24);
+            _IFOG = _mm256_comp_fmadd_ps(_weight_xc_IFOG0, _xi0, _IFOG);
+            _sum1 = _mm256_comp_fmadd_ps(_weight_xc_IFOG1, _xi1, _sum1);
+            _sum2 = _mm256_comp_fmadd_ps(_weight_xc_IFOG2, _xi2, _sum2);
+            _sum3 = _mm256_comp_fmadd_ps(_weight_xc_IFOG3, _xi3, _sum3);
+
+            x += 4;
+            weight_xc_IFOG += 32;
+        }
+        for (; i < size; i++)
+        {
+            __m256 _xi = _mm256_broadcast_ss(x);
+            __m256 _weight_xc_IFOG = _mm256_loadu_ps(weight_xc_IFOG);
+            _IFOG = _mm256_comp_fmadd_ps(_weight_xc_IFOG, _xi, _IFOG);
 
-                x += 1;
-                weight_xc_IFOG += 8;
-            }
+            x += 1;
+            weight_xc_IFOG += 8;
+        }
 
-            const float* hidden_ptr = hidden_state;
+        const float* hidden_ptr = hidden_prev;
 
-            i = 0;
-            for (; i + 3 < num_output; i += 4)
-            {
-                __m256 _h_cont0 = _mm256_broadcast_ss(hidden_ptr);
-                __m256 _h_cont1 = _mm256_broadcast_ss(hidden_ptr + 1);
-                __m256 _h_cont2 = _mm256_broadcast_ss(hidden_ptr + 2);
-                __m256 _h_cont3 = _mm256_broadcast_ss(hidden_ptr + 3);
-                __m256 _weight_hc_IFOG0 = _mm256_loadu_ps(weight_hc_IFOG);
-                __m256 _weight_hc_IFOG1 = _mm256_loadu_ps(weight_hc_IFOG + 8);
-                __m256 _weight_hc_IFOG2 = _mm256_loadu_ps(weight_hc_IFOG + 16);
-                __m256 _weight_hc_IFOG3 = _mm256_loadu_ps(weight_hc_IFOG + 24);
-                _IFOG = _mm256_comp_fmadd_ps(_weight_hc_IFOG0, _h_cont0, _IFOG);
-                _sum1 = _mm256_comp_fmadd_ps(_weight_hc_IFOG1, _h_cont1, _sum1);
-                _sum2 = _mm256_comp_fmadd_ps(_weight_hc_IFOG2, _h_cont2, _sum2);
-                _sum3 = _mm256_comp_fmadd_ps(_weight_hc_IFOG3, _h_cont3, _sum3);
-
-                hidden_ptr += 4;
-                weight_hc_IFOG += 32;
-            }
-            for (; i < num_output; i++)
-            {
-                __m256 _h_cont = _mm256_broadcast_ss(hidden_ptr);
-                __m256 _weight_hc_IFOG = _mm256_loadu_ps(weight_hc_IFOG);
-                _IFOG = _mm256_comp_fmadd_ps(_weight_hc_IFOG, _h_cont, _IFOG);
+        i = 0;
+        for (; i + 3 < num_output; i += 4)
+        {
+            __m256 _h_cont0 = _mm256_broadcast_ss(hidden_ptr);
+            __m256 _h_cont1 = _mm256_broadcast_ss(hidden_ptr + 1);
+            __m256 _h_cont2 = _mm256_broadcast_ss(hidden_ptr + 2);
+            __m256 _h_cont3 = _mm256_broadcast_ss(hidden_ptr + 3);
+            __m256 _weight_hc_IFOG0 = _mm256_loadu_ps(weight_hc_IFOG);
+            __m256 _weight_hc_IFOG1 = _mm256_loadu_ps(weight_hc_IFOG + 8);
+            __m256 _weight_hc_IFOG2 = _mm256_loadu_ps(weight_hc_IFOG + 16);
+            __m256 _weight_hc_IFOG3 = _mm256_loadu_ps(weight_hc_IFOG + 24);
+            _IFOG = _mm256_comp_fmadd_ps(_weight_hc_IFOG0, _h_cont0, _IFOG);
+            _sum1 = _mm256_comp_fmadd_ps(_weight_hc_IFOG1, _h_cont1, _sum1);
+            _sum2 = _mm256_comp_fmadd_ps(_weight_hc_IFOG2, _h_cont2, _sum2);
+            _sum3 = _mm256_comp_fmadd_ps(_weight_hc_IFOG3, _h_cont3, _sum3);
+
+            hidden_ptr += 4;
+            weight_hc_IFOG += 32;
+        }
+        for (; i < num_output; i++)
+        {
+            __m256 _h_cont = _mm256_broadcast_ss(hidden_ptr);
+            __m256 _weight_hc_IFOG = _mm256_loadu_ps(weight_hc_IFOG);
+            _IFOG = _mm256_comp_fmadd_ps(_weight_hc_IFOG, _h_cont, _IFOG);
 
-                hidden_ptr += 1;
-                weight_hc_IFOG += 8;
-            }
+            hidden_ptr += 1;
+            weight_hc_IFOG += 8;
+        }
 
-            float* gates_data = gates.row(q);
+        float* gates_data = gates.row(q);
 
-            _IFOG = _mm256_add_ps(_IFOG, _sum1);
-            _sum2 = _mm256_add_ps(_sum2, _sum3);
-            _IFOG = _mm256_add_ps(_IFOG, _sum2);
+        _IFOG = _mm256_add_ps(_IFOG, _sum1);
+        _sum2 = _mm256_add_ps(_sum2, _sum3);
+        _IFOG = _mm256_add_ps(_IFOG, _sum2);
 
-            _mm256_storeu_ps(gates_data, _IFOG);
-        }
-#else
-        int nn_hidden_size = 0;
-        int remain_hidden_size_start = 0;
+        _mm256_storeu_ps(gates_data, _IFOG);
+    }
 #endif // __AVX__
+    for (; q < q1; q++)
+    {
+        const float* bias_c_IFOG = (const float*)bias_c + q * 4;
 
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q = remain_hidden_size_start; q < hidden_size; q++)
-        {
-            const float* bias_c_IFOG = (const float*)bias_c + q * 4;
-
-            // gate I F O G
+        // gate I F O G
 #if __AVX__
-            const float* weight_xc_IFOG = weight_xc.row(q / 2 + q % 2);
-            const float* weight_hc_IFOG = weight_hc.row(q / 2 + q % 2);
+        const float* weight_xc_IFOG = weight_xc.row(q / 2 + q % 2);
+        const float* weight_hc_IFOG = weight_hc.row(q / 2 + q % 2);
 #else
-            const float* weight_xc_IFOG = weight_xc.row(q);
-            const float* weight_hc_IFOG = weight_hc.row(q);
+        const float* weight_xc_IFOG = weight_xc.row(q);
+        const float* weight_hc_IFOG = weight_hc.row(q);
 #endif
 
 #if __SSE2__
-            __m128 _IFOG = _mm_loadu_ps(bias_c_IFOG);
-            __m128 _sum1 = _mm_setzero_ps();
-            __m128 _sum2 = _mm_setzero_ps();
-            __m128 _sum3 = _mm_setzero_ps();
+        __m128 _IFOG = _mm_loadu_ps(bias_c_IFOG);
+        __m128 _sum1 = _mm_setzero_ps();
+        __m128 _sum2 = _mm_setzero_ps();
+        __m128 _sum3 = _mm_setzero_ps();
 #else  // __SSE2__
-            float I = bias_c_IFOG[0];
-            float F = bias_c_IFOG[1];
-            float O = bias_c_IFOG[2];
-            float G = bias_c_IFOG[3];
+        float I = bias_c_IFOG[0];
+        float F = bias_c_IFOG[1];
+        float O = bias_c_IFOG[2];
+        float G = bias_c_IFOG[3];
 #endif // __SSE2__
 
-            const float* x = bottom_blob.row(ti);
+        const float* x = bottom_blob.row(ti);
 
-            int i = 0;
+        int i = 0;
 #if __SSE2__
-            for (; i + 3 < size; i += 4)
-            {
-                __m128 _xi0 = _mm_load1_ps(x);
-                __m128 _xi1 = _mm_load1_ps(x + 1);
-                __m128 _xi2 = _mm_load1_ps(x + 2);
-                __m128 _xi3 = _mm_load1_ps(x + 3);
-                __m128 _weight_xc_IFOG0 = _mm_loadu_ps(weight_xc_IFOG);
-                __m128 _weight_xc_IFOG1 = _mm_loadu_ps(weight_xc_IFOG + 4);
-                __m128 _weight_xc_IFOG2 = _mm_loadu_ps(weight_xc_IFOG + 8);
-                __m128 _weight_xc_IFOG3 = _mm_loadu_ps(weight_xc_IFOG + 12);
-                _IFOG = _mm_comp_fmadd_ps(_weight_xc_IFOG0, _xi0, _IFOG);
-                _sum1 = _mm_comp_fmadd_ps(_weight_xc_IFOG1, _xi1, _sum1);
-                _sum2 = _mm_comp_fmadd_ps(_weight_xc_IFOG2, _xi2, _sum2);
-                _sum3 = _mm_comp_fmadd_ps(_weight_xc_IFOG3, _xi3, _sum3);
-
-                x += 4;
-                weight_xc_IFOG += 16;
-            }
+        for (; i + 3 < size; i += 4)
+        {
+            __m128 _xi0 = _mm_load1_ps(x);
+            __m128 _xi1 = _mm_load1_ps(x + 1);
+            __m128 _xi2 = _mm_load1_ps(x + 2);
+            __m128 _xi3 = _mm_load1_ps(x + 3);
+            __m128 _weight_xc_IFOG0 = _mm_loadu_ps(weight_xc_IFOG);
+            __m128 _weight_xc_IFOG1 = _mm_loadu_ps(weight_xc_IFOG + 4);
+            __m128 _weight_xc_IFOG2 = _mm_loadu_ps(weight_xc_IFOG + 8);
+            __m128 _weight_xc_IFOG3 = _mm_loadu_ps(weight_xc_IFOG + 12);
+            _IFOG = _mm_comp_fmadd_ps(_weight_xc_IFOG0, _xi0, _IFOG);
+            _sum1 = _mm_comp_fmadd_ps(_weight_xc_IFOG1, _xi1, _sum1);
+            _sum2 = _mm_comp_fmadd_ps(_weight_xc_IFOG2, _xi2, _sum2);
+            _sum3 = _mm_comp_fmadd_ps(_weight_xc_IFOG3, _xi3, _sum3);
+
+            x += 4;
+            weight_xc_IFOG += 16;
+        }
 #endif // __SSE2__
-            for (; i < size; i++)
-            {
+        for (; i < size; i++)
+        {
 #if __SSE2__
-                __m128 _xi = _mm_load1_ps(x);
-                __m128 _weight_xc_IFOG = _mm_loadu_ps(weight_xc_IFOG);
-                _IFOG = _mm_comp_fmadd_ps(_weight_xc_IFOG, _xi, _IFOG);
+            __m128 _xi = _mm_load1_ps(x);
+            __m128 _weight_xc_IFOG = _mm_loadu_ps(weight_xc_IFOG);
+            _IFOG = _mm_comp_fmadd_ps(_weight_xc_IFOG, _xi, _IFOG);
 #else  // __SSE2__
-                float xi = x[0];
-                I += xi * weight_xc_IFOG[0];
-                F += xi * weight_xc_IFOG[1];
-                O += xi * weight_xc_IFOG[2];
-                G += xi * weight_xc_IFOG[3];
+            float xi = x[0];
+            I += xi * weight_xc_IFOG[0];
+            F += xi * weight_xc_IFOG[1];
+            O += xi * weight_xc_IFOG[2];
+            G += xi * weight_xc_IFOG[3];
 #endif // __SSE2__
 
-                x += 1;
-                weight_xc_IFOG += 4;
-            }
+            x += 1;
+            weight_xc_IFOG += 4;
+        }
 
-            const float* hidden_ptr = hidden_state;
+        const float* hidden_ptr = hidden_prev;
 
-            i = 0;
+        i = 0;
 #if __SSE2__
-            for (; i + 3 < num_output; i += 4)
-            {
-                __m128 _h_cont0 = _mm_load1_ps(hidden_ptr);
-                __m128 _h_cont1 = _mm_load1_ps(hidden_ptr + 1);
-                __m128 _h_cont2 = _mm_load1_ps(hidden_ptr + 2);
-                __m128 _h_cont3 = _mm_load1_ps(hidden_ptr + 3);
-                __m128 _weight_hc_IFOG0 = _mm_loadu_ps(weight_hc_IFOG);
-                __m128 _weight_hc_IFOG1 = _mm_loadu_ps(weight_hc_IFOG + 4);
-                __m128 _weight_hc_IFOG2 = _mm_loadu_ps(weight_hc_IFOG + 8);
-                __m128 _weight_hc_IFOG3 = _mm_loadu_ps(weight_hc_IFOG + 12);
-                _IFOG = _mm_comp_fmadd_ps(_weight_hc_IFOG0, _h_cont0, _IFOG);
-                _sum1 = _mm_comp_fmadd_ps(_weight_hc_IFOG1, _h_cont1, _sum1);
-                _sum2 = _mm_comp_fmadd_ps(_weight_hc_IFOG2, _h_cont2, _sum2);
-                _sum3 = _mm_comp_fmadd_ps(_weight_hc_IFOG3, _h_cont3, _sum3);
-
-                hidden_ptr += 4;
-                weight_hc_IFOG += 16;
-            }
+        for (; i + 3 < num_output; i += 4)
+        {
+            __m128 _h_cont0 = _mm_load1_ps(hidden_ptr);
+            __m128 _h_cont1 = _mm_load1_ps(hidden_ptr + 1);
+            __m128 _h_cont2 = _mm_load1_ps(hidden_ptr + 2);
+            __m128 _h_cont3 = _mm_load1_ps(hidden_ptr + 3);
+            __m128 _weight_hc_IFOG0 = _mm_loadu_ps(weight_hc_IFOG);
+            __m128 _weight_hc_IFOG1 = _mm_loadu_ps(weight_hc_IFOG + 4);
+            __m128 _weight_hc_IFOG2 = _mm_loadu_ps(weight_hc_IFOG + 8);
+            __m128 _weight_hc_IFOG3 = _mm_loadu_ps(weight_hc_IFOG + 12);
+            _IFOG = _mm_comp_fmadd_ps(_weight_hc_IFOG0, _h_cont0, _IFOG);
+            _sum1 = _mm_comp_fmadd_ps(_weight_hc_IFOG1, _h_cont1, _sum1);
+            _sum2 = _mm_comp_fmadd_ps(_weight_hc_IFOG2, _h_cont2, _sum2);
+            _sum3 = _mm_comp_fmadd_ps(_weight_hc_IFOG3, _h_cont3, _sum3);
+
+            hidden_ptr += 4;
+            weight_hc_IFOG += 16;
+        }
 #endif // __SSE2__
-            for (; i < num_output; i++)
-            {
+        for (; i < num_output; i++)
+        {
 #if __SSE2__
-                __m128 _h_cont = _mm_load1_ps(hidden_ptr);
-                __m128 _weight_hc_IFOG = _mm_loadu_ps(weight_hc_IFOG);
-                _IFOG = _mm_comp_fmadd_ps(_weight_hc_IFOG, _h_cont, _IFOG);
+            __m128 _h_cont = _mm_load1_ps(hidden_ptr);
+            __m128 _weight_hc_IFOG = _mm_loadu_ps(weight_hc_IFOG);
+            _IFOG = _mm_comp_fmadd_ps(_weight_hc_IFOG, _h_cont, _IFOG);
 #else  // __SSE2__
-                float h_cont = hidden_ptr[0];
-                I += h_cont * weight_hc_IFOG[0];
-                F += h_cont * weight_hc_IFOG[1];
-                O += h_cont * weight_hc_IFOG[2];
-                G += h_cont * weight_hc_IFOG[3];
+            float h_cont = hidden_ptr[0];
+            I += h_cont * weight_hc_IFOG[0];
+            F += h_cont * weight_hc_IFOG[1];
+            O += h_cont * weight_hc_IFOG[2];
+            G += h_cont * weight_hc_IFOG[3];
 #endif // __SSE2__
 
-                hidden_ptr += 1;
-                weight_hc_IFOG += 4;
-            }
+            hidden_ptr += 1;
+            weight_hc_IFOG += 4;
+        }
 
-            float* gates_data = gates.row(q);
+        float* gates_data = gates.row(q);
 
 #if __SSE2__
-            _IFOG = _mm_add_ps(_IFOG, _sum1);
-            _sum2 = _mm_add_ps(_sum2, _sum3);
-            _IFOG = _mm_add_ps(_IFOG, _sum2);
+        _IFOG = _mm_add_ps(_IFOG, _sum1);
+        _sum2 = _mm_add_ps(_sum2, _sum3);
+        _IFOG = _mm_add_ps(_IFOG, _sum2);
 
-            _mm_storeu_ps(gates_data, _IFOG);
+        _mm_storeu_ps(gates_data, _IFOG);
 #else  // __SSE2__
-            gates_data[0] = I;
-            gates_data[1] = F;
-            gates_data[2] = O;
-            gates_data[3] = G;
+        gates_data[0] = I;
+        gates_data[1] = F;
+        gates_data[2] = O;
+        gates_data[3] = G;
 #endif // __SSE2__
-        }
+    }
 
-        // lstm unit
-        // sigmoid(I)
-        // sigmoid(F)
-        // sigmoid(O)
-        // tanh(G)
-        // c_t := f_t .* c_{t-1} + i_t .* g_t
-        // h_t := o_t .* tanh[c_t]
-        float* output_data = top_blob.row(ti);
+    // lstm unit
+    // sigmoid(I)
+    // sigmoid(F)
+    // sigmoid(O)
+    // tanh(G)
+    // c_t := f_t .* c_{t-1} + i_t .* g_t
+    // h_t := o_t .* tanh[c_t]
+    float* output_data = top_blob.row(ti);
 
-        float* cell_ptr = cell_state;
-        float* hidden_ptr = hidden_state;
-        float* tmp_hidden_ptr = tmp_hidden_state;
+    float* cell_ptr = cell_state;
+    float* tmp_hidden_ptr = tmp_hidden_state;
 
+    q = q0;
 #if __SSE2__
-        nn_hidden_size = hidden_size >> 2;
-        remain_hidden_size_start = nn_hidden_size << 2;
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int qq = 0; qq < nn_hidden_size; qq++)
+    for (; q + 3 < q1; q += 4)
+    {
+        const float* gates_data = gates.row(q);
+
+        __m128 _IFOG_4x4_0 = _mm_loadu_ps(gates_data);
+        __m128 _IFOG_4x4_1 = _mm_loadu_ps(gates_data + 4);
+        __m128 _IFOG_4x4_2 = _mm_loadu_ps(gates_data + 8);
+        __m128 _IFOG_4x4_3 = _mm_loadu_ps(gates_data + 12);
+
+        _MM_TRANSPOSE4_PS(_IFOG_4x4_0, _IFOG_4x4_1, _IFOG_4x4_2, _IFOG_4x4_3);
+
+        __m128 _lstm_I = sigmoid_sse(_IFOG_4x4_0);
+        __m128 _lstm_F = sigmoid_sse(_IFOG_4x4_1);
+        __m128 _lstm_O = sigmoid_sse(_IFOG_4x4_2);
+        __m128 _lstm_G = tanh_sse(_IFOG_4x4_3);
+
+        __m128 _cell2 = _mm_add_ps(_mm_mul_ps(_lstm_F, _mm_loadu_ps(cell_ptr + q)), _mm_mul_ps(_lstm_I, _lstm_G));
+        __m128 _lstm_H = _mm_mul_ps(_lstm_O, tanh_sse(_cell2));
+
+        _mm_storeu_ps(cell_ptr + q, _cell2);
+
+        if (num_output == hidden_size)
         {
-            int q = qq * 4;
+            _mm_storeu_ps(output_data + q, _lstm_H);
+        }
+        else
+        {
+            _mm_storeu_ps(tmp_hidden_ptr + q, _lstm_H);
+        }
+    }
+#endif // __SSE2__
+    for (; q < q1; q++)
+    {
+        const float* gates_data = gates.row(q);
+
+        float I = gates_data[0];
+        float F = gates_data[1];
+        float O = gates_data[2];
+        float G = gates_data[3];
 
-            const float* gates_data = gates.row(q);
+        I = 1.f / (1.f + expf(-I));
+        F = 1.f / (1.f + expf(-F));
+        O = 1.f / (1.f + expf(-O));
+        G = tanhf(G);
 
-            __m128 _IFOG_4x4_0 = _mm_loadu_ps(gates_data);
-            __m128 _IFOG_4x4_1 = _mm_loadu_ps(gates_data + 4);
-            __m128 _IFOG_4x4_2 = _mm_loadu_ps(gates_data + 8);
-            __m128 _IFOG_4x4_3 = _mm_loadu_ps(gates_data + 12);
+        float cell2 = F * cell_ptr[q] + I * G;
+        float H = O * tanhf(cell2);
+
+        cell_ptr[q] = cell2;
+        if (num_output == hidden_size)
+        {
+            output_data[q] = H;
+        }
+        else
+        {
+            tmp_hidden_ptr[q] = H;
+        }
+    }
+}
 
-            _MM_TRANSPOSE4_PS(_IFOG_4x4_0, _IFOG_4x4_1, _IFOG_4x4_2, _IFOG_4x4_3);
+// projection of timestep t for the outputs [q0, q1)
+static void lstm_projection(Mat& top_blob, int reverse, int t, const Mat& weight_hr, const Mat& tmp_hidden_state, int q0, int q1)
+{
+    int T = top_blob.h;
+    int hidden_size = tmp_hidden_state.w;
 
-            __m128 _lstm_I = sigmoid_sse(_IFOG_4x4_0);
-            __m128 _lstm_F = sigmoid_sse(_IFOG_4x4_1);
-            __m128 _lstm_O = sigmoid_sse(_IFOG_4x4_2);
-            __m128 _lstm_G = tanh_sse(_IFOG_4x4_3);
+    int ti = reverse ? T - 1 - t : t;
 
-            __m128 _cell2 = _mm_add_ps(_mm_mul_ps(_lstm_F, _mm_loadu_ps(cell_ptr + q)), _mm_mul_ps(_lstm_I, _lstm_G));
-            __m128 _lstm_H = _mm_mul_ps(_lstm_O, tanh_sse(_cell2));
+    float* output_data = top_blob.row(ti);
 
-            _mm_storeu_ps(cell_ptr + q, _cell2);
+    for (int q = q0; q < q1; q++)
+    {
+        const float* hr = weight_hr.row(q);
+        const float* tmp_hidden_ptr = tmp_hidden_state;
 
-            if (num_output == hidden_size)
-            {
-                _mm_storeu_ps(hidden_ptr + q, _lstm_H);
-                _mm_storeu_ps(output_data + q, _lstm_H);
-            }
-            else
-            {
-                _mm_storeu_ps(tmp_hidden_ptr + q, _lstm_H);
-            }
+        float H = 0;
+        for (int i = 0; i < hidden_size; i++)
+        {
+            H += tmp_hidden_ptr[i] * hr[i];
         }
-#else  // __SSE2__
-        remain_hidden_size_start = 0;
-#endif // __SSE2__
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q = remain_hidden_size_start; q < hidden_size; q++)
+
+        output_data[q] = H;
+    }
+}
+
+// the hidden state of the last timestep for the outputs [q0, q1)
+static void lstm_hidden_state(const Mat& top_blob, int reverse, Mat& hidden_state, int q0, int q1)
+{
+    int T = top_blob.h;
+    if (T == 0)
+        return;
+
+    const float* output_data = top_blob.row(reverse ? 0 : T - 1);
+    float* hidden_ptr = hidden_state;
+
+    for (int q = q0; q < q1; q++)
+    {
+        hidden_ptr[q] = output_data[q];
+    }
+}
+
+// all timesteps on thread tid of a team of nT, the team meets at a spin barrier after each step
+static void lstm_team(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& weight_hr, Mat& hidden_state, Mat& cell_state, Mat& gates, Mat& tmp_hidden_state, SpinBarrier& barrier, int tid, int nT)
+{
+    int T = bottom_blob.h;
+
+    int num_output = top_blob.w;
+    int hidden_size = cell_state.w;
+
+    // the same hidden units on the same thread every step, so gates and cell need no barrier
+    int q0;
+    int q1;
+    get_thread_range(hidden_size, 4, tid, nT, q0, q1);
+
+    int p0;
+    int p1;
+    get_thread_range(num_output, 1, tid, nT, p0, p1);
+
+    for (int t = 0; t < T; t++)
+    {
+        lstm_step(bottom_blob, top_blob, reverse, t, weight_xc, bias_c, weight_hc, hidden_state, cell_state, gates, tmp_hidden_state, q0, q1);
+
+        barrier.wait(nT);
+
+        if (num_output != hidden_size)
         {
-            const float* gates_data = gates.row(q);
+            lstm_projection(top_blob, reverse, t, weight_hr, tmp_hidden_state, p0, p1);
 
-            float I = gates_data[0];
-            float F = gates_data[1];
-            float O = gates_data[2];
-            float G = gates_data[3];
+            barrier.wait(nT);
+        }
+    }
 
-            I = 1.f / (1.f + expf(-I));
-            F = 1.f / (1.f + expf(-F));
-            O = 1.f / (1.f + expf(-O));
-            G = tanhf(G);
+    lstm_hidden_state(top_blob, reverse, hidden_state, p0, p1);
+}
 
-            float cell2 = F * cell_ptr[q] + I * G;
-            float H = O * tanhf(cell2);
+static int lstm(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& weight_hr, Mat& hidden_state, Mat& cell_state, const Option& opt)
+{
+    int num_output = top_blob.w;
+    int hidden_size = cell_state.w;
 
-            cell_ptr[q] = cell2;
-            if (num_output == hidden_size)
-            {
-                hidden_ptr[q] = H;
-                output_data[q] = H;
-            }
-            else
-            {
-                tmp_hidden_ptr[q] = H;
-            }
+    // 4 x hidden_size
+    Mat gates(4, hidden_size, 4u, opt.workspace_allocator);
+    if (gates.empty())
+        return -100;
+
+    Mat tmp_hidden_state;
+    if (num_output != hidden_size)
+    {
+        tmp_hidden_state.create(hidden_size, 4u, opt.workspace_allocator);
+        if (tmp_hidden_state.empty())
+            return -100;
+    }
+
+#if NCNN_SIMPLEOMP
+    // simpleomp may run the team one after another, enter the parallel region per step instead
+    int T = bottom_blob.h;
+    for (int t = 0; t < T; t++)
+    {
+        #pragma omp parallel num_threads(opt.num_threads)
+        {
+            int q0;
+            int q1;
+            get_thread_range(hidden_size, 4, get_omp_thread_num(), get_omp_num_threads(), q0, q1);
+
+            lstm_step(bottom_blob, top_blob, reverse, t, weight_xc, bias_c, weight_hc, hidden_state, cell_state, gates, tmp_hidden_state, q0, q1);
         }
 
         if (num_output != hidden_size)
         {
-            // int nn_num_output = num_output >> 2;
-            // int remain_num_output_start = nn_num_output << 2;
-            // #pragma omp parallel for num_threads(opt.num_threads)
-            // for (int qq = 0; qq < nn_num_output; qq++)
-            // {
-            //     int q = qq * 4;
-            //
-            // }
-            int remain_num_output_start = 0;
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int q = remain_num_output_start; q < num_output; q++)
+            #pragma omp parallel num_threads(opt.num_threads)
             {
-                const float* hr = weight_hr.row(q);
-                const float* tmp_hidden_ptr = tmp_hidden_state;
+                int q0;
+                int q1;
+                get_thread_range(num_output, 1, get_omp_thread_num(), get_omp_num_threads(), q0, q1);
 
-                float H = 0;
-                for (int i = 0; i < hidden_size; i++)
-                {
-                    H += tmp_hidden_ptr[i] * hr[i];
-                }
+                lstm_projection(top_blob, reverse, t, weight_hr, tmp_hidden_state, q0, q1);
+            }
+        }
+    }
+
+    lstm_hidden_state(top_blob, reverse, hidden_state, 0, num_output);
+#else  // NCNN_SIMPLEOMP
+    SpinBarrier barrier;
 
-                output_data[q] = H;
-                hidden_ptr[q] = H;
+    // one parallel region for the whole sequence
+    #pragma omp parallel num_threads(opt.num_threads)
+    {
+        lstm_team(bottom_blob, top_blob, reverse, weight_xc, bias_c, weight_hc, weight_hr, hidden_state, cell_state, gates, tmp_hidden_state, barrier, get_omp_thread_num(), get_omp_num_threads());
+    }
+#endif // NCNN_SIMPLEOMP
+
+    return 0;
+}
+
+// both directions at once, each on one half of the team
+// the weights and states hold the forward direction in channel / row 0 and the reverse in 1
+static int lstm_bidirectional(const Mat& bottom_blob, Mat& top_blob_forward, Mat& top_blob_reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& weight_hr, Mat& hidden_state, Mat& cell_state, const Option& opt)
+{
+    int num_output = top_blob_forward.w;
+    int hidden_size = cell_state.w;
+
+    Mat hidden0 = hidden_state.row_range(0, 1);
+    Mat cell0 = cell_state.row_range(0, 1);
+    Mat hidden1 = hidden_state.row_range(1, 1);
+    Mat cell1 = cell_state.row_range(1, 1);
+
+    const Mat weight_hr0 = num_output == hidden_size ? Mat() : weight_hr.channel(0);
+    const Mat weight_hr1 = num_output == hidden_size ? Mat() : weight_hr.channel(1);
+
+#if NCNN_SIMPLEOMP
+    {
+        int ret = lstm(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), weight_hr0, hidden0, cell0, opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    {
+        int ret = lstm(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), weight_hr1, hidden1, cell1, opt);
+        if (ret != 0)
+            return ret;
+    }
+#else  // NCNN_SIMPLEOMP
+    Mat gates(4, hidden_size, 2, 4u, opt.workspace_allocator);
+    if (gates.empty())
+        return -100;
+
+    Mat tmp_hidden_state;
+    if (num_output != hidden_size)
+    {
+        tmp_hidden_state.create(hidden_size, 2, 4u, opt.workspace_allocator);
+        if (tmp_hidden_state.empty())
+            return -100;
+    }
+
+    Mat gates0 = gates.channel(0);
+    Mat gates1 = gates.channel(1);
+    Mat tmp_hidden_state0 = num_output == hidden_size ? Mat() : tmp_hidden_state.row_range(0, 1);
+    Mat tmp_hidden_state1 = num_output == hidden_size ? Mat() : tmp_hidden_state.row_range(1, 1);
+
+    SpinBarrier barrier0;
+    SpinBarrier barrier1;
+
+    #pragma omp parallel num_threads(opt.num_threads)
+    {
+        const int tid = get_omp_thread_num();
+        const int nT = get_omp_num_threads();
+
+        if (nT == 1)
+        {
+            lstm_team(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), weight_hr0, hidden0, cell0, gates0, tmp_hidden_state0, barrier0, 0, 1);
+            lstm_team(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), weight_hr1, hidden1, cell1, gates1, tmp_hidden_state1, barrier1, 0, 1);
+        }
+        else
+        {
+            const int nT0 = (nT + 1) / 2;
+            if (tid < nT0)
+            {
+                lstm_team(bottom_blob, top_blob_forward, 0, weight_xc.channel(0), bias_c.channel(0), weight_hc.channel(0), weight_hr0, hidden0, cell0, gates0, tmp_hidden_state0, barrier0, tid, nT0);
+            }
+            else
+            {
+                lstm_team(bottom_blob, top_blob_reverse, 1, weight_xc.channel(1), bias_c.channel(1), weight_hc.channel(1), weight_hr1, hidden1, cell1, gates1, tmp_hidden_state1, barrier1, tid - nT0, nT - nT0);
             }
         }
     }
+#endif // NCNN_SIMPLEOMP
 
     return 0;
 }
@@ -575,12 +724,12 @@ int LSTM_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
     int num_directions = direction == 2 ? 2 : 1;
 
     // initial hidden state
-    Mat hidden(num_output, 4u, opt.workspace_allocator);
+    Mat hidden(num_output, num_directions, 4u, opt.workspace_allocator);
     if (hidden.empty())
         return -100;
     hidden.fill(0.f);
 
-    Mat cell(hidden_size, 4u, opt.workspace_allocator);
+    Mat cell(hidden_size, num_directions, 4u, opt.workspace_allocator);
     if (cell.empty())
         return -100;
     cell.fill(0.f);
@@ -608,16 +757,7 @@ int LSTM_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
             return -100;
 
         {
-            int ret = lstm(bottom_blob, top_blob_forward, 0, weight_xc_data_packed.channel(0), bias_c_data_packed.channel(0), weight_hc_data_packed.channel(0), num_output == hidden_size ? Mat() : weight_hr_data.channel(0), hidden, cell, opt);
-            if (ret != 0)
-                return ret;
-        }
-
-        hidden.fill(0.0f);
-        cell.fill(0.0f);
-
-        {
-            int ret = lstm(bottom_blob, top_blob_reverse, 1, weight_xc_data_packed.channel(1), bias_c_data_packed.channel(1), weight_hc_data_packed.channel(1), num_output == hidden_size ? Mat() : weight_hr_data.channel(1), hidden, cell, opt);
+            int ret = lstm_bidirectional(bottom_blob, top_blob_forward, top_blob_reverse, weight_xc_data_packed, bias_c_data_packed, weight_hc_data_packed, weight_hr_data, hidden, cell, opt);
             if (ret != 0)
                 return ret;
         }
@@ -694,18 +834,8 @@ int LSTM_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& to
         if (top_blob_reverse.empty())
             return -100;
 
-        Mat hidden0 = hidden.row_range(0, 1);
-        Mat cell0 = cell.row_range(0, 1);
-        {
-            int ret = lstm(bottom_blob, top_blob_forward, 0, weight_xc_data_packed.channel(0), bias_c_data_packed.channel(0), weight_hc_data_packed.channel(0), num_output == hidden_size ? Mat() : weight_hr_data.channel(0), hidden0, cell0, opt);
-            if (ret != 0)
-                return ret;
-        }
-
-        Mat hidden1 = hidden.row_range(1, 1);
-        Mat cell1 = cell.row_range(1, 1);
         {
-            int ret = lstm(bottom_blob, top_blob_reverse, 1, weight_xc_data_packed.channel(1), bias_c_data_packed.channel(1), weight_hc_data_packed.channel(1), num_output == hidden_size ? Mat() : weight_hr_data.channel(1), hidden1, cell1, opt);
+            int ret = lstm_bidirectional(bottom_blob, top_blob_forward, top_blob_reverse, weight_xc_data_packed, bias_c_data_packed, weight_hc_data_packed, weight_hr_data, hidden, cell, opt);
             if (ret != 0)
                 return ret;
         }
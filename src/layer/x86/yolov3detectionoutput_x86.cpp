@@ -6,6 +6,8 @@
 
 #include "yolov3detectionoutput_x86.h"
 
+#include "detection.h"
+
 #include <float.h>
 
 namespace ncnn {
@@ -22,11 +24,11 @@ static inline float sigmoid(float x)
 int Yolov3DetectionOutput_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
     // gather all box
-    std::vector<BBoxRect> all_bbox_rects;
+    std::vector<Detection> all_bbox_rects;
 
     for (size_t b = 0; b < bottom_blobs.size(); b++)
     {
-        std::vector<std::vector<BBoxRect> > all_box_bbox_rects;
+        std::vector<std::vector<Detection> > all_box_bbox_rects;
         all_box_bbox_rects.resize(num_box);
         const Mat& bottom_top_blobs = bottom_blobs[b];
 
@@ -146,9 +148,7 @@ int Yolov3DetectionOutput_x86::forward(const std::vector<Mat>& bottom_blobs, std
                         float bbox_xmax = bbox_cx + bbox_w * 0.5f;
                         float bbox_ymax = bbox_cy + bbox_h * 0.5f;
 
-                        float area = bbox_w * bbox_h;
-
-                        BBoxRect c = {confidence, bbox_xmin, bbox_ymin, bbox_xmax, bbox_ymax, area, class_index};
+                        Detection c = {bbox_xmin, bbox_ymin, bbox_xmax, bbox_ymax, confidence, class_index};
                         all_box_bbox_rects[pp].push_back(c);
                     }
 
@@ -164,25 +164,25 @@ int Yolov3DetectionOutput_x86::forward(const std::vector<Mat>& bottom_blobs, std
 
         for (int i = 0; i < num_box; i++)
         {
-            const std::vector<BBoxRect>& box_bbox_rects = all_box_bbox_rects[i];
+            const std::vector<Detection>& box_bbox_rects = all_box_bbox_rects[i];
 
             all_bbox_rects.insert(all_bbox_rects.end(), box_bbox_rects.begin(), box_bbox_rects.end());
         }
     }
 
     // global sort inplace
-    qsort_descent_inplace(all_bbox_rects);
+    sort_detections(all_bbox_rects);
 
     // apply nms
-    std::vector<size_t> picked;
-    nms_sorted_bboxes(all_bbox_rects, picked, nms_threshold);
+    std::vector<int> picked;
+    nms_sorted_detections(all_bbox_rects, picked, nms_threshold);
 
     // select
-    std::vector<BBoxRect> bbox_rects;
+    std::vector<Detection> bbox_rects;
 
     for (size_t i = 0; i < picked.size(); i++)
     {
-        size_t z = picked[i];
+        int z = picked[i];
         bbox_rects.push_back(all_bbox_rects[z]);
     }
 
@@ -198,7 +198,7 @@ int Yolov3DetectionOutput_x86::forward(const std::vector<Mat>& bottom_blobs, std
 
     for (int i = 0; i < num_detected; i++)
     {
-        const BBoxRect& r = bbox_rects[i];
+        const Detection& r = bbox_rects[i];
         float score = r.score;
         float* outptr = top_blob.row(i);
 
@@ -3,10 +3,9 @@
 
 #include "yolov3detectionoutput.h"
 
+#include "detection.h"
 #include "layer_type.h"
 
-#include <float.h>
-
 namespace ncnn {
 
 Yolov3DetectionOutput::Yolov3DetectionOutput()
@@ -40,90 +39,6 @@ int Yolov3DetectionOutput::load_param(const ParamDict& pd)
     return 0;
 }
 
-static inline float intersection_area(const Yolov3DetectionOutput::BBoxRect& a, const Yolov3DetectionOutput::BBoxRect& b)
-{
-    if (a.xmin > b.xmax || a.xmax < b.xmin || a.ymin > b.ymax || a.ymax < b.ymin)
-    {
-        // no intersection
-        return 0.f;
-    }
-
-    float inter_width = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
-    float inter_height = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
-
-    return inter_width * inter_height;
-}
-
-void Yolov3DetectionOutput::qsort_descent_inplace(std::vector<BBoxRect>& datas, int left, int right) const
-{
-    int i = left;
-    int j = right;
-    float p = datas[(left + right) / 2].score;
-
-    while (i <= j)
-    {
-        while (datas[i].score > p)
-            i++;
-
-        while (datas[j].score < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(datas[i], datas[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    if (left < j)
-        qsort_descent_inplace(datas, left, j);
-
-    if (i < right)
-        qsort_descent_inplace(datas, i, right);
-}
-
-void Yolov3DetectionOutput::qsort_descent_inplace(std::vector<BBoxRect>& datas) const
-{
-    if (datas.empty())
-        return;
-
-    qsort_descent_inplace(datas, 0, static_cast<int>(datas.size() - 1));
-}
-
-void Yolov3DetectionOutput::nms_sorted_bboxes(std::vector<BBoxRect>& bboxes, std::vector<size_t>& picked, float nms_threshold) const
-{
-    picked.clear();
-
-    const size_t n = bboxes.size();
-
-    for (size_t i = 0; i < n; i++)
-    {
-        const BBoxRect& a = bboxes[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const BBoxRect& b = bboxes[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = a.area + b.area - inter_area;
-            // float IoU = inter_area / union_area
-            if (inter_area > nms_threshold * union_area)
-            {
-                keep = 0;
-                break;
-            }
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 static inline float sigmoid(float x)
 {
     return 1.f / (1.f + expf(-x));
@@ -132,11 +47,11 @@ static inline float sigmoid(float x)
 int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
     // gather all box
-    std::vector<BBoxRect> all_bbox_rects;
+    std::vector<Detection> all_bbox_rects;
 
     for (size_t b = 0; b < bottom_blobs.size(); b++)
     {
-        std::vector<std::vector<BBoxRect> > all_box_bbox_rects;
+        std::vector<std::vector<Detection> > all_box_bbox_rects;
         all_box_bbox_rects.resize(num_box);
         const Mat& bottom_top_blobs = bottom_blobs[b];
 
@@ -175,22 +90,18 @@ int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::ve
             Mat scores = bottom_top_blobs.channel_range(p + 5, num_class);
             //softmax->forward_inplace(scores, opt);
 
+            // class index with max class score of each position in a row
+            std::vector<int> class_indexes(w);
+            std::vector<float> class_scores(w);
+
             for (int i = 0; i < h; i++)
             {
+                argmax_scores(scores.row(i), num_class, scores.cstep, w, class_indexes.data(), class_scores.data());
+
                 for (int j = 0; j < w; j++)
                 {
-                    // find class index with max class score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int q = 0; q < num_class; q++)
-                    {
-                        float score = scores.channel(q).row(i)[j];
-                        if (score > class_score)
-                        {
-                            class_index = q;
-                            class_score = score;
-                        }
-                    }
+                    const int class_index = class_indexes[j];
+                    const float class_score = class_scores[j];
 
                     //sigmoid(box_score) * sigmoid(class_score)
                     float confidence = 1.f / ((1.f + expf(-box_score_ptr[0]) * (1.f + expf(-class_score))));
@@ -207,9 +118,7 @@ int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::ve
                         float bbox_xmax = bbox_cx + bbox_w * 0.5f;
                         float bbox_ymax = bbox_cy + bbox_h * 0.5f;
 
-                        float area = bbox_w * bbox_h;
-
-                        BBoxRect c = {confidence, bbox_xmin, bbox_ymin, bbox_xmax, bbox_ymax, area, class_index};
+                        Detection c = {bbox_xmin, bbox_ymin, bbox_xmax, bbox_ymax, confidence, class_index};
                         all_box_bbox_rects[pp].push_back(c);
                     }
 
@@ -225,25 +134,25 @@ int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::ve
 
         for (int i = 0; i < num_box; i++)
         {
-            const std::vector<BBoxRect>& box_bbox_rects = all_box_bbox_rects[i];
+            const std::vector<Detection>& box_bbox_rects = all_box_bbox_rects[i];
 
             all_bbox_rects.insert(all_bbox_rects.end(), box_bbox_rects.begin(), box_bbox_rects.end());
         }
     }
 
     // global sort inplace
-    qsort_descent_inplace(all_bbox_rects);
+    sort_detections(all_bbox_rects);
 
     // apply nms
-    std::vector<size_t> picked;
-    nms_sorted_bboxes(all_bbox_rects, picked, nms_threshold);
+    std::vector<int> picked;
+    nms_sorted_detections(all_bbox_rects, picked, nms_threshold);
 
     // select
-    std::vector<BBoxRect> bbox_rects;
+    std::vector<Detection> bbox_rects;
 
     for (size_t i = 0; i < picked.size(); i++)
     {
-        size_t z = picked[i];
+        int z = picked[i];
         bbox_rects.push_back(all_bbox_rects[z]);
     }
 
@@ -259,7 +168,7 @@ int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::ve
 
     for (int i = 0; i < num_detected; i++)
     {
-        const BBoxRect& r = bbox_rects[i];
+        const Detection& r = bbox_rects[i];
         float score = r.score;
         float* outptr = top_blob.row(i);
 
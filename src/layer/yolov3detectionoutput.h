@@ -28,22 +28,6 @@ public:
     Mat anchors_scale;
     int mask_group_num;
     ncnn::Layer* softmax;
-
-public:
-    struct BBoxRect
-    {
-        float score;
-        float xmin;
-        float ymin;
-        float xmax;
-        float ymax;
-        float area;
-        int label;
-    };
-
-    void qsort_descent_inplace(std::vector<BBoxRect>& datas, int left, int right) const;
-    void qsort_descent_inplace(std::vector<BBoxRect>& datas) const;
-    void nms_sorted_bboxes(std::vector<BBoxRect>& bboxes, std::vector<size_t>& picked, float nms_threshold) const;
 };
 
 } // namespace ncnn
@@ -1120,83 +1120,189 @@ void VkImageMat::create_like(const VkImageMat& im, VkAllocator* _allocator)
 
 void Mat::substract_mean_normalize(const float* mean_vals, const float* norm_vals)
 {
-    Layer* op;
+    Option opt;
+    opt.num_threads = 1;
+
+    substract_mean_normalize(mean_vals, norm_vals, opt);
+}
 
-    if (mean_vals && !norm_vals)
+void Mat::substract_mean_normalize(const float* mean_vals, const float* norm_vals, const Option& opt)
+{
+    if (!mean_vals && !norm_vals)
+        return;
+
+    if (dims == 1 || dims == 2)
     {
-        // substract mean only
-        op = create_layer(LayerType::Bias);
+        // c is 1 here, the whole mat is one channel like the former bias and scale layer path
+        Mat m(w * h * elempack, 1, 1, data, elemsize / elempack, 1);
+        MeanNormalizer normalizer(mean_vals, norm_vals, 1);
+        normalizer.apply(m, opt);
+        return;
+    }
 
-        ParamDict pd;
-        pd.set(0, c);
+    MeanNormalizer normalizer(mean_vals, norm_vals, c * elempack);
+    normalizer.apply(*this, opt);
+}
 
-        op->load_param(pd);
+MeanNormalizer::MeanNormalizer()
+{
+    channels = 0;
+}
 
-        Mat weights[1];
-        weights[0] = Mat(c);
-        for (int q = 0; q < c; q++)
-        {
-            weights[0][q] = -mean_vals[q];
-        }
+MeanNormalizer::MeanNormalizer(const float* mean_vals, const float* norm_vals, int _channels)
+{
+    channels = _channels;
 
-        op->load_model(ModelBinFromMatArray(weights));
-    }
-    else if (!mean_vals && norm_vals)
+    scale_data.create(channels);
+    bias_data.create(channels);
+    if (scale_data.empty() || bias_data.empty())
+        return;
+
+    for (int q = 0; q < channels; q++)
     {
-        // normalize only
-        op = create_layer(LayerType::Scale);
+        const float mean = mean_vals ? mean_vals[q] : 0.f;
+        const float norm = norm_vals ? norm_vals[q] : 1.f;
+        scale_data[q] = norm;
+        bias_data[q] = norm_vals ? -mean * norm : -mean;
+    }
+}
 
-        ParamDict pd;
-        pd.set(0, c);
+// ptr holds n floats whose lane i belongs to scale[i % elempack] and bias[i % elempack]
+static void mean_normalize_inplace(float* ptr, int n, int elempack, const float* scale, const float* bias)
+{
+    // repeat the lanes to 16 floats so that every vector width sees a whole period
+    float scale16[16];
+    float bias16[16];
+    for (int k = 0; k < 16; k++)
+    {
+        scale16[k] = scale[k % elempack];
+        bias16[k] = bias[k % elempack];
+    }
+
+    int i = 0;
+#if __AVX512F__
+    __m512 _s = _mm512_loadu_ps(scale16);
+    __m512 _b = _mm512_loadu_ps(bias16);
+    for (; i + 15 < n; i += 16)
+    {
+        _mm512_storeu_ps(ptr + i, _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(ptr + i), _s), _b));
+    }
+#elif __AVX__
+    __m256 _s0 = _mm256_loadu_ps(scale16);
+    __m256 _s1 = _mm256_loadu_ps(scale16 + 8);
+    __m256 _b0 = _mm256_loadu_ps(bias16);
+    __m256 _b1 = _mm256_loadu_ps(bias16 + 8);
+    for (; i + 15 < n; i += 16)
+    {
+        __m256 _p0 = _mm256_loadu_ps(ptr + i);
+        __m256 _p1 = _mm256_loadu_ps(ptr + i + 8);
+        _mm256_storeu_ps(ptr + i, _mm256_add_ps(_mm256_mul_ps(_p0, _s0), _b0));
+        _mm256_storeu_ps(ptr + i + 8, _mm256_add_ps(_mm256_mul_ps(_p1, _s1), _b1));
+    }
+#elif __SSE2__
+    __m128 _s0 = _mm_loadu_ps(scale16);
+    __m128 _s1 = _mm_loadu_ps(scale16 + 4);
+    __m128 _s2 = _mm_loadu_ps(scale16 + 8);
+    __m128 _s3 = _mm_loadu_ps(scale16 + 12);
+    __m128 _b0 = _mm_loadu_ps(bias16);
+    __m128 _b1 = _mm_loadu_ps(bias16 + 4);
+    __m128 _b2 = _mm_loadu_ps(bias16 + 8);
+    __m128 _b3 = _mm_loadu_ps(bias16 + 12);
+    for (; i + 15 < n; i += 16)
+    {
+        _mm_storeu_ps(ptr + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr + i), _s0), _b0));
+        _mm_storeu_ps(ptr + i + 4, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr + i + 4), _s1), _b1));
+        _mm_storeu_ps(ptr + i + 8, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr + i + 8), _s2), _b2));
+        _mm_storeu_ps(ptr + i + 12, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr + i + 12), _s3), _b3));
+    }
+#elif __ARM_NEON
+    float32x4_t _s0 = vld1q_f32(scale16);
+    float32x4_t _s1 = vld1q_f32(scale16 + 4);
+    float32x4_t _s2 = vld1q_f32(scale16 + 8);
+    float32x4_t _s3 = vld1q_f32(scale16 + 12);
+    float32x4_t _b0 = vld1q_f32(bias16);
+    float32x4_t _b1 = vld1q_f32(bias16 + 4);
+    float32x4_t _b2 = vld1q_f32(bias16 + 8);
+    float32x4_t _b3 = vld1q_f32(bias16 + 12);
+    for (; i + 15 < n; i += 16)
+    {
+        vst1q_f32(ptr + i, vmlaq_f32(_b0, vld1q_f32(ptr + i), _s0));
+        vst1q_f32(ptr + i + 4, vmlaq_f32(_b1, vld1q_f32(ptr + i + 4), _s1));
+        vst1q_f32(ptr + i + 8, vmlaq_f32(_b2, vld1q_f32(ptr + i + 8), _s2));
+        vst1q_f32(ptr + i + 12, vmlaq_f32(_b3, vld1q_f32(ptr + i + 12), _s3));
+    }
+#endif // __AVX512F__
+    for (; i < n; i++)
+    {
+        ptr[i] = ptr[i] * scale16[i % 16] + bias16[i % 16];
+    }
+}
 
-        op->load_param(pd);
+int MeanNormalizer::apply(Mat& m, const Option& opt) const
+{
+    if (m.empty())
+        return 0;
 
-        Mat weights[1];
-        weights[0] = Mat(c);
-        for (int q = 0; q < c; q++)
-        {
-            weights[0][q] = norm_vals[q];
-        }
+    const int elempack = m.elempack;
+    if (m.elemsize != elempack * 4u)
+    {
+        NCNN_LOGE("MeanNormalizer only works on fp32 mat, got elemsize %d elempack %d", (int)m.elemsize, elempack);
+        return -1;
+    }
 
-        op->load_model(ModelBinFromMatArray(weights));
+    // split into groups of elempack channels
+    int groups;
+    int size;
+    size_t group_step;
+    if (m.dims == 1)
+    {
+        groups = m.w;
+        size = 1;
+        group_step = elempack;
+    }
+    else if (m.dims == 2)
+    {
+        groups = m.h;
+        size = m.w;
+        group_step = (size_t)m.w * elempack;
     }
-    else if (mean_vals && norm_vals)
+    else
     {
-        // substract mean and normalize
-        op = create_layer(LayerType::Scale);
+        groups = m.c;
+        size = m.w * m.h * m.d;
+        group_step = m.cstep * elempack;
+    }
 
-        ParamDict pd;
-        pd.set(0, c);
-        pd.set(1, 1);
+    if (groups * elempack != channels || scale_data.empty())
+    {
+        NCNN_LOGE("MeanNormalizer set up for %d channels, got %d", channels, groups * elempack);
+        return -1;
+    }
 
-        op->load_param(pd);
+    const float* scale = scale_data;
+    const float* bias = bias_data;
 
-        Mat weights[2];
-        weights[0] = Mat(c);
-        weights[1] = Mat(c);
-        for (int q = 0; q < c; q++)
+    if (m.dims == 1)
+    {
+        // channels are contiguous, run the whole vector at once
+        float* ptr = m;
+        for (int i = 0; i < groups * elempack; i++)
         {
-            weights[0][q] = norm_vals[q];
-            weights[1][q] = -mean_vals[q] * norm_vals[q];
+            ptr[i] = ptr[i] * scale[i] + bias[i];
         }
 
-        op->load_model(ModelBinFromMatArray(weights));
-    }
-    else // if (!mean_vals && !norm_vals)
-    {
-        return;
+        return 0;
     }
 
-    Option opt;
-    opt.num_threads = 1; // TODO
-
-    op->create_pipeline(opt);
-
-    op->forward_inplace(*this, opt);
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < groups; q++)
+    {
+        float* ptr = (float*)m.data + group_step * q;
 
-    op->destroy_pipeline(opt);
+        mean_normalize_inplace(ptr, size * elempack, elempack, scale + q * elempack, bias + q * elempack);
+    }
 
-    delete op;
+    return 0;
 }
 
 Mat Mat::from_float16(const unsigned short* data, int size)
@@ -1211,6 +1317,23 @@ Mat Mat::from_float16(const unsigned short* data, int size)
     return dst;
 }
 
+Mat Mat::from_external(void* data, int w, int h, int c, size_t cstep, size_t elemsize, int elempack)
+{
+    Mat m(w, h, c, data, elemsize, elempack);
+    if (cstep == 0)
+        return m;
+
+    if (cstep < (size_t)w * h)
+    {
+        NCNN_LOGE("cstep %d is smaller than channel size %d x %d", (int)cstep, w, h);
+        return Mat();
+    }
+
+    m.cstep = cstep;
+
+    return m;
+}
+
 #if NCNN_VULKAN
 #if NCNN_PLATFORM_API
 #if __ANDROID_API__ >= 26
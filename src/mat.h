@@ -46,6 +46,55 @@ class VkMat;
 class VkImageMat;
 #endif // NCNN_VULKAN
 
+#if NCNN_PIXEL
+// parameters of Mat::from_pixels_preprocess()
+class NCNN_EXPORT PixelPreprocessOption
+{
+public:
+    PixelPreprocessOption();
+
+    // letterbox a w x h image like yolov5, the longer side is scaled to target_size keeping aspect ratio
+    // then the output is padded to the next multiple of align with the image centered, or to target_size square when align is 0
+    void set_letterbox(int w, int h, int target_size, int align = 0);
+
+public:
+    // source roi, roiw and roih 0 for the whole image
+    int roix;
+    int roiy;
+    int roiw;
+    int roih;
+
+    // resize to this size, 0 for the roi size
+    int target_width;
+    int target_height;
+
+    // constant border around the resized image, the output is the target size plus borders
+    int pad_top;
+    int pad_bottom;
+    int pad_left;
+    int pad_right;
+
+    // border pixel value before substract mean and normalize
+    float pad_value;
+
+    // channel-wise (v - mean) * norm on the converted pixel, null to skip
+    const float* mean_vals;
+    const float* norm_vals;
+
+    // output elempack, must divide the output channel count
+    int elempack;
+
+    // output storage 0=fp32 1=fp16 2=bf16 3=int8
+    int elemtype;
+
+    // int8 output is round((v - mean) * norm * int8_scale)
+    float int8_scale;
+
+    // worker threads for the row bands
+    int num_threads;
+};
+#endif // NCNN_PIXEL
+
 // the three dimension matrix
 class NCNN_EXPORT Mat
 {
@@ -253,14 +302,24 @@ public:
         PIXEL_BGRA2GRAY = PIXEL_BGRA | (PIXEL_GRAY << PIXEL_CONVERT_SHIFT),
         PIXEL_BGRA2RGBA = PIXEL_BGRA | (PIXEL_RGBA << PIXEL_CONVERT_SHIFT),
     };
+    enum PixelResizeType
+    {
+        PIXEL_RESIZE_BILINEAR = 0,
+        PIXEL_RESIZE_AREA = 1,
+        PIXEL_RESIZE_BICUBIC = 2,
+    };
     // convenient construct from pixel data
     static Mat from_pixels(const unsigned char* pixels, int type, int w, int h, Allocator* allocator = 0);
     // convenient construct from pixel data with stride(bytes-per-row) parameter
     static Mat from_pixels(const unsigned char* pixels, int type, int w, int h, int stride, Allocator* allocator = 0);
+    // convenient construct from pixel data with stride(bytes-per-row) parameter, rows split across opt.num_threads
+    static Mat from_pixels(const unsigned char* pixels, int type, int w, int h, int stride, const Option& opt);
     // convenient construct from pixel data and resize to specific size
     static Mat from_pixels_resize(const unsigned char* pixels, int type, int w, int h, int target_width, int target_height, Allocator* allocator = 0);
     // convenient construct from pixel data and resize to specific size with stride(bytes-per-row) parameter
     static Mat from_pixels_resize(const unsigned char* pixels, int type, int w, int h, int stride, int target_width, int target_height, Allocator* allocator = 0);
+    // convenient construct from pixel data and resize to specific size with stride(bytes-per-row) parameter and PixelResizeType filter, rows split across opt.num_threads
+    static Mat from_pixels_resize(const unsigned char* pixels, int type, int w, int h, int stride, int target_width, int target_height, int resize_type, const Option& opt);
     // convenient construct from pixel data roi
     static Mat from_pixels_roi(const unsigned char* pixels, int type, int w, int h, int roix, int roiy, int roiw, int roih, Allocator* allocator = 0);
     // convenient construct from pixel data roi with stride(bytes-per-row) parameter
@@ -269,11 +328,24 @@ public:
     static Mat from_pixels_roi_resize(const unsigned char* pixels, int type, int w, int h, int roix, int roiy, int roiw, int roih, int target_width, int target_height, Allocator* allocator = 0);
     // convenient construct from pixel data roi and resize to specific size with stride(bytes-per-row) parameter
     static Mat from_pixels_roi_resize(const unsigned char* pixels, int type, int w, int h, int stride, int roix, int roiy, int roiw, int roih, int target_width, int target_height, Allocator* allocator = 0);
+    // convenient construct from pixel data with roi, resize, convert, substract mean, normalize and pack in one pass
+    // produces the same values as from_pixels_roi_resize() followed by substract_mean_normalize()
+    static Mat from_pixels_preprocess(const unsigned char* pixels, int type, int w, int h, int stride, const PixelPreprocessOption& opt, Allocator* allocator = 0);
+    // convenient construct from yuv420sp(nv21) frame with roi, resize, convert, substract mean, normalize and pack in one pass
+    // type is the output PIXEL_RGB PIXEL_BGR PIXEL_GRAY PIXEL_RGBA or PIXEL_BGRA, w and h must be even
+    // produces the same values as yuv420sp2rgb() followed by from_pixels_preprocess()
+    static Mat from_yuv420sp(const unsigned char* yuv420sp, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator = 0);
+    // convenient construct from yuv420sp(nv12) frame, same as from_yuv420sp() otherwise
+    static Mat from_yuv420sp_nv12(const unsigned char* yuv420sp, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator = 0);
+    // convenient construct from yuv420p(i420) frame, same as from_yuv420sp() otherwise
+    static Mat from_yuv420p(const unsigned char* yuv420p, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator = 0);
 
     // convenient export to pixel data
     void to_pixels(unsigned char* pixels, int type) const;
     // convenient export to pixel data with stride(bytes-per-row) parameter
     void to_pixels(unsigned char* pixels, int type, int stride) const;
+    // convenient export to pixel data with stride(bytes-per-row) parameter, rows split across opt.num_threads
+    void to_pixels(unsigned char* pixels, int type, int stride, const Option& opt) const;
     // convenient export to pixel data and resize to specific size
     void to_pixels_resize(unsigned char* pixels, int type, int target_width, int target_height) const;
     // convenient export to pixel data and resize to specific size with stride(bytes-per-row) parameter
@@ -296,11 +368,19 @@ public:
 #endif // NCNN_PIXEL
 
     // substract channel-wise mean values, then multiply by normalize values, pass 0 to skip
+    // the channel axis is c, a 1d or 2d mat is a single channel and only reads mean_vals[0] and norm_vals[0]
+    // sets up a MeanNormalizer and its two scale and bias mats on every call, keep one MeanNormalizer for repeated use
     void substract_mean_normalize(const float* mean_vals, const float* norm_vals);
+    // same as above, channels split across opt.num_threads
+    void substract_mean_normalize(const float* mean_vals, const float* norm_vals, const Option& opt);
 
     // convenient construct from half precision floating point data
     static Mat from_float16(const unsigned short* data, int size);
 
+    // wrap external memory without copy, channels are cstep elements apart, 0 for the default aligned cstep
+    // the memory is not owned and must outlive the mat
+    static Mat from_external(void* data, int w, int h, int c, size_t cstep, size_t elemsize = 4u, int elempack = 1);
+
     // pointer to the data
     void* data;
 
@@ -335,6 +415,26 @@ public:
     size_t cstep;
 };
 
+// channel-wise (v - mean) * norm set up once and applied in place to many mats without allocation
+// works on fp32 mat of any elempack, the channel axis is c for 3d/4d, h for 2d and w for 1d
+class NCNN_EXPORT MeanNormalizer
+{
+public:
+    MeanNormalizer();
+    // mean_vals and norm_vals hold channels values, pass 0 to skip
+    MeanNormalizer(const float* mean_vals, const float* norm_vals, int channels);
+
+    // returns -1 when m is not fp32 or its channel count differs
+    int apply(Mat& m, const Option& opt) const;
+
+public:
+    int channels;
+
+    // v * scale + bias
+    Mat scale_data;
+    Mat bias_data;
+};
+
 #if NCNN_VULKAN
 
 // the three dimension matrix, vulkan version
@@ -623,6 +723,36 @@ NCNN_EXPORT void resize_bilinear_c3(const unsigned char* src, int srcw, int srch
 NCNN_EXPORT void resize_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
 // image pixel bilinear resize, convenient wrapper for yuv420sp(nv21/nv12)
 NCNN_EXPORT void resize_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+// image pixel area resize, averages the source pixels covered by every destination pixel, upscale falls back to bilinear
+NCNN_EXPORT void resize_area_c1(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+NCNN_EXPORT void resize_area_c2(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+NCNN_EXPORT void resize_area_c3(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+NCNN_EXPORT void resize_area_c4(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+// image pixel area resize with stride(bytes-per-row) parameter
+NCNN_EXPORT void resize_area_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+NCNN_EXPORT void resize_area_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+NCNN_EXPORT void resize_area_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+NCNN_EXPORT void resize_area_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+// image pixel area resize with stride(bytes-per-row) parameter, rows split across opt.num_threads
+NCNN_EXPORT void resize_area_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+NCNN_EXPORT void resize_area_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+NCNN_EXPORT void resize_area_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+NCNN_EXPORT void resize_area_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+// image pixel bicubic resize
+NCNN_EXPORT void resize_bicubic_c1(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+NCNN_EXPORT void resize_bicubic_c2(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+NCNN_EXPORT void resize_bicubic_c3(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+NCNN_EXPORT void resize_bicubic_c4(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+// image pixel bicubic resize with stride(bytes-per-row) parameter
+NCNN_EXPORT void resize_bicubic_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+NCNN_EXPORT void resize_bicubic_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+NCNN_EXPORT void resize_bicubic_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+NCNN_EXPORT void resize_bicubic_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
+// image pixel bicubic resize with stride(bytes-per-row) parameter, rows split across opt.num_threads
+NCNN_EXPORT void resize_bicubic_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+NCNN_EXPORT void resize_bicubic_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+NCNN_EXPORT void resize_bicubic_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
+NCNN_EXPORT void resize_bicubic_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt);
 #endif // NCNN_PIXEL
 #if NCNN_PIXEL_ROTATE
 // type is the from type, 6 means rotating from 6 to 1
@@ -648,6 +778,13 @@ NCNN_EXPORT void kanna_rotate_c3(const unsigned char* src, int srcw, int srch, i
 NCNN_EXPORT void kanna_rotate_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type);
 // image pixel kanna rotate, convenient wrapper for yuv420sp(nv21/nv12)
 NCNN_EXPORT void kanna_rotate_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, int type);
+// image pixel kanna rotate with stride(bytes-per-row) parameter, destination rows split across opt.num_threads
+NCNN_EXPORT void kanna_rotate_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt);
+NCNN_EXPORT void kanna_rotate_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt);
+NCNN_EXPORT void kanna_rotate_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt);
+NCNN_EXPORT void kanna_rotate_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt);
+// image pixel kanna rotate for yuv420sp(nv21/nv12), destination rows split across opt.num_threads
+NCNN_EXPORT void kanna_rotate_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, int type, const Option& opt);
 #endif // NCNN_PIXEL_ROTATE
 #if NCNN_PIXEL_AFFINE
 // resolve affine transform matrix from rotation angle, scale factor and x y offset
@@ -668,6 +805,16 @@ NCNN_EXPORT void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int
 NCNN_EXPORT void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type = 0, unsigned int v = 0);
 // image pixel bilinear warpaffine, convenient wrapper for yuv420sp(nv21/nv12), set -233 for transparent border color, the color YUV_ is little-endian encoded
 NCNN_EXPORT void warpaffine_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, const float* tm, int type = 0, unsigned int v = 0);
+// image pixel bilinear warpaffine inverse transform with stride(bytes-per-row) parameter, rows split across opt.num_threads
+NCNN_EXPORT void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt);
+NCNN_EXPORT void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt);
+NCNN_EXPORT void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt);
+NCNN_EXPORT void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt);
+// image pixel bilinear warpaffine for yuv420sp(nv21/nv12), rows split across opt.num_threads
+NCNN_EXPORT void warpaffine_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, const float* tm, int type, unsigned int v, const Option& opt);
+// warp count regions of one source image in one call, dsts[i] receives w x h pixels of channels warped by tms + i * 6
+// regions are spread across opt.num_threads, channels is 1 ~ 4
+NCNN_EXPORT void warpaffine_bilinear_batch(const unsigned char* src, int srcw, int srch, int srcstride, int channels, int count, unsigned char* const* dsts, int w, int h, int stride, const float* tms, int type, unsigned int v, const Option& opt);
 #endif // NCNN_PIXEL_AFFINE
 #if NCNN_PIXEL_DRAWING
 // draw rectangle, set thickness -1 for filled rectangle, the color RGBA is little-endian encoded
@@ -13,6 +13,166 @@
 namespace ncnn {
 
 #if NCNN_PIXEL
+#if __SSE2__
+// widen 16 u8 to 16 fp32
+static NCNN_FORCEINLINE void store_u8x16_f32(float* ptr, __m128i _v)
+{
+#if __AVX512F__
+    _mm512_storeu_ps(ptr, _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_v)));
+#elif __AVX2__
+    _mm256_storeu_ps(ptr, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_v)));
+    _mm256_storeu_ps(ptr + 8, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_unpackhi_epi64(_v, _v))));
+#else
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _v16_0 = _mm_unpacklo_epi8(_v, _zero);
+    __m128i _v16_1 = _mm_unpackhi_epi8(_v, _zero);
+    _mm_storeu_ps(ptr, _mm_cvtepi32_ps(_mm_unpacklo_epi16(_v16_0, _zero)));
+    _mm_storeu_ps(ptr + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(_v16_0, _zero)));
+    _mm_storeu_ps(ptr + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(_v16_1, _zero)));
+    _mm_storeu_ps(ptr + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(_v16_1, _zero)));
+#endif
+}
+
+// narrow 16 fp32 to 16 u8, truncate and saturate like SATURATE_CAST_UCHAR
+static NCNN_FORCEINLINE __m128i load_f32_u8x16(const float* ptr)
+{
+#if __AVX512F__
+    __m512i _v = _mm512_max_epi32(_mm512_cvttps_epi32(_mm512_loadu_ps(ptr)), _mm512_setzero_si512());
+    return _mm512_cvtusepi32_epi8(_v);
+#else
+    __m128i _v0 = _mm_cvttps_epi32(_mm_loadu_ps(ptr));
+    __m128i _v1 = _mm_cvttps_epi32(_mm_loadu_ps(ptr + 4));
+    __m128i _v2 = _mm_cvttps_epi32(_mm_loadu_ps(ptr + 8));
+    __m128i _v3 = _mm_cvttps_epi32(_mm_loadu_ps(ptr + 12));
+    return _mm_packus_epi16(_mm_packs_epi32(_v0, _v1), _mm_packs_epi32(_v2, _v3));
+#endif
+}
+
+// deinterleave 16 pixels of 3 channels with unpack network
+static NCNN_FORCEINLINE void load_u8x16x3(const unsigned char* p, __m128i& _c0, __m128i& _c1, __m128i& _c2)
+{
+    __m128i _t00 = _mm_loadu_si128((const __m128i*)p);
+    __m128i _t01 = _mm_loadu_si128((const __m128i*)(p + 16));
+    __m128i _t02 = _mm_loadu_si128((const __m128i*)(p + 32));
+
+    __m128i _t10 = _mm_unpacklo_epi8(_t00, _mm_unpackhi_epi64(_t01, _t01));
+    __m128i _t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t00, _t00), _t02);
+    __m128i _t12 = _mm_unpacklo_epi8(_t01, _mm_unpackhi_epi64(_t02, _t02));
+
+    __m128i _t20 = _mm_unpacklo_epi8(_t10, _mm_unpackhi_epi64(_t11, _t11));
+    __m128i _t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t10, _t10), _t12);
+    __m128i _t22 = _mm_unpacklo_epi8(_t11, _mm_unpackhi_epi64(_t12, _t12));
+
+    __m128i _t30 = _mm_unpacklo_epi8(_t20, _mm_unpackhi_epi64(_t21, _t21));
+    __m128i _t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t20, _t20), _t22);
+    __m128i _t32 = _mm_unpacklo_epi8(_t21, _mm_unpackhi_epi64(_t22, _t22));
+
+    _c0 = _mm_unpacklo_epi8(_t30, _mm_unpackhi_epi64(_t31, _t31));
+    _c1 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t30, _t30), _t32);
+    _c2 = _mm_unpacklo_epi8(_t31, _mm_unpackhi_epi64(_t32, _t32));
+}
+
+// interleave 16 pixels of 3 channels
+static NCNN_FORCEINLINE void store_u8x16x3(unsigned char* p, __m128i _c0, __m128i _c1, __m128i _c2)
+{
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _c01_0 = _mm_unpacklo_epi8(_c0, _c1);
+    __m128i _c01_1 = _mm_unpackhi_epi8(_c0, _c1);
+    __m128i _c2z_0 = _mm_unpacklo_epi8(_c2, _zero);
+    __m128i _c2z_1 = _mm_unpackhi_epi8(_c2, _zero);
+
+    __m128i _p00 = _mm_unpacklo_epi16(_c01_0, _c2z_0);
+    __m128i _p01 = _mm_unpackhi_epi16(_c01_0, _c2z_0);
+    __m128i _p02 = _mm_unpacklo_epi16(_c01_1, _c2z_1);
+    __m128i _p03 = _mm_unpackhi_epi16(_c01_1, _c2z_1);
+
+    __m128i _p10 = _mm_unpacklo_epi32(_p00, _p01);
+    __m128i _p11 = _mm_unpackhi_epi32(_p00, _p01);
+    __m128i _p12 = _mm_unpacklo_epi32(_p02, _p03);
+    __m128i _p13 = _mm_unpackhi_epi32(_p02, _p03);
+
+    __m128i _p20 = _mm_slli_si128(_mm_unpacklo_epi64(_p10, _p11), 1);
+    __m128i _p21 = _mm_unpackhi_epi64(_p10, _p11);
+    __m128i _p22 = _mm_slli_si128(_mm_unpacklo_epi64(_p12, _p13), 1);
+    __m128i _p23 = _mm_unpackhi_epi64(_p12, _p13);
+
+    __m128i _p30 = _mm_slli_epi64(_mm_unpacklo_epi32(_p20, _p21), 8);
+    __m128i _p31 = _mm_srli_epi64(_mm_unpackhi_epi32(_p20, _p21), 8);
+    __m128i _p32 = _mm_slli_epi64(_mm_unpacklo_epi32(_p22, _p23), 8);
+    __m128i _p33 = _mm_srli_epi64(_mm_unpackhi_epi32(_p22, _p23), 8);
+
+    __m128i _p40 = _mm_unpacklo_epi64(_p30, _p31);
+    __m128i _p41 = _mm_unpackhi_epi64(_p30, _p31);
+    __m128i _p42 = _mm_unpacklo_epi64(_p32, _p33);
+    __m128i _p43 = _mm_unpackhi_epi64(_p32, _p33);
+
+    _mm_storeu_si128((__m128i*)p, _mm_or_si128(_mm_srli_si128(_p40, 2), _mm_slli_si128(_p41, 10)));
+    _mm_storeu_si128((__m128i*)(p + 16), _mm_or_si128(_mm_srli_si128(_p41, 6), _mm_slli_si128(_p42, 6)));
+    _mm_storeu_si128((__m128i*)(p + 32), _mm_or_si128(_mm_srli_si128(_p42, 10), _mm_slli_si128(_p43, 2)));
+}
+
+// deinterleave 16 pixels of 4 channels
+static NCNN_FORCEINLINE void load_u8x16x4(const unsigned char* p, __m128i& _c0, __m128i& _c1, __m128i& _c2, __m128i& _c3)
+{
+    __m128i _v0 = _mm_loadu_si128((const __m128i*)p);
+    __m128i _v1 = _mm_loadu_si128((const __m128i*)(p + 16));
+    __m128i _v2 = _mm_loadu_si128((const __m128i*)(p + 32));
+    __m128i _v3 = _mm_loadu_si128((const __m128i*)(p + 48));
+
+    __m128i _u0 = _mm_unpacklo_epi8(_v0, _v2);
+    __m128i _u1 = _mm_unpackhi_epi8(_v0, _v2);
+    __m128i _u2 = _mm_unpacklo_epi8(_v1, _v3);
+    __m128i _u3 = _mm_unpackhi_epi8(_v1, _v3);
+
+    _v0 = _mm_unpacklo_epi8(_u0, _u2);
+    _v1 = _mm_unpackhi_epi8(_u0, _u2);
+    _v2 = _mm_unpacklo_epi8(_u1, _u3);
+    _v3 = _mm_unpackhi_epi8(_u1, _u3);
+
+    _u0 = _mm_unpacklo_epi8(_v0, _v2);
+    _u1 = _mm_unpackhi_epi8(_v0, _v2);
+    _u2 = _mm_unpacklo_epi8(_v1, _v3);
+    _u3 = _mm_unpackhi_epi8(_v1, _v3);
+
+    _c0 = _mm_unpacklo_epi8(_u0, _u2);
+    _c1 = _mm_unpackhi_epi8(_u0, _u2);
+    _c2 = _mm_unpacklo_epi8(_u1, _u3);
+    _c3 = _mm_unpackhi_epi8(_u1, _u3);
+}
+
+// interleave 16 pixels of 4 channels
+static NCNN_FORCEINLINE void store_u8x16x4(unsigned char* p, __m128i _c0, __m128i _c1, __m128i _c2, __m128i _c3)
+{
+    __m128i _u0 = _mm_unpacklo_epi8(_c0, _c2);
+    __m128i _u1 = _mm_unpackhi_epi8(_c0, _c2);
+    __m128i _u2 = _mm_unpacklo_epi8(_c1, _c3);
+    __m128i _u3 = _mm_unpackhi_epi8(_c1, _c3);
+
+    _mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi8(_u0, _u2));
+    _mm_storeu_si128((__m128i*)(p + 16), _mm_unpackhi_epi8(_u0, _u2));
+    _mm_storeu_si128((__m128i*)(p + 32), _mm_unpacklo_epi8(_u1, _u3));
+    _mm_storeu_si128((__m128i*)(p + 48), _mm_unpackhi_epi8(_u1, _u3));
+}
+
+// (r * 77 + g * 150 + b * 29) >> 8, the sum never exceeds 65280
+static NCNN_FORCEINLINE __m128i rgb2gray_u8x16(__m128i _r, __m128i _g, __m128i _b)
+{
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _R2Y = _mm_set1_epi16(77);
+    __m128i _G2Y = _mm_set1_epi16(150);
+    __m128i _B2Y = _mm_set1_epi16(29);
+
+    __m128i _y0 = _mm_mullo_epi16(_mm_unpacklo_epi8(_r, _zero), _R2Y);
+    __m128i _y1 = _mm_mullo_epi16(_mm_unpackhi_epi8(_r, _zero), _R2Y);
+    _y0 = _mm_add_epi16(_y0, _mm_mullo_epi16(_mm_unpacklo_epi8(_g, _zero), _G2Y));
+    _y1 = _mm_add_epi16(_y1, _mm_mullo_epi16(_mm_unpackhi_epi8(_g, _zero), _G2Y));
+    _y0 = _mm_add_epi16(_y0, _mm_mullo_epi16(_mm_unpacklo_epi8(_b, _zero), _B2Y));
+    _y1 = _mm_add_epi16(_y1, _mm_mullo_epi16(_mm_unpackhi_epi8(_b, _zero), _B2Y));
+
+    return _mm_packus_epi16(_mm_srli_epi16(_y0, 8), _mm_srli_epi16(_y1, 8));
+}
+#endif // __SSE2__
+
 static int from_rgb(const unsigned char* rgb, int w, int h, int stride, Mat& m, Allocator* allocator)
 {
     m.create(w, h, 3, 4u, allocator);
@@ -35,6 +195,9 @@ static int from_rgb(const unsigned char* rgb, int w, int h, int stride, Mat& m,
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -108,6 +271,22 @@ static int from_rgb(const unsigned char* rgb, int w, int h, int stride, Mat& m,
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b;
+            load_u8x16x3(rgb, _r, _g, _b);
+
+            store_u8x16_f32(ptr0, _r);
+            store_u8x16_f32(ptr1, _g);
+            store_u8x16_f32(ptr2, _b);
+
+            rgb += 3 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = rgb[0];
@@ -149,6 +328,9 @@ static void to_rgb(const Mat& m, unsigned char* rgb, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -180,6 +362,21 @@ static void to_rgb(const Mat& m, unsigned char* rgb, int stride)
             ptr2 += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r = load_f32_u8x16(ptr0);
+            __m128i _g = load_f32_u8x16(ptr1);
+            __m128i _b = load_f32_u8x16(ptr2);
+
+            store_u8x16x3(rgb, _r, _g, _b);
+
+            rgb += 3 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             rgb[0] = SATURATE_CAST_UCHAR(*ptr0);
@@ -217,6 +414,9 @@ static int from_gray(const unsigned char* gray, int w, int h, int stride, Mat& m
 #if __ARM_NEON
         int nn = w >> 4;
         int remain = w - (nn << 4);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -273,6 +473,15 @@ static int from_gray(const unsigned char* gray, int w, int h, int stride, Mat& m
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            store_u8x16_f32(ptr, _mm_loadu_si128((const __m128i*)gray));
+
+            gray += 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr = *gray;
@@ -308,6 +517,9 @@ static void to_gray(const Mat& m, unsigned char* gray, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -328,6 +540,15 @@ static void to_gray(const Mat& m, unsigned char* gray, int stride)
             ptr += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            _mm_storeu_si128((__m128i*)gray, load_f32_u8x16(ptr));
+
+            gray += 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *gray = SATURATE_CAST_UCHAR(*ptr);
@@ -364,6 +585,9 @@ static int from_rgba(const unsigned char* rgba, int w, int h, int stride, Mat& m
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -451,6 +675,24 @@ static int from_rgba(const unsigned char* rgba, int w, int h, int stride, Mat& m
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b, _a;
+            load_u8x16x4(rgba, _r, _g, _b, _a);
+
+            store_u8x16_f32(ptr0, _r);
+            store_u8x16_f32(ptr1, _g);
+            store_u8x16_f32(ptr2, _b);
+            store_u8x16_f32(ptr3, _a);
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+            ptr3 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = rgba[0];
@@ -495,6 +737,9 @@ static void to_rgba(const Mat& m, unsigned char* rgba, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -531,6 +776,23 @@ static void to_rgba(const Mat& m, unsigned char* rgba, int stride)
             ptr3 += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r = load_f32_u8x16(ptr0);
+            __m128i _g = load_f32_u8x16(ptr1);
+            __m128i _b = load_f32_u8x16(ptr2);
+            __m128i _a = load_f32_u8x16(ptr3);
+
+            store_u8x16x4(rgba, _r, _g, _b, _a);
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+            ptr3 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             rgba[0] = SATURATE_CAST_UCHAR(*ptr0);
@@ -572,6 +834,9 @@ static int from_rgb2bgr(const unsigned char* rgb, int w, int h, int stride, Mat&
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -645,6 +910,22 @@ static int from_rgb2bgr(const unsigned char* rgb, int w, int h, int stride, Mat&
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b;
+            load_u8x16x3(rgb, _r, _g, _b);
+
+            store_u8x16_f32(ptr0, _b);
+            store_u8x16_f32(ptr1, _g);
+            store_u8x16_f32(ptr2, _r);
+
+            rgb += 3 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = rgb[2];
@@ -686,6 +967,9 @@ static void to_bgr2rgb(const Mat& m, unsigned char* rgb, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -717,6 +1001,21 @@ static void to_bgr2rgb(const Mat& m, unsigned char* rgb, int stride)
             ptr2 += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _b = load_f32_u8x16(ptr0);
+            __m128i _g = load_f32_u8x16(ptr1);
+            __m128i _r = load_f32_u8x16(ptr2);
+
+            store_u8x16x3(rgb, _r, _g, _b);
+
+            rgb += 3 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             rgb[2] = SATURATE_CAST_UCHAR(*ptr0);
@@ -760,6 +1059,9 @@ static int from_rgb2gray(const unsigned char* rgb, int w, int h, int stride, Mat
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -821,6 +1123,18 @@ static int from_rgb2gray(const unsigned char* rgb, int w, int h, int stride, Mat
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b;
+            load_u8x16x3(rgb, _r, _g, _b);
+
+            store_u8x16_f32(ptr, rgb2gray_u8x16(_r, _g, _b));
+
+            rgb += 3 * 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr = static_cast<float>((rgb[0] * R2Y + rgb[1] * G2Y + rgb[2] * B2Y) >> Y_shift);
@@ -842,6 +1156,7 @@ static int from_rgb2rgba(const unsigned char* rgb, int w, int h, int stride, Mat
         return -100;
 
     Mat rgb_channels = m.channel_range(0, 3);
+    rgb_channels.cstep = m.cstep; // m may be a row band of a larger mat
     from_rgb(rgb, w, h, stride, rgb_channels, allocator);
 
     Mat alpha_channel = m.channel(3);
@@ -873,6 +1188,9 @@ static void to_rgb2rgba(const Mat& m, unsigned char* rgba, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -906,6 +1224,21 @@ static void to_rgb2rgba(const Mat& m, unsigned char* rgba, int stride)
             ptr2 += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r = load_f32_u8x16(ptr0);
+            __m128i _g = load_f32_u8x16(ptr1);
+            __m128i _b = load_f32_u8x16(ptr2);
+
+            store_u8x16x4(rgba, _r, _g, _b, _mm_set1_epi8(-1));
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             rgba[0] = SATURATE_CAST_UCHAR(*ptr0);
@@ -950,6 +1283,9 @@ static int from_bgr2gray(const unsigned char* bgr, int w, int h, int stride, Mat
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1011,6 +1347,18 @@ static int from_bgr2gray(const unsigned char* bgr, int w, int h, int stride, Mat
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _b, _g, _r;
+            load_u8x16x3(bgr, _b, _g, _r);
+
+            store_u8x16_f32(ptr, rgb2gray_u8x16(_r, _g, _b));
+
+            bgr += 3 * 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr = static_cast<float>((bgr[2] * R2Y + bgr[1] * G2Y + bgr[0] * B2Y) >> Y_shift);
@@ -1032,6 +1380,7 @@ static int from_bgr2rgba(const unsigned char* bgr, int w, int h, int stride, Mat
         return -100;
 
     Mat rgb_channels = m.channel_range(0, 3);
+    rgb_channels.cstep = m.cstep; // m may be a row band of a larger mat
     from_rgb2bgr(bgr, w, h, stride, rgb_channels, allocator);
 
     Mat alpha_channel = m.channel(3);
@@ -1063,6 +1412,9 @@ static void to_bgr2rgba(const Mat& m, unsigned char* rgba, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1096,6 +1448,21 @@ static void to_bgr2rgba(const Mat& m, unsigned char* rgba, int stride)
             ptr2 += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _b = load_f32_u8x16(ptr0);
+            __m128i _g = load_f32_u8x16(ptr1);
+            __m128i _r = load_f32_u8x16(ptr2);
+
+            store_u8x16x4(rgba, _r, _g, _b, _mm_set1_epi8(-1));
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             rgba[0] = SATURATE_CAST_UCHAR(*ptr2);
@@ -1136,6 +1503,9 @@ static int from_gray2rgb(const unsigned char* gray, int w, int h, int stride, Ma
 #if __ARM_NEON
         int nn = w >> 4;
         int remain = w - (nn << 4);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1212,6 +1582,21 @@ static int from_gray2rgb(const unsigned char* gray, int w, int h, int stride, Ma
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _gray = _mm_loadu_si128((const __m128i*)gray);
+
+            store_u8x16_f32(ptr0, _gray);
+            store_u8x16_f32(ptr1, _gray);
+            store_u8x16_f32(ptr2, _gray);
+
+            gray += 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = *gray;
@@ -1237,6 +1622,7 @@ static int from_gray2rgba(const unsigned char* gray, int w, int h, int stride, M
         return -100;
 
     Mat rgb_channels = m.channel_range(0, 3);
+    rgb_channels.cstep = m.cstep; // m may be a row band of a larger mat
     from_gray2rgb(gray, w, h, stride, rgb_channels, allocator);
 
     Mat alpha_channel = m.channel(3);
@@ -1266,6 +1652,9 @@ static void to_gray2rgba(const Mat& m, unsigned char* rgba, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1293,6 +1682,17 @@ static void to_gray2rgba(const Mat& m, unsigned char* rgba, int stride)
             ptr += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _gray = load_f32_u8x16(ptr);
+
+            store_u8x16x4(rgba, _gray, _gray, _gray, _mm_set1_epi8(-1));
+
+            rgba += 4 * 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             unsigned char gray = SATURATE_CAST_UCHAR(*ptr);
@@ -1332,6 +1732,9 @@ static int from_rgba2rgb(const unsigned char* rgba, int w, int h, int stride, Ma
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1405,6 +1808,22 @@ static int from_rgba2rgb(const unsigned char* rgba, int w, int h, int stride, Ma
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b, _a;
+            load_u8x16x4(rgba, _r, _g, _b, _a);
+
+            store_u8x16_f32(ptr0, _r);
+            store_u8x16_f32(ptr1, _g);
+            store_u8x16_f32(ptr2, _b);
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = rgba[0];
@@ -1445,6 +1864,9 @@ static int from_rgba2bgr(const unsigned char* rgba, int w, int h, int stride, Ma
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1518,6 +1940,22 @@ static int from_rgba2bgr(const unsigned char* rgba, int w, int h, int stride, Ma
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b, _a;
+            load_u8x16x4(rgba, _r, _g, _b, _a);
+
+            store_u8x16_f32(ptr0, _b);
+            store_u8x16_f32(ptr1, _g);
+            store_u8x16_f32(ptr2, _r);
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = rgba[2];
@@ -1562,6 +2000,9 @@ static int from_rgba2gray(const unsigned char* rgba, int w, int h, int stride, M
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1623,6 +2064,18 @@ static int from_rgba2gray(const unsigned char* rgba, int w, int h, int stride, M
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b, _a;
+            load_u8x16x4(rgba, _r, _g, _b, _a);
+
+            store_u8x16_f32(ptr, rgb2gray_u8x16(_r, _g, _b));
+
+            rgba += 4 * 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr = static_cast<float>((rgba[0] * R2Y + rgba[1] * G2Y + rgba[2] * B2Y) >> Y_shift);
@@ -1660,6 +2113,9 @@ static int from_rgba2bgra(const unsigned char* rgba, int w, int h, int stride, M
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1747,6 +2203,24 @@ static int from_rgba2bgra(const unsigned char* rgba, int w, int h, int stride, M
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r, _g, _b, _a;
+            load_u8x16x4(rgba, _r, _g, _b, _a);
+
+            store_u8x16_f32(ptr0, _b);
+            store_u8x16_f32(ptr1, _g);
+            store_u8x16_f32(ptr2, _r);
+            store_u8x16_f32(ptr3, _a);
+
+            rgba += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+            ptr3 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr0 = rgba[2];
@@ -1791,6 +2265,9 @@ static void to_rgba2bgra(const Mat& m, unsigned char* bgra, int stride)
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1827,6 +2304,23 @@ static void to_rgba2bgra(const Mat& m, unsigned char* bgra, int stride)
             ptr3 += 8;
         }
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _r = load_f32_u8x16(ptr0);
+            __m128i _g = load_f32_u8x16(ptr1);
+            __m128i _b = load_f32_u8x16(ptr2);
+            __m128i _a = load_f32_u8x16(ptr3);
+
+            store_u8x16x4(bgra, _b, _g, _r, _a);
+
+            bgra += 4 * 16;
+            ptr0 += 16;
+            ptr1 += 16;
+            ptr2 += 16;
+            ptr3 += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             bgra[0] = SATURATE_CAST_UCHAR(*ptr2);
@@ -1872,6 +2366,9 @@ static int from_bgra2gray(const unsigned char* bgra, int w, int h, int stride, M
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -1933,6 +2430,18 @@ static int from_bgra2gray(const unsigned char* bgra, int w, int h, int stride, M
         }
 #endif // __aarch64__
 #endif // __ARM_NEON
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _b, _g, _r, _a;
+            load_u8x16x4(bgra, _b, _g, _r, _a);
+
+            store_u8x16_f32(ptr, rgb2gray_u8x16(_r, _g, _b));
+
+            bgra += 4 * 16;
+            ptr += 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain--)
         {
             *ptr = static_cast<float>((bgra[2] * R2Y + bgra[1] * G2Y + bgra[0] * B2Y) >> Y_shift);
@@ -1960,6 +2469,15 @@ void yuv420sp2rgb(const unsigned char* yuv420sp, int w, int h, unsigned char* rg
     int8x8_t _v113 = vdup_n_s8(113);
 #endif // __ARM_NEON
 
+#if __SSE2__
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _v128 = _mm_set1_epi16(128);
+    __m128i _v90 = _mm_set1_epi16(90);
+    __m128i _v46 = _mm_set1_epi16(46);
+    __m128i _v22 = _mm_set1_epi16(22);
+    __m128i _v113 = _mm_set1_epi16(113);
+#endif // __SSE2__
+
     for (int y = 0; y < h; y += 2)
     {
         const unsigned char* yptr0 = yptr;
@@ -1970,6 +2488,9 @@ void yuv420sp2rgb(const unsigned char* yuv420sp, int w, int h, unsigned char* rg
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -2076,6 +2597,45 @@ void yuv420sp2rgb(const unsigned char* yuv420sp, int w, int h, unsigned char* rg
 #endif // __ARM_NEON
 
 #define SATURATE_CAST_UCHAR(X) (unsigned char)::std::min(::std::max((int)(X), 0), 255);
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _vu = _mm_loadu_si128((const __m128i*)vuptr);
+            __m128i _vv16 = _mm_sub_epi16(_mm_and_si128(_vu, _mm_set1_epi16(0xff)), _v128);
+            __m128i _uu16 = _mm_sub_epi16(_mm_srli_epi16(_vu, 8), _v128);
+
+            // every chroma pair is shared by two horizontal pixels
+            __m128i _ruv0 = _mm_mullo_epi16(_mm_unpacklo_epi16(_vv16, _vv16), _v90);
+            __m128i _ruv1 = _mm_mullo_epi16(_mm_unpackhi_epi16(_vv16, _vv16), _v90);
+            __m128i _guv0 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi16(_vv16, _vv16), _v46), _mm_mullo_epi16(_mm_unpacklo_epi16(_uu16, _uu16), _v22));
+            __m128i _guv1 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi16(_vv16, _vv16), _v46), _mm_mullo_epi16(_mm_unpackhi_epi16(_uu16, _uu16), _v22));
+            __m128i _buv0 = _mm_mullo_epi16(_mm_unpacklo_epi16(_uu16, _uu16), _v113);
+            __m128i _buv1 = _mm_mullo_epi16(_mm_unpackhi_epi16(_uu16, _uu16), _v113);
+
+            __m128i _y0 = _mm_loadu_si128((const __m128i*)yptr0);
+            __m128i _y1 = _mm_loadu_si128((const __m128i*)yptr1);
+            __m128i _yy00 = _mm_slli_epi16(_mm_unpacklo_epi8(_y0, _zero), 6);
+            __m128i _yy01 = _mm_slli_epi16(_mm_unpackhi_epi8(_y0, _zero), 6);
+            __m128i _yy10 = _mm_slli_epi16(_mm_unpacklo_epi8(_y1, _zero), 6);
+            __m128i _yy11 = _mm_slli_epi16(_mm_unpackhi_epi8(_y1, _zero), 6);
+
+            __m128i _r0 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy00, _ruv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy01, _ruv1), 6));
+            __m128i _g0 = _mm_packus_epi16(_mm_srai_epi16(_mm_sub_epi16(_yy00, _guv0), 6), _mm_srai_epi16(_mm_sub_epi16(_yy01, _guv1), 6));
+            __m128i _b0 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy00, _buv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy01, _buv1), 6));
+            __m128i _r1 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy10, _ruv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy11, _ruv1), 6));
+            __m128i _g1 = _mm_packus_epi16(_mm_srai_epi16(_mm_sub_epi16(_yy10, _guv0), 6), _mm_srai_epi16(_mm_sub_epi16(_yy11, _guv1), 6));
+            __m128i _b1 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy10, _buv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy11, _buv1), 6));
+
+            store_u8x16x3(rgb0, _r0, _g0, _b0);
+            store_u8x16x3(rgb1, _r1, _g1, _b1);
+
+            yptr0 += 16;
+            yptr1 += 16;
+            vuptr += 16;
+            rgb0 += 3 * 16;
+            rgb1 += 3 * 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain -= 2)
         {
             // R = 1.164 * yy + 1.596 * vv
@@ -2151,6 +2711,15 @@ void yuv420sp2rgb_nv12(const unsigned char* yuv420sp, int w, int h, unsigned cha
     int8x8_t _v113 = vdup_n_s8(113);
 #endif // __ARM_NEON
 
+#if __SSE2__
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _v128 = _mm_set1_epi16(128);
+    __m128i _v90 = _mm_set1_epi16(90);
+    __m128i _v46 = _mm_set1_epi16(46);
+    __m128i _v22 = _mm_set1_epi16(22);
+    __m128i _v113 = _mm_set1_epi16(113);
+#endif // __SSE2__
+
     for (int y = 0; y < h; y += 2)
     {
         const unsigned char* yptr0 = yptr;
@@ -2161,6 +2730,9 @@ void yuv420sp2rgb_nv12(const unsigned char* yuv420sp, int w, int h, unsigned cha
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = w >> 4;
+        int remain = w - (nn << 4);
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -2267,6 +2839,45 @@ void yuv420sp2rgb_nv12(const unsigned char* yuv420sp, int w, int h, unsigned cha
 #endif // __ARM_NEON
 
 #define SATURATE_CAST_UCHAR(X) (unsigned char)::std::min(::std::max((int)(X), 0), 255);
+#if __SSE2__
+        for (; nn > 0; nn--)
+        {
+            __m128i _uv = _mm_loadu_si128((const __m128i*)uvptr);
+            __m128i _uu16 = _mm_sub_epi16(_mm_and_si128(_uv, _mm_set1_epi16(0xff)), _v128);
+            __m128i _vv16 = _mm_sub_epi16(_mm_srli_epi16(_uv, 8), _v128);
+
+            // every chroma pair is shared by two horizontal pixels
+            __m128i _ruv0 = _mm_mullo_epi16(_mm_unpacklo_epi16(_vv16, _vv16), _v90);
+            __m128i _ruv1 = _mm_mullo_epi16(_mm_unpackhi_epi16(_vv16, _vv16), _v90);
+            __m128i _guv0 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi16(_vv16, _vv16), _v46), _mm_mullo_epi16(_mm_unpacklo_epi16(_uu16, _uu16), _v22));
+            __m128i _guv1 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi16(_vv16, _vv16), _v46), _mm_mullo_epi16(_mm_unpackhi_epi16(_uu16, _uu16), _v22));
+            __m128i _buv0 = _mm_mullo_epi16(_mm_unpacklo_epi16(_uu16, _uu16), _v113);
+            __m128i _buv1 = _mm_mullo_epi16(_mm_unpackhi_epi16(_uu16, _uu16), _v113);
+
+            __m128i _y0 = _mm_loadu_si128((const __m128i*)yptr0);
+            __m128i _y1 = _mm_loadu_si128((const __m128i*)yptr1);
+            __m128i _yy00 = _mm_slli_epi16(_mm_unpacklo_epi8(_y0, _zero), 6);
+            __m128i _yy01 = _mm_slli_epi16(_mm_unpackhi_epi8(_y0, _zero), 6);
+            __m128i _yy10 = _mm_slli_epi16(_mm_unpacklo_epi8(_y1, _zero), 6);
+            __m128i _yy11 = _mm_slli_epi16(_mm_unpackhi_epi8(_y1, _zero), 6);
+
+            __m128i _r0 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy00, _ruv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy01, _ruv1), 6));
+            __m128i _g0 = _mm_packus_epi16(_mm_srai_epi16(_mm_sub_epi16(_yy00, _guv0), 6), _mm_srai_epi16(_mm_sub_epi16(_yy01, _guv1), 6));
+            __m128i _b0 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy00, _buv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy01, _buv1), 6));
+            __m128i _r1 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy10, _ruv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy11, _ruv1), 6));
+            __m128i _g1 = _mm_packus_epi16(_mm_srai_epi16(_mm_sub_epi16(_yy10, _guv0), 6), _mm_srai_epi16(_mm_sub_epi16(_yy11, _guv1), 6));
+            __m128i _b1 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy10, _buv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy11, _buv1), 6));
+
+            store_u8x16x3(rgb0, _r0, _g0, _b0);
+            store_u8x16x3(rgb1, _r1, _g1, _b1);
+
+            yptr0 += 16;
+            yptr1 += 16;
+            uvptr += 16;
+            rgb0 += 3 * 16;
+            rgb1 += 3 * 16;
+        }
+#endif // __SSE2__
         for (; remain > 0; remain -= 2)
         {
             // R = 1.164 * yy + 1.596 * vv
@@ -2448,76 +3059,146 @@ Mat Mat::from_pixels(const unsigned char* pixels, int type, int w, int h, Alloca
     return Mat();
 }
 
-Mat Mat::from_pixels(const unsigned char* pixels, int type, int w, int h, int stride, Allocator* allocator)
+static int from_pixels_to_mat(const unsigned char* pixels, int type, int w, int h, int stride, Mat& m, Allocator* allocator)
 {
-    Mat m;
-
-    if (type & PIXEL_CONVERT_MASK)
+    if (type & Mat::PIXEL_CONVERT_MASK)
     {
         switch (type)
         {
-        case PIXEL_RGB2BGR:
-        case PIXEL_BGR2RGB:
+        case Mat::PIXEL_RGB2BGR:
+        case Mat::PIXEL_BGR2RGB:
             from_rgb2bgr(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_RGB2GRAY:
+        case Mat::PIXEL_RGB2GRAY:
             from_rgb2gray(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_RGB2RGBA:
-        case PIXEL_BGR2BGRA:
+        case Mat::PIXEL_RGB2RGBA:
+        case Mat::PIXEL_BGR2BGRA:
             from_rgb2rgba(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_BGR2GRAY:
+        case Mat::PIXEL_BGR2GRAY:
             from_bgr2gray(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_BGR2RGBA:
-        case PIXEL_RGB2BGRA:
+        case Mat::PIXEL_BGR2RGBA:
+        case Mat::PIXEL_RGB2BGRA:
             from_bgr2rgba(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_GRAY2RGB:
-        case PIXEL_GRAY2BGR:
+        case Mat::PIXEL_GRAY2RGB:
+        case Mat::PIXEL_GRAY2BGR:
             from_gray2rgb(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_GRAY2RGBA:
-        case PIXEL_GRAY2BGRA:
+        case Mat::PIXEL_GRAY2RGBA:
+        case Mat::PIXEL_GRAY2BGRA:
             from_gray2rgba(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_RGBA2RGB:
-        case PIXEL_BGRA2BGR:
+        case Mat::PIXEL_RGBA2RGB:
+        case Mat::PIXEL_BGRA2BGR:
             from_rgba2rgb(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_RGBA2BGR:
-        case PIXEL_BGRA2RGB:
+        case Mat::PIXEL_RGBA2BGR:
+        case Mat::PIXEL_BGRA2RGB:
             from_rgba2bgr(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_RGBA2GRAY:
+        case Mat::PIXEL_RGBA2GRAY:
             from_rgba2gray(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_RGBA2BGRA:
-        case PIXEL_BGRA2RGBA:
+        case Mat::PIXEL_RGBA2BGRA:
+        case Mat::PIXEL_BGRA2RGBA:
             from_rgba2bgra(pixels, w, h, stride, m, allocator);
             break;
-        case PIXEL_BGRA2GRAY:
+        case Mat::PIXEL_BGRA2GRAY:
             from_bgra2gray(pixels, w, h, stride, m, allocator);
             break;
         default:
             // unimplemented convert type
             NCNN_LOGE("unimplemented convert type %d", type);
-            break;
+            return -1;
         }
     }
     else
     {
-        if (type == PIXEL_RGB || type == PIXEL_BGR)
+        if (type == Mat::PIXEL_RGB || type == Mat::PIXEL_BGR)
             from_rgb(pixels, w, h, stride, m, allocator);
 
-        if (type == PIXEL_GRAY)
+        if (type == Mat::PIXEL_GRAY)
             from_gray(pixels, w, h, stride, m, allocator);
 
-        if (type == PIXEL_RGBA || type == PIXEL_BGRA)
+        if (type == Mat::PIXEL_RGBA || type == Mat::PIXEL_BGRA)
             from_rgba(pixels, w, h, stride, m, allocator);
     }
 
+    return m.empty() ? -1 : 0;
+}
+
+Mat Mat::from_pixels(const unsigned char* pixels, int type, int w, int h, int stride, Allocator* allocator)
+{
+    Mat m;
+    from_pixels_to_mat(pixels, type, w, h, stride, m, allocator);
+    return m;
+}
+
+static int get_pixel_type_to_channels(int type)
+{
+    int type_to = (type & Mat::PIXEL_CONVERT_MASK) ? (type >> Mat::PIXEL_CONVERT_SHIFT) : (type & Mat::PIXEL_FORMAT_MASK);
+
+    if (type_to == Mat::PIXEL_RGB || type_to == Mat::PIXEL_BGR)
+        return 3;
+
+    if (type_to == Mat::PIXEL_GRAY)
+        return 1;
+
+    if (type_to == Mat::PIXEL_RGBA || type_to == Mat::PIXEL_BGRA)
+        return 4;
+
+    return 0;
+}
+
+// rows [y, y + rows) of every channel of m, sharing the channel step of m
+// the converters see a mat that is already created and fill it in place
+static Mat get_pixel_row_band(const Mat& m, int y, int rows)
+{
+    Mat band = m.channel(0).row_range(y, rows);
+    band.dims = 3;
+    band.c = m.c;
+    band.cstep = m.cstep;
+    band.allocator = m.allocator;
+    return band;
+}
+
+Mat Mat::from_pixels(const unsigned char* pixels, int type, int w, int h, int stride, const Option& opt)
+{
+    const int num_threads = std::min(opt.num_threads, h);
+    if (num_threads <= 1)
+        return Mat::from_pixels(pixels, type, w, h, stride, opt.blob_allocator);
+
+    const int channels = get_pixel_type_to_channels(type);
+    if (channels == 0)
+    {
+        // unknown convert type
+        NCNN_LOGE("unknown convert type %d", type);
+        return Mat();
+    }
+
+    Mat m;
+    m.create(w, h, channels, 4u, opt.blob_allocator);
+    if (m.empty())
+        return m;
+
+    int ret = 0;
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+        const int y0 = h * i / num_threads;
+        const int y1 = h * (i + 1) / num_threads;
+
+        Mat band = get_pixel_row_band(m, y0, y1 - y0);
+        if (from_pixels_to_mat(pixels + y0 * stride, type, w, y1 - y0, stride, band, band.allocator) != 0)
+            ret = -1;
+    }
+
+    if (ret != 0)
+        return Mat();
+
     return m;
 }
 
@@ -2577,6 +3258,71 @@ Mat Mat::from_pixels_resize(const unsigned char* pixels, int type, int w, int h,
     return Mat();
 }
 
+Mat Mat::from_pixels_resize(const unsigned char* pixels, int type, int w, int h, int stride, int target_width, int target_height, int resize_type, const Option& opt)
+{
+    if (w == target_width && h == target_height)
+        return Mat::from_pixels(pixels, type, w, h, stride, opt);
+
+    int type_from = type & PIXEL_FORMAT_MASK;
+
+    int channels = 0;
+    if (type_from == PIXEL_RGB || type_from == PIXEL_BGR)
+        channels = 3;
+    else if (type_from == PIXEL_GRAY)
+        channels = 1;
+    else if (type_from == PIXEL_RGBA || type_from == PIXEL_BGRA)
+        channels = 4;
+
+    if (channels == 0)
+    {
+        // unknown convert type
+        NCNN_LOGE("unknown convert type %d", type);
+        return Mat();
+    }
+
+    if (resize_type != PIXEL_RESIZE_BILINEAR && resize_type != PIXEL_RESIZE_AREA && resize_type != PIXEL_RESIZE_BICUBIC)
+    {
+        NCNN_LOGE("unsupported resize type %d", resize_type);
+        return Mat();
+    }
+
+    Mat dst(target_width, target_height, (size_t)channels, channels, opt.workspace_allocator);
+    if (dst.empty())
+        return Mat();
+
+    const int dst_stride = target_width * channels;
+
+    if (resize_type == PIXEL_RESIZE_BILINEAR)
+    {
+        if (channels == 1)
+            resize_bilinear_c1(pixels, w, h, stride, dst, target_width, target_height, dst_stride);
+        if (channels == 3)
+            resize_bilinear_c3(pixels, w, h, stride, dst, target_width, target_height, dst_stride);
+        if (channels == 4)
+            resize_bilinear_c4(pixels, w, h, stride, dst, target_width, target_height, dst_stride);
+    }
+    if (resize_type == PIXEL_RESIZE_AREA)
+    {
+        if (channels == 1)
+            resize_area_c1(pixels, w, h, stride, dst, target_width, target_height, dst_stride, opt);
+        if (channels == 3)
+            resize_area_c3(pixels, w, h, stride, dst, target_width, target_height, dst_stride, opt);
+        if (channels == 4)
+            resize_area_c4(pixels, w, h, stride, dst, target_width, target_height, dst_stride, opt);
+    }
+    if (resize_type == PIXEL_RESIZE_BICUBIC)
+    {
+        if (channels == 1)
+            resize_bicubic_c1(pixels, w, h, stride, dst, target_width, target_height, dst_stride, opt);
+        if (channels == 3)
+            resize_bicubic_c3(pixels, w, h, stride, dst, target_width, target_height, dst_stride, opt);
+        if (channels == 4)
+            resize_bicubic_c4(pixels, w, h, stride, dst, target_width, target_height, dst_stride, opt);
+    }
+
+    return Mat::from_pixels(dst, type, target_width, target_height, dst_stride, opt);
+}
+
 Mat Mat::from_pixels_roi(const unsigned char* pixels, int type, int w, int h, int roix, int roiy, int roiw, int roih, Allocator* allocator)
 {
     if (roix < 0 || roiy < 0 || roiw <= 0 || roih <= 0 || roix + roiw > w || roiy + roih > h)
@@ -2752,6 +3498,26 @@ void Mat::to_pixels(unsigned char* pixels, int type, int stride) const
     }
 }
 
+void Mat::to_pixels(unsigned char* pixels, int type, int stride, const Option& opt) const
+{
+    const int num_threads = std::min(opt.num_threads, h);
+    if (num_threads <= 1)
+    {
+        to_pixels(pixels, type, stride);
+        return;
+    }
+
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+        const int y0 = h * i / num_threads;
+        const int y1 = h * (i + 1) / num_threads;
+
+        const Mat band = get_pixel_row_band(*this, y0, y1 - y0);
+        band.to_pixels(pixels + y0 * stride, type, stride);
+    }
+}
+
 void Mat::to_pixels_resize(unsigned char* pixels, int type, int target_width, int target_height) const
 {
     int type_to = (type & PIXEL_CONVERT_MASK) ? (type >> PIXEL_CONVERT_SHIFT) : (type & PIXEL_FORMAT_MASK);
@@ -6,6 +6,7 @@
 #include <arm_neon.h>
 #endif // __ARM_NEON
 #include <limits.h>
+#include <string.h>
 
 #include "platform.h"
 
@@ -140,6 +141,277 @@ void invert_affine_transform(const float* tm, float* tm_inv)
     tm_inv[5] = b2;
 }
 
+#if __SSE2__
+// fixed-point bilinear weight pairs (1024 - f, f) of 4 pixels, one pair per 32-bit lane
+static NCNN_FORCEINLINE __m128i bilinear_weight_pair(__m128i _XY)
+{
+    __m128i _f = _mm_and_si128(_XY, _mm_set1_epi32((1 << 10) - 1));
+    return _mm_or_si128(_mm_sub_epi32(_mm_set1_epi32(1 << 10), _f), _mm_slli_epi32(_f, 16));
+}
+
+// blend 4 outputs from the u16 sample pairs (s0, s1) of the upper and lower source row
+// same fixed-point rounding as the scalar path
+static NCNN_FORCEINLINE __m128i bilinear_blend(__m128i _a01, __m128i _b01, __m128i _alpha, __m128i _beta)
+{
+    __m128i _a = _mm_srli_epi32(_mm_madd_epi16(_a01, _alpha), 5);
+    __m128i _b = _mm_srli_epi32(_mm_madd_epi16(_b01, _alpha), 5);
+    return _mm_srli_epi32(_mm_madd_epi16(_mm_or_si128(_a, _mm_slli_epi32(_b, 16)), _beta), 15);
+}
+
+// blend 4 channels of one pixel, _a0a1 and _b0b1 hold the two samples interleaved per channel
+static NCNN_FORCEINLINE __m128i bilinear_blend_pixel(__m128i _a0a1, __m128i _b0b1, __m128i _alpha, __m128i _beta, int i)
+{
+    __m128i _alpha_i;
+    __m128i _beta_i;
+    switch (i)
+    {
+    case 0:
+        _alpha_i = _mm_shuffle_epi32(_alpha, _MM_SHUFFLE(0, 0, 0, 0));
+        _beta_i = _mm_shuffle_epi32(_beta, _MM_SHUFFLE(0, 0, 0, 0));
+        break;
+    case 1:
+        _alpha_i = _mm_shuffle_epi32(_alpha, _MM_SHUFFLE(1, 1, 1, 1));
+        _beta_i = _mm_shuffle_epi32(_beta, _MM_SHUFFLE(1, 1, 1, 1));
+        break;
+    case 2:
+        _alpha_i = _mm_shuffle_epi32(_alpha, _MM_SHUFFLE(2, 2, 2, 2));
+        _beta_i = _mm_shuffle_epi32(_beta, _MM_SHUFFLE(2, 2, 2, 2));
+        break;
+    default:
+        _alpha_i = _mm_shuffle_epi32(_alpha, _MM_SHUFFLE(3, 3, 3, 3));
+        _beta_i = _mm_shuffle_epi32(_beta, _MM_SHUFFLE(3, 3, 3, 3));
+        break;
+    }
+
+    return bilinear_blend(_a0a1, _b0b1, _alpha_i, _beta_i);
+}
+
+// blend 4 pixels of 4 channels, _a0 _a1 _b0 _b1 hold the 4 bytes of every sample per 32-bit lane
+static NCNN_FORCEINLINE void bilinear_blend_4x4(__m128i _a0, __m128i _a1, __m128i _b0, __m128i _b1, __m128i _alpha, __m128i _beta, __m128i& _d01, __m128i& _d23)
+{
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _a01l = _mm_unpacklo_epi8(_a0, _a1);
+    __m128i _a01h = _mm_unpackhi_epi8(_a0, _a1);
+    __m128i _b01l = _mm_unpacklo_epi8(_b0, _b1);
+    __m128i _b01h = _mm_unpackhi_epi8(_b0, _b1);
+
+    __m128i _d0 = bilinear_blend_pixel(_mm_unpacklo_epi8(_a01l, _zero), _mm_unpacklo_epi8(_b01l, _zero), _alpha, _beta, 0);
+    __m128i _d1 = bilinear_blend_pixel(_mm_unpackhi_epi8(_a01l, _zero), _mm_unpackhi_epi8(_b01l, _zero), _alpha, _beta, 1);
+    __m128i _d2 = bilinear_blend_pixel(_mm_unpacklo_epi8(_a01h, _zero), _mm_unpacklo_epi8(_b01h, _zero), _alpha, _beta, 2);
+    __m128i _d3 = bilinear_blend_pixel(_mm_unpackhi_epi8(_a01h, _zero), _mm_unpackhi_epi8(_b01h, _zero), _alpha, _beta, 3);
+
+    _d01 = _mm_packs_epi32(_d0, _d1);
+    _d23 = _mm_packs_epi32(_d2, _d3);
+}
+
+#if __AVX2__
+// source byte offsets of 8 pixels, all inside the image
+static NCNN_FORCEINLINE __m256i warpaffine_offset8(int X0, int Y0, const int* adelta, const int* bdelta, int srcstride, int elemsize)
+{
+    __m256i _sx = _mm256_srai_epi32(_mm256_add_epi32(_mm256_set1_epi32(X0), _mm256_loadu_si256((const __m256i*)adelta)), 10);
+    __m256i _sy = _mm256_srai_epi32(_mm256_add_epi32(_mm256_set1_epi32(Y0), _mm256_loadu_si256((const __m256i*)bdelta)), 10);
+    return _mm256_add_epi32(_mm256_mullo_epi32(_sy, _mm256_set1_epi32(srcstride)), _mm256_mullo_epi32(_sx, _mm256_set1_epi32(elemsize)));
+}
+#endif // __AVX2__
+
+// 8 destination pixels whose source samples are all inside the image
+static void warpaffine_bilinear_inside8_c1(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+    __m128i _Xl = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)adelta));
+    __m128i _Xh = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)(adelta + 4)));
+    __m128i _Yl = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)bdelta));
+    __m128i _Yh = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)(bdelta + 4)));
+
+    // two horizontal neighbors per row, a 32-bit gather would read past them
+    unsigned short a01[8];
+    unsigned short b01[8];
+    for (int i = 0; i < 8; i++)
+    {
+        const unsigned char* p = src0 + srcstride * ((Y0 + bdelta[i]) >> 10) + ((X0 + adelta[i]) >> 10);
+        a01[i] = (unsigned short)(p[0] | (p[1] << 8));
+        b01[i] = (unsigned short)(p[srcstride] | (p[srcstride + 1] << 8));
+    }
+
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _a01 = _mm_loadu_si128((const __m128i*)a01);
+    __m128i _b01 = _mm_loadu_si128((const __m128i*)b01);
+
+    __m128i _dl = bilinear_blend(_mm_unpacklo_epi8(_a01, _zero), _mm_unpacklo_epi8(_b01, _zero), bilinear_weight_pair(_Xl), bilinear_weight_pair(_Yl));
+    __m128i _dh = bilinear_blend(_mm_unpackhi_epi8(_a01, _zero), _mm_unpackhi_epi8(_b01, _zero), bilinear_weight_pair(_Xh), bilinear_weight_pair(_Yh));
+
+    __m128i _d = _mm_packs_epi32(_dl, _dh);
+    _mm_storel_epi64((__m128i*)dst0, _mm_packus_epi16(_d, _d));
+}
+
+static void warpaffine_bilinear_inside8_c2(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+    __m128i _Xl = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)adelta));
+    __m128i _Xh = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)(adelta + 4)));
+    __m128i _Yl = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)bdelta));
+    __m128i _Yh = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)(bdelta + 4)));
+
+    // a0c0 a0c1 a1c0 a1c1 per 32-bit lane
+#if __AVX2__
+    __m256i _offset = warpaffine_offset8(X0, Y0, adelta, bdelta, srcstride, 2);
+    __m256i _a01 = _mm256_i32gather_epi32((const int*)src0, _offset, 1);
+    __m256i _b01 = _mm256_i32gather_epi32((const int*)(src0 + srcstride), _offset, 1);
+    __m128i _a01l = _mm256_castsi256_si128(_a01);
+    __m128i _a01h = _mm256_extracti128_si256(_a01, 1);
+    __m128i _b01l = _mm256_castsi256_si128(_b01);
+    __m128i _b01h = _mm256_extracti128_si256(_b01, 1);
+#else
+    int a01[8];
+    int b01[8];
+    for (int i = 0; i < 8; i++)
+    {
+        const unsigned char* p = src0 + srcstride * ((Y0 + bdelta[i]) >> 10) + ((X0 + adelta[i]) >> 10) * 2;
+        memcpy(a01 + i, p, 4);
+        memcpy(b01 + i, p + srcstride, 4);
+    }
+    __m128i _a01l = _mm_loadu_si128((const __m128i*)a01);
+    __m128i _a01h = _mm_loadu_si128((const __m128i*)(a01 + 4));
+    __m128i _b01l = _mm_loadu_si128((const __m128i*)b01);
+    __m128i _b01h = _mm_loadu_si128((const __m128i*)(b01 + 4));
+#endif // __AVX2__
+
+    __m128i _alphal = bilinear_weight_pair(_Xl);
+    __m128i _alphah = bilinear_weight_pair(_Xh);
+    __m128i _betal = bilinear_weight_pair(_Yl);
+    __m128i _betah = bilinear_weight_pair(_Yh);
+
+    // reorder to (a0c0, a1c0) (a0c1, a1c1) pairs, both channels of a pixel share its weights
+    __m128i _zero = _mm_setzero_si128();
+#define SAMPLE_PAIRS(X) _mm_shufflehi_epi16(_mm_shufflelo_epi16((X), _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0))
+    __m128i _d0 = bilinear_blend(SAMPLE_PAIRS(_mm_unpacklo_epi8(_a01l, _zero)), SAMPLE_PAIRS(_mm_unpacklo_epi8(_b01l, _zero)), _mm_unpacklo_epi32(_alphal, _alphal), _mm_unpacklo_epi32(_betal, _betal));
+    __m128i _d1 = bilinear_blend(SAMPLE_PAIRS(_mm_unpackhi_epi8(_a01l, _zero)), SAMPLE_PAIRS(_mm_unpackhi_epi8(_b01l, _zero)), _mm_unpackhi_epi32(_alphal, _alphal), _mm_unpackhi_epi32(_betal, _betal));
+    __m128i _d2 = bilinear_blend(SAMPLE_PAIRS(_mm_unpacklo_epi8(_a01h, _zero)), SAMPLE_PAIRS(_mm_unpacklo_epi8(_b01h, _zero)), _mm_unpacklo_epi32(_alphah, _alphah), _mm_unpacklo_epi32(_betah, _betah));
+    __m128i _d3 = bilinear_blend(SAMPLE_PAIRS(_mm_unpackhi_epi8(_a01h, _zero)), SAMPLE_PAIRS(_mm_unpackhi_epi8(_b01h, _zero)), _mm_unpackhi_epi32(_alphah, _alphah), _mm_unpackhi_epi32(_betah, _betah));
+#undef SAMPLE_PAIRS
+
+    _mm_storeu_si128((__m128i*)dst0, _mm_packus_epi16(_mm_packs_epi32(_d0, _d1), _mm_packs_epi32(_d2, _d3)));
+}
+
+static void warpaffine_bilinear_inside8_c3(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+    __m128i _Xl = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)adelta));
+    __m128i _Xh = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)(adelta + 4)));
+    __m128i _Yl = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)bdelta));
+    __m128i _Yh = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)(bdelta + 4)));
+
+    // a0 = bytes 0..3 of the pair and a1 = bytes 2..5 shifted, the 4th channel is ignored
+    // neither load leaves the 6 bytes of the two samples
+#if __AVX2__
+    __m256i _offset = warpaffine_offset8(X0, Y0, adelta, bdelta, srcstride, 3);
+    __m256i _a0 = _mm256_i32gather_epi32((const int*)src0, _offset, 1);
+    __m256i _a1 = _mm256_srli_epi32(_mm256_i32gather_epi32((const int*)(src0 + 2), _offset, 1), 8);
+    __m256i _b0 = _mm256_i32gather_epi32((const int*)(src0 + srcstride), _offset, 1);
+    __m256i _b1 = _mm256_srli_epi32(_mm256_i32gather_epi32((const int*)(src0 + srcstride + 2), _offset, 1), 8);
+    __m128i _a0l = _mm256_castsi256_si128(_a0);
+    __m128i _a0h = _mm256_extracti128_si256(_a0, 1);
+    __m128i _a1l = _mm256_castsi256_si128(_a1);
+    __m128i _a1h = _mm256_extracti128_si256(_a1, 1);
+    __m128i _b0l = _mm256_castsi256_si128(_b0);
+    __m128i _b0h = _mm256_extracti128_si256(_b0, 1);
+    __m128i _b1l = _mm256_castsi256_si128(_b1);
+    __m128i _b1h = _mm256_extracti128_si256(_b1, 1);
+#else
+    int a0[8];
+    int a1[8];
+    int b0[8];
+    int b1[8];
+    for (int i = 0; i < 8; i++)
+    {
+        const unsigned char* p = src0 + srcstride * ((Y0 + bdelta[i]) >> 10) + ((X0 + adelta[i]) >> 10) * 3;
+        memcpy(a0 + i, p, 4);
+        memcpy(a1 + i, p + 2, 4);
+        memcpy(b0 + i, p + srcstride, 4);
+        memcpy(b1 + i, p + srcstride + 2, 4);
+    }
+    __m128i _a0l = _mm_loadu_si128((const __m128i*)a0);
+    __m128i _a0h = _mm_loadu_si128((const __m128i*)(a0 + 4));
+    __m128i _a1l = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)a1), 8);
+    __m128i _a1h = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(a1 + 4)), 8);
+    __m128i _b0l = _mm_loadu_si128((const __m128i*)b0);
+    __m128i _b0h = _mm_loadu_si128((const __m128i*)(b0 + 4));
+    __m128i _b1l = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)b1), 8);
+    __m128i _b1h = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(b1 + 4)), 8);
+#endif // __AVX2__
+
+    __m128i _d01;
+    __m128i _d23;
+    __m128i _d45;
+    __m128i _d67;
+    bilinear_blend_4x4(_a0l, _a1l, _b0l, _b1l, bilinear_weight_pair(_Xl), bilinear_weight_pair(_Yl), _d01, _d23);
+    bilinear_blend_4x4(_a0h, _a1h, _b0h, _b1h, bilinear_weight_pair(_Xh), bilinear_weight_pair(_Yh), _d45, _d67);
+
+    // drop the 4th channel
+    unsigned char tmp[32];
+    _mm_storeu_si128((__m128i*)tmp, _mm_packus_epi16(_d01, _d23));
+    _mm_storeu_si128((__m128i*)(tmp + 16), _mm_packus_epi16(_d45, _d67));
+    for (int i = 0; i < 8; i++)
+    {
+        dst0[i * 3 + 0] = tmp[i * 4 + 0];
+        dst0[i * 3 + 1] = tmp[i * 4 + 1];
+        dst0[i * 3 + 2] = tmp[i * 4 + 2];
+    }
+}
+
+static void warpaffine_bilinear_inside8_c4(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+    __m128i _Xl = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)adelta));
+    __m128i _Xh = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)(adelta + 4)));
+    __m128i _Yl = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)bdelta));
+    __m128i _Yh = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)(bdelta + 4)));
+
+#if __AVX2__
+    __m256i _offset = warpaffine_offset8(X0, Y0, adelta, bdelta, srcstride, 4);
+    __m256i _a0 = _mm256_i32gather_epi32((const int*)src0, _offset, 1);
+    __m256i _a1 = _mm256_i32gather_epi32((const int*)(src0 + 4), _offset, 1);
+    __m256i _b0 = _mm256_i32gather_epi32((const int*)(src0 + srcstride), _offset, 1);
+    __m256i _b1 = _mm256_i32gather_epi32((const int*)(src0 + srcstride + 4), _offset, 1);
+    __m128i _a0l = _mm256_castsi256_si128(_a0);
+    __m128i _a0h = _mm256_extracti128_si256(_a0, 1);
+    __m128i _a1l = _mm256_castsi256_si128(_a1);
+    __m128i _a1h = _mm256_extracti128_si256(_a1, 1);
+    __m128i _b0l = _mm256_castsi256_si128(_b0);
+    __m128i _b0h = _mm256_extracti128_si256(_b0, 1);
+    __m128i _b1l = _mm256_castsi256_si128(_b1);
+    __m128i _b1h = _mm256_extracti128_si256(_b1, 1);
+#else
+    int a0[8];
+    int a1[8];
+    int b0[8];
+    int b1[8];
+    for (int i = 0; i < 8; i++)
+    {
+        const unsigned char* p = src0 + srcstride * ((Y0 + bdelta[i]) >> 10) + ((X0 + adelta[i]) >> 10) * 4;
+        memcpy(a0 + i, p, 4);
+        memcpy(a1 + i, p + 4, 4);
+        memcpy(b0 + i, p + srcstride, 4);
+        memcpy(b1 + i, p + srcstride + 4, 4);
+    }
+    __m128i _a0l = _mm_loadu_si128((const __m128i*)a0);
+    __m128i _a0h = _mm_loadu_si128((const __m128i*)(a0 + 4));
+    __m128i _a1l = _mm_loadu_si128((const __m128i*)a1);
+    __m128i _a1h = _mm_loadu_si128((const __m128i*)(a1 + 4));
+    __m128i _b0l = _mm_loadu_si128((const __m128i*)b0);
+    __m128i _b0h = _mm_loadu_si128((const __m128i*)(b0 + 4));
+    __m128i _b1l = _mm_loadu_si128((const __m128i*)b1);
+    __m128i _b1h = _mm_loadu_si128((const __m128i*)(b1 + 4));
+#endif // __AVX2__
+
+    __m128i _d01;
+    __m128i _d23;
+    __m128i _d45;
+    __m128i _d67;
+    bilinear_blend_4x4(_a0l, _a1l, _b0l, _b1l, bilinear_weight_pair(_Xl), bilinear_weight_pair(_Yl), _d01, _d23);
+    bilinear_blend_4x4(_a0h, _a1h, _b0h, _b1h, bilinear_weight_pair(_Xh), bilinear_weight_pair(_Yh), _d45, _d67);
+
+    _mm_storeu_si128((__m128i*)dst0, _mm_packus_epi16(_d01, _d23));
+    _mm_storeu_si128((__m128i*)(dst0 + 16), _mm_packus_epi16(_d45, _d67));
+}
+#endif // __SSE2__
+
 void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, const float* tm, int type, unsigned int v)
 {
     return warpaffine_bilinear_c1(src, srcw, srch, srcw, dst, w, h, w, tm, type, v);
@@ -161,12 +433,18 @@ void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, unsign
 }
 
 void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return warpaffine_bilinear_c1(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+}
+
+void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt)
 {
     const unsigned char* border_color = (const unsigned char*)&v;
-    const int wgap = stride - w;
 
     const unsigned char* src0 = src;
-    unsigned char* dst0 = dst;
 
 #define SATURATE_CAST_SHORT(X) (short)::std::min(::std::max((int)(X), SHRT_MIN), SHRT_MAX)
 #define SATURATE_CAST_INT(X)   (int)::std::min(::std::max((int)((X) + ((X) >= 0.f ? 0.5f : -0.5f)), INT_MIN), INT_MAX)
@@ -179,9 +457,11 @@ void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int sr
         bdelta[x] = SATURATE_CAST_INT(tm[3] * x * (1 << 10));
     }
 
-    int y = 0;
-    for (; y < h; y++)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int y = 0; y < h; y++)
     {
+        unsigned char* dst0 = dst + y * stride;
+
         int X0 = SATURATE_CAST_INT((tm[1] * y + tm[2]) * (1 << 10));
         int Y0 = SATURATE_CAST_INT((tm[4] * y + tm[5]) * (1 << 10));
 
@@ -287,6 +567,10 @@ void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int sr
 
                 vst1_u8(dst0, _dst);
 
+                dst0 += 8;
+#elif __SSE2__
+                warpaffine_bilinear_inside8_c1(src0, srcstride, X0, Y0, adelta.data() + x, bdelta.data() + x, dst0);
+
                 dst0 += 8;
 #else
                 for (int xi = 0; xi < 8; xi++)
@@ -457,8 +741,6 @@ void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int sr
 
             dst0 += 1;
         }
-
-        dst0 += wgap;
     }
 
 #undef SATURATE_CAST_SHORT
@@ -466,12 +748,18 @@ void warpaffine_bilinear_c1(const unsigned char* src, int srcw, int srch, int sr
 }
 
 void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return warpaffine_bilinear_c2(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+}
+
+void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt)
 {
     const unsigned char* border_color = (const unsigned char*)&v;
-    const int wgap = stride - w * 2;
 
     const unsigned char* src0 = src;
-    unsigned char* dst0 = dst;
 
 #define SATURATE_CAST_SHORT(X) (short)::std::min(::std::max((int)(X), SHRT_MIN), SHRT_MAX)
 #define SATURATE_CAST_INT(X)   (int)::std::min(::std::max((int)((X) + ((X) >= 0.f ? 0.5f : -0.5f)), INT_MIN), INT_MAX)
@@ -484,9 +772,11 @@ void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int sr
         bdelta[x] = SATURATE_CAST_INT(tm[3] * x * (1 << 10));
     }
 
-    int y = 0;
-    for (; y < h; y++)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int y = 0; y < h; y++)
     {
+        unsigned char* dst0 = dst + y * stride;
+
         int X0 = SATURATE_CAST_INT((tm[1] * y + tm[2]) * (1 << 10));
         int Y0 = SATURATE_CAST_INT((tm[4] * y + tm[5]) * (1 << 10));
 
@@ -605,6 +895,10 @@ void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int sr
 
                 vst2_u8(dst0, _dst);
 
+                dst0 += 2 * 8;
+#elif __SSE2__
+                warpaffine_bilinear_inside8_c2(src0, srcstride, X0, Y0, adelta.data() + x, bdelta.data() + x, dst0);
+
                 dst0 += 2 * 8;
 #else
                 for (int xi = 0; xi < 8; xi++)
@@ -784,8 +1078,6 @@ void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int sr
 
             dst0 += 2;
         }
-
-        dst0 += wgap;
     }
 
 #undef SATURATE_CAST_SHORT
@@ -793,12 +1085,18 @@ void warpaffine_bilinear_c2(const unsigned char* src, int srcw, int srch, int sr
 }
 
 void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return warpaffine_bilinear_c3(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+}
+
+void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt)
 {
     const unsigned char* border_color = (const unsigned char*)&v;
-    const int wgap = stride - w * 3;
 
     const unsigned char* src0 = src;
-    unsigned char* dst0 = dst;
 
 #define SATURATE_CAST_SHORT(X) (short)::std::min(::std::max((int)(X), SHRT_MIN), SHRT_MAX)
 #define SATURATE_CAST_INT(X)   (int)::std::min(::std::max((int)((X) + ((X) >= 0.f ? 0.5f : -0.5f)), INT_MIN), INT_MAX)
@@ -811,9 +1109,11 @@ void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int sr
         bdelta[x] = SATURATE_CAST_INT(tm[3] * x * (1 << 10));
     }
 
-    int y = 0;
-    for (; y < h; y++)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int y = 0; y < h; y++)
     {
+        unsigned char* dst0 = dst + y * stride;
+
         int X0 = SATURATE_CAST_INT((tm[1] * y + tm[2]) * (1 << 10));
         int Y0 = SATURATE_CAST_INT((tm[4] * y + tm[5]) * (1 << 10));
 
@@ -965,6 +1265,10 @@ void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int sr
 
                 vst3_u8(dst0, _dst);
 
+                dst0 += 3 * 8;
+#elif __SSE2__
+                warpaffine_bilinear_inside8_c3(src0, srcstride, X0, Y0, adelta.data() + x, bdelta.data() + x, dst0);
+
                 dst0 += 3 * 8;
 #else
                 for (int xi = 0; xi < 8; xi++)
@@ -1151,8 +1455,6 @@ void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int sr
 
             dst0 += 3;
         }
-
-        dst0 += wgap;
     }
 
 #undef SATURATE_CAST_SHORT
@@ -1160,12 +1462,18 @@ void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int sr
 }
 
 void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return warpaffine_bilinear_c4(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+}
+
+void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt)
 {
     const unsigned char* border_color = (const unsigned char*)&v;
-    const int wgap = stride - w * 4;
 
     const unsigned char* src0 = src;
-    unsigned char* dst0 = dst;
 
 #define SATURATE_CAST_SHORT(X) (short)::std::min(::std::max((int)(X), SHRT_MIN), SHRT_MAX)
 #define SATURATE_CAST_INT(X)   (int)::std::min(::std::max((int)((X) + ((X) >= 0.f ? 0.5f : -0.5f)), INT_MIN), INT_MAX)
@@ -1178,9 +1486,11 @@ void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int sr
         bdelta[x] = SATURATE_CAST_INT(tm[3] * x * (1 << 10));
     }
 
-    int y = 0;
-    for (; y < h; y++)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int y = 0; y < h; y++)
     {
+        unsigned char* dst0 = dst + y * stride;
+
         int X0 = SATURATE_CAST_INT((tm[1] * y + tm[2]) * (1 << 10));
         int Y0 = SATURATE_CAST_INT((tm[4] * y + tm[5]) * (1 << 10));
 
@@ -1367,6 +1677,10 @@ void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int sr
 
                 vst4_u8(dst0, _dst);
 
+                dst0 += 4 * 8;
+#elif __SSE2__
+                warpaffine_bilinear_inside8_c4(src0, srcstride, X0, Y0, adelta.data() + x, bdelta.data() + x, dst0);
+
                 dst0 += 4 * 8;
 #else
                 for (int xi = 0; xi < 8; xi++)
@@ -1560,8 +1874,6 @@ void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int sr
 
             dst0 += 4;
         }
-
-        dst0 += wgap;
     }
 
 #undef SATURATE_CAST_SHORT
@@ -1569,6 +1881,14 @@ void warpaffine_bilinear_c4(const unsigned char* src, int srcw, int srch, int sr
 }
 
 void warpaffine_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, const float* tm, int type, unsigned int v)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return warpaffine_bilinear_yuv420sp(src, srcw, srch, dst, w, h, tm, type, v, opt);
+}
+
+void warpaffine_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, const float* tm, int type, unsigned int v, const Option& opt)
 {
     // assert srcw % 2 == 0
     // assert srch % 2 == 0
@@ -1587,7 +1907,7 @@ void warpaffine_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch,
 
     const unsigned char* srcY = src;
     unsigned char* dstY = dst;
-    warpaffine_bilinear_c1(srcY, srcw, srch, dstY, w, h, tm, type, v_y);
+    warpaffine_bilinear_c1(srcY, srcw, srch, srcw, dstY, w, h, w, tm, type, v_y, opt);
 
     const float tm_uv[6] = {
         tm[0],
@@ -1600,7 +1920,52 @@ void warpaffine_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch,
 
     const unsigned char* srcUV = src + srcw * srch;
     unsigned char* dstUV = dst + w * h;
-    warpaffine_bilinear_c2(srcUV, srcw / 2, srch / 2, dstUV, w / 2, h / 2, tm_uv, type, v_uv);
+    warpaffine_bilinear_c2(srcUV, srcw / 2, srch / 2, srcw, dstUV, w / 2, h / 2, w, tm_uv, type, v_uv, opt);
+}
+
+static void warpaffine_bilinear(const unsigned char* src, int srcw, int srch, int srcstride, int channels, unsigned char* dst, int w, int h, int stride, const float* tm, int type, unsigned int v, const Option& opt)
+{
+    switch (channels)
+    {
+    case 1:
+        warpaffine_bilinear_c1(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+        break;
+    case 2:
+        warpaffine_bilinear_c2(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+        break;
+    case 3:
+        warpaffine_bilinear_c3(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+        break;
+    case 4:
+        warpaffine_bilinear_c4(src, srcw, srch, srcstride, dst, w, h, stride, tm, type, v, opt);
+        break;
+    default:
+        // unsupported channels
+        break;
+    }
+}
+
+void warpaffine_bilinear_batch(const unsigned char* src, int srcw, int srch, int srcstride, int channels, int count, unsigned char* const* dsts, int w, int h, int stride, const float* tms, int type, unsigned int v, const Option& opt)
+{
+    if (count < opt.num_threads)
+    {
+        // few regions, split the rows of every region instead
+        for (int i = 0; i < count; i++)
+        {
+            warpaffine_bilinear(src, srcw, srch, srcstride, channels, dsts[i], w, h, stride, tms + i * 6, type, v, opt);
+        }
+
+        return;
+    }
+
+    Option opt_region = opt;
+    opt_region.num_threads = 1;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < count; i++)
+    {
+        warpaffine_bilinear(src, srcw, srch, srcstride, channels, dsts[i], w, h, stride, tms + i * 6, type, v, opt_region);
+    }
 }
 #endif // NCNN_PIXEL_AFFINE
 
@@ -4,6 +4,8 @@
 #include "mat.h"
 
 #include <limits.h>
+#include <math.h>
+#include <string.h>
 
 #if __ARM_NEON
 #include <arm_neon.h>
@@ -1053,6 +1055,1733 @@ void resize_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsi
     unsigned char* dstUV = dst + w * h;
     resize_bilinear_c2(srcUV, srcw / 2, srch / 2, dstUV, w / 2, h / 2);
 }
+
+static void resize_area_accumulate(const unsigned char* Sp, int n, unsigned int* sum)
+{
+    int i = 0;
+#if __ARM_NEON
+    for (; i + 15 < n; i += 16)
+    {
+        uint8x16_t _p = vld1q_u8(Sp + i);
+        uint16x8_t _pl = vmovl_u8(vget_low_u8(_p));
+        uint16x8_t _ph = vmovl_u8(vget_high_u8(_p));
+        vst1q_u32(sum + i, vaddw_u16(vld1q_u32(sum + i), vget_low_u16(_pl)));
+        vst1q_u32(sum + i + 4, vaddw_u16(vld1q_u32(sum + i + 4), vget_high_u16(_pl)));
+        vst1q_u32(sum + i + 8, vaddw_u16(vld1q_u32(sum + i + 8), vget_low_u16(_ph)));
+        vst1q_u32(sum + i + 12, vaddw_u16(vld1q_u32(sum + i + 12), vget_high_u16(_ph)));
+    }
+#elif __AVX512F__
+    for (; i + 15 < n; i += 16)
+    {
+        __m512i _p = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(Sp + i)));
+        _mm512_storeu_si512((__m512i*)(sum + i), _mm512_add_epi32(_mm512_loadu_si512((const __m512i*)(sum + i)), _p));
+    }
+#elif __AVX2__
+    for (; i + 7 < n; i += 8)
+    {
+        __m256i _p = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(Sp + i)));
+        _mm256_storeu_si256((__m256i*)(sum + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(sum + i)), _p));
+    }
+#elif __SSE2__
+    __m128i _zero = _mm_setzero_si128();
+    for (; i + 15 < n; i += 16)
+    {
+        __m128i _p = _mm_loadu_si128((const __m128i*)(Sp + i));
+        __m128i _pl = _mm_unpacklo_epi8(_p, _zero);
+        __m128i _ph = _mm_unpackhi_epi8(_p, _zero);
+        _mm_storeu_si128((__m128i*)(sum + i), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(sum + i)), _mm_unpacklo_epi16(_pl, _zero)));
+        _mm_storeu_si128((__m128i*)(sum + i + 4), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(sum + i + 4)), _mm_unpackhi_epi16(_pl, _zero)));
+        _mm_storeu_si128((__m128i*)(sum + i + 8), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(sum + i + 8)), _mm_unpacklo_epi16(_ph, _zero)));
+        _mm_storeu_si128((__m128i*)(sum + i + 12), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(sum + i + 12)), _mm_unpackhi_epi16(_ph, _zero)));
+    }
+#endif // __ARM_NEON
+    for (; i < n; i++)
+    {
+        sum[i] += Sp[i];
+    }
+}
+
+// clamp to [0, 255] and round to nearest
+static void resize_row_store(const float* rowp, int n, unsigned char* Dp)
+{
+    int i = 0;
+#if __ARM_NEON
+    float32x4_t _zero = vdupq_n_f32(0.f);
+    float32x4_t _v255 = vdupq_n_f32(255.f);
+    float32x4_t _half = vdupq_n_f32(0.5f);
+    for (; i + 7 < n; i += 8)
+    {
+        float32x4_t _p0 = vaddq_f32(vminq_f32(vmaxq_f32(vld1q_f32(rowp + i), _zero), _v255), _half);
+        float32x4_t _p1 = vaddq_f32(vminq_f32(vmaxq_f32(vld1q_f32(rowp + i + 4), _zero), _v255), _half);
+        uint16x8_t _p = vcombine_u16(vmovn_u32(vcvtq_u32_f32(_p0)), vmovn_u32(vcvtq_u32_f32(_p1)));
+        vst1_u8(Dp + i, vmovn_u16(_p));
+    }
+#elif __SSE2__
+    __m128 _zero = _mm_setzero_ps();
+    __m128 _v255 = _mm_set1_ps(255.f);
+    __m128 _half = _mm_set1_ps(0.5f);
+    for (; i + 15 < n; i += 16)
+    {
+        __m128i _p0 = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(rowp + i), _zero), _v255), _half));
+        __m128i _p1 = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(rowp + i + 4), _zero), _v255), _half));
+        __m128i _p2 = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(rowp + i + 8), _zero), _v255), _half));
+        __m128i _p3 = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(rowp + i + 12), _zero), _v255), _half));
+        _mm_storeu_si128((__m128i*)(Dp + i), _mm_packus_epi16(_mm_packs_epi32(_p0, _p1), _mm_packs_epi32(_p2, _p3)));
+    }
+#endif // __ARM_NEON
+    for (; i < n; i++)
+    {
+        Dp[i] = (unsigned char)(std::min(std::max(rowp[i], 0.f), 255.f) + 0.5f);
+    }
+}
+
+// sum += rowp * beta
+static void resize_row_accumulate(const float* rowp, float beta, int n, float* sum)
+{
+    int i = 0;
+#if __ARM_NEON
+    float32x4_t _beta = vdupq_n_f32(beta);
+    for (; i + 3 < n; i += 4)
+    {
+        vst1q_f32(sum + i, vmlaq_f32(vld1q_f32(sum + i), vld1q_f32(rowp + i), _beta));
+    }
+#elif __AVX512F__
+    __m512 _beta = _mm512_set1_ps(beta);
+    for (; i + 15 < n; i += 16)
+    {
+        _mm512_storeu_ps(sum + i, _mm512_add_ps(_mm512_loadu_ps(sum + i), _mm512_mul_ps(_mm512_loadu_ps(rowp + i), _beta)));
+    }
+#elif __AVX__
+    __m256 _beta = _mm256_set1_ps(beta);
+    for (; i + 7 < n; i += 8)
+    {
+        _mm256_storeu_ps(sum + i, _mm256_add_ps(_mm256_loadu_ps(sum + i), _mm256_mul_ps(_mm256_loadu_ps(rowp + i), _beta)));
+    }
+#elif __SSE2__
+    __m128 _beta = _mm_set1_ps(beta);
+    for (; i + 3 < n; i += 4)
+    {
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(_mm_loadu_ps(rowp + i), _beta)));
+    }
+#endif // __ARM_NEON
+    for (; i < n; i++)
+    {
+        sum[i] += rowp[i] * beta;
+    }
+}
+
+static void resize_area_integer(const unsigned char* src, int srcstride, int channels, unsigned char* dst, int w, int stride, int kx, int ky, int y0, int y1)
+{
+    const int wsize = w * kx * channels;
+    const int area = kx * ky;
+
+    // power of two area divides with shift
+    int shift = -1;
+    if ((area & (area - 1)) == 0)
+    {
+        shift = 0;
+        while ((1 << shift) < area)
+            shift++;
+    }
+
+    std::vector<unsigned int> sum(wsize);
+
+    for (int y = y0; y < y1; y++)
+    {
+        // vertical sum of ky rows
+        memset(sum.data(), 0, wsize * sizeof(unsigned int));
+
+        const unsigned char* S = src + srcstride * (y * ky);
+        for (int i = 0; i < ky; i++)
+        {
+            resize_area_accumulate(S + srcstride * i, wsize, sum.data());
+        }
+
+        // horizontal sum of kx pixels
+        const unsigned int* sump = sum.data();
+        unsigned char* Dp = dst + stride * y;
+        for (int dx = 0; dx < w; dx++)
+        {
+            for (int k = 0; k < channels; k++)
+            {
+                unsigned int s = area / 2;
+                for (int i = 0; i < kx; i++)
+                {
+                    s += sump[i * channels + k];
+                }
+
+                Dp[k] = (unsigned char)(shift >= 0 ? s >> shift : s / area);
+            }
+
+            sump += kx * channels;
+            Dp += channels;
+        }
+    }
+}
+
+struct ResizeAreaTab
+{
+    int di;
+    int si;
+    float alpha;
+};
+
+// the fraction of every source cell covered by the destination cell, weights of one destination cell sum to 1
+static void compute_resize_area_tab(int ssize, int dsize, double scale, std::vector<ResizeAreaTab>& tab)
+{
+    for (int dx = 0; dx < dsize; dx++)
+    {
+        const double fsx1 = dx * scale;
+        const double fsx2 = fsx1 + scale;
+        const double cell = std::min(scale, ssize - fsx1);
+
+        int sx1 = (int)ceil(fsx1);
+        int sx2 = (int)floor(fsx2);
+        sx2 = std::min(sx2, ssize - 1);
+        sx1 = std::min(sx1, sx2);
+
+        if (sx1 - fsx1 > 1e-3)
+        {
+            ResizeAreaTab t = {dx, sx1 - 1, (float)((sx1 - fsx1) / cell)};
+            tab.push_back(t);
+        }
+
+        for (int sx = sx1; sx < sx2; sx++)
+        {
+            ResizeAreaTab t = {dx, sx, (float)(1.0 / cell)};
+            tab.push_back(t);
+        }
+
+        if (fsx2 - sx2 > 1e-3)
+        {
+            ResizeAreaTab t = {dx, sx2, (float)(std::min(std::min(fsx2 - sx2, 1.0), cell) / cell)};
+            tab.push_back(t);
+        }
+    }
+}
+
+static void hresize_area(const unsigned char* S, int channels, int w, const std::vector<ResizeAreaTab>& xtab, float* rowp)
+{
+    memset(rowp, 0, w * channels * sizeof(float));
+
+    for (size_t i = 0; i < xtab.size(); i++)
+    {
+        const unsigned char* Sp = S + xtab[i].si * channels;
+        float* rp = rowp + xtab[i].di * channels;
+        const float alpha = xtab[i].alpha;
+
+        for (int k = 0; k < channels; k++)
+        {
+            rp[k] += Sp[k] * alpha;
+        }
+    }
+}
+
+static void resize_area_general(const unsigned char* src, int srcstride, int channels, unsigned char* dst, int w, int stride, const std::vector<ResizeAreaTab>& xtab, const std::vector<ResizeAreaTab>& ytab, const std::vector<int>& ytab_start, int y0, int y1)
+{
+    const int wsize = w * channels;
+
+    std::vector<float> row(wsize);
+    std::vector<float> sum(wsize);
+
+    int prev_sy = -1;
+
+    for (int y = y0; y < y1; y++)
+    {
+        memset(sum.data(), 0, wsize * sizeof(float));
+
+        for (int i = ytab_start[y]; i < ytab_start[y + 1]; i++)
+        {
+            const int sy = ytab[i].si;
+
+            // the boundary source row is shared with the previous destination row
+            if (sy != prev_sy)
+            {
+                hresize_area(src + srcstride * sy, channels, w, xtab, row.data());
+                prev_sy = sy;
+            }
+
+            resize_row_accumulate(row.data(), ytab[i].alpha, wsize, sum.data());
+        }
+
+        resize_row_store(sum.data(), wsize, dst + stride * y);
+    }
+}
+
+static void resize_area(const unsigned char* src, int srcw, int srch, int srcstride, int channels, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    if (w > srcw || h > srch)
+    {
+        // area interpolation does not upscale, take bilinear as the closest filter
+        if (channels == 1)
+            resize_bilinear_c1(src, srcw, srch, srcstride, dst, w, h, stride);
+        if (channels == 2)
+            resize_bilinear_c2(src, srcw, srch, srcstride, dst, w, h, stride);
+        if (channels == 3)
+            resize_bilinear_c3(src, srcw, srch, srcstride, dst, w, h, stride);
+        if (channels == 4)
+            resize_bilinear_c4(src, srcw, srch, srcstride, dst, w, h, stride);
+        return;
+    }
+
+    const int num_threads = std::max(std::min(opt.num_threads, h), 1);
+
+    if (srcw % w == 0 && srch % h == 0)
+    {
+        const int kx = srcw / w;
+        const int ky = srch / h;
+
+        #pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < num_threads; i++)
+        {
+            resize_area_integer(src, srcstride, channels, dst, w, stride, kx, ky, h * i / num_threads, h * (i + 1) / num_threads);
+        }
+
+        return;
+    }
+
+    std::vector<ResizeAreaTab> xtab;
+    std::vector<ResizeAreaTab> ytab;
+    compute_resize_area_tab(srcw, w, (double)srcw / w, xtab);
+    compute_resize_area_tab(srch, h, (double)srch / h, ytab);
+
+    // the range of ytab entries of every destination row
+    std::vector<int> ytab_start(h + 1, 0);
+    for (size_t i = 0; i < ytab.size(); i++)
+    {
+        ytab_start[ytab[i].di + 1] = (int)i + 1;
+    }
+    for (int y = 1; y <= h; y++)
+    {
+        ytab_start[y] = std::max(ytab_start[y], ytab_start[y - 1]);
+    }
+
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+        resize_area_general(src, srcstride, channels, dst, w, stride, xtab, ytab, ytab_start, h * i / num_threads, h * (i + 1) / num_threads);
+    }
+}
+
+static inline void interpolate_cubic(float fx, float* coeffs)
+{
+    const float A = -0.75f;
+
+    float fx0 = fx + 1;
+    float fx1 = fx;
+    float fx2 = 1 - fx;
+    // float fx3 = 2 - fx;
+
+    coeffs[0] = A * fx0 * fx0 * fx0 - 5 * A * fx0 * fx0 + 8 * A * fx0 - 4 * A;
+    coeffs[1] = (A + 2) * fx1 * fx1 * fx1 - (A + 3) * fx1 * fx1 + 1;
+    coeffs[2] = (A + 2) * fx2 * fx2 * fx2 - (A + 3) * fx2 * fx2 + 1;
+    coeffs[3] = 1.f - coeffs[0] - coeffs[1] - coeffs[2];
+}
+
+// the first of the 4 taps and their weights for every destination pixel
+static void compute_resize_cubic_tab(int ssize, int dsize, int* ofs, float* alpha)
+{
+    const double scale = (double)ssize / dsize;
+
+    for (int dx = 0; dx < dsize; dx++)
+    {
+        float fx = (float)((dx + 0.5) * scale - 0.5);
+        int sx = (int)floor(fx);
+        fx -= sx;
+
+        interpolate_cubic(fx, alpha + dx * 4);
+
+        ofs[dx] = sx - 1;
+    }
+}
+
+static void hresize_cubic(const unsigned char* S, int channels, int w, const int* xofs, const float* alpha, float* rowp)
+{
+    if (channels == 4)
+    {
+        for (int dx = 0; dx < w; dx++)
+        {
+            const int* ofs = xofs + dx * 4;
+            const float* a = alpha + dx * 4;
+#if __SSE2__
+            __m128i _zero = _mm_setzero_si128();
+            __m128 _sum = _mm_setzero_ps();
+            for (int i = 0; i < 4; i++)
+            {
+                int p;
+                memcpy(&p, S + ofs[i], 4);
+                __m128i _p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p), _zero), _zero);
+                _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_cvtepi32_ps(_p), _mm_set1_ps(a[i])));
+            }
+            _mm_storeu_ps(rowp + dx * 4, _sum);
+#elif __ARM_NEON
+            float32x4_t _sum = vdupq_n_f32(0.f);
+            for (int i = 0; i < 4; i++)
+            {
+                unsigned int p;
+                memcpy(&p, S + ofs[i], 4);
+                uint16x8_t _p = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(p)));
+                _sum = vmlaq_n_f32(_sum, vcvtq_f32_u32(vmovl_u16(vget_low_u16(_p))), a[i]);
+            }
+            vst1q_f32(rowp + dx * 4, _sum);
+#else
+            for (int k = 0; k < 4; k++)
+            {
+                rowp[dx * 4 + k] = S[ofs[0] + k] * a[0] + S[ofs[1] + k] * a[1] + S[ofs[2] + k] * a[2] + S[ofs[3] + k] * a[3];
+            }
+#endif // __SSE2__
+        }
+
+        return;
+    }
+
+    for (int dx = 0; dx < w; dx++)
+    {
+        const int* ofs = xofs + dx * 4;
+        const float* a = alpha + dx * 4;
+
+        for (int k = 0; k < channels; k++)
+        {
+            rowp[dx * channels + k] = S[ofs[0] + k] * a[0] + S[ofs[1] + k] * a[1] + S[ofs[2] + k] * a[2] + S[ofs[3] + k] * a[3];
+        }
+    }
+}
+
+static void vresize_cubic(const float* rows0p, const float* rows1p, const float* rows2p, const float* rows3p, const float* beta, int wsize, float* rowp)
+{
+    int i = 0;
+#if __ARM_NEON
+    for (; i + 3 < wsize; i += 4)
+    {
+        float32x4_t _sum = vmulq_n_f32(vld1q_f32(rows0p + i), beta[0]);
+        _sum = vmlaq_n_f32(_sum, vld1q_f32(rows1p + i), beta[1]);
+        _sum = vmlaq_n_f32(_sum, vld1q_f32(rows2p + i), beta[2]);
+        _sum = vmlaq_n_f32(_sum, vld1q_f32(rows3p + i), beta[3]);
+        vst1q_f32(rowp + i, _sum);
+    }
+#elif __AVX512F__
+    __m512 _b0 = _mm512_set1_ps(beta[0]);
+    __m512 _b1 = _mm512_set1_ps(beta[1]);
+    __m512 _b2 = _mm512_set1_ps(beta[2]);
+    __m512 _b3 = _mm512_set1_ps(beta[3]);
+    for (; i + 15 < wsize; i += 16)
+    {
+        __m512 _sum = _mm512_mul_ps(_mm512_loadu_ps(rows0p + i), _b0);
+        _sum = _mm512_add_ps(_sum, _mm512_mul_ps(_mm512_loadu_ps(rows1p + i), _b1));
+        _sum = _mm512_add_ps(_sum, _mm512_mul_ps(_mm512_loadu_ps(rows2p + i), _b2));
+        _sum = _mm512_add_ps(_sum, _mm512_mul_ps(_mm512_loadu_ps(rows3p + i), _b3));
+        _mm512_storeu_ps(rowp + i, _sum);
+    }
+#elif __AVX__
+    __m256 _b0 = _mm256_set1_ps(beta[0]);
+    __m256 _b1 = _mm256_set1_ps(beta[1]);
+    __m256 _b2 = _mm256_set1_ps(beta[2]);
+    __m256 _b3 = _mm256_set1_ps(beta[3]);
+    for (; i + 7 < wsize; i += 8)
+    {
+        __m256 _sum = _mm256_mul_ps(_mm256_loadu_ps(rows0p + i), _b0);
+        _sum = _mm256_add_ps(_sum, _mm256_mul_ps(_mm256_loadu_ps(rows1p + i), _b1));
+        _sum = _mm256_add_ps(_sum, _mm256_mul_ps(_mm256_loadu_ps(rows2p + i), _b2));
+        _sum = _mm256_add_ps(_sum, _mm256_mul_ps(_mm256_loadu_ps(rows3p + i), _b3));
+        _mm256_storeu_ps(rowp + i, _sum);
+    }
+#elif __SSE2__
+    __m128 _b0 = _mm_set1_ps(beta[0]);
+    __m128 _b1 = _mm_set1_ps(beta[1]);
+    __m128 _b2 = _mm_set1_ps(beta[2]);
+    __m128 _b3 = _mm_set1_ps(beta[3]);
+    for (; i + 3 < wsize; i += 4)
+    {
+        __m128 _sum = _mm_mul_ps(_mm_loadu_ps(rows0p + i), _b0);
+        _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_loadu_ps(rows1p + i), _b1));
+        _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_loadu_ps(rows2p + i), _b2));
+        _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_loadu_ps(rows3p + i), _b3));
+        _mm_storeu_ps(rowp + i, _sum);
+    }
+#endif // __ARM_NEON
+    for (; i < wsize; i++)
+    {
+        rowp[i] = rows0p[i] * beta[0] + rows1p[i] * beta[1] + rows2p[i] * beta[2] + rows3p[i] * beta[3];
+    }
+}
+
+static void resize_bicubic_rows(const unsigned char* src, int srch, int srcstride, int channels, unsigned char* dst, int w, int stride, const int* xofs, const float* alpha, const int* yofs, const float* beta, int y0, int y1)
+{
+    const int wsize = w * channels;
+
+    // ring of 4 horizontally resized rows, slot sy & 3 holds source row sy
+    std::vector<float> rows(wsize * 4);
+    std::vector<float> row(wsize);
+    int rows_sy[4] = {INT_MIN, INT_MIN, INT_MIN, INT_MIN};
+
+    for (int y = y0; y < y1; y++)
+    {
+        const float* rowsp[4];
+        for (int i = 0; i < 4; i++)
+        {
+            const int sy = yofs[y] + i;
+            float* rowp = rows.data() + wsize * (sy & 3);
+
+            if (rows_sy[sy & 3] != sy)
+            {
+                const int sy_clamped = std::min(std::max(sy, 0), srch - 1);
+                hresize_cubic(src + srcstride * sy_clamped, channels, w, xofs, alpha, rowp);
+                rows_sy[sy & 3] = sy;
+            }
+
+            rowsp[i] = rowp;
+        }
+
+        vresize_cubic(rowsp[0], rowsp[1], rowsp[2], rowsp[3], beta + y * 4, wsize, row.data());
+
+        resize_row_store(row.data(), wsize, dst + stride * y);
+    }
+}
+
+static void resize_bicubic(const unsigned char* src, int srcw, int srch, int srcstride, int channels, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    std::vector<int> xofs(w * 4);
+    std::vector<float> alpha(w * 4);
+    std::vector<int> yofs(h);
+    std::vector<float> beta(h * 4);
+
+    compute_resize_cubic_tab(srcw, w, xofs.data(), alpha.data());
+    compute_resize_cubic_tab(srch, h, yofs.data(), beta.data());
+
+    // expand to the byte offsets of the 4 horizontal taps, replicate the border
+    for (int dx = w - 1; dx >= 0; dx--)
+    {
+        const int sx = xofs[dx];
+        for (int i = 0; i < 4; i++)
+        {
+            xofs[dx * 4 + i] = std::min(std::max(sx + i, 0), srcw - 1) * channels;
+        }
+    }
+
+    const int num_threads = std::max(std::min(opt.num_threads, h), 1);
+
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+        resize_bicubic_rows(src, srch, srcstride, channels, dst, w, stride, xofs.data(), alpha.data(), yofs.data(), beta.data(), h * i / num_threads, h * (i + 1) / num_threads);
+    }
+}
+
+void resize_area_c1(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_area_c1(src, srcw, srch, srcw * 1, dst, w, h, w * 1);
+}
+
+void resize_area_c2(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_area_c2(src, srcw, srch, srcw * 2, dst, w, h, w * 2);
+}
+
+void resize_area_c3(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_area_c3(src, srcw, srch, srcw * 3, dst, w, h, w * 3);
+}
+
+void resize_area_c4(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_area_c4(src, srcw, srch, srcw * 4, dst, w, h, w * 4);
+}
+
+void resize_area_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_area(src, srcw, srch, srcstride, 1, dst, w, h, stride, opt);
+}
+
+void resize_area_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_area(src, srcw, srch, srcstride, 2, dst, w, h, stride, opt);
+}
+
+void resize_area_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_area(src, srcw, srch, srcstride, 3, dst, w, h, stride, opt);
+}
+
+void resize_area_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_area(src, srcw, srch, srcstride, 4, dst, w, h, stride, opt);
+}
+
+void resize_area_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_area(src, srcw, srch, srcstride, 1, dst, w, h, stride, opt);
+}
+
+void resize_area_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_area(src, srcw, srch, srcstride, 2, dst, w, h, stride, opt);
+}
+
+void resize_area_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_area(src, srcw, srch, srcstride, 3, dst, w, h, stride, opt);
+}
+
+void resize_area_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_area(src, srcw, srch, srcstride, 4, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c1(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_bicubic_c1(src, srcw, srch, srcw * 1, dst, w, h, w * 1);
+}
+
+void resize_bicubic_c2(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_bicubic_c2(src, srcw, srch, srcw * 2, dst, w, h, w * 2);
+}
+
+void resize_bicubic_c3(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_bicubic_c3(src, srcw, srch, srcw * 3, dst, w, h, w * 3);
+}
+
+void resize_bicubic_c4(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    return resize_bicubic_c4(src, srcw, srch, srcw * 4, dst, w, h, w * 4);
+}
+
+void resize_bicubic_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_bicubic(src, srcw, srch, srcstride, 1, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_bicubic(src, srcw, srch, srcstride, 2, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_bicubic(src, srcw, srch, srcstride, 3, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
+{
+    Option opt;
+    opt.num_threads = 1;
+
+    return resize_bicubic(src, srcw, srch, srcstride, 4, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_bicubic(src, srcw, srch, srcstride, 1, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_bicubic(src, srcw, srch, srcstride, 2, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_bicubic(src, srcw, srch, srcstride, 3, dst, w, h, stride, opt);
+}
+
+void resize_bicubic_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, const Option& opt)
+{
+    return resize_bicubic(src, srcw, srch, srcstride, 4, dst, w, h, stride, opt);
+}
+
+PixelPreprocessOption::PixelPreprocessOption()
+{
+    roix = 0;
+    roiy = 0;
+    roiw = 0;
+    roih = 0;
+    target_width = 0;
+    target_height = 0;
+    pad_top = 0;
+    pad_bottom = 0;
+    pad_left = 0;
+    pad_right = 0;
+    pad_value = 0.f;
+    mean_vals = 0;
+    norm_vals = 0;
+    elempack = 1;
+    elemtype = 0;
+    int8_scale = 1.f;
+    num_threads = 1;
+}
+
+void PixelPreprocessOption::set_letterbox(int w, int h, int target_size, int align)
+{
+    // same rounding as the yolov5 example
+    int tw = w;
+    int th = h;
+    if (w > h)
+    {
+        float scale = (float)target_size / w;
+        tw = target_size;
+        th = h * scale;
+    }
+    else
+    {
+        float scale = (float)target_size / h;
+        th = target_size;
+        tw = w * scale;
+    }
+
+    const int outw = align > 0 ? (tw + align - 1) / align * align : target_size;
+    const int outh = align > 0 ? (th + align - 1) / align * align : target_size;
+    const int wpad = outw - tw;
+    const int hpad = outh - th;
+
+    target_width = tw;
+    target_height = th;
+    pad_top = hpad / 2;
+    pad_bottom = hpad - hpad / 2;
+    pad_left = wpad / 2;
+    pad_right = wpad - wpad / 2;
+}
+
+static int get_pixel_channels(int format)
+{
+    if (format == Mat::PIXEL_RGB || format == Mat::PIXEL_BGR)
+        return 3;
+    if (format == Mat::PIXEL_GRAY)
+        return 1;
+    if (format == Mat::PIXEL_RGBA || format == Mat::PIXEL_BGRA)
+        return 4;
+    return 0;
+}
+
+// channel index of r g b a in format, -1 if absent
+static void get_pixel_rgba_index(int format, int* rgba_index)
+{
+    rgba_index[0] = -1;
+    rgba_index[1] = -1;
+    rgba_index[2] = -1;
+    rgba_index[3] = -1;
+
+    if (format == Mat::PIXEL_RGB || format == Mat::PIXEL_RGBA)
+    {
+        rgba_index[0] = 0;
+        rgba_index[1] = 1;
+        rgba_index[2] = 2;
+    }
+    if (format == Mat::PIXEL_BGR || format == Mat::PIXEL_BGRA)
+    {
+        rgba_index[0] = 2;
+        rgba_index[1] = 1;
+        rgba_index[2] = 0;
+    }
+    if (format == Mat::PIXEL_RGBA || format == Mat::PIXEL_BGRA)
+    {
+        rgba_index[3] = 3;
+    }
+}
+
+static inline signed char float2int8(float v)
+{
+    int int32 = static_cast<int>(round(v));
+    if (int32 > 127) return 127;
+    if (int32 < -127) return -127;
+    return (signed char)int32;
+}
+
+
+// convert one yuv420 row to rgbx with the same fixed point arithmetic as yuv420sp2rgb
+// uptr and vptr point to the chroma row, uvstep is 1 for planar and 2 for semi-planar chroma, x0 is the first column
+static void yuv420_to_rgbx_row(const unsigned char* yptr, const unsigned char* uptr, const unsigned char* vptr, int uvstep, int x0, int w, unsigned char* rgbx)
+{
+#define SATURATE_CAST_UCHAR(X) (unsigned char)::std::min(::std::max((int)(X), 0), 255);
+
+    int x = 0;
+
+    // start on an even column so that every chroma sample serves two pixels
+    if (x0 % 2 == 1 && w > 0)
+    {
+        const int ci = x0 / 2 * uvstep;
+        const int u = uptr[ci] - 128;
+        const int v = vptr[ci] - 128;
+
+        const int yy = yptr[x0] << 6;
+        rgbx[0] = SATURATE_CAST_UCHAR((yy + 90 * v) >> 6);
+        rgbx[1] = SATURATE_CAST_UCHAR((yy - 46 * v - 22 * u) >> 6);
+        rgbx[2] = SATURATE_CAST_UCHAR((yy + 113 * u) >> 6);
+        rgbx[3] = 255;
+
+        x = 1;
+    }
+
+    const unsigned char* yp = yptr + x0 + x;
+    const unsigned char* up = uptr + (x0 + x) / 2 * uvstep;
+    const unsigned char* vp = vptr + (x0 + x) / 2 * uvstep;
+    unsigned char* outptr = rgbx + x * 4;
+
+#if __ARM_NEON
+    uint8x8_t _v128 = vdup_n_u8(128);
+    uint8x16_t _v255 = vdupq_n_u8(255);
+    for (; x + 15 < w; x += 16)
+    {
+        uint8x8_t _u;
+        uint8x8_t _v;
+        if (uvstep == 2)
+        {
+            // vptr is uptr + 1 for nv12 and uptr - 1 for nv21
+            uint8x8x2_t _uv = vld2_u8(std::min(up, vp));
+            _u = up < vp ? _uv.val[0] : _uv.val[1];
+            _v = up < vp ? _uv.val[1] : _uv.val[0];
+        }
+        else
+        {
+            _u = vld1_u8(up);
+            _v = vld1_u8(vp);
+        }
+
+        uint8x8x2_t _uu2 = vzip_u8(_u, _u);
+        uint8x8x2_t _vv2 = vzip_u8(_v, _v);
+
+        uint8x16_t _y = vld1q_u8(yp);
+
+        uint8x8x4_t _rgbx0;
+        uint8x8x4_t _rgbx1;
+        for (int i = 0; i < 2; i++)
+        {
+            int16x8_t _yy = vreinterpretq_s16_u16(vshll_n_u8(i == 0 ? vget_low_u8(_y) : vget_high_u8(_y), 6));
+            int16x8_t _uu = vreinterpretq_s16_u16(vsubl_u8(_uu2.val[i], _v128));
+            int16x8_t _vv = vreinterpretq_s16_u16(vsubl_u8(_vv2.val[i], _v128));
+
+            int16x8_t _r = vmlaq_n_s16(_yy, _vv, 90);
+            int16x8_t _g = vmlsq_n_s16(vmlsq_n_s16(_yy, _vv, 46), _uu, 22);
+            int16x8_t _b = vmlaq_n_s16(_yy, _uu, 113);
+
+            uint8x8x4_t& _rgbx = i == 0 ? _rgbx0 : _rgbx1;
+            _rgbx.val[0] = vqshrun_n_s16(_r, 6);
+            _rgbx.val[1] = vqshrun_n_s16(_g, 6);
+            _rgbx.val[2] = vqshrun_n_s16(_b, 6);
+            _rgbx.val[3] = vget_low_u8(_v255);
+        }
+
+        vst4_u8(outptr, _rgbx0);
+        vst4_u8(outptr + 32, _rgbx1);
+
+        yp += 16;
+        up += 8 * uvstep;
+        vp += 8 * uvstep;
+        outptr += 64;
+    }
+#elif __SSE2__
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _v128 = _mm_set1_epi16(128);
+    __m128i _v90 = _mm_set1_epi16(90);
+    __m128i _v46 = _mm_set1_epi16(46);
+    __m128i _v22 = _mm_set1_epi16(22);
+    __m128i _v113 = _mm_set1_epi16(113);
+    __m128i _v255 = _mm_set1_epi8((char)255);
+    for (; x + 15 < w; x += 16)
+    {
+        __m128i _uu16;
+        __m128i _vv16;
+        if (uvstep == 2)
+        {
+            __m128i _uv = _mm_loadu_si128((const __m128i*)std::min(up, vp));
+            __m128i _lo = _mm_and_si128(_uv, _mm_set1_epi16(0xff));
+            __m128i _hi = _mm_srli_epi16(_uv, 8);
+            _uu16 = _mm_sub_epi16(up < vp ? _lo : _hi, _v128);
+            _vv16 = _mm_sub_epi16(up < vp ? _hi : _lo, _v128);
+        }
+        else
+        {
+            _uu16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)up), _zero), _v128);
+            _vv16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)vp), _zero), _v128);
+        }
+
+        // every chroma sample is shared by two horizontal pixels
+        __m128i _ruv0 = _mm_mullo_epi16(_mm_unpacklo_epi16(_vv16, _vv16), _v90);
+        __m128i _ruv1 = _mm_mullo_epi16(_mm_unpackhi_epi16(_vv16, _vv16), _v90);
+        __m128i _guv0 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi16(_vv16, _vv16), _v46), _mm_mullo_epi16(_mm_unpacklo_epi16(_uu16, _uu16), _v22));
+        __m128i _guv1 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi16(_vv16, _vv16), _v46), _mm_mullo_epi16(_mm_unpackhi_epi16(_uu16, _uu16), _v22));
+        __m128i _buv0 = _mm_mullo_epi16(_mm_unpacklo_epi16(_uu16, _uu16), _v113);
+        __m128i _buv1 = _mm_mullo_epi16(_mm_unpackhi_epi16(_uu16, _uu16), _v113);
+
+        __m128i _y = _mm_loadu_si128((const __m128i*)yp);
+        __m128i _yy0 = _mm_slli_epi16(_mm_unpacklo_epi8(_y, _zero), 6);
+        __m128i _yy1 = _mm_slli_epi16(_mm_unpackhi_epi8(_y, _zero), 6);
+
+        __m128i _r = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy0, _ruv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy1, _ruv1), 6));
+        __m128i _g = _mm_packus_epi16(_mm_srai_epi16(_mm_sub_epi16(_yy0, _guv0), 6), _mm_srai_epi16(_mm_sub_epi16(_yy1, _guv1), 6));
+        __m128i _b = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(_yy0, _buv0), 6), _mm_srai_epi16(_mm_add_epi16(_yy1, _buv1), 6));
+
+        __m128i _rgl = _mm_unpacklo_epi8(_r, _g);
+        __m128i _rgh = _mm_unpackhi_epi8(_r, _g);
+        __m128i _bxl = _mm_unpacklo_epi8(_b, _v255);
+        __m128i _bxh = _mm_unpackhi_epi8(_b, _v255);
+        _mm_storeu_si128((__m128i*)outptr, _mm_unpacklo_epi16(_rgl, _bxl));
+        _mm_storeu_si128((__m128i*)(outptr + 16), _mm_unpackhi_epi16(_rgl, _bxl));
+        _mm_storeu_si128((__m128i*)(outptr + 32), _mm_unpacklo_epi16(_rgh, _bxh));
+        _mm_storeu_si128((__m128i*)(outptr + 48), _mm_unpackhi_epi16(_rgh, _bxh));
+
+        yp += 16;
+        up += 8 * uvstep;
+        vp += 8 * uvstep;
+        outptr += 64;
+    }
+#endif // __ARM_NEON
+    for (; x < w; x++)
+    {
+        // the chroma sample moves on every second pixel
+        const int u = up[0] - 128;
+        const int v = vp[0] - 128;
+
+        const int yy = yp[0] << 6;
+        outptr[0] = SATURATE_CAST_UCHAR((yy + 90 * v) >> 6);
+        outptr[1] = SATURATE_CAST_UCHAR((yy - 46 * v - 22 * u) >> 6);
+        outptr[2] = SATURATE_CAST_UCHAR((yy + 113 * u) >> 6);
+        outptr[3] = 255;
+
+        if ((x0 + x) % 2 == 1)
+        {
+            up += uvstep;
+            vp += uvstep;
+        }
+
+        yp += 1;
+        outptr += 4;
+    }
+
+#undef SATURATE_CAST_UCHAR
+}
+
+class PixelPreprocessKernel
+{
+public:
+    PixelPreprocessKernel();
+
+    // return 0 if success, -100 if the row buffers could not be allocated
+    int forward(int y0, int y1, Mat& m) const;
+
+protected:
+    const unsigned char* source_row(int sy, unsigned char* buf) const;
+    void convert_row(const unsigned char* row, float* line) const;
+    void store_row(const float* line, int y, Mat& m) const;
+
+public:
+    void fill_pad(int y, int x0, int count, Mat& m) const;
+
+public:
+    // source image and roi
+    const unsigned char* src;
+    int srcstride;
+    int roix;
+    int roiy;
+    int srcw;
+    int srch;
+    int srcc;
+
+    // yuv420 chroma planes, src is the luma plane and rows are converted to rgbx on the fly
+    const unsigned char* u;
+    const unsigned char* v;
+    int uvstride;
+    int uvstep;
+
+    int w;
+    int outc;
+
+    // how each output channel is made
+    // >= 0 source channel, -1 gray from source rgb, -2 opaque alpha
+    int channel_map[4];
+    int rgb_index[3];
+
+    // resize coeffs, empty when roi size equals target size
+    bool resize;
+    const int* xofs;
+    const short* ialpha;
+    const int* yofs;
+    const short* ibeta;
+
+    float scale[4];
+    float bias[4];
+
+    // where the resized image starts in the padded output, pad_value already normalized
+    int dstx;
+    int dsty;
+    float pad_value[4];
+
+    int elempack;
+    int elemtype;
+    float int8_scale;
+};
+
+PixelPreprocessKernel::PixelPreprocessKernel()
+{
+    src = 0;
+    srcstride = 0;
+    roix = 0;
+    roiy = 0;
+    srcw = 0;
+    srch = 0;
+    srcc = 0;
+    u = 0;
+    v = 0;
+    uvstride = 0;
+    uvstep = 0;
+    w = 0;
+    outc = 0;
+    resize = false;
+    xofs = 0;
+    ialpha = 0;
+    yofs = 0;
+    ibeta = 0;
+    dstx = 0;
+    dsty = 0;
+    elempack = 1;
+    elemtype = 0;
+    int8_scale = 1.f;
+}
+
+const unsigned char* PixelPreprocessKernel::source_row(int sy, unsigned char* buf) const
+{
+    const int y = roiy + sy;
+
+    if (!u)
+        return src + srcstride * y + roix * srcc;
+
+    const unsigned char* yptr = src + srcstride * y;
+    const unsigned char* uptr = u + uvstride * (y / 2);
+    const unsigned char* vptr = v + uvstride * (y / 2);
+    yuv420_to_rgbx_row(yptr, uptr, vptr, uvstep, roix, srcw, buf);
+
+    return buf;
+}
+
+#if __SSE2__
+// channel ci of 4 interleaved pixels as int32
+static inline __m128i load_u8_channel_4(const unsigned char* ptr, int srcc, int ci)
+{
+    if (srcc == 1)
+    {
+        int v;
+        memcpy(&v, ptr, 4);
+        __m128i _p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), _mm_setzero_si128());
+        return _mm_unpacklo_epi16(_p, _mm_setzero_si128());
+    }
+
+    if (srcc == 4)
+    {
+        __m128i _p = _mm_loadu_si128((const __m128i*)ptr);
+        return _mm_and_si128(_mm_srl_epi32(_p, _mm_cvtsi32_si128(ci * 8)), _mm_set1_epi32(255));
+    }
+
+    return _mm_setr_epi32(ptr[ci], ptr[srcc + ci], ptr[srcc * 2 + ci], ptr[srcc * 3 + ci]);
+}
+#endif // __SSE2__
+
+void PixelPreprocessKernel::convert_row(const unsigned char* row, float* line) const
+{
+    // coeffs for r g b = 0.299f, 0.587f, 0.114f
+    const unsigned char Y_shift = 8; //14
+    const unsigned char R2Y = 77;
+    const unsigned char G2Y = 150;
+    const unsigned char B2Y = 29;
+
+    for (int k = 0; k < outc; k++)
+    {
+        const int ci = channel_map[k];
+        const float s = scale[k];
+        const float b = bias[k];
+        float* outptr = line + k * w;
+
+        if (ci >= 0)
+        {
+            int x = 0;
+#if __ARM_NEON
+            float32x4_t _s = vdupq_n_f32(s);
+            float32x4_t _b = vdupq_n_f32(b);
+            for (; x + 7 < w; x += 8)
+            {
+                const unsigned char* ptr = row + x * srcc;
+
+                uint8x8_t _p;
+                if (srcc == 1)
+                {
+                    _p = vld1_u8(ptr);
+                }
+                else if (srcc == 3)
+                {
+                    uint8x8x3_t _p3 = vld3_u8(ptr);
+                    _p = ci == 0 ? _p3.val[0] : ci == 1 ? _p3.val[1] : _p3.val[2];
+                }
+                else
+                {
+                    uint8x8x4_t _p4 = vld4_u8(ptr);
+                    _p = ci == 0 ? _p4.val[0] : ci == 1 ? _p4.val[1] : ci == 2 ? _p4.val[2] : _p4.val[3];
+                }
+
+                uint16x8_t _p16 = vmovl_u8(_p);
+                float32x4_t _p0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(_p16)));
+                float32x4_t _p1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(_p16)));
+                vst1q_f32(outptr + x, vmlaq_f32(_b, _p0, _s));
+                vst1q_f32(outptr + x + 4, vmlaq_f32(_b, _p1, _s));
+            }
+#elif __SSE2__
+            __m128 _s = _mm_set1_ps(s);
+            __m128 _b = _mm_set1_ps(b);
+            for (; x + 3 < w; x += 4)
+            {
+                __m128 _p = _mm_cvtepi32_ps(load_u8_channel_4(row + x * srcc, srcc, ci));
+                _mm_storeu_ps(outptr + x, _mm_add_ps(_mm_mul_ps(_p, _s), _b));
+            }
+#endif // __ARM_NEON
+            const unsigned char* ptr = row + x * srcc + ci;
+            for (; x < w; x++)
+            {
+                outptr[x] = ptr[0] * s + b;
+                ptr += srcc;
+            }
+        }
+        else if (ci == -1)
+        {
+            const int ri = rgb_index[0];
+            const int gi = rgb_index[1];
+            const int bi = rgb_index[2];
+
+            int x = 0;
+#if __ARM_NEON
+            float32x4_t _s = vdupq_n_f32(s);
+            float32x4_t _b = vdupq_n_f32(b);
+            uint8x8_t _R2Y = vdup_n_u8(R2Y);
+            uint8x8_t _G2Y = vdup_n_u8(G2Y);
+            uint8x8_t _B2Y = vdup_n_u8(B2Y);
+            for (; x + 7 < w; x += 8)
+            {
+                const unsigned char* ptr = row + x * srcc;
+
+                uint8x8_t _r;
+                uint8x8_t _g;
+                uint8x8_t _bb;
+                if (srcc == 3)
+                {
+                    uint8x8x3_t _p3 = vld3_u8(ptr);
+                    _r = ri == 0 ? _p3.val[0] : _p3.val[2];
+                    _g = _p3.val[1];
+                    _bb = bi == 0 ? _p3.val[0] : _p3.val[2];
+                }
+                else
+                {
+                    uint8x8x4_t _p4 = vld4_u8(ptr);
+                    _r = ri == 0 ? _p4.val[0] : ri == 1 ? _p4.val[1] : ri == 2 ? _p4.val[2] : _p4.val[3];
+                    _g = gi == 0 ? _p4.val[0] : gi == 1 ? _p4.val[1] : gi == 2 ? _p4.val[2] : _p4.val[3];
+                    _bb = bi == 0 ? _p4.val[0] : bi == 1 ? _p4.val[1] : bi == 2 ? _p4.val[2] : _p4.val[3];
+                }
+
+                // the sum stays below 65536
+                uint16x8_t _y = vmull_u8(_r, _R2Y);
+                _y = vmlal_u8(_y, _g, _G2Y);
+                _y = vmlal_u8(_y, _bb, _B2Y);
+                _y = vshrq_n_u16(_y, Y_shift);
+
+                float32x4_t _p0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(_y)));
+                float32x4_t _p1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(_y)));
+                vst1q_f32(outptr + x, vmlaq_f32(_b, _p0, _s));
+                vst1q_f32(outptr + x + 4, vmlaq_f32(_b, _p1, _s));
+            }
+#elif __SSE2__
+            __m128 _s = _mm_set1_ps(s);
+            __m128 _b = _mm_set1_ps(b);
+            __m128i _R2Y = _mm_set1_epi32(R2Y);
+            __m128i _G2Y = _mm_set1_epi32(G2Y);
+            __m128i _B2Y = _mm_set1_epi32(B2Y);
+            for (; x + 3 < w; x += 4)
+            {
+                const unsigned char* ptr = row + x * srcc;
+
+                // products fit in the low 16 bits of each lane
+                __m128i _y = _mm_mullo_epi16(load_u8_channel_4(ptr, srcc, ri), _R2Y);
+                _y = _mm_add_epi32(_y, _mm_mullo_epi16(load_u8_channel_4(ptr, srcc, gi), _G2Y));
+                _y = _mm_add_epi32(_y, _mm_mullo_epi16(load_u8_channel_4(ptr, srcc, bi), _B2Y));
+                _y = _mm_srli_epi32(_y, Y_shift);
+
+                _mm_storeu_ps(outptr + x, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_y), _s), _b));
+            }
+#endif // __ARM_NEON
+            const unsigned char* ptr = row + x * srcc;
+            for (; x < w; x++)
+            {
+                outptr[x] = static_cast<float>((ptr[ri] * R2Y + ptr[gi] * G2Y + ptr[bi] * B2Y) >> Y_shift) * s + b;
+                ptr += srcc;
+            }
+        }
+        else
+        {
+            const float v = 255.f * s + b;
+            for (int x = 0; x < w; x++)
+            {
+                outptr[x] = v;
+            }
+        }
+    }
+}
+
+void PixelPreprocessKernel::store_row(const float* line, int y, Mat& m) const
+{
+    for (int g = 0; g < outc / elempack; g++)
+    {
+        const float* lines = line + g * elempack * w;
+
+        if (elemtype == 0)
+        {
+            float* outptr = m.channel(g).row(dsty + y) + dstx * elempack;
+
+            if (elempack == 1)
+            {
+                memcpy(outptr, lines, w * sizeof(float));
+                continue;
+            }
+
+            int x = 0;
+            if (elempack == 4)
+            {
+                const float* l0 = lines;
+                const float* l1 = lines + w;
+                const float* l2 = lines + w * 2;
+                const float* l3 = lines + w * 3;
+#if __ARM_NEON
+                for (; x + 3 < w; x += 4)
+                {
+                    float32x4x4_t _p;
+                    _p.val[0] = vld1q_f32(l0 + x);
+                    _p.val[1] = vld1q_f32(l1 + x);
+                    _p.val[2] = vld1q_f32(l2 + x);
+                    _p.val[3] = vld1q_f32(l3 + x);
+                    vst4q_f32(outptr + x * 4, _p);
+                }
+#endif // __ARM_NEON
+#if __SSE2__
+                for (; x + 3 < w; x += 4)
+                {
+                    __m128 _p0 = _mm_loadu_ps(l0 + x);
+                    __m128 _p1 = _mm_loadu_ps(l1 + x);
+                    __m128 _p2 = _mm_loadu_ps(l2 + x);
+                    __m128 _p3 = _mm_loadu_ps(l3 + x);
+                    _MM_TRANSPOSE4_PS(_p0, _p1, _p2, _p3);
+                    _mm_storeu_ps(outptr + x * 4, _p0);
+                    _mm_storeu_ps(outptr + x * 4 + 4, _p1);
+                    _mm_storeu_ps(outptr + x * 4 + 8, _p2);
+                    _mm_storeu_ps(outptr + x * 4 + 12, _p3);
+                }
+#endif // __SSE2__
+            }
+            for (; x < w; x++)
+            {
+                for (int i = 0; i < elempack; i++)
+                {
+                    outptr[x * elempack + i] = lines[i * w + x];
+                }
+            }
+        }
+        if (elemtype == 1 || elemtype == 2)
+        {
+            unsigned short* outptr = m.channel(g).row<unsigned short>(dsty + y) + dstx * elempack;
+
+            for (int x = 0; x < w; x++)
+            {
+                for (int i = 0; i < elempack; i++)
+                {
+                    const float v = lines[i * w + x];
+                    outptr[x * elempack + i] = elemtype == 1 ? float32_to_float16(v) : float32_to_bfloat16(v);
+                }
+            }
+        }
+        if (elemtype == 3)
+        {
+            signed char* outptr = m.channel(g).row<signed char>(dsty + y) + dstx * elempack;
+
+            for (int x = 0; x < w; x++)
+            {
+                for (int i = 0; i < elempack; i++)
+                {
+                    outptr[x * elempack + i] = float2int8(lines[i * w + x] * int8_scale);
+                }
+            }
+        }
+    }
+}
+
+void PixelPreprocessKernel::fill_pad(int y, int x0, int count, Mat& m) const
+{
+    if (count <= 0)
+        return;
+
+    for (int g = 0; g < outc / elempack; g++)
+    {
+        const float* v = pad_value + g * elempack;
+
+        if (elemtype == 0)
+        {
+            float* outptr = m.channel(g).row(y) + x0 * elempack;
+            for (int x = 0; x < count; x++)
+            {
+                for (int i = 0; i < elempack; i++)
+                {
+                    outptr[x * elempack + i] = v[i];
+                }
+            }
+        }
+        if (elemtype == 1 || elemtype == 2)
+        {
+            unsigned short vs[4];
+            for (int i = 0; i < elempack; i++)
+            {
+                vs[i] = elemtype == 1 ? float32_to_float16(v[i]) : float32_to_bfloat16(v[i]);
+            }
+
+            unsigned short* outptr = m.channel(g).row<unsigned short>(y) + x0 * elempack;
+            for (int x = 0; x < count; x++)
+            {
+                for (int i = 0; i < elempack; i++)
+                {
+                    outptr[x * elempack + i] = vs[i];
+                }
+            }
+        }
+        if (elemtype == 3)
+        {
+            signed char vs[4];
+            for (int i = 0; i < elempack; i++)
+            {
+                vs[i] = float2int8(v[i] * int8_scale);
+            }
+
+            signed char* outptr = m.channel(g).row<signed char>(y) + x0 * elempack;
+            for (int x = 0; x < count; x++)
+            {
+                for (int i = 0; i < elempack; i++)
+                {
+                    outptr[x * elempack + i] = vs[i];
+                }
+            }
+        }
+    }
+}
+
+int PixelPreprocessKernel::forward(int y0, int y1, Mat& m) const
+{
+    // only a few rows live at once
+    Mat rowsbuf0(w * srcc + 1, (size_t)2u);
+    Mat rowsbuf1(w * srcc + 1, (size_t)2u);
+    Mat rowbuf(w * srcc, (size_t)1u);
+    Mat linebuf(w * outc);
+    if (rowsbuf0.empty() || rowsbuf1.empty() || rowbuf.empty() || linebuf.empty())
+        return -100;
+
+    // converted yuv420 source rows
+    Mat srcrowbuf0;
+    Mat srcrowbuf1;
+    if (u)
+    {
+        srcrowbuf0.create(srcw * srcc, (size_t)1u);
+        srcrowbuf1.create(srcw * srcc, (size_t)1u);
+        if (srcrowbuf0.empty() || srcrowbuf1.empty())
+            return -100;
+    }
+
+    short* rows0 = (short*)rowsbuf0.data;
+    short* rows1 = (short*)rowsbuf1.data;
+    unsigned char* row = (unsigned char*)rowbuf.data;
+    float* line = linebuf;
+
+    // the second tap of a single pixel wide or high image is itself
+    const int xstep1 = srcw == 1 ? 0 : srcc;
+    const int ystep1 = srch == 1 ? 0 : 1;
+
+    int prev_sy1 = -2;
+
+    for (int y = y0; y < y1; y++)
+    {
+        // left and right border of this row while it is hot
+        fill_pad(dsty + y, 0, dstx, m);
+        fill_pad(dsty + y, dstx + w, m.w - dstx - w, m);
+
+        if (!resize)
+        {
+            convert_row(source_row(y, srcrowbuf0), line);
+            store_row(line, y, m);
+            continue;
+        }
+
+        const int sy = yofs[y];
+
+        if (sy == prev_sy1)
+        {
+            // reuse all rows
+        }
+        else if (sy == prev_sy1 + 1)
+        {
+            // hresize one row
+            short* rows0_old = rows0;
+            rows0 = rows1;
+            rows1 = rows0_old;
+            const unsigned char* S1 = source_row(sy + ystep1, srcrowbuf1);
+
+            for (int dx = 0; dx < w; dx++)
+            {
+                const unsigned char* S1p = S1 + xofs[dx];
+                const short a0 = ialpha[dx * 2];
+                const short a1 = ialpha[dx * 2 + 1];
+
+                for (int k = 0; k < srcc; k++)
+                {
+                    rows1[dx * srcc + k] = (S1p[k] * a0 + S1p[k + xstep1] * a1) >> 4;
+                }
+            }
+        }
+        else
+        {
+            // hresize two rows
+            const unsigned char* S0 = source_row(sy, srcrowbuf0);
+            const unsigned char* S1 = source_row(sy + ystep1, srcrowbuf1);
+
+            for (int dx = 0; dx < w; dx++)
+            {
+                const unsigned char* S0p = S0 + xofs[dx];
+                const unsigned char* S1p = S1 + xofs[dx];
+                const short a0 = ialpha[dx * 2];
+                const short a1 = ialpha[dx * 2 + 1];
+
+                for (int k = 0; k < srcc; k++)
+                {
+                    rows0[dx * srcc + k] = (S0p[k] * a0 + S0p[k + xstep1] * a1) >> 4;
+                    rows1[dx * srcc + k] = (S1p[k] * a0 + S1p[k + xstep1] * a1) >> 4;
+                }
+            }
+        }
+
+        prev_sy1 = sy;
+
+        // vresize to the same u8 pixels as resize_bilinear
+        vresize_one(rows0, rows1, w * srcc, row, ibeta[y * 2], ibeta[y * 2 + 1]);
+
+        convert_row(row, line);
+        store_row(line, y, m);
+    }
+
+    return 0;
+}
+
+// shared by from_pixels_preprocess and from_yuv420*, the caller fills in the source of kernel
+static Mat pixel_preprocess(PixelPreprocessKernel& kernel, int type, int w, int h, const PixelPreprocessOption& opt, Allocator* allocator)
+{
+    const int type_from = type & Mat::PIXEL_FORMAT_MASK;
+    const int type_to = (type & Mat::PIXEL_CONVERT_MASK) ? (type >> Mat::PIXEL_CONVERT_SHIFT) : type_from;
+
+    const int srcc = get_pixel_channels(type_from);
+    const int outc = get_pixel_channels(type_to);
+    if (srcc == 0 || outc == 0)
+    {
+        NCNN_LOGE("unknown convert type %d", type);
+        return Mat();
+    }
+
+    const int roiw = opt.roiw ? opt.roiw : w;
+    const int roih = opt.roih ? opt.roih : h;
+    if (opt.roix < 0 || opt.roiy < 0 || roiw <= 0 || roih <= 0 || opt.roix + roiw > w || opt.roiy + roih > h)
+    {
+        NCNN_LOGE("roi %d %d %d %d out of image %d %d", opt.roix, opt.roiy, roiw, roih, w, h);
+        return Mat();
+    }
+
+    const int elempack = opt.elempack;
+    if (elempack <= 0 || outc % elempack != 0)
+    {
+        NCNN_LOGE("elempack %d does not divide %d channels", elempack, outc);
+        return Mat();
+    }
+
+    if (opt.elemtype < 0 || opt.elemtype > 3)
+    {
+        NCNN_LOGE("unsupported elemtype %d", opt.elemtype);
+        return Mat();
+    }
+
+    const int target_width = opt.target_width ? opt.target_width : roiw;
+    const int target_height = opt.target_height ? opt.target_height : roih;
+
+    if (opt.pad_top < 0 || opt.pad_bottom < 0 || opt.pad_left < 0 || opt.pad_right < 0)
+    {
+        NCNN_LOGE("negative pad %d %d %d %d", opt.pad_top, opt.pad_bottom, opt.pad_left, opt.pad_right);
+        return Mat();
+    }
+
+    kernel.roix = opt.roix;
+    kernel.roiy = opt.roiy;
+    kernel.srcw = roiw;
+    kernel.srch = roih;
+    kernel.srcc = srcc;
+    kernel.w = target_width;
+    kernel.outc = outc;
+    kernel.elempack = elempack;
+    kernel.elemtype = opt.elemtype;
+    kernel.int8_scale = opt.int8_scale;
+
+    // map output channels to source channels
+    {
+        int rgba_index_from[4];
+        get_pixel_rgba_index(type_from, rgba_index_from);
+
+        int rgba_index_to[4];
+        get_pixel_rgba_index(type_to, rgba_index_to);
+
+        kernel.rgb_index[0] = rgba_index_from[0];
+        kernel.rgb_index[1] = rgba_index_from[1];
+        kernel.rgb_index[2] = rgba_index_from[2];
+
+        if (type_to == Mat::PIXEL_GRAY)
+        {
+            kernel.channel_map[0] = type_from == Mat::PIXEL_GRAY ? 0 : -1;
+        }
+        else
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const int k = rgba_index_to[i];
+                if (k == -1)
+                    continue;
+
+                if (type_from == Mat::PIXEL_GRAY)
+                    kernel.channel_map[k] = i == 3 ? -2 : 0;
+                else
+                    kernel.channel_map[k] = rgba_index_from[i] == -1 ? -2 : rgba_index_from[i];
+            }
+        }
+    }
+
+    // same arithmetic as substract_mean_normalize
+    for (int k = 0; k < outc; k++)
+    {
+        const float mean = opt.mean_vals ? opt.mean_vals[k] : 0.f;
+        const float norm = opt.norm_vals ? opt.norm_vals[k] : 1.f;
+        kernel.scale[k] = norm;
+        kernel.bias[k] = opt.norm_vals ? -mean * norm : -mean;
+        kernel.pad_value[k] = opt.pad_value * kernel.scale[k] + kernel.bias[k];
+    }
+
+    kernel.dstx = opt.pad_left;
+    kernel.dsty = opt.pad_top;
+
+    kernel.resize = target_width != roiw || target_height != roih;
+
+    std::vector<int> xofs;
+    std::vector<short> ialpha;
+    std::vector<int> yofs;
+    std::vector<short> ibeta;
+    if (kernel.resize)
+    {
+        const int INTER_RESIZE_COEF_BITS = 11;
+        const int INTER_RESIZE_COEF_SCALE = 1 << INTER_RESIZE_COEF_BITS;
+
+        double scale_x = (double)roiw / target_width;
+        double scale_y = (double)roih / target_height;
+
+        xofs.resize(target_width);
+        ialpha.resize(target_width * 2);
+        yofs.resize(target_height);
+        ibeta.resize(target_height * 2);
+
+#define SATURATE_CAST_SHORT(X) (short)::std::min(::std::max((int)(X + (X >= 0.f ? 0.5f : -0.5f)), SHRT_MIN), SHRT_MAX);
+
+        for (int dx = 0; dx < target_width; dx++)
+        {
+            float fx = (float)((dx + 0.5) * scale_x - 0.5);
+            int sx = static_cast<int>(floor(fx));
+            fx -= sx;
+
+            if (sx < 0)
+            {
+                sx = 0;
+                fx = 0.f;
+            }
+            if (sx >= roiw - 1)
+            {
+                sx = std::max(roiw - 2, 0);
+                fx = roiw == 1 ? 0.f : 1.f;
+            }
+
+            xofs[dx] = sx * srcc;
+
+            float a0 = (1.f - fx) * INTER_RESIZE_COEF_SCALE;
+            float a1 = fx * INTER_RESIZE_COEF_SCALE;
+
+            ialpha[dx * 2] = SATURATE_CAST_SHORT(a0);
+            ialpha[dx * 2 + 1] = SATURATE_CAST_SHORT(a1);
+        }
+
+        for (int dy = 0; dy < target_height; dy++)
+        {
+            float fy = (float)((dy + 0.5) * scale_y - 0.5);
+            int sy = static_cast<int>(floor(fy));
+            fy -= sy;
+
+            if (sy < 0)
+            {
+                sy = 0;
+                fy = 0.f;
+            }
+            if (sy >= roih - 1)
+            {
+                sy = std::max(roih - 2, 0);
+                fy = roih == 1 ? 0.f : 1.f;
+            }
+
+            yofs[dy] = sy;
+
+            float b0 = (1.f - fy) * INTER_RESIZE_COEF_SCALE;
+            float b1 = fy * INTER_RESIZE_COEF_SCALE;
+
+            ibeta[dy * 2] = SATURATE_CAST_SHORT(b0);
+            ibeta[dy * 2 + 1] = SATURATE_CAST_SHORT(b1);
+        }
+
+#undef SATURATE_CAST_SHORT
+
+        kernel.xofs = &xofs[0];
+        kernel.ialpha = &ialpha[0];
+        kernel.yofs = &yofs[0];
+        kernel.ibeta = &ibeta[0];
+    }
+
+    size_t elemsize = elempack * 4u;
+    if (opt.elemtype == 1 || opt.elemtype == 2)
+        elemsize = elempack * 2u;
+    if (opt.elemtype == 3)
+        elemsize = elempack * 1u;
+
+    const int outw = opt.pad_left + target_width + opt.pad_right;
+    const int outh = opt.pad_top + target_height + opt.pad_bottom;
+
+    Mat m;
+    m.create(outw, outh, outc / elempack, elemsize, elempack, allocator);
+    if (m.empty())
+        return m;
+
+    // top and bottom border rows, the bands below fill the left and right border
+    const int pad_rows = opt.pad_top + opt.pad_bottom;
+    if (pad_rows > 0)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i = 0; i < pad_rows; i++)
+        {
+            const int y = i < opt.pad_top ? i : target_height + i;
+            kernel.fill_pad(y, 0, outw, m);
+        }
+    }
+
+    // split rows into contiguous bands so that each band reuses its hresize rows
+    const int nbands = std::max(std::min(opt.num_threads, target_height), 1);
+
+    std::vector<int> rets(nbands);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int b = 0; b < nbands; b++)
+    {
+        const int y0 = target_height * b / nbands;
+        const int y1 = target_height * (b + 1) / nbands;
+
+        rets[b] = kernel.forward(y0, y1, m);
+    }
+
+    for (int b = 0; b < nbands; b++)
+    {
+        if (rets[b] != 0)
+        {
+            NCNN_LOGE("pixel preprocess out of memory");
+            return Mat();
+        }
+    }
+
+    return m;
+}
+
+Mat Mat::from_pixels_preprocess(const unsigned char* pixels, int type, int w, int h, int stride, const PixelPreprocessOption& opt, Allocator* allocator)
+{
+    PixelPreprocessKernel kernel;
+    kernel.src = pixels;
+    kernel.srcstride = stride;
+
+    return pixel_preprocess(kernel, type, w, h, opt, allocator);
+}
+
+// yuv420 frames are converted as rgba, type is the output rgb bgr gray rgba or bgra
+static Mat yuv420_preprocess(const unsigned char* y, const unsigned char* u, const unsigned char* v, int uvstride, int uvstep, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator)
+{
+    if (type != Mat::PIXEL_RGB && type != Mat::PIXEL_BGR && type != Mat::PIXEL_GRAY && type != Mat::PIXEL_RGBA && type != Mat::PIXEL_BGRA)
+    {
+        NCNN_LOGE("unsupported yuv420 output type %d", type);
+        return Mat();
+    }
+
+    if (w % 2 != 0 || h % 2 != 0)
+    {
+        NCNN_LOGE("yuv420 size %d %d must be even", w, h);
+        return Mat();
+    }
+
+    PixelPreprocessKernel kernel;
+    kernel.src = y;
+    kernel.srcstride = w;
+    kernel.u = u;
+    kernel.v = v;
+    kernel.uvstride = uvstride;
+    kernel.uvstep = uvstep;
+
+    const int type_rgba = type == Mat::PIXEL_RGBA ? Mat::PIXEL_RGBA : Mat::PIXEL_RGBA | (type << Mat::PIXEL_CONVERT_SHIFT);
+
+    return pixel_preprocess(kernel, type_rgba, w, h, opt, allocator);
+}
+
+Mat Mat::from_yuv420sp(const unsigned char* yuv420sp, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator)
+{
+    // interleaved vu after the luma plane
+    const unsigned char* vu = yuv420sp + w * h;
+
+    return yuv420_preprocess(yuv420sp, vu + 1, vu, w, 2, w, h, type, opt, allocator);
+}
+
+Mat Mat::from_yuv420sp_nv12(const unsigned char* yuv420sp, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator)
+{
+    // interleaved uv after the luma plane
+    const unsigned char* uv = yuv420sp + w * h;
+
+    return yuv420_preprocess(yuv420sp, uv, uv + 1, w, 2, w, h, type, opt, allocator);
+}
+
+Mat Mat::from_yuv420p(const unsigned char* yuv420p, int w, int h, int type, const PixelPreprocessOption& opt, Allocator* allocator)
+{
+    // u plane then v plane after the luma plane
+    const unsigned char* u = yuv420p + w * h;
+    const unsigned char* v = u + (w / 2) * (h / 2);
+
+    return yuv420_preprocess(yuv420p, u, v, w / 2, 1, w, h, type, opt, allocator);
+}
 #endif // NCNN_PIXEL
 
 } // namespace ncnn
@@ -7,9 +7,144 @@
 #endif // __ARM_NEON
 #include "platform.h"
 
+#include <algorithm>
+
 namespace ncnn {
 
 #if NCNN_PIXEL_ROTATE
+
+#if __SSE2__
+// transpose one 8x8 block, dst row j receives column j of the 8 src rows
+static NCNN_FORCEINLINE void kanna_rotate_tile_8x8_c1(const unsigned char* src, int src_step, unsigned char* dst, int dst_step)
+{
+    __m128i _r0 = _mm_loadl_epi64((const __m128i*)src);
+    __m128i _r1 = _mm_loadl_epi64((const __m128i*)(src + src_step));
+    __m128i _r2 = _mm_loadl_epi64((const __m128i*)(src + src_step * 2));
+    __m128i _r3 = _mm_loadl_epi64((const __m128i*)(src + src_step * 3));
+    __m128i _r4 = _mm_loadl_epi64((const __m128i*)(src + src_step * 4));
+    __m128i _r5 = _mm_loadl_epi64((const __m128i*)(src + src_step * 5));
+    __m128i _r6 = _mm_loadl_epi64((const __m128i*)(src + src_step * 6));
+    __m128i _r7 = _mm_loadl_epi64((const __m128i*)(src + src_step * 7));
+
+    __m128i _r01 = _mm_unpacklo_epi8(_r0, _r1);
+    __m128i _r23 = _mm_unpacklo_epi8(_r2, _r3);
+    __m128i _r45 = _mm_unpacklo_epi8(_r4, _r5);
+    __m128i _r67 = _mm_unpacklo_epi8(_r6, _r7);
+
+    __m128i _r0123l = _mm_unpacklo_epi16(_r01, _r23);
+    __m128i _r0123h = _mm_unpackhi_epi16(_r01, _r23);
+    __m128i _r4567l = _mm_unpacklo_epi16(_r45, _r67);
+    __m128i _r4567h = _mm_unpackhi_epi16(_r45, _r67);
+
+    __m128i _c01 = _mm_unpacklo_epi32(_r0123l, _r4567l);
+    __m128i _c23 = _mm_unpackhi_epi32(_r0123l, _r4567l);
+    __m128i _c45 = _mm_unpacklo_epi32(_r0123h, _r4567h);
+    __m128i _c67 = _mm_unpackhi_epi32(_r0123h, _r4567h);
+
+    _mm_storel_epi64((__m128i*)dst, _c01);
+    _mm_storel_epi64((__m128i*)(dst + dst_step), _mm_unpackhi_epi64(_c01, _c01));
+    _mm_storel_epi64((__m128i*)(dst + dst_step * 2), _c23);
+    _mm_storel_epi64((__m128i*)(dst + dst_step * 3), _mm_unpackhi_epi64(_c23, _c23));
+    _mm_storel_epi64((__m128i*)(dst + dst_step * 4), _c45);
+    _mm_storel_epi64((__m128i*)(dst + dst_step * 5), _mm_unpackhi_epi64(_c45, _c45));
+    _mm_storel_epi64((__m128i*)(dst + dst_step * 6), _c67);
+    _mm_storel_epi64((__m128i*)(dst + dst_step * 7), _mm_unpackhi_epi64(_c67, _c67));
+}
+
+static NCNN_FORCEINLINE void kanna_rotate_tile_8x8_c2(const unsigned char* src, int src_step, unsigned char* dst, int dst_step)
+{
+    __m128i _r0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i _r1 = _mm_loadu_si128((const __m128i*)(src + src_step));
+    __m128i _r2 = _mm_loadu_si128((const __m128i*)(src + src_step * 2));
+    __m128i _r3 = _mm_loadu_si128((const __m128i*)(src + src_step * 3));
+    __m128i _r4 = _mm_loadu_si128((const __m128i*)(src + src_step * 4));
+    __m128i _r5 = _mm_loadu_si128((const __m128i*)(src + src_step * 5));
+    __m128i _r6 = _mm_loadu_si128((const __m128i*)(src + src_step * 6));
+    __m128i _r7 = _mm_loadu_si128((const __m128i*)(src + src_step * 7));
+
+    __m128i _r01l = _mm_unpacklo_epi16(_r0, _r1);
+    __m128i _r01h = _mm_unpackhi_epi16(_r0, _r1);
+    __m128i _r23l = _mm_unpacklo_epi16(_r2, _r3);
+    __m128i _r23h = _mm_unpackhi_epi16(_r2, _r3);
+    __m128i _r45l = _mm_unpacklo_epi16(_r4, _r5);
+    __m128i _r45h = _mm_unpackhi_epi16(_r4, _r5);
+    __m128i _r67l = _mm_unpacklo_epi16(_r6, _r7);
+    __m128i _r67h = _mm_unpackhi_epi16(_r6, _r7);
+
+    __m128i _t0 = _mm_unpacklo_epi32(_r01l, _r23l);
+    __m128i _t1 = _mm_unpackhi_epi32(_r01l, _r23l);
+    __m128i _t2 = _mm_unpacklo_epi32(_r01h, _r23h);
+    __m128i _t3 = _mm_unpackhi_epi32(_r01h, _r23h);
+    __m128i _u0 = _mm_unpacklo_epi32(_r45l, _r67l);
+    __m128i _u1 = _mm_unpackhi_epi32(_r45l, _r67l);
+    __m128i _u2 = _mm_unpacklo_epi32(_r45h, _r67h);
+    __m128i _u3 = _mm_unpackhi_epi32(_r45h, _r67h);
+
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi64(_t0, _u0));
+    _mm_storeu_si128((__m128i*)(dst + dst_step), _mm_unpackhi_epi64(_t0, _u0));
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 2), _mm_unpacklo_epi64(_t1, _u1));
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 3), _mm_unpackhi_epi64(_t1, _u1));
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 4), _mm_unpacklo_epi64(_t2, _u2));
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 5), _mm_unpackhi_epi64(_t2, _u2));
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 6), _mm_unpacklo_epi64(_t3, _u3));
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 7), _mm_unpackhi_epi64(_t3, _u3));
+}
+
+static NCNN_FORCEINLINE void transpose4x4_epi32(__m128i& _r0, __m128i& _r1, __m128i& _r2, __m128i& _r3)
+{
+    __m128i _t0 = _mm_unpacklo_epi32(_r0, _r1);
+    __m128i _t1 = _mm_unpacklo_epi32(_r2, _r3);
+    __m128i _t2 = _mm_unpackhi_epi32(_r0, _r1);
+    __m128i _t3 = _mm_unpackhi_epi32(_r2, _r3);
+    _r0 = _mm_unpacklo_epi64(_t0, _t1);
+    _r1 = _mm_unpackhi_epi64(_t0, _t1);
+    _r2 = _mm_unpacklo_epi64(_t2, _t3);
+    _r3 = _mm_unpackhi_epi64(_t2, _t3);
+}
+
+static NCNN_FORCEINLINE void kanna_rotate_tile_8x8_c4(const unsigned char* src, int src_step, unsigned char* dst, int dst_step)
+{
+    // four 4x4 blocks, a for columns 0-3 and b for columns 4-7
+    __m128i _a0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i _b0 = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i _a1 = _mm_loadu_si128((const __m128i*)(src + src_step));
+    __m128i _b1 = _mm_loadu_si128((const __m128i*)(src + src_step + 16));
+    __m128i _a2 = _mm_loadu_si128((const __m128i*)(src + src_step * 2));
+    __m128i _b2 = _mm_loadu_si128((const __m128i*)(src + src_step * 2 + 16));
+    __m128i _a3 = _mm_loadu_si128((const __m128i*)(src + src_step * 3));
+    __m128i _b3 = _mm_loadu_si128((const __m128i*)(src + src_step * 3 + 16));
+    __m128i _a4 = _mm_loadu_si128((const __m128i*)(src + src_step * 4));
+    __m128i _b4 = _mm_loadu_si128((const __m128i*)(src + src_step * 4 + 16));
+    __m128i _a5 = _mm_loadu_si128((const __m128i*)(src + src_step * 5));
+    __m128i _b5 = _mm_loadu_si128((const __m128i*)(src + src_step * 5 + 16));
+    __m128i _a6 = _mm_loadu_si128((const __m128i*)(src + src_step * 6));
+    __m128i _b6 = _mm_loadu_si128((const __m128i*)(src + src_step * 6 + 16));
+    __m128i _a7 = _mm_loadu_si128((const __m128i*)(src + src_step * 7));
+    __m128i _b7 = _mm_loadu_si128((const __m128i*)(src + src_step * 7 + 16));
+
+    transpose4x4_epi32(_a0, _a1, _a2, _a3);
+    transpose4x4_epi32(_a4, _a5, _a6, _a7);
+    transpose4x4_epi32(_b0, _b1, _b2, _b3);
+    transpose4x4_epi32(_b4, _b5, _b6, _b7);
+
+    _mm_storeu_si128((__m128i*)dst, _a0);
+    _mm_storeu_si128((__m128i*)(dst + 16), _a4);
+    _mm_storeu_si128((__m128i*)(dst + dst_step), _a1);
+    _mm_storeu_si128((__m128i*)(dst + dst_step + 16), _a5);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 2), _a2);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 2 + 16), _a6);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 3), _a3);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 3 + 16), _a7);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 4), _b0);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 4 + 16), _b4);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 5), _b1);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 5 + 16), _b5);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 6), _b2);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 6 + 16), _b6);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 7), _b3);
+    _mm_storeu_si128((__m128i*)(dst + dst_step * 7 + 16), _b7);
+}
+#endif // __SSE2__
 // should be a kanna ascii art here in my local branch
 // but we shall ask the original art author for permission first ...
 // https://www.reddit.com/r/anime/comments/5uxjn4/i_recreated_the_kanna_ascii_art_from_kobayashisan/
@@ -1892,6 +2027,29 @@ static void kanna_rotate_5_c1(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        const unsigned char* src_tile = src0;
+        const int src_step = srcstride;
+        unsigned char* dst_tile = dst + y;
+        const int dst_step = stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c1(src_tile + x, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i] = src_tile[i * src_step + x];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -2133,6 +2291,30 @@ static void kanna_rotate_5_c2(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        const unsigned char* src_tile = src0;
+        const int src_step = srcstride;
+        unsigned char* dst_tile = dst + y * 2;
+        const int dst_step = stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c2(src_tile + x * 2, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 2 + 0] = src_tile[i * src_step + x * 2 + 0];
+                dst_tile[x * dst_step + i * 2 + 1] = src_tile[i * src_step + x * 2 + 1];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -2738,6 +2920,32 @@ static void kanna_rotate_5_c4(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        const unsigned char* src_tile = src0;
+        const int src_step = srcstride;
+        unsigned char* dst_tile = dst + y * 4;
+        const int dst_step = stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c4(src_tile + x * 4, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 4 + 0] = src_tile[i * src_step + x * 4 + 0];
+                dst_tile[x * dst_step + i * 4 + 1] = src_tile[i * src_step + x * 4 + 1];
+                dst_tile[x * dst_step + i * 4 + 2] = src_tile[i * src_step + x * 4 + 2];
+                dst_tile[x * dst_step + i * 4 + 3] = src_tile[i * src_step + x * 4 + 3];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -2936,6 +3144,30 @@ static void kanna_rotate_6_c1(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        // the 8 src rows in reverse order
+        const unsigned char* src_tile = src0 + 7 * srcstride;
+        const int src_step = -srcstride;
+        unsigned char* dst_tile = dstend - (y + 8);
+        const int dst_step = stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c1(src_tile + x, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i] = src_tile[i * src_step + x];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -3180,6 +3412,31 @@ static void kanna_rotate_6_c2(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        // the 8 src rows in reverse order
+        const unsigned char* src_tile = src0 + 7 * srcstride;
+        const int src_step = -srcstride;
+        unsigned char* dst_tile = dstend - (y + 8) * 2;
+        const int dst_step = stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c2(src_tile + x * 2, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 2 + 0] = src_tile[i * src_step + x * 2 + 0];
+                dst_tile[x * dst_step + i * 2 + 1] = src_tile[i * src_step + x * 2 + 1];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -3791,6 +4048,33 @@ static void kanna_rotate_6_c4(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        // the 8 src rows in reverse order
+        const unsigned char* src_tile = src0 + 7 * srcstride;
+        const int src_step = -srcstride;
+        unsigned char* dst_tile = dstend - (y + 8) * 4;
+        const int dst_step = stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c4(src_tile + x * 4, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 4 + 0] = src_tile[i * src_step + x * 4 + 0];
+                dst_tile[x * dst_step + i * 4 + 1] = src_tile[i * src_step + x * 4 + 1];
+                dst_tile[x * dst_step + i * 4 + 2] = src_tile[i * src_step + x * 4 + 2];
+                dst_tile[x * dst_step + i * 4 + 3] = src_tile[i * src_step + x * 4 + 3];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -3989,6 +4273,30 @@ static void kanna_rotate_7_c1(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        // the 8 src rows in reverse order
+        const unsigned char* src_tile = src0 + 7 * srcstride;
+        const int src_step = -srcstride;
+        unsigned char* dst_tile = dstend - (y + 8);
+        const int dst_step = -stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c1(src_tile + x, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i] = src_tile[i * src_step + x];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -4233,6 +4541,31 @@ static void kanna_rotate_7_c2(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        // the 8 src rows in reverse order
+        const unsigned char* src_tile = src0 + 7 * srcstride;
+        const int src_step = -srcstride;
+        unsigned char* dst_tile = dstend - (y + 8) * 2;
+        const int dst_step = -stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c2(src_tile + x * 2, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 2 + 0] = src_tile[i * src_step + x * 2 + 0];
+                dst_tile[x * dst_step + i * 2 + 1] = src_tile[i * src_step + x * 2 + 1];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -4844,6 +5177,33 @@ static void kanna_rotate_7_c4(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        // the 8 src rows in reverse order
+        const unsigned char* src_tile = src0 + 7 * srcstride;
+        const int src_step = -srcstride;
+        unsigned char* dst_tile = dstend - (y + 8) * 4;
+        const int dst_step = -stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c4(src_tile + x * 4, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 4 + 0] = src_tile[i * src_step + x * 4 + 0];
+                dst_tile[x * dst_step + i * 4 + 1] = src_tile[i * src_step + x * 4 + 1];
+                dst_tile[x * dst_step + i * 4 + 2] = src_tile[i * src_step + x * 4 + 2];
+                dst_tile[x * dst_step + i * 4 + 3] = src_tile[i * src_step + x * 4 + 3];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -5042,6 +5402,29 @@ static void kanna_rotate_8_c1(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        const unsigned char* src_tile = src0;
+        const int src_step = srcstride;
+        unsigned char* dst_tile = dstend + y;
+        const int dst_step = -stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c1(src_tile + x, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i] = src_tile[i * src_step + x];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -5286,6 +5669,30 @@ static void kanna_rotate_8_c2(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        const unsigned char* src_tile = src0;
+        const int src_step = srcstride;
+        unsigned char* dst_tile = dstend + y * 2;
+        const int dst_step = -stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c2(src_tile + x * 2, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 2 + 0] = src_tile[i * src_step + x * 2 + 0];
+                dst_tile[x * dst_step + i * 2 + 1] = src_tile[i * src_step + x * 2 + 1];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -5897,6 +6304,32 @@ static void kanna_rotate_8_c4(const unsigned char* src, int srcw, int srch, int
 
         src0 += srcwgap + 7 * srcstride;
     }
+#elif __SSE2__
+    for (; y + 7 < srch; y += 8)
+    {
+        const unsigned char* src_tile = src0;
+        const int src_step = srcstride;
+        unsigned char* dst_tile = dstend + y * 4;
+        const int dst_step = -stride;
+
+        int x = 0;
+        for (; x + 7 < srcw; x += 8)
+        {
+            kanna_rotate_tile_8x8_c4(src_tile + x * 4, src_step, dst_tile + x * dst_step, dst_step);
+        }
+        for (; x < srcw; x++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dst_tile[x * dst_step + i * 4 + 0] = src_tile[i * src_step + x * 4 + 0];
+                dst_tile[x * dst_step + i * 4 + 1] = src_tile[i * src_step + x * 4 + 1];
+                dst_tile[x * dst_step + i * 4 + 2] = src_tile[i * src_step + x * 4 + 2];
+                dst_tile[x * dst_step + i * 4 + 3] = src_tile[i * src_step + x * 4 + 3];
+            }
+        }
+
+        src0 += 8 * srcstride;
+    }
 #endif // __ARM_NEON
     for (; y < srch; y++)
     {
@@ -6101,6 +6534,84 @@ void kanna_rotate_yuv420sp(const unsigned char* src, int srcw, int srch, unsigne
     unsigned char* dstUV = dst + w * h;
     kanna_rotate_c2(srcUV, srcw / 2, srch / 2, dstUV, w / 2, h / 2, type);
 }
+
+typedef void (*kanna_rotate_func)(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type);
+
+static void kanna_rotate_threaded(kanna_rotate_func rotate, int elemsize, const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt)
+{
+    const int num_threads = std::min(opt.num_threads, h);
+    if (num_threads <= 1 || type < 1 || type > 8)
+    {
+        rotate(src, srcw, srch, srcstride, dst, w, h, stride, type);
+        return;
+    }
+
+    // split the dst rows into bands, each band rotates its own src sub-rectangle
+    #pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < num_threads; i++)
+    {
+        const int y0 = h * i / num_threads;
+        const int rows = h * (i + 1) / num_threads - y0;
+
+        unsigned char* band_dst = dst + (size_t)y0 * stride;
+
+        switch (type)
+        {
+        case 1:
+        case 2:
+            rotate(src + (size_t)y0 * srcstride, srcw, rows, srcstride, band_dst, w, rows, stride, type);
+            break;
+        case 3:
+        case 4:
+            rotate(src + (size_t)(h - y0 - rows) * srcstride, srcw, rows, srcstride, band_dst, w, rows, stride, type);
+            break;
+        case 5:
+        case 6:
+            rotate(src + y0 * elemsize, rows, srch, srcstride, band_dst, w, rows, stride, type);
+            break;
+        case 7:
+        case 8:
+            rotate(src + (h - y0 - rows) * elemsize, rows, srch, srcstride, band_dst, w, rows, stride, type);
+            break;
+        }
+    }
+}
+
+void kanna_rotate_c1(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt)
+{
+    kanna_rotate_threaded(kanna_rotate_c1, 1, src, srcw, srch, srcstride, dst, w, h, stride, type, opt);
+}
+
+void kanna_rotate_c2(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt)
+{
+    kanna_rotate_threaded(kanna_rotate_c2, 2, src, srcw, srch, srcstride, dst, w, h, stride, type, opt);
+}
+
+void kanna_rotate_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt)
+{
+    kanna_rotate_threaded(kanna_rotate_c3, 3, src, srcw, srch, srcstride, dst, w, h, stride, type, opt);
+}
+
+void kanna_rotate_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride, int type, const Option& opt)
+{
+    kanna_rotate_threaded(kanna_rotate_c4, 4, src, srcw, srch, srcstride, dst, w, h, stride, type, opt);
+}
+
+void kanna_rotate_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h, int type, const Option& opt)
+{
+    // assert srcw % 2 == 0
+    // assert srch % 2 == 0
+    // assert w % 2 == 0
+    // assert h % 2 == 0
+
+    const unsigned char* srcY = src;
+    unsigned char* dstY = dst;
+    kanna_rotate_c1(srcY, srcw, srch, srcw, dstY, w, h, w, type, opt);
+
+    const unsigned char* srcUV = src + srcw * srch;
+    unsigned char* dstUV = dst + w * h;
+    kanna_rotate_c2(srcUV, srcw / 2, srch / 2, srcw, dstUV, w / 2, h / 2, w, type, opt);
+}
 #endif // NCNN_PIXEL_ROTATE
 
 } // namespace ncnn
@@ -8,14 +8,16 @@
 #include "layer_type.h"
 #include "modelbin.h"
 #include "paramdict.h"
+#include "profiler.h"
+#include "threadpool.h"
+
+#include <list>
 
 #include <stdarg.h>
 #include <stdint.h>
 #include <string.h>
 
-#if NCNN_BENCHMARK
 #include "benchmark.h"
-#endif // NCNN_BENCHMARK
 
 #if NCNN_VULKAN
 #include "command.h"
@@ -24,6 +26,143 @@
 
 namespace ncnn {
 
+// count the bytes requested through an allocator during profiling
+// falls back to fastMalloc/fastFree when there is no underlying allocator
+class ProfileAllocator : public Allocator
+{
+public:
+    ProfileAllocator(Allocator* _allocator)
+        : allocator(_allocator), allocated_bytes(0)
+    {
+    }
+
+    virtual void* fastMalloc(size_t size)
+    {
+        {
+            MutexLockGuard g(lock);
+            allocated_bytes += size;
+        }
+        return allocator ? allocator->fastMalloc(size) : ncnn::fastMalloc(size);
+    }
+
+    virtual void fastFree(void* ptr)
+    {
+        if (allocator)
+            allocator->fastFree(ptr);
+        else
+            ncnn::fastFree(ptr);
+    }
+
+    size_t get_allocated_bytes()
+    {
+        MutexLockGuard g(lock);
+        return allocated_bytes;
+    }
+
+    Allocator* const allocator;
+
+private:
+    Mutex lock;
+    size_t allocated_bytes;
+};
+
+// profiling state shared by extractor copies
+// wrappers live as long as any blob mat may still reference them
+class ExtractorProfileState
+{
+public:
+    ExtractorProfileState()
+        : refcount(1)
+    {
+    }
+
+    ~ExtractorProfileState()
+    {
+        for (size_t i = 0; i < allocators.size(); i++)
+        {
+            delete allocators[i];
+        }
+    }
+
+    ProfileAllocator* get_allocator(Allocator* allocator)
+    {
+        for (size_t i = 0; i < allocators.size(); i++)
+        {
+            if (allocators[i]->allocator == allocator)
+                return allocators[i];
+        }
+
+        ProfileAllocator* profile_allocator = new ProfileAllocator(allocator);
+        allocators.push_back(profile_allocator);
+        return profile_allocator;
+    }
+
+    bool owns(const Allocator* allocator) const
+    {
+        for (size_t i = 0; i < allocators.size(); i++)
+        {
+            if (allocators[i] == allocator)
+                return true;
+        }
+        return false;
+    }
+
+    int refcount;
+    std::vector<ProfileAllocator*> allocators;
+};
+
+class LayerProfileContext
+{
+public:
+    Profiler* profiler;
+    size_t extractor_id;
+    ProfileAllocator* blob_allocator;
+    ProfileAllocator* workspace_allocator;
+};
+
+static void get_shape(const Mat& m, Mat& shape)
+{
+    shape.dims = m.dims;
+    shape.w = m.w;
+    shape.h = m.h;
+    shape.d = m.d;
+    shape.c = m.c;
+    shape.elempack = m.elempack;
+    shape.elemsize = m.elemsize;
+    shape.cstep = m.cstep;
+}
+
+class AsyncRequestPrivate
+{
+public:
+    Mutex lock;
+    ConditionVariable condition;
+    bool ready;
+    int ret;
+    std::vector<Mat> outputs;
+    float deadline_ms;
+};
+
+// one submitted inference waiting for a worker
+struct AsyncJob
+{
+    std::vector<Mat> inputs;
+    AsyncRequest* request;
+    async_callback_func callback;
+    void* userdata;
+    // in get_current_time() milliseconds, deadline 0 for none
+    double submit_time;
+    double deadline;
+};
+
+struct LocalAllocatorSlot
+{
+    PoolAllocator* blob_allocator;
+    PoolAllocator* workspace_allocator;
+    // for single threaded extractors, no other thread touches their workspace
+    UnlockedPoolAllocator* unlocked_workspace_allocator;
+};
+
 class NetPrivate
 {
 public:
@@ -38,7 +177,7 @@ public:
 #endif // NCNN_VULKAN
 
     friend class Extractor;
-    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, const Option& opt) const;
+    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, const Option& opt, const LayerProfileContext* profile_context = 0) const;
 
 #if NCNN_VULKAN
     int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const;
@@ -69,8 +208,38 @@ public:
     std::vector<custom_layer_registry_entry> custom_layer_registry;
     std::vector<overwrite_builtin_layer_registry_entry> overwrite_builtin_layer_registry;
 
-    PoolAllocator* local_blob_allocator;
-    PoolAllocator* local_workspace_allocator;
+    // pools of the thread slots, created when a thread first runs an extractor
+    // a slot below the last one belongs to a single thread, the last one is shared by the rest
+    std::vector<LocalAllocatorSlot> local_allocators;
+    Mutex local_allocator_lock;
+
+    void get_local_allocators(int num_threads, Allocator** blob_allocator, Allocator** workspace_allocator);
+
+    // lane of opt.numa_node while loading weights
+    ThreadPool* numa_thread_pool;
+
+    int submit(Net* net, const std::vector<Mat>& inputs, AsyncRequest& request, async_callback_func callback, void* userdata);
+    void run_async_job(AsyncJob& job, Allocator* blob_allocator, Allocator* workspace_allocator);
+    int run_async_batch(std::vector<AsyncJob>& batch, Allocator* blob_allocator, Allocator* workspace_allocator);
+    void complete_async_job(AsyncJob& job, int ret, const std::vector<Mat>& outputs);
+    double async_batch_close_time() const;
+    void stop_async_workers();
+    static void* async_worker(void* args);
+
+    // submit() queue and the workers draining it
+    Net* async_net;
+    int async_worker_count;
+    std::vector<Thread*> async_workers;
+    std::list<AsyncJob> async_jobs;
+    Mutex async_lock;
+    ConditionVariable async_condition;
+    bool async_exit;
+
+    // micro batching
+    int async_batch_size;
+    double async_batch_window;
+    // moving average of batch run time in ms for closing the window before a deadline
+    double async_batch_time;
 
 #if NCNN_VULKAN
     const VulkanDevice* vkdev;
@@ -85,8 +254,15 @@ public:
 NetPrivate::NetPrivate(Option& _opt)
     : opt(_opt)
 {
-    local_blob_allocator = 0;
-    local_workspace_allocator = 0;
+    numa_thread_pool = 0;
+
+    async_net = 0;
+    async_worker_count = 1;
+    async_exit = false;
+
+    async_batch_size = 1;
+    async_batch_window = 0.0;
+    async_batch_time = 0.0;
 
 #if NCNN_VULKAN
     vkdev = 0;
@@ -157,7 +333,7 @@ int NetPrivate::upload_model()
 }
 #endif // NCNN_VULKAN
 
-int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, const Option& opt) const
+int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, const Option& opt, const LayerProfileContext* profile_context) const
 {
     const Layer* layer = layers[layer_index];
 
@@ -170,12 +346,32 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, cons
 
         if (blob_mats[bottom_blob_index].dims == 0)
         {
-            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt);
+            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt, profile_context);
             if (ret != 0)
                 return ret;
         }
     }
 
+    LayerProfile profile;
+    double profile_start = 0;
+    if (profile_context)
+    {
+        profile.extractor_id = profile_context->extractor_id;
+        profile.layer_index = layer_index;
+        profile.layer = layer;
+
+        profile.bottom_shapes.resize(layer->bottoms.size());
+        for (size_t i = 0; i < layer->bottoms.size(); i++)
+        {
+            get_shape(blob_mats[layer->bottoms[i]], profile.bottom_shapes[i]);
+        }
+
+        profile.blob_allocated_bytes = profile_context->blob_allocator->get_allocated_bytes();
+        profile.workspace_allocated_bytes = profile_context->workspace_allocator->get_allocated_bytes();
+
+        profile_start = get_current_time();
+    }
+
 #if NCNN_BENCHMARK
     double start = get_current_time();
     Mat bottom_blob;
@@ -212,6 +408,27 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, cons
         benchmark(layer, start, end);
     }
 #endif
+    if (profile_context)
+    {
+        double profile_end = get_current_time();
+
+        profile.start_ns = (uint64_t)(profile_start * 1000000);
+        profile.elapsed_ns = (uint64_t)((profile_end - profile_start) * 1000000);
+
+        profile.blob_allocated_bytes = profile_context->blob_allocator->get_allocated_bytes() - profile.blob_allocated_bytes;
+        profile.workspace_allocated_bytes = profile_context->workspace_allocator->get_allocated_bytes() - profile.workspace_allocated_bytes;
+
+        profile.top_shapes.resize(layer->tops.size());
+        for (size_t i = 0; i < layer->tops.size(); i++)
+        {
+            get_shape(blob_mats[layer->tops[i]], profile.top_shapes[i]);
+        }
+
+        profile.cost = estimate_layer_cost(layer, profile.bottom_shapes, profile.top_shapes);
+        profile.ret = ret;
+
+        profile_context->profiler->layer_forward(profile);
+    }
     if (ret != 0)
         return ret;
 
@@ -557,8 +774,8 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
 
         if (opt.lightmode)
         {
-            // deep copy for inplace forward if data is shared
-            if (layer->support_inplace && *bottom_blob_ref.refcount != 1)
+            // deep copy for inplace forward if data is shared or external
+            if (layer->support_inplace && (!bottom_blob_ref.refcount || *bottom_blob_ref.refcount != 1))
             {
                 bottom_blob = bottom_blob_ref.clone(opt.blob_allocator);
                 if (bottom_blob.empty())
@@ -614,8 +831,8 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
 
             if (opt.lightmode)
             {
-                // deep copy for inplace forward if data is shared
-                if (layer->support_inplace && *bottom_blob_ref.refcount != 1)
+                // deep copy for inplace forward if data is shared or external
+                if (layer->support_inplace && (!bottom_blob_ref.refcount || *bottom_blob_ref.refcount != 1))
                 {
                     bottom_blobs[i] = bottom_blob_ref.clone(opt.blob_allocator);
                     if (bottom_blobs[i].empty())
@@ -1530,6 +1747,25 @@ int Net::load_param_bin(const DataReader& dr)
     return 0;
 }
 
+struct NetLoadModelJob
+{
+    Net* net;
+    const DataReader* dr;
+};
+
+static int load_model_on_pool(void* args)
+{
+    NetLoadModelJob* job = (NetLoadModelJob*)args;
+    return job->net->load_model(*job->dr);
+}
+
+static int bind_numa_memory_policy(void* args)
+{
+    // failure only loses the placement hint, first touch on the node cpus still applies
+    set_numa_memory_policy(*(const int*)args);
+    return 0;
+}
+
 int Net::load_model(const DataReader& dr)
 {
     if (d->layers.empty())
@@ -1538,6 +1774,30 @@ int Net::load_model(const DataReader& dr)
         return -1;
     }
 
+    if (opt.numa_node >= 0 && !d->numa_thread_pool)
+    {
+        // weights and packed weights are allocated and touched by the node threads
+        // the lane only lives for the load, extractors opt in to the node with set_thread_pool
+        d->numa_thread_pool = new ThreadPool(get_numa_node_affinity_mask(opt.numa_node), opt.num_threads);
+        d->numa_thread_pool->run(bind_numa_memory_policy, &opt.numa_node);
+
+        NetLoadModelJob job;
+        job.net = this;
+        job.dr = &dr;
+        int ret = d->numa_thread_pool->run(load_model_on_pool, &job);
+
+        delete d->numa_thread_pool;
+        d->numa_thread_pool = 0;
+
+        return ret;
+    }
+
+    const bool numa_interleave = opt.use_numa_interleave && opt.numa_node < 0 && get_numa_node_count() > 1;
+    if (numa_interleave)
+    {
+        push_numa_memory_policy(-2);
+    }
+
     int layer_count = (int)d->layers.size();
 
     // load file
@@ -1595,24 +1855,17 @@ int Net::load_model(const DataReader& dr)
         }
     }
 
-    if (opt.use_local_pool_allocator)
+    if (numa_interleave)
     {
-        if (opt.blob_allocator == 0)
-        {
-            if (!d->local_blob_allocator)
-            {
-                d->local_blob_allocator = new PoolAllocator;
-                d->local_blob_allocator->set_size_compare_ratio(0.f);
-            }
-        }
-        if (opt.workspace_allocator == 0)
-        {
-            if (!d->local_workspace_allocator)
-            {
-                d->local_workspace_allocator = new PoolAllocator;
-                d->local_workspace_allocator->set_size_compare_ratio(0.f);
-            }
-        }
+        // back to the policy the application had
+        pop_numa_memory_policy();
+    }
+
+    if (opt.use_local_pool_allocator && d->local_allocators.empty())
+    {
+        // one slot per cpu plus the shared one, the pools are created on first use
+        const LocalAllocatorSlot empty_slot = {0, 0, 0};
+        d->local_allocators.resize(std::max(get_cpu_count(), 1) + 1, empty_slot);
     }
 
 #if NCNN_VULKAN
@@ -1780,6 +2033,9 @@ int Net::load_model(AAssetManager* mgr, const char* assetpath)
 
 void Net::clear()
 {
+    // queued inferences still need the layers
+    d->stop_async_workers();
+
     d->blobs.clear();
     for (size_t i = 0; i < d->layers.size(); i++)
     {
@@ -1832,15 +2088,18 @@ void Net::clear()
     }
     d->layers.clear();
 
-    if (d->local_blob_allocator)
+    for (size_t i = 0; i < d->local_allocators.size(); i++)
     {
-        delete d->local_blob_allocator;
-        d->local_blob_allocator = 0;
+        delete d->local_allocators[i].blob_allocator;
+        delete d->local_allocators[i].workspace_allocator;
+        delete d->local_allocators[i].unlocked_workspace_allocator;
     }
-    if (d->local_workspace_allocator)
+    d->local_allocators.clear();
+
+    if (d->numa_thread_pool)
     {
-        delete d->local_workspace_allocator;
-        d->local_workspace_allocator = 0;
+        delete d->numa_thread_pool;
+        d->numa_thread_pool = 0;
     }
 
 #if NCNN_VULKAN
@@ -1868,142 +2127,521 @@ Extractor Net::create_extractor() const
     return Extractor(this, d->blobs.size());
 }
 
-const std::vector<int>& Net::input_indexes() const
+int Net::submit(const std::vector<Mat>& inputs, AsyncRequest& request, async_callback_func callback, void* userdata)
 {
-    return d->input_blob_indexes;
+    return d->submit(this, inputs, request, callback, userdata);
 }
 
-const std::vector<int>& Net::output_indexes() const
+void Net::set_async_worker_count(int count)
 {
-    return d->output_blob_indexes;
+    d->async_worker_count = std::max(count, 1);
 }
 
-#if NCNN_STRING
-const std::vector<const char*>& Net::input_names() const
+void Net::set_async_batching(int max_batch_size, float batch_window_ms)
 {
-    return d->input_blob_names;
+    d->async_batch_size = std::max(max_batch_size, 1);
+    d->async_batch_window = std::max(batch_window_ms, 0.f);
 }
 
-const std::vector<const char*>& Net::output_names() const
+int NetPrivate::submit(Net* net, const std::vector<Mat>& inputs, AsyncRequest& request, async_callback_func callback, void* userdata)
 {
-    return d->output_blob_names;
-}
-#endif
+    if (inputs.size() != input_blob_indexes.size())
+    {
+        NCNN_LOGE("submit expects %d inputs but got %d", (int)input_blob_indexes.size(), (int)inputs.size());
+        return -1;
+    }
 
-const std::vector<Blob>& Net::blobs() const
-{
-    return d->blobs;
-}
+    AsyncRequestPrivate* rd = request.d;
+    {
+        MutexLockGuard guard(rd->lock);
+        if (!rd->ready)
+        {
+            NCNN_LOGE("submit a request that is still pending");
+            return -1;
+        }
 
-const std::vector<Layer*>& Net::layers() const
-{
-    return d->layers;
-}
+        rd->ready = false;
+        rd->ret = 0;
+        rd->outputs.clear();
+    }
 
-std::vector<Blob>& Net::mutable_blobs()
-{
-    return d->blobs;
-}
+    AsyncJob job;
+    job.inputs = inputs;
+    job.request = &request;
+    job.callback = callback;
+    job.userdata = userdata;
+    job.submit_time = get_current_time();
+    job.deadline = rd->deadline_ms > 0.f ? job.submit_time + rd->deadline_ms : 0.0;
 
-std::vector<Layer*>& Net::mutable_layers()
-{
-    return d->layers;
-}
+#if NCNN_THREADS
+    MutexLockGuard guard(async_lock);
 
-#if NCNN_VULKAN
-void Net::set_vulkan_device(int device_index)
-{
-    opt.vulkan_device_index = device_index;
-    d->vkdev = get_gpu_device(device_index);
-}
+    if (async_workers.empty())
+    {
+        async_net = net;
+        async_exit = false;
+        for (int i = 0; i < async_worker_count; i++)
+        {
+            async_workers.push_back(new Thread(async_worker, (void*)this));
+        }
+    }
 
-void Net::set_vulkan_device(const VulkanDevice* _vkdev)
-{
-    opt.vulkan_device_index = _vkdev->info.device_index();
-    d->vkdev = _vkdev;
-}
+    async_jobs.push_back(job);
+    async_condition.signal();
+#else
+    // no thread, run in place
+    async_net = net;
+    run_async_job(job, 0, 0);
+#endif // NCNN_THREADS
 
-const VulkanDevice* Net::vulkan_device() const
-{
-    return d->vkdev;
+    return 0;
 }
-#endif // NCNN_VULKAN
 
-#if NCNN_STRING
-int Net::find_blob_index_by_name(const char* name) const
+void NetPrivate::run_async_job(AsyncJob& job, Allocator* blob_allocator, Allocator* workspace_allocator)
 {
-    for (size_t i = 0; i < d->blobs.size(); i++)
+    int ret = 0;
+    std::vector<Mat> outputs(output_blob_indexes.size());
+
     {
-        const Blob& blob = d->blobs[i];
-        if (blob.name == name)
+        Extractor ex = async_net->create_extractor();
+        if (!opt.blob_allocator && blob_allocator)
+            ex.set_blob_allocator(blob_allocator);
+        if (!opt.workspace_allocator && workspace_allocator)
+            ex.set_workspace_allocator(workspace_allocator);
+
+        for (size_t i = 0; i < input_blob_indexes.size(); i++)
         {
-            return static_cast<int>(i);
+            ex.input(input_blob_indexes[i], job.inputs[i]);
+        }
+
+        for (size_t i = 0; i < output_blob_indexes.size(); i++)
+        {
+            ret = ex.extract(output_blob_indexes[i], outputs[i]);
+            if (ret != 0)
+                break;
+
+            if (outputs[i].allocator && outputs[i].allocator == blob_allocator)
+            {
+                // detach the returned mat from the worker allocator
+                outputs[i] = outputs[i].clone();
+                if (outputs[i].empty())
+                {
+                    ret = -100;
+                    break;
+                }
+            }
         }
     }
 
-    NCNN_LOGE("find_blob_index_by_name %s failed", name);
-    return -1;
+    complete_async_job(job, ret, outputs);
 }
 
-int Net::find_layer_index_by_name(const char* name) const
+int NetPrivate::run_async_batch(std::vector<AsyncJob>& batch, Allocator* blob_allocator, Allocator* workspace_allocator)
 {
-    for (size_t i = 0; i < d->layers.size(); i++)
+    // drop the ones already late
+    const double now = get_current_time();
+
+    std::vector<AsyncJob*> jobs;
+    for (size_t i = 0; i < batch.size(); i++)
     {
-        const Layer* layer = d->layers[i];
-        if (layer->name == name)
+        if (batch[i].deadline > 0.0 && now > batch[i].deadline)
         {
-            return static_cast<int>(i);
+            complete_async_job(batch[i], -1, std::vector<Mat>());
+            continue;
         }
+
+        jobs.push_back(&batch[i]);
     }
 
-    NCNN_LOGE("find_layer_index_by_name %s failed", name);
-    return -1;
-}
+    const int job_count = (int)jobs.size();
+    if (job_count == 0)
+        return 0;
 
-int Net::custom_layer_to_index(const char* type)
-{
-    const size_t custom_layer_registry_entry_count = d->custom_layer_registry.size();
-    for (size_t i = 0; i < custom_layer_registry_entry_count; i++)
+    if (job_count == 1)
     {
-        if (strcmp(type, d->custom_layer_registry[i].name) == 0)
-            return static_cast<int>(i);
+        run_async_job(*jobs[0], blob_allocator, workspace_allocator);
+        return 1;
     }
 
-    return -1;
+    // ncnn blobs have no batch axis, a batch is several extractors side by side
+    // the parallel layers nested in there run single threaded, so this only pays off
+    // when every thread of the team gets a request of its own
+    const int num_threads = opt.num_threads;
+    const int side_by_side_count = num_threads > 1 ? job_count / num_threads * num_threads : 0;
+
+    if (side_by_side_count > 0)
+    {
+        #pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < side_by_side_count; i++)
+        {
+            run_async_job(*jobs[i], blob_allocator, workspace_allocator);
+        }
+    }
+
+    // the rest one after another with the whole team
+    for (int i = side_by_side_count; i < job_count; i++)
+    {
+        run_async_job(*jobs[i], blob_allocator, workspace_allocator);
+    }
+
+    return job_count;
 }
 
-Layer* Net::create_custom_layer(const char* type)
+void NetPrivate::complete_async_job(AsyncJob& job, int ret, const std::vector<Mat>& outputs)
 {
-    int index = custom_layer_to_index(type);
-    if (index == -1)
-        return 0;
+    job.inputs.clear();
 
-    return create_custom_layer(index);
+    AsyncRequestPrivate* rd = job.request->d;
+    rd->ret = ret;
+    rd->outputs = outputs;
+
+    if (job.callback)
+    {
+        job.callback(job.request, job.userdata);
+    }
+
+    MutexLockGuard guard(rd->lock);
+    rd->ready = true;
+    rd->condition.broadcast();
 }
 
-Layer* Net::create_overwrite_builtin_layer(const char* type)
+double NetPrivate::async_batch_close_time() const
 {
-    int typeindex = layer_to_index(type);
-    if (typeindex == -1)
-        return 0;
+    // wait for more requests until the window of the oldest closes
+    double close_time = async_jobs.front().submit_time + async_batch_window;
 
-    return create_overwrite_builtin_layer(typeindex);
+    // or the batch would miss a deadline
+    int i = 0;
+    for (std::list<AsyncJob>::const_iterator it = async_jobs.begin(); it != async_jobs.end() && i < async_batch_size; ++it, i++)
+    {
+        if (it->deadline > 0.0)
+            close_time = std::min(close_time, it->deadline - async_batch_time);
+    }
+
+    return close_time;
 }
-#endif // NCNN_STRING
 
-Layer* Net::create_custom_layer(int index)
+void NetPrivate::stop_async_workers()
 {
-    const size_t custom_layer_registry_entry_count = d->custom_layer_registry.size();
-    if (index < 0 || static_cast<unsigned int>(index) >= custom_layer_registry_entry_count)
-        return 0;
+    async_lock.lock();
+    async_exit = true;
+    async_condition.broadcast();
+    async_lock.unlock();
 
-    layer_creator_func layer_creator = d->custom_layer_registry[index].creator;
-    if (!layer_creator)
-        return 0;
+    for (size_t i = 0; i < async_workers.size(); i++)
+    {
+        async_workers[i]->join();
+        delete async_workers[i];
+    }
+    async_workers.clear();
 
-    Layer* layer = layer_creator(d->custom_layer_registry[index].userdata);
-    layer->typeindex = ncnn::LayerType::CustomBit | index;
-    return layer;
+    async_exit = false;
+}
+
+void* NetPrivate::async_worker(void* args)
+{
+    NetPrivate* d = (NetPrivate*)args;
+
+    // reused by every job of this worker without contention
+    PoolAllocator blob_allocator;
+    PoolAllocator workspace_allocator;
+    blob_allocator.set_size_compare_ratio(0.f);
+    workspace_allocator.set_size_compare_ratio(0.f);
+
+    d->async_lock.lock();
+    for (;;)
+    {
+        while (d->async_jobs.empty() && !d->async_exit)
+        {
+            d->async_condition.wait(d->async_lock);
+        }
+
+        // drain the queue before exit
+        if (d->async_jobs.empty())
+            break;
+
+        if (d->async_batch_size > 1)
+        {
+            // hold on until the batch fills or the window closes
+            while (!d->async_jobs.empty() && (int)d->async_jobs.size() < d->async_batch_size && !d->async_exit)
+            {
+                const double wait_time = d->async_batch_close_time() - get_current_time();
+                if (wait_time <= 0.0)
+                    break;
+
+                // wake up at least once a second, a far window must not overflow the microseconds
+                const double wait_us = std::min(wait_time * 1000, 1000000.0);
+                d->async_condition.timed_wait(d->async_lock, (int)wait_us + 1);
+            }
+
+            // taken by another worker meanwhile
+            if (d->async_jobs.empty())
+                continue;
+        }
+
+        std::vector<AsyncJob> batch;
+        while (!d->async_jobs.empty() && (int)batch.size() < d->async_batch_size)
+        {
+            batch.push_back(d->async_jobs.front());
+            d->async_jobs.pop_front();
+        }
+        d->async_lock.unlock();
+
+        const double start = get_current_time();
+
+        const int run_count = d->run_async_batch(batch, &blob_allocator, &workspace_allocator);
+
+        const double batch_time = get_current_time() - start;
+
+        d->async_lock.lock();
+
+        if (run_count > 0)
+            d->async_batch_time = d->async_batch_time == 0.0 ? batch_time : d->async_batch_time * 0.8 + batch_time * 0.2;
+    }
+    d->async_lock.unlock();
+
+    return 0;
+}
+
+AsyncRequest::AsyncRequest()
+    : d(new AsyncRequestPrivate)
+{
+    d->ready = true;
+    d->ret = 0;
+    d->deadline_ms = 0.f;
+}
+
+AsyncRequest::~AsyncRequest()
+{
+    wait();
+
+    delete d;
+}
+
+AsyncRequest::AsyncRequest(const AsyncRequest&)
+    : d(0)
+{
+}
+
+AsyncRequest& AsyncRequest::operator=(const AsyncRequest&)
+{
+    return *this;
+}
+
+int AsyncRequest::wait()
+{
+    MutexLockGuard guard(d->lock);
+    while (!d->ready)
+    {
+        d->condition.wait(d->lock);
+    }
+
+    return d->ret;
+}
+
+bool AsyncRequest::ready() const
+{
+    MutexLockGuard guard(d->lock);
+    return d->ready;
+}
+
+const std::vector<Mat>& AsyncRequest::outputs() const
+{
+    return d->outputs;
+}
+
+void AsyncRequest::set_deadline(float deadline_ms)
+{
+    d->deadline_ms = deadline_ms;
+}
+
+// keep the cost of each layer forward
+class CostProfiler : public Profiler
+{
+public:
+    CostProfiler(std::vector<LayerCost>& _costs)
+        : costs(_costs)
+    {
+    }
+
+    virtual void layer_forward(const LayerProfile& profile)
+    {
+        costs[profile.layer_index] = profile.cost;
+    }
+
+    std::vector<LayerCost>& costs;
+};
+
+int Net::estimate_cost(const std::vector<Mat>& inputs, std::vector<LayerCost>& costs) const
+{
+    if (inputs.size() != d->input_blob_indexes.size())
+    {
+        NCNN_LOGE("estimate_cost expect %d inputs but got %d", (int)d->input_blob_indexes.size(), (int)inputs.size());
+        return -1;
+    }
+
+    costs.clear();
+    costs.resize(d->layers.size());
+
+    CostProfiler profiler(costs);
+
+    Extractor ex = create_extractor();
+    ex.set_profiler(&profiler);
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        int ret = ex.input(d->input_blob_indexes[i], inputs[i]);
+        if (ret != 0)
+            return ret;
+    }
+
+    for (size_t i = 0; i < d->output_blob_indexes.size(); i++)
+    {
+        Mat out;
+        int ret = ex.extract(d->output_blob_indexes[i], out);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+const std::vector<int>& Net::input_indexes() const
+{
+    return d->input_blob_indexes;
+}
+
+const std::vector<int>& Net::output_indexes() const
+{
+    return d->output_blob_indexes;
+}
+
+#if NCNN_STRING
+const std::vector<const char*>& Net::input_names() const
+{
+    return d->input_blob_names;
+}
+
+const std::vector<const char*>& Net::output_names() const
+{
+    return d->output_blob_names;
+}
+#endif
+
+const std::vector<Blob>& Net::blobs() const
+{
+    return d->blobs;
+}
+
+const std::vector<Layer*>& Net::layers() const
+{
+    return d->layers;
+}
+
+std::vector<Blob>& Net::mutable_blobs()
+{
+    return d->blobs;
+}
+
+std::vector<Layer*>& Net::mutable_layers()
+{
+    return d->layers;
+}
+
+#if NCNN_VULKAN
+void Net::set_vulkan_device(int device_index)
+{
+    opt.vulkan_device_index = device_index;
+    d->vkdev = get_gpu_device(device_index);
+}
+
+void Net::set_vulkan_device(const VulkanDevice* _vkdev)
+{
+    opt.vulkan_device_index = _vkdev->info.device_index();
+    d->vkdev = _vkdev;
+}
+
+const VulkanDevice* Net::vulkan_device() const
+{
+    return d->vkdev;
+}
+#endif // NCNN_VULKAN
+
+#if NCNN_STRING
+int Net::find_blob_index_by_name(const char* name) const
+{
+    for (size_t i = 0; i < d->blobs.size(); i++)
+    {
+        const Blob& blob = d->blobs[i];
+        if (blob.name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    NCNN_LOGE("find_blob_index_by_name %s failed", name);
+    return -1;
+}
+
+int Net::find_layer_index_by_name(const char* name) const
+{
+    for (size_t i = 0; i < d->layers.size(); i++)
+    {
+        const Layer* layer = d->layers[i];
+        if (layer->name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    NCNN_LOGE("find_layer_index_by_name %s failed", name);
+    return -1;
+}
+
+int Net::custom_layer_to_index(const char* type)
+{
+    const size_t custom_layer_registry_entry_count = d->custom_layer_registry.size();
+    for (size_t i = 0; i < custom_layer_registry_entry_count; i++)
+    {
+        if (strcmp(type, d->custom_layer_registry[i].name) == 0)
+            return static_cast<int>(i);
+    }
+
+    return -1;
+}
+
+Layer* Net::create_custom_layer(const char* type)
+{
+    int index = custom_layer_to_index(type);
+    if (index == -1)
+        return 0;
+
+    return create_custom_layer(index);
+}
+
+Layer* Net::create_overwrite_builtin_layer(const char* type)
+{
+    int typeindex = layer_to_index(type);
+    if (typeindex == -1)
+        return 0;
+
+    return create_overwrite_builtin_layer(typeindex);
+}
+#endif // NCNN_STRING
+
+Layer* Net::create_custom_layer(int index)
+{
+    const size_t custom_layer_registry_entry_count = d->custom_layer_registry.size();
+    if (index < 0 || static_cast<unsigned int>(index) >= custom_layer_registry_entry_count)
+        return 0;
+
+    layer_creator_func layer_creator = d->custom_layer_registry[index].creator;
+    if (!layer_creator)
+        return 0;
+
+    Layer* layer = layer_creator(d->custom_layer_registry[index].userdata);
+    layer->typeindex = ncnn::LayerType::CustomBit | index;
+    return layer;
 }
 
 Layer* Net::create_overwrite_builtin_layer(int typeindex)
@@ -2031,17 +2669,138 @@ Layer* Net::create_overwrite_builtin_layer(int typeindex)
     return layer;
 }
 
+// small index of the calling thread, assigned on first use
+// an exiting thread gives its index back, so a churn of short lived threads keeps reusing the low ones
+static Mutex g_thread_slot_lock;
+static std::vector<int> g_free_thread_slots;
+static int g_thread_slot_count = 0;
+
+static void release_thread_slot(void* value)
+{
+    g_thread_slot_lock.lock();
+    g_free_thread_slots.push_back((int)((size_t)value - 1));
+    g_thread_slot_lock.unlock();
+}
+
+static ThreadLocalStorage g_thread_slot(release_thread_slot);
+
+static int get_thread_slot()
+{
+    size_t slot = (size_t)g_thread_slot.get();
+    if (slot == 0)
+    {
+        g_thread_slot_lock.lock();
+        if (g_free_thread_slots.empty())
+        {
+            slot = (size_t)g_thread_slot_count++ + 1;
+        }
+        else
+        {
+            // the lowest free index, the per cpu slots are the low ones
+            size_t lowest = 0;
+            for (size_t i = 1; i < g_free_thread_slots.size(); i++)
+            {
+                if (g_free_thread_slots[i] < g_free_thread_slots[lowest])
+                    lowest = i;
+            }
+
+            slot = (size_t)g_free_thread_slots[lowest] + 1;
+            g_free_thread_slots[lowest] = g_free_thread_slots.back();
+            g_free_thread_slots.pop_back();
+        }
+        g_thread_slot_lock.unlock();
+
+        g_thread_slot.set((void*)slot);
+    }
+
+    return (int)(slot - 1);
+}
+
+void NetPrivate::get_local_allocators(int num_threads, Allocator** blob_allocator, Allocator** workspace_allocator)
+{
+    if (local_allocators.empty())
+        return;
+
+    // threads beyond the cpu count share the last slot
+    const int shared_slot = (int)local_allocators.size() - 1;
+    const int slot = std::min(get_thread_slot(), shared_slot);
+
+    // an owned slot is only ever filled by its thread
+    if (slot == shared_slot)
+        local_allocator_lock.lock();
+
+    LocalAllocatorSlot& s = local_allocators[slot];
+
+    if (blob_allocator)
+    {
+        // blob mats are released by whichever thread clears the extractor, keep the lock
+        if (!s.blob_allocator)
+        {
+            s.blob_allocator = new PoolAllocator;
+            s.blob_allocator->set_size_compare_ratio(0.f);
+        }
+
+        *blob_allocator = s.blob_allocator;
+    }
+
+    if (workspace_allocator)
+    {
+        if (num_threads == 1 && slot != shared_slot)
+        {
+            // layers run on this thread alone and free their workspace before returning
+            if (!s.unlocked_workspace_allocator)
+            {
+                s.unlocked_workspace_allocator = new UnlockedPoolAllocator;
+                s.unlocked_workspace_allocator->set_size_compare_ratio(0.f);
+            }
+
+            *workspace_allocator = s.unlocked_workspace_allocator;
+        }
+        else
+        {
+            if (!s.workspace_allocator)
+            {
+                s.workspace_allocator = new PoolAllocator;
+                s.workspace_allocator->set_size_compare_ratio(0.f);
+            }
+
+            *workspace_allocator = s.workspace_allocator;
+        }
+    }
+
+    if (slot == shared_slot)
+        local_allocator_lock.unlock();
+}
+
 class ExtractorPrivate
 {
 public:
     ExtractorPrivate(const Net* _net)
-        : net(_net)
+        : net(_net), profiler(0), profile_state(0), local_blob_allocator(0)
     {
     }
+
+    void release_profile_state()
+    {
+        if (profile_state && NCNN_XADD(&profile_state->refcount, -1) == 1)
+        {
+            delete profile_state;
+        }
+        profile_state = 0;
+    }
+
+    int forward_layer_profiled(const NetPrivate* net_d, int layer_index);
+
     const Net* net;
     std::vector<Mat> blob_mats;
     Option opt;
 
+    Profiler* profiler;
+    ExtractorProfileState* profile_state;
+
+    // the net local pool picked for this extractor
+    Allocator* local_blob_allocator;
+
 #if NCNN_VULKAN
     VkAllocator* local_blob_vkallocator;
     VkAllocator* local_staging_vkallocator;
@@ -2050,8 +2809,86 @@ public:
 #endif // NCNN_VULKAN
 };
 
+// released ExtractorPrivate keep the capacity of their blob vectors for the next extractor
+// so that creating one does not touch the heap once warm
+// a slot is claimed with an atomic flag, every thread probes from its own slot first
+#define NCNN_EXTRACTOR_CACHE_SIZE 64
+#define NCNN_EXTRACTOR_CACHE_PROBE 4
+
+struct ExtractorCacheSlot
+{
+    int busy;
+    ExtractorPrivate* d;
+};
+
+static ExtractorCacheSlot g_extractor_cache[NCNN_EXTRACTOR_CACHE_SIZE];
+
+static struct ExtractorCacheCleanup
+{
+    ~ExtractorCacheCleanup()
+    {
+        for (int i = 0; i < NCNN_EXTRACTOR_CACHE_SIZE; i++)
+        {
+            delete g_extractor_cache[i].d;
+            g_extractor_cache[i].d = 0;
+        }
+    }
+} g_extractor_cache_cleanup;
+
+static ExtractorPrivate* acquire_extractor_private(const Net* net)
+{
+    const int home = get_thread_slot();
+
+    for (int i = 0; i < NCNN_EXTRACTOR_CACHE_PROBE; i++)
+    {
+        ExtractorCacheSlot& slot = g_extractor_cache[(home + i) % NCNN_EXTRACTOR_CACHE_SIZE];
+
+        ExtractorPrivate* d = 0;
+        if (NCNN_XADD(&slot.busy, 1) == 0)
+        {
+            d = slot.d;
+            slot.d = 0;
+        }
+        NCNN_XADD(&slot.busy, -1);
+
+        if (d)
+        {
+            d->net = net;
+            d->profiler = 0;
+            d->profile_state = 0;
+            d->local_blob_allocator = 0;
+            return d;
+        }
+    }
+
+    return new ExtractorPrivate(net);
+}
+
+static void release_extractor_private(ExtractorPrivate* d)
+{
+    const int home = get_thread_slot();
+
+    for (int i = 0; i < NCNN_EXTRACTOR_CACHE_PROBE; i++)
+    {
+        ExtractorCacheSlot& slot = g_extractor_cache[(home + i) % NCNN_EXTRACTOR_CACHE_SIZE];
+
+        bool cached = false;
+        if (NCNN_XADD(&slot.busy, 1) == 0 && !slot.d)
+        {
+            slot.d = d;
+            cached = true;
+        }
+        NCNN_XADD(&slot.busy, -1);
+
+        if (cached)
+            return;
+    }
+
+    delete d;
+}
+
 Extractor::Extractor(const Net* _net, size_t blob_count)
-    : d(new ExtractorPrivate(_net))
+    : d(acquire_extractor_private(_net))
 {
     d->blob_mats.resize(blob_count);
     d->opt = d->net->opt;
@@ -2071,15 +2908,23 @@ Extractor::~Extractor()
 {
     clear();
 
-    delete d;
+    d->release_profile_state();
+
+    release_extractor_private(d);
 }
 
 Extractor::Extractor(const Extractor& rhs)
-    : d(new ExtractorPrivate(0))
+    : d(acquire_extractor_private(0))
 {
     d->net = rhs.d->net;
     d->blob_mats = rhs.d->blob_mats;
     d->opt = rhs.d->opt;
+    d->local_blob_allocator = rhs.d->local_blob_allocator;
+
+    d->profiler = rhs.d->profiler;
+    d->profile_state = rhs.d->profile_state;
+    if (d->profile_state)
+        NCNN_XADD(&d->profile_state->refcount, 1);
 
 #if NCNN_VULKAN
     d->local_blob_vkallocator = 0;
@@ -2094,9 +2939,18 @@ Extractor& Extractor::operator=(const Extractor& rhs)
     if (this == &rhs)
         return *this;
 
+    // blob mats may still reference the old profile allocators
+    if (rhs.d->profile_state)
+        NCNN_XADD(&rhs.d->profile_state->refcount, 1);
+
     d->net = rhs.d->net;
     d->blob_mats = rhs.d->blob_mats;
     d->opt = rhs.d->opt;
+    d->local_blob_allocator = rhs.d->local_blob_allocator;
+
+    d->release_profile_state();
+    d->profiler = rhs.d->profiler;
+    d->profile_state = rhs.d->profile_state;
 
 #if NCNN_VULKAN
     d->local_blob_vkallocator = 0;
@@ -2147,11 +3001,39 @@ void Extractor::set_blob_allocator(Allocator* allocator)
     d->opt.blob_allocator = allocator;
 }
 
+void Extractor::set_profiler(Profiler* profiler)
+{
+    d->profiler = profiler;
+}
+
+int ExtractorPrivate::forward_layer_profiled(const NetPrivate* net_d, int layer_index)
+{
+    if (!profile_state)
+        profile_state = new ExtractorProfileState;
+
+    LayerProfileContext profile_context;
+    profile_context.profiler = profiler;
+    profile_context.extractor_id = (size_t)this;
+    profile_context.blob_allocator = profile_state->get_allocator(opt.blob_allocator);
+    profile_context.workspace_allocator = profile_state->get_allocator(opt.workspace_allocator);
+
+    Option opt_profile = opt;
+    opt_profile.blob_allocator = profile_context.blob_allocator;
+    opt_profile.workspace_allocator = profile_context.workspace_allocator;
+
+    return net_d->forward_layer(layer_index, blob_mats, opt_profile, &profile_context);
+}
+
 void Extractor::set_workspace_allocator(Allocator* allocator)
 {
     d->opt.workspace_allocator = allocator;
 }
 
+void Extractor::set_thread_pool(ThreadPool* thread_pool)
+{
+    d->opt.thread_pool = thread_pool;
+}
+
 #if NCNN_VULKAN
 void Extractor::set_vulkan_compute(bool enable)
 {
@@ -2211,6 +3093,24 @@ int Extractor::extract(const char* blob_name, Mat& feat, int type)
 
     return extract(blob_index, feat, type);
 }
+
+int Extractor::extract_to(const char* blob_name, Mat& feat)
+{
+    int blob_index = d->net->find_blob_index_by_name(blob_name);
+    if (blob_index == -1)
+    {
+        NCNN_LOGE("Try");
+        const std::vector<const char*>& output_names = d->net->output_names();
+        for (size_t i = 0; i < output_names.size(); i++)
+        {
+            NCNN_LOGE("    ex.extract_to(\"%s\", out%d);", output_names[i], (int)i);
+        }
+
+        return -1;
+    }
+
+    return extract_to(blob_index, feat);
+}
 #endif // NCNN_STRING
 
 int Extractor::input(int blob_index, const Mat& in)
@@ -2223,16 +3123,43 @@ int Extractor::input(int blob_index, const Mat& in)
     return 0;
 }
 
-int Extractor::extract(int blob_index, Mat& feat, int type)
+struct ExtractorForwardJob
 {
-    if (blob_index < 0 || blob_index >= (int)d->blob_mats.size())
-        return -1;
+    Extractor* ex;
+    int blob_index;
+};
+
+int Extractor::forward_blob_on_pool(void* args)
+{
+    ExtractorForwardJob* job = (ExtractorForwardJob*)args;
+    const Option& opt = job->ex->d->opt;
 
+    // blocktime and denormals are per thread, apply them on the lane too
     int old_blocktime = get_kmp_blocktime();
-    set_kmp_blocktime(d->opt.openmp_blocktime);
+    set_kmp_blocktime(opt.openmp_blocktime);
 
     int old_flush_denormals = get_flush_denormals();
-    set_flush_denormals(d->opt.flush_denormals);
+    set_flush_denormals(opt.flush_denormals);
+
+    int ret = job->ex->forward_blob(job->blob_index);
+
+    set_kmp_blocktime(old_blocktime);
+    set_flush_denormals(old_flush_denormals);
+
+    return ret;
+}
+
+// run the producers of blob_index unless it is computed already
+int Extractor::forward_blob(int blob_index)
+{
+    if (d->opt.thread_pool && !d->opt.thread_pool->is_current() && d->blob_mats[blob_index].dims == 0)
+    {
+        // hop onto the lane thread so that the parallel layers fork its worker team
+        ExtractorForwardJob job;
+        job.ex = this;
+        job.blob_index = blob_index;
+        return d->opt.thread_pool->run(forward_blob_on_pool, &job);
+    }
 
     int ret = 0;
 
@@ -2240,16 +3167,23 @@ int Extractor::extract(int blob_index, Mat& feat, int type)
     {
         int layer_index = d->net->blobs()[blob_index].producer;
 
-        // use local allocator
+        // use local allocator of the thread slot
+        // the workspace pool belongs to the thread running this forward, so it is picked anew every time
+        Allocator* local_workspace_allocator = 0;
         if (d->opt.use_local_pool_allocator)
         {
-            if (!d->opt.blob_allocator)
+            Allocator** blob_allocator = d->opt.blob_allocator ? 0 : &d->opt.blob_allocator;
+            Allocator** workspace_allocator = d->opt.workspace_allocator ? 0 : &local_workspace_allocator;
+
+            d->net->d->get_local_allocators(d->opt.num_threads, blob_allocator, workspace_allocator);
+
+            if (blob_allocator)
             {
-                d->opt.blob_allocator = d->net->d->local_blob_allocator;
+                d->local_blob_allocator = d->opt.blob_allocator;
             }
-            if (!d->opt.workspace_allocator)
+            if (local_workspace_allocator)
             {
-                d->opt.workspace_allocator = d->net->d->local_workspace_allocator;
+                d->opt.workspace_allocator = local_workspace_allocator;
             }
         }
 
@@ -2302,15 +3236,47 @@ int Extractor::extract(int blob_index, Mat& feat, int type)
 #endif // NCNN_BENCHMARK
             }
         }
+        else if (d->profiler)
+        {
+            ret = d->forward_layer_profiled(d->net->d, layer_index);
+        }
         else
         {
             ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->opt);
         }
 #else
-        ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->opt);
+        if (d->profiler)
+        {
+            ret = d->forward_layer_profiled(d->net->d, layer_index);
+        }
+        else
+        {
+            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->opt);
+        }
 #endif // NCNN_VULKAN
+
+        if (local_workspace_allocator)
+        {
+            d->opt.workspace_allocator = 0;
+        }
     }
 
+    return ret;
+}
+
+int Extractor::extract(int blob_index, Mat& feat, int type)
+{
+    if (blob_index < 0 || blob_index >= (int)d->blob_mats.size())
+        return -1;
+
+    int old_blocktime = get_kmp_blocktime();
+    set_kmp_blocktime(d->opt.openmp_blocktime);
+
+    int old_flush_denormals = get_flush_denormals();
+    set_flush_denormals(d->opt.flush_denormals);
+
+    int ret = forward_blob(blob_index);
+
     feat = d->blob_mats[blob_index];
 
     // empty is valid for outputs
@@ -2386,7 +3352,15 @@ int Extractor::extract(int blob_index, Mat& feat, int type)
         if (feat.empty())
             return -100;
 
-        if (d->opt.use_local_pool_allocator && feat.allocator == d->net->d->local_blob_allocator)
+        if (d->profile_state && d->profile_state->owns(feat.allocator))
+        {
+            // detach the returned mat from profile allocator
+            feat = feat.clone(d->opt.blob_allocator);
+            if (feat.empty())
+                return -100;
+        }
+
+        if (d->local_blob_allocator && feat.allocator == d->local_blob_allocator)
         {
             // detach the returned mat from local pool allocator
             // so we could destroy net instance much earlier
@@ -2402,6 +3376,128 @@ int Extractor::extract(int blob_index, Mat& feat, int type)
     return ret;
 }
 
+// 16bit blobs hold fp16 unless extract() would read them as bf16
+static bool feat_is_bf16(const Option& opt)
+{
+#if NCNN_ARM82
+    if (opt.use_fp16_storage && cpu_support_arm_asimdhp())
+        return false;
+#endif // NCNN_ARM82
+#if NCNN_VFPV4
+    if (opt.use_fp16_storage && !opt.use_bf16_storage && cpu_support_arm_vfpv4())
+        return false;
+#endif // NCNN_VFPV4
+#if NCNN_ZVFH
+    if (opt.use_fp16_storage && cpu_support_riscv_zvfh())
+        return false;
+#endif // NCNN_ZVFH
+    return opt.use_bf16_storage;
+}
+
+// unpack and cast feat to fp32 straight into the caller mat in one pass
+static int store_feat(const Mat& feat, Mat& dst, const Option& opt)
+{
+    if (feat.empty() || dst.empty())
+        return -100;
+
+    const int dims = feat.dims;
+    const int elempack = feat.elempack;
+    const int out_elempack = dst.elempack;
+
+    bool shape_ok = dst.dims == dims && dst.elemsize == out_elempack * 4u && (out_elempack == 1 || out_elempack == elempack);
+    if (dims == 1)
+        shape_ok = shape_ok && dst.w * out_elempack == feat.w * elempack;
+    if (dims == 2)
+        shape_ok = shape_ok && dst.w == feat.w && dst.h * out_elempack == feat.h * elempack;
+    if (dims >= 3)
+        shape_ok = shape_ok && dst.w == feat.w && dst.h == feat.h && dst.d == feat.d && dst.c * out_elempack == feat.c * elempack;
+
+    if (!shape_ok)
+    {
+        NCNN_LOGE("extract_to shape mismatch, blob %d %d %d %d elempack %d", feat.w, feat.h, feat.d, feat.c, elempack);
+        return -1;
+    }
+
+    // the packed axis is w for 1d, h for 2d and c otherwise
+    const int outer = dims == 1 ? dst.w : dims == 2 ? dst.h : dst.c;
+    const int inner = dims == 1 ? 1 : dims == 2 ? feat.w : feat.w * feat.h * feat.d;
+    const size_t step = dims == 1 ? 1 : dims == 2 ? feat.w : feat.cstep;
+    const size_t out_step = dims == 1 ? 1 : dims == 2 ? dst.w : dst.cstep;
+
+    const int elembits = feat.elembits();
+    const bool bf16 = elembits == 16 && feat_is_bf16(opt);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < outer; q++)
+    {
+        float* outptr = (float*)((unsigned char*)dst.data + out_step * dst.elemsize * q);
+
+        // same packing copies whole groups, unpacking picks one lane
+        const int gq = out_elempack == elempack ? q : q / elempack;
+        const int lane = out_elempack == elempack ? 0 : q % elempack;
+        const int stride = out_elempack == elempack ? 1 : elempack;
+        const int size = out_elempack == elempack ? inner * elempack : inner;
+
+        const unsigned char* ptr = (const unsigned char*)feat.data + step * feat.elemsize * gq;
+
+        if (elembits == 32)
+        {
+            const float* p = (const float*)ptr + lane;
+            if (stride == 1)
+            {
+                memcpy(outptr, p, size * sizeof(float));
+                continue;
+            }
+
+            for (int i = 0; i < size; i++)
+            {
+                outptr[i] = p[i * stride];
+            }
+        }
+        if (elembits == 16)
+        {
+            const unsigned short* p = (const unsigned short*)ptr + lane;
+            for (int i = 0; i < size; i++)
+            {
+                outptr[i] = bf16 ? bfloat16_to_float32(p[i * stride]) : float16_to_float32(p[i * stride]);
+            }
+        }
+        if (elembits == 8)
+        {
+            const signed char* p = (const signed char*)ptr + lane;
+            for (int i = 0; i < size; i++)
+            {
+                outptr[i] = (float)p[i * stride];
+            }
+        }
+    }
+
+    return 0;
+}
+
+int Extractor::extract_to(int blob_index, Mat& feat)
+{
+    if (blob_index < 0 || blob_index >= (int)d->blob_mats.size())
+        return -1;
+
+    int old_blocktime = get_kmp_blocktime();
+    set_kmp_blocktime(d->opt.openmp_blocktime);
+
+    int old_flush_denormals = get_flush_denormals();
+    set_flush_denormals(d->opt.flush_denormals);
+
+    int ret = forward_blob(blob_index);
+    if (ret == 0)
+    {
+        ret = store_feat(d->blob_mats[blob_index], feat, d->opt);
+    }
+
+    set_kmp_blocktime(old_blocktime);
+    set_flush_denormals(old_flush_denormals);
+
+    return ret;
+}
+
 #if NCNN_VULKAN
 #if NCNN_STRING
 int Extractor::input(const char* blob_name, const VkMat& in)
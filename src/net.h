@@ -21,9 +21,16 @@ namespace ncnn {
 #if NCNN_VULKAN
 class VkCompute;
 #endif // NCNN_VULKAN
+class AsyncRequest;
 class DataReader;
 class Extractor;
+class LayerCost;
 class NetPrivate;
+class Profiler;
+
+// called on the worker thread when a submitted inference finished
+typedef void (*async_callback_func)(AsyncRequest* request, void* userdata);
+
 class NCNN_EXPORT Net
 {
 public:
@@ -116,8 +123,33 @@ public:
     void clear();
 
     // construct an Extractor from network
+    // safe to call from many threads, the state of released extractors is reused without locking
+    // with opt.use_local_pool_allocator every thread slot gets its own pool allocators
     Extractor create_extractor() const;
 
+    // queue one inference for the async workers and return at once
+    // inputs are fed in input_indexes() order, the request receives outputs in output_indexes() order
+    // callback runs on the worker thread before request.wait() returns, the request must outlive it
+    // return 0 if queued
+    int submit(const std::vector<Mat>& inputs, AsyncRequest& request, async_callback_func callback = 0, void* userdata = 0);
+
+    // number of async worker threads, each runs one extractor with opt.num_threads at a time
+    // default 1, apply before the first submit
+    void set_async_worker_count(int count);
+
+    // collect up to max_batch_size queued requests within batch_window_ms of the oldest one
+    // and run them side by side on opt.num_threads threads, one thread per request
+    // whole groups of opt.num_threads requests go side by side, the rest one after another on the full team
+    // the window closes early for a request whose deadline is coming
+    // default 1 and 0 for no batching, apply before the first submit
+    void set_async_batching(int max_batch_size, float batch_window_ms);
+
+    // estimate flops and memory traffic of every layer
+    // runs one inference with inputs fed in input_indexes() order
+    // costs are indexed by layer, layers not reached or run on gpu stay zero
+    // return 0 if success
+    int estimate_cost(const std::vector<Mat>& inputs, std::vector<LayerCost>& costs) const;
+
     // get input/output indexes/names
     const std::vector<int>& input_indexes() const;
     const std::vector<int>& output_indexes() const;
@@ -151,6 +183,40 @@ private:
     NetPrivate* const d;
 };
 
+class AsyncRequestPrivate;
+// completion state of one Net::submit(), like a future
+// one request may be submitted again once it is ready
+class NCNN_EXPORT AsyncRequest
+{
+public:
+    AsyncRequest();
+    // wait for the pending inference
+    ~AsyncRequest();
+
+    // block until the inference finished
+    // return 0 if success
+    int wait();
+
+    // whether the inference finished, never blocks
+    bool ready() const;
+
+    // outputs in output_indexes() order, valid once ready
+    const std::vector<Mat>& outputs() const;
+
+    // latency budget counted from submit, 0 for none(default)
+    // the inference is dropped and wait() returns -1 if the deadline passed before it started
+    // applies to the next submit
+    void set_deadline(float deadline_ms);
+
+private:
+    AsyncRequest(const AsyncRequest&);
+    AsyncRequest& operator=(const AsyncRequest&);
+
+private:
+    friend class NetPrivate;
+    AsyncRequestPrivate* const d;
+};
+
 class ExtractorPrivate;
 class NCNN_EXPORT Extractor
 {
@@ -181,6 +247,16 @@ public:
     // set workspace memory allocator
     void set_workspace_allocator(Allocator* allocator);
 
+    // run the cpu forward on the lane thread of this pool, null for the calling thread
+    // parallel layers then only use the threads of that lane
+    // extractors sharing one pool run one at a time, give each concurrent extractor its own pool
+    void set_thread_pool(ThreadPool* thread_pool);
+
+    // set per-layer profiler, null to disable
+    // the profiler receives every cpu layer forward of this extractor
+    // it must outlive the extractor
+    void set_profiler(Profiler* profiler);
+
 #if NCNN_VULKAN
     // deprecated, no-op
     // instead, set net.opt.use_vulkan_compute before net.load_param()
@@ -195,6 +271,8 @@ public:
 
 #if NCNN_STRING
     // set input by blob name
+    // in may wrap external memory with any cstep, see Mat::from_external()
+    // it is read without copy and never written, keep it valid until the last extract returns
     // return 0 if success
     int input(const char* blob_name, const Mat& in);
 
@@ -215,6 +293,18 @@ public:
     // type = 1, do not convert fp16/bf16 or / and packing
     int extract(int blob_index, Mat& feat, int type = 0);
 
+#if NCNN_STRING
+    // get result by blob name into caller memory
+    // feat must wrap the destination already, fp32 in the blob shape with elempack 1 or the blob elempack
+    // any cstep is accepted, unpacking and casting to fp32 write straight into feat
+    // return 0 if success
+    int extract_to(const char* blob_name, Mat& feat);
+#endif // NCNN_STRING
+
+    // get result by blob index into caller memory
+    // return 0 if success
+    int extract_to(int blob_index, Mat& feat);
+
 #if NCNN_VULKAN
 #if NCNN_STRING
     // set input by blob name
@@ -239,6 +329,10 @@ protected:
     friend Extractor Net::create_extractor() const;
     Extractor(const Net* net, size_t blob_count);
 
+private:
+    int forward_blob(int blob_index);
+    static int forward_blob_on_pool(void* args);
+
 private:
     ExtractorPrivate* const d;
 };
@@ -0,0 +1,425 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "netpipeline.h"
+
+#include "allocator.h"
+
+#include <limits.h>
+
+#include <list>
+
+namespace ncnn {
+
+// one unit of work flowing through the stages
+struct PipelineItem
+{
+    std::vector<Mat> mats;
+    int tag;
+};
+
+// bounded fifo in front of a stage, the last one holds the pipeline output
+class PipelineQueue
+{
+public:
+    PipelineQueue(int _capacity)
+        : capacity(_capacity), closed(false), cancelled(false)
+    {
+    }
+
+    // block while full
+    // return false if closed or the pipeline is going away
+    bool push(const PipelineItem& item)
+    {
+        MutexLockGuard guard(lock);
+        while ((int)items.size() >= capacity && !closed && !cancelled)
+        {
+            not_full.wait(lock);
+        }
+
+        if (closed || cancelled)
+            return false;
+
+        items.push_back(item);
+        not_empty.signal();
+        return true;
+    }
+
+    // block while empty
+    // return false once closed and drained, or if the pipeline is going away
+    bool pop(PipelineItem& item)
+    {
+        MutexLockGuard guard(lock);
+        while (items.empty() && !closed && !cancelled)
+        {
+#if NCNN_THREADS
+            not_empty.wait(lock);
+#else
+            // nobody else can fill the queue
+            return false;
+#endif
+        }
+
+        if (cancelled || items.empty())
+            return false;
+
+        item = items.front();
+        items.pop_front();
+        not_full.signal();
+        return true;
+    }
+
+    // no more push, pop drains what is left
+    void close()
+    {
+        MutexLockGuard guard(lock);
+        closed = true;
+        not_empty.broadcast();
+        not_full.broadcast();
+    }
+
+    // wake everyone up and drop the items
+    void cancel()
+    {
+        MutexLockGuard guard(lock);
+        cancelled = true;
+        items.clear();
+        not_empty.broadcast();
+        not_full.broadcast();
+    }
+
+    int capacity;
+
+private:
+    std::list<PipelineItem> items;
+    bool closed;
+    bool cancelled;
+
+    Mutex lock;
+    ConditionVariable not_empty;
+    ConditionVariable not_full;
+};
+
+struct PipelineStage
+{
+    const Net* net;
+    CpuSet cpus;
+    pipeline_stage_func func;
+    void* userdata;
+
+    PipelineQueue* input;
+    PipelineQueue* output;
+
+    // reused by every item of this stage
+    PoolAllocator blob_allocator;
+    PoolAllocator workspace_allocator;
+
+    Thread* thread;
+};
+
+class NetPipelinePrivate
+{
+public:
+    void start();
+    static void* stage_worker(void* args);
+
+    std::vector<PipelineStage*> stages;
+
+    // queues[i] feeds stages[i], the last one is the output
+    std::vector<PipelineQueue*> queues;
+    int queue_capacity;
+
+    bool running;
+    Mutex lock;
+};
+
+static int forward_stage(Extractor& ex, const Net& net, const std::vector<Mat>& inputs, std::vector<std::vector<Mat> >& outputs)
+{
+    const std::vector<int>& input_indexes = net.input_indexes();
+    const std::vector<int>& output_indexes = net.output_indexes();
+
+    if (inputs.size() != input_indexes.size())
+    {
+        NCNN_LOGE("pipeline stage expects %d inputs but got %d", (int)input_indexes.size(), (int)inputs.size());
+        return -1;
+    }
+
+    for (size_t i = 0; i < input_indexes.size(); i++)
+    {
+        ex.input(input_indexes[i], inputs[i]);
+    }
+
+    std::vector<Mat> out(output_indexes.size());
+    for (size_t i = 0; i < output_indexes.size(); i++)
+    {
+        int ret = ex.extract(output_indexes[i], out[i]);
+        if (ret != 0)
+            return ret;
+    }
+
+    outputs.push_back(out);
+
+    return 0;
+}
+
+static int run_stage(PipelineStage* stage, const PipelineItem& item, std::vector<PipelineItem>& results)
+{
+    const Net* net = stage->net;
+
+    std::vector<std::vector<Mat> > outputs;
+    int ret = 0;
+    {
+        Extractor ex = net->create_extractor();
+        if (!net->opt.blob_allocator)
+            ex.set_blob_allocator(&stage->blob_allocator);
+        if (!net->opt.workspace_allocator)
+            ex.set_workspace_allocator(&stage->workspace_allocator);
+
+        if (stage->func)
+            ret = stage->func(ex, item.mats, outputs, stage->userdata);
+        else
+            ret = forward_stage(ex, *net, item.mats, outputs);
+    }
+
+    if (ret != 0)
+    {
+        NCNN_LOGE("pipeline stage dropped item %d with error %d", item.tag, ret);
+        return ret;
+    }
+
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        PipelineItem result;
+        result.mats = outputs[i];
+        result.tag = item.tag;
+
+        for (size_t j = 0; j < result.mats.size(); j++)
+        {
+            // detach from the stage allocator, which is gone with the pipeline
+            if (result.mats[j].allocator == &stage->blob_allocator)
+            {
+                result.mats[j] = result.mats[j].clone();
+                if (result.mats[j].empty())
+                    return -100;
+            }
+        }
+
+        results.push_back(result);
+    }
+
+    return 0;
+}
+
+void* NetPipelinePrivate::stage_worker(void* args)
+{
+    PipelineStage* stage = (PipelineStage*)args;
+
+#if !NCNN_SIMPLEOMP
+    // this thread and the worker team it forks later stay on the cpu set
+    set_cpu_thread_affinity(stage->cpus);
+#endif
+
+    PipelineItem item;
+    while (stage->input->pop(item))
+    {
+        std::vector<PipelineItem> results;
+        run_stage(stage, item, results);
+
+        item.mats.clear();
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            if (!stage->output->push(results[i]))
+                break;
+        }
+    }
+
+    // nothing more comes from upstream
+    stage->output->close();
+
+    return 0;
+}
+
+void NetPipelinePrivate::start()
+{
+    for (size_t i = 0; i < queues.size(); i++)
+    {
+#if NCNN_THREADS
+        queues[i]->capacity = queue_capacity;
+#else
+        // push runs every stage in place and nobody pops in between
+        queues[i]->capacity = INT_MAX;
+#endif
+    }
+
+#if NCNN_THREADS
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        stages[i]->thread = new Thread(stage_worker, (void*)stages[i]);
+    }
+#endif
+
+    running = true;
+}
+
+NetPipeline::NetPipeline()
+    : d(new NetPipelinePrivate)
+{
+    d->queue_capacity = 4;
+    d->running = false;
+
+    // output queue
+    d->queues.push_back(new PipelineQueue(d->queue_capacity));
+}
+
+NetPipeline::~NetPipeline()
+{
+    for (size_t i = 0; i < d->queues.size(); i++)
+    {
+        d->queues[i]->cancel();
+    }
+
+    for (size_t i = 0; i < d->stages.size(); i++)
+    {
+        if (d->stages[i]->thread)
+        {
+            d->stages[i]->thread->join();
+            delete d->stages[i]->thread;
+        }
+        delete d->stages[i];
+    }
+
+    for (size_t i = 0; i < d->queues.size(); i++)
+    {
+        delete d->queues[i];
+    }
+
+    delete d;
+}
+
+NetPipeline::NetPipeline(const NetPipeline&)
+    : d(0)
+{
+}
+
+NetPipeline& NetPipeline::operator=(const NetPipeline&)
+{
+    return *this;
+}
+
+int NetPipeline::add_stage(const Net& net, const CpuSet& cpus, pipeline_stage_func func, void* userdata)
+{
+    MutexLockGuard guard(d->lock);
+
+    if (d->running)
+    {
+        NCNN_LOGE("add_stage after the pipeline started");
+        return -1;
+    }
+
+    PipelineStage* stage = new PipelineStage;
+    stage->net = &net;
+    stage->cpus = cpus;
+    stage->func = func;
+    stage->userdata = userdata;
+    stage->thread = 0;
+
+    // items of one stage have the same shapes, reuse any cached buffer that fits
+    stage->blob_allocator.set_size_compare_ratio(0.f);
+    stage->workspace_allocator.set_size_compare_ratio(0.f);
+
+    // the new stage reads the former output queue and writes a new one
+    stage->input = d->queues.back();
+    stage->output = new PipelineQueue(d->queue_capacity);
+    d->queues.push_back(stage->output);
+
+    d->stages.push_back(stage);
+
+    return (int)d->stages.size() - 1;
+}
+
+void NetPipeline::set_queue_capacity(int capacity)
+{
+    MutexLockGuard guard(d->lock);
+
+    d->queue_capacity = capacity < 1 ? 1 : capacity;
+}
+
+int NetPipeline::push(const std::vector<Mat>& inputs, int tag)
+{
+    {
+        MutexLockGuard guard(d->lock);
+
+        if (d->stages.empty())
+        {
+            NCNN_LOGE("push to a pipeline without stage");
+            return -1;
+        }
+
+        if (!d->running)
+            d->start();
+    }
+
+    PipelineItem item;
+    item.mats = inputs;
+    item.tag = tag;
+
+#if NCNN_THREADS
+    if (!d->queues[0]->push(item))
+        return -1;
+#else
+    // no thread, run every stage in place
+    std::vector<PipelineItem> items(1, item);
+    for (size_t i = 0; i < d->stages.size(); i++)
+    {
+        std::vector<PipelineItem> results;
+        for (size_t j = 0; j < items.size(); j++)
+        {
+            run_stage(d->stages[i], items[j], results);
+        }
+        items.swap(results);
+    }
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (!d->queues.back()->push(items[i]))
+            return -1;
+    }
+#endif // NCNN_THREADS
+
+    return 0;
+}
+
+int NetPipeline::pop(std::vector<Mat>& outputs, int* tag)
+{
+    PipelineItem item;
+    if (!d->queues.back()->pop(item))
+        return -1;
+
+    outputs = item.mats;
+    if (tag)
+        *tag = item.tag;
+
+    return 0;
+}
+
+void NetPipeline::close()
+{
+    MutexLockGuard guard(d->lock);
+
+#if NCNN_THREADS
+    if (d->running)
+    {
+        // the stages close the queues behind them once drained
+        d->queues[0]->close();
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < d->queues.size(); i++)
+    {
+        d->queues[i]->close();
+    }
+}
+
+} // namespace ncnn
@@ -0,0 +1,65 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NCNN_NETPIPELINE_H
+#define NCNN_NETPIPELINE_H
+
+#include "cpu.h"
+#include "mat.h"
+#include "net.h"
+#include "platform.h"
+
+namespace ncnn {
+
+// run one item on a pipeline stage, called on the stage thread
+// ex is a fresh extractor of the stage net that uses the stage allocators
+// push the items for the next stage into outputs, zero or more per input
+// return 0 if success, the item is dropped otherwise
+typedef int (*pipeline_stage_func)(Extractor& ex, const std::vector<Mat>& inputs, std::vector<std::vector<Mat> >& outputs, void* userdata);
+
+class NetPipelinePrivate;
+// chains several nets into stages that run at the same time
+// every stage owns a thread pinned to its cpu set, its own pool allocators and a bounded input queue
+// so stage 1 of item N+1 overlaps stage 2 of item N, a full queue blocks the stage in front of it
+// with NCNN_SIMPLEOMP the worker threads are shared by the whole process and nothing is pinned
+class NCNN_EXPORT NetPipeline
+{
+public:
+    NetPipeline();
+    // close, drop what was not popped and join the stages
+    ~NetPipeline();
+
+    // append a stage running net on cpus, the net must outlive the pipeline
+    // layers use net.opt.num_threads threads, size it to the cpu set
+    // func 0 feeds inputs in input_indexes() order and passes the output_indexes() outputs on as one item
+    // apply before the first push
+    // return the stage index, -1 if already running
+    int add_stage(const Net& net, const CpuSet& cpus, pipeline_stage_func func = 0, void* userdata = 0);
+
+    // capacity of the queue in front of every stage and of the output queue
+    // default 4, apply before the first push
+    void set_queue_capacity(int capacity);
+
+    // feed one item to the first stage, blocks while its queue is full
+    // tag is handed on to every item derived from this one
+    // return 0 if queued
+    int push(const std::vector<Mat>& inputs, int tag = 0);
+
+    // take one item from the last stage, blocks until there is one
+    // return -1 once closed and drained
+    int pop(std::vector<Mat>& outputs, int* tag = 0);
+
+    // no more push, the stages finish what is queued and pop returns -1 afterwards
+    void close();
+
+private:
+    NetPipeline(const NetPipeline&);
+    NetPipeline& operator=(const NetPipeline&);
+
+private:
+    NetPipelinePrivate* const d;
+};
+
+} // namespace ncnn
+
+#endif // NCNN_NETPIPELINE_H
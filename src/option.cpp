@@ -67,9 +67,14 @@ Option::Option()
     use_fp16_uniform = true;
     use_int8_uniform = true;
 
-    use_reserved_9 = false;
+    use_numa_interleave = false;
     use_reserved_10 = false;
     use_reserved_11 = false;
+
+    thread_pool = 0;
+    numa_node = -1;
+
+    parallel_schedule = 0;
 }
 
 } // namespace ncnn
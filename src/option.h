@@ -14,6 +14,7 @@ class PipelineCache;
 #endif // NCNN_VULKAN
 
 class Allocator;
+class ThreadPool;
 class NCNN_EXPORT Option
 {
 public:
@@ -141,9 +142,30 @@ public:
     bool use_fp16_uniform;
     bool use_int8_uniform;
 
-    bool use_reserved_9;
+    // spread the weight pages over all numa nodes while loading
+    // one shared copy without the cross socket hot spot of first touch placement
+    // changes should be applied before loading weight
+    bool use_numa_interleave;
     bool use_reserved_10;
     bool use_reserved_11;
+
+    // run inference on the lane thread of this pool
+    // null for the calling thread, num_threads should match the pool size
+    ThreadPool* thread_pool;
+
+    // load weights on this numa node, -1 for no binding
+    // weights are first touched by the node threads, load the model into one net per node to replicate it
+    // run extractors there with set_thread_pool and a pool on get_numa_node_affinity_mask(numa_node)
+    // changes should be applied before loading weight
+    int numa_node;
+
+    // how the tiles of the hot gemm and convolution loops are split across threads
+    // 0 = static, one contiguous block per thread(default)
+    // 1 = dynamic, one tile at a time, faster cores take more tiles
+    // 2 = guided, shrinking blocks, fewer claims than dynamic
+    // 3 = work stealing, one contiguous block per thread, idle threads take tiles from the others
+    // dynamic, guided and work stealing suit x86 hybrid p-core and e-core or busy shared hosts
+    int parallel_schedule;
 };
 
 } // namespace ncnn
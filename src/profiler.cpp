@@ -0,0 +1,541 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "profiler.h"
+
+#include "layer_type.h"
+
+#include "layer/convolution.h"
+#include "layer/convolution1d.h"
+#include "layer/convolution3d.h"
+#include "layer/convolutiondepthwise.h"
+#include "layer/convolutiondepthwise1d.h"
+#include "layer/convolutiondepthwise3d.h"
+#include "layer/deconvolution.h"
+#include "layer/deconvolution1d.h"
+#include "layer/deconvolution3d.h"
+#include "layer/deconvolutiondepthwise.h"
+#include "layer/deconvolutiondepthwise1d.h"
+#include "layer/deconvolutiondepthwise3d.h"
+#include "layer/gemm.h"
+#include "layer/gru.h"
+#include "layer/innerproduct.h"
+#include "layer/lstm.h"
+#include "layer/multiheadattention.h"
+#include "layer/pooling.h"
+#include "layer/rnn.h"
+
+#if NCNN_STDIO
+#include <stdio.h>
+#endif
+
+namespace ncnn {
+
+LayerCost::LayerCost()
+{
+    flops = 0;
+    weight_bytes = 0;
+    read_bytes = 0;
+    write_bytes = 0;
+}
+
+// unpacked element count
+static uint64_t shape_elemcount(const Mat& m)
+{
+    if (m.dims == 0)
+        return 0;
+
+    return (uint64_t)m.w * m.h * m.d * m.c * m.elempack;
+}
+
+static uint64_t shape_bytes(const Mat& m)
+{
+    if (m.dims == 0)
+        return 0;
+
+    return (uint64_t)m.w * m.h * m.d * m.c * m.elemsize;
+}
+
+// unpacked channel count, the outermost axis
+static int shape_channels(const Mat& m)
+{
+    if (m.dims == 1)
+        return m.w * m.elempack;
+    if (m.dims == 2)
+        return m.h * m.elempack;
+    return m.c * m.elempack;
+}
+
+// multiply-add per output element of convolution style layers
+#define CONVOLUTION_MACS(T) \
+    macs = top_elemcount * (((const T*)layer)->weight_data_size / std::max(((const T*)layer)->num_output, 1)); \
+    weight_count = ((const T*)layer)->weight_data_size
+
+// deconvolution scatters every input element to kernel x num_output / group outputs
+#define DECONVOLUTION_MACS(T) \
+    macs = bottom_elemcount * (((const T*)layer)->weight_data_size / std::max(bottom_channels, 1)); \
+    weight_count = ((const T*)layer)->weight_data_size
+
+LayerCost estimate_layer_cost(const Layer* layer, const std::vector<Mat>& bottom_shapes, const std::vector<Mat>& top_shapes)
+{
+    LayerCost cost;
+
+    for (size_t i = 0; i < bottom_shapes.size(); i++)
+    {
+        cost.read_bytes += shape_bytes(bottom_shapes[i]);
+    }
+    for (size_t i = 0; i < top_shapes.size(); i++)
+    {
+        cost.write_bytes += shape_bytes(top_shapes[i]);
+    }
+
+    if (!layer || (layer->typeindex & LayerType::CustomBit))
+        return cost;
+
+    const Mat bottom_shape = bottom_shapes.empty() ? Mat() : bottom_shapes[0];
+    const Mat top_shape = top_shapes.empty() ? Mat() : top_shapes[0];
+
+    const uint64_t bottom_elemcount = shape_elemcount(bottom_shape);
+    const uint64_t top_elemcount = shape_elemcount(top_shape);
+    const int bottom_channels = shape_channels(bottom_shape);
+
+    // weights follow the activation storage unless quantized
+    const int elembytes = bottom_shape.elempack ? (int)(bottom_shape.elemsize / bottom_shape.elempack) : 4;
+    int weight_elembytes = elembytes == 1 ? 4 : elembytes;
+
+    uint64_t macs = 0;
+    uint64_t weight_count = 0;
+    uint64_t elementwise_ops = 0;
+
+    switch (layer->typeindex)
+    {
+    case LayerType::Convolution:
+        CONVOLUTION_MACS(Convolution);
+        if (((const Convolution*)layer)->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    case LayerType::ConvolutionDepthWise:
+        CONVOLUTION_MACS(ConvolutionDepthWise);
+        if (((const ConvolutionDepthWise*)layer)->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    case LayerType::Convolution1D:
+        CONVOLUTION_MACS(Convolution1D);
+        break;
+    case LayerType::ConvolutionDepthWise1D:
+        CONVOLUTION_MACS(ConvolutionDepthWise1D);
+        break;
+    case LayerType::Convolution3D:
+        CONVOLUTION_MACS(Convolution3D);
+        break;
+    case LayerType::ConvolutionDepthWise3D:
+        CONVOLUTION_MACS(ConvolutionDepthWise3D);
+        break;
+    case LayerType::Deconvolution:
+        DECONVOLUTION_MACS(Deconvolution);
+        break;
+    case LayerType::DeconvolutionDepthWise:
+        DECONVOLUTION_MACS(DeconvolutionDepthWise);
+        break;
+    case LayerType::Deconvolution1D:
+        DECONVOLUTION_MACS(Deconvolution1D);
+        break;
+    case LayerType::DeconvolutionDepthWise1D:
+        DECONVOLUTION_MACS(DeconvolutionDepthWise1D);
+        break;
+    case LayerType::Deconvolution3D:
+        DECONVOLUTION_MACS(Deconvolution3D);
+        break;
+    case LayerType::DeconvolutionDepthWise3D:
+        DECONVOLUTION_MACS(DeconvolutionDepthWise3D);
+        break;
+    case LayerType::InnerProduct:
+    {
+        const InnerProduct* innerproduct = (const InnerProduct*)layer;
+        macs = top_elemcount / std::max(innerproduct->num_output, 1) * innerproduct->weight_data_size;
+        weight_count = innerproduct->weight_data_size;
+        if (innerproduct->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    }
+    case LayerType::Gemm:
+    {
+        const Gemm* gemm = (const Gemm*)layer;
+        int K = gemm->constantK;
+        if (!gemm->constantA && !gemm->constantB)
+        {
+            K = gemm->transA ? bottom_shape.h * bottom_shape.elempack : bottom_shape.w;
+        }
+        macs = top_elemcount * K;
+        if (gemm->constantA)
+            weight_count += (uint64_t)gemm->constantM * K;
+        if (gemm->constantB)
+            weight_count += (uint64_t)gemm->constantN * K;
+        if (gemm->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    }
+    case LayerType::MatMul:
+    {
+        // the reduction axis is the innermost of A
+        macs = top_elemcount * bottom_shape.w;
+        break;
+    }
+    case LayerType::MultiHeadAttention:
+    {
+        const MultiHeadAttention* mha = (const MultiHeadAttention*)layer;
+        const int embed_dim = mha->embed_dim;
+        const uint64_t q_len = bottom_shape.h * bottom_shape.elempack;
+        const uint64_t kv_len = bottom_shapes.size() >= 2 ? bottom_shapes[1].h * bottom_shapes[1].elempack : q_len;
+        const int qdim = embed_dim > 0 ? mha->weight_data_size / embed_dim : 0;
+
+        // q k v out projection, q @ k and attention @ v
+        macs = q_len * embed_dim * qdim + kv_len * embed_dim * (mha->kdim + mha->vdim) + q_len * embed_dim * qdim + q_len * kv_len * embed_dim * 2;
+        weight_count = (uint64_t)embed_dim * (qdim * 2 + mha->kdim + mha->vdim);
+        elementwise_ops = q_len * kv_len * mha->num_heads;
+        if (mha->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    }
+    case LayerType::LSTM:
+    {
+        const LSTM* lstm = (const LSTM*)layer;
+        const int num_directions = lstm->direction == 2 ? 2 : 1;
+        const uint64_t T = bottom_shape.h * bottom_shape.elempack;
+        weight_count = lstm->weight_data_size + (uint64_t)num_directions * lstm->hidden_size * 4 * lstm->num_output;
+        if (lstm->num_output != lstm->hidden_size)
+            weight_count += (uint64_t)num_directions * lstm->hidden_size * lstm->num_output;
+        macs = T * weight_count;
+        elementwise_ops = T * num_directions * lstm->hidden_size * 4;
+        if (lstm->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    }
+    case LayerType::GRU:
+    {
+        const GRU* gru = (const GRU*)layer;
+        const int num_directions = gru->direction == 2 ? 2 : 1;
+        const uint64_t T = bottom_shape.h * bottom_shape.elempack;
+        weight_count = gru->weight_data_size + (uint64_t)num_directions * gru->num_output * 3 * gru->num_output;
+        macs = T * weight_count;
+        elementwise_ops = T * num_directions * gru->num_output * 3;
+        if (gru->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    }
+    case LayerType::RNN:
+    {
+        const RNN* rnn = (const RNN*)layer;
+        const int num_directions = rnn->direction == 2 ? 2 : 1;
+        const uint64_t T = bottom_shape.h * bottom_shape.elempack;
+        weight_count = rnn->weight_data_size + (uint64_t)num_directions * rnn->num_output * rnn->num_output;
+        macs = T * weight_count;
+        elementwise_ops = T * num_directions * rnn->num_output;
+        if (rnn->int8_scale_term)
+            weight_elembytes = 1;
+        break;
+    }
+    case LayerType::Pooling:
+    {
+        const Pooling* pooling = (const Pooling*)layer;
+        if (pooling->global_pooling || pooling->adaptive_pooling)
+            elementwise_ops = bottom_elemcount;
+        else
+            elementwise_ops = top_elemcount * pooling->kernel_w * pooling->kernel_h;
+        break;
+    }
+    case LayerType::Pooling1D:
+    case LayerType::Pooling3D:
+    case LayerType::Reduction:
+    case LayerType::StatisticsPooling:
+        elementwise_ops = bottom_elemcount;
+        break;
+    case LayerType::BatchNorm:
+    case LayerType::Scale:
+    case LayerType::InstanceNorm:
+    case LayerType::GroupNorm:
+    case LayerType::LayerNorm:
+    case LayerType::RMSNorm:
+    case LayerType::Normalize:
+    case LayerType::MVN:
+    case LayerType::Softmax:
+    case LayerType::LRN:
+        // a few passes over the data
+        elementwise_ops = top_elemcount * 4;
+        break;
+    case LayerType::AbsVal:
+    case LayerType::Bias:
+    case LayerType::BinaryOp:
+    case LayerType::BNLL:
+    case LayerType::CELU:
+    case LayerType::Clip:
+    case LayerType::Dequantize:
+    case LayerType::Eltwise:
+    case LayerType::ELU:
+    case LayerType::Erf:
+    case LayerType::Exp:
+    case LayerType::GELU:
+    case LayerType::GLU:
+    case LayerType::HardSigmoid:
+    case LayerType::HardSwish:
+    case LayerType::Interp:
+    case LayerType::Log:
+    case LayerType::Mish:
+    case LayerType::Power:
+    case LayerType::PReLU:
+    case LayerType::Quantize:
+    case LayerType::ReLU:
+    case LayerType::Requantize:
+    case LayerType::SELU:
+    case LayerType::Shrink:
+    case LayerType::Sigmoid:
+    case LayerType::Softplus:
+    case LayerType::Swish:
+    case LayerType::TanH:
+    case LayerType::Threshold:
+    case LayerType::UnaryOp:
+        elementwise_ops = top_elemcount;
+        break;
+    case LayerType::Input:
+    case LayerType::Split:
+    case LayerType::Noop:
+    case LayerType::Dropout:
+        // blobs are shared, nothing moved
+        cost.read_bytes = 0;
+        cost.write_bytes = 0;
+        break;
+    default:
+        // data movement only
+        break;
+    }
+
+    cost.flops = macs * 2 + elementwise_ops;
+    cost.weight_bytes = weight_count * weight_elembytes;
+
+    return cost;
+}
+
+#undef CONVOLUTION_MACS
+#undef DECONVOLUTION_MACS
+
+LayerProfile::LayerProfile()
+{
+    extractor_id = 0;
+    layer_index = -1;
+    layer = 0;
+    start_ns = 0;
+    elapsed_ns = 0;
+    blob_allocated_bytes = 0;
+    workspace_allocated_bytes = 0;
+    ret = 0;
+}
+
+Profiler::~Profiler()
+{
+}
+
+class TraceProfilerPrivate
+{
+public:
+    Mutex lock;
+    std::vector<LayerProfile> profiles;
+};
+
+TraceProfiler::TraceProfiler()
+    : d(new TraceProfilerPrivate)
+{
+}
+
+TraceProfiler::~TraceProfiler()
+{
+    delete d;
+}
+
+TraceProfiler::TraceProfiler(const TraceProfiler&)
+    : d(0)
+{
+}
+
+TraceProfiler& TraceProfiler::operator=(const TraceProfiler&)
+{
+    return *this;
+}
+
+void TraceProfiler::layer_forward(const LayerProfile& profile)
+{
+    MutexLockGuard g(d->lock);
+    d->profiles.push_back(profile);
+}
+
+void TraceProfiler::clear()
+{
+    MutexLockGuard g(d->lock);
+    d->profiles.clear();
+}
+
+int TraceProfiler::count() const
+{
+    MutexLockGuard g(d->lock);
+    return (int)d->profiles.size();
+}
+
+const LayerProfile& TraceProfiler::get(int index) const
+{
+    MutexLockGuard g(d->lock);
+    return d->profiles[index];
+}
+
+#if NCNN_STDIO
+static void print_shape(FILE* fp, const Mat& m)
+{
+    if (m.dims == 1)
+        fprintf(fp, "[%d *%d]", m.w, m.elempack);
+    if (m.dims == 2)
+        fprintf(fp, "[%d,%d *%d]", m.w, m.h, m.elempack);
+    if (m.dims == 3)
+        fprintf(fp, "[%d,%d,%d *%d]", m.w, m.h, m.c, m.elempack);
+    if (m.dims == 4)
+        fprintf(fp, "[%d,%d,%d,%d *%d]", m.w, m.h, m.d, m.c, m.elempack);
+}
+
+static void print_shapes(FILE* fp, const std::vector<Mat>& shapes)
+{
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        if (i != 0)
+            fprintf(fp, " ");
+        print_shape(fp, shapes[i]);
+    }
+}
+
+int TraceProfiler::save(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        NCNN_LOGE("fopen %s failed", path);
+        return -1;
+    }
+
+    MutexLockGuard g(d->lock);
+
+    // one trace row per extractor
+    std::vector<size_t> extractor_ids;
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+
+    for (size_t i = 0; i < d->profiles.size(); i++)
+    {
+        const LayerProfile& profile = d->profiles[i];
+
+        int tid = -1;
+        for (size_t j = 0; j < extractor_ids.size(); j++)
+        {
+            if (extractor_ids[j] == profile.extractor_id)
+            {
+                tid = (int)j;
+                break;
+            }
+        }
+        if (tid == -1)
+        {
+            tid = (int)extractor_ids.size();
+            extractor_ids.push_back(profile.extractor_id);
+        }
+
+#if NCNN_STRING
+        const char* type = profile.layer ? profile.layer->type.c_str() : "";
+        const char* name = profile.layer ? profile.layer->name.c_str() : "";
+#else
+        const char* type = "";
+        const char* name = "";
+#endif
+
+        fprintf(fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,", name, type, tid, profile.start_ns / 1000.0, profile.elapsed_ns / 1000.0);
+        fprintf(fp, "\"args\":{\"index\":%d,\"in\":\"", profile.layer_index);
+        print_shapes(fp, profile.bottom_shapes);
+        fprintf(fp, "\",\"out\":\"");
+        print_shapes(fp, profile.top_shapes);
+        fprintf(fp, "\",\"blob_bytes\":%lu,\"workspace_bytes\":%lu,", (unsigned long)profile.blob_allocated_bytes, (unsigned long)profile.workspace_allocated_bytes);
+        fprintf(fp, "\"flops\":%.0f,\"weight_bytes\":%.0f,\"read_bytes\":%.0f,\"write_bytes\":%.0f}}", (double)profile.cost.flops, (double)profile.cost.weight_bytes, (double)profile.cost.read_bytes, (double)profile.cost.write_bytes);
+        fprintf(fp, i + 1 == d->profiles.size() ? "\n" : ",\n");
+    }
+
+    fprintf(fp, "]}\n");
+
+    fclose(fp);
+
+    return 0;
+}
+
+void TraceProfiler::print_summary() const
+{
+    MutexLockGuard g(d->lock);
+
+    // aggregate by layer type
+    std::vector<const Layer*> type_layers;
+    std::vector<uint64_t> type_elapsed_ns;
+    std::vector<uint64_t> type_flops;
+    std::vector<uint64_t> type_bytes;
+    std::vector<int> type_counts;
+    uint64_t total_elapsed_ns = 0;
+
+    for (size_t i = 0; i < d->profiles.size(); i++)
+    {
+        const LayerProfile& profile = d->profiles[i];
+        if (!profile.layer)
+            continue;
+
+        size_t j = 0;
+        for (; j < type_layers.size(); j++)
+        {
+            if (type_layers[j]->typeindex == profile.layer->typeindex)
+                break;
+        }
+        if (j == type_layers.size())
+        {
+            type_layers.push_back(profile.layer);
+            type_elapsed_ns.push_back(0);
+            type_flops.push_back(0);
+            type_bytes.push_back(0);
+            type_counts.push_back(0);
+        }
+
+        type_elapsed_ns[j] += profile.elapsed_ns;
+        type_flops[j] += profile.cost.flops;
+        type_bytes[j] += profile.cost.weight_bytes + profile.cost.read_bytes + profile.cost.write_bytes;
+        type_counts[j] += 1;
+        total_elapsed_ns += profile.elapsed_ns;
+    }
+
+    // hottest first
+    for (size_t i = 0; i < type_layers.size(); i++)
+    {
+        for (size_t j = i + 1; j < type_layers.size(); j++)
+        {
+            if (type_elapsed_ns[j] > type_elapsed_ns[i])
+            {
+                std::swap(type_layers[i], type_layers[j]);
+                std::swap(type_elapsed_ns[i], type_elapsed_ns[j]);
+                std::swap(type_flops[i], type_flops[j]);
+                std::swap(type_bytes[i], type_bytes[j]);
+                std::swap(type_counts[i], type_counts[j]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < type_layers.size(); i++)
+    {
+#if NCNN_STRING
+        const char* type = type_layers[i]->type.c_str();
+#else
+        const char* type = "";
+#endif
+        // flop per ns is GFLOP/s, byte per ns is GB/s
+        const double elapsed_ns = type_elapsed_ns[i] ? (double)type_elapsed_ns[i] : 1.0;
+        fprintf(stderr, "%-24s %6d calls  %10.3lfms  %6.2lf%%  %9.2lf GFLOP/s  %8.2lf GB/s\n", type, type_counts[i], type_elapsed_ns[i] / 1000000.0, total_elapsed_ns ? type_elapsed_ns[i] * 100.0 / total_elapsed_ns : 0.0, type_flops[i] / elapsed_ns, type_bytes[i] / elapsed_ns);
+    }
+}
+#endif // NCNN_STDIO
+
+} // namespace ncnn
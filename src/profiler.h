@@ -0,0 +1,119 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NCNN_PROFILER_H
+#define NCNN_PROFILER_H
+
+#include <stdint.h>
+
+#include "layer.h"
+#include "mat.h"
+#include "platform.h"
+
+namespace ncnn {
+
+// roofline style work estimate of one layer forward
+// multiply-add counts as two flops
+class NCNN_EXPORT LayerCost
+{
+public:
+    LayerCost();
+
+public:
+    uint64_t flops;
+
+    // bytes of constant weight touched
+    uint64_t weight_bytes;
+
+    // bytes of bottom blobs read and top blobs written
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+};
+
+// estimate the cost of layer forward from its params and the blob shapes
+// custom and unknown layers are counted as pure memory traffic
+NCNN_EXPORT LayerCost estimate_layer_cost(const Layer* layer, const std::vector<Mat>& bottom_shapes, const std::vector<Mat>& top_shapes);
+
+// what happened in one layer forward
+class NCNN_EXPORT LayerProfile
+{
+public:
+    LayerProfile();
+
+public:
+    // the extractor running the layer, distinct for concurrent extractors
+    size_t extractor_id;
+
+    int layer_index;
+    const Layer* layer;
+
+    // blob shapes without data, elempack and elemsize tell the storage path taken
+    std::vector<Mat> bottom_shapes;
+    std::vector<Mat> top_shapes;
+
+    // nanoseconds since the clock origin of get_current_time()
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+
+    // bytes requested from blob and workspace allocator during the forward
+    size_t blob_allocated_bytes;
+    size_t workspace_allocated_bytes;
+
+    // estimated work of this forward
+    LayerCost cost;
+
+    // layer forward return value
+    int ret;
+};
+
+// runtime per-layer profiling hook
+// set to Extractor via set_profiler(), no rebuild with NCNN_BENCHMARK needed
+class NCNN_EXPORT Profiler
+{
+public:
+    virtual ~Profiler();
+
+    // called on the extractor thread after each cpu layer forward
+    // must be thread-safe if shared by concurrent extractors
+    virtual void layer_forward(const LayerProfile& profile) = 0;
+};
+
+// collect layer profiles and dump chrome://tracing compatible json
+class TraceProfilerPrivate;
+class NCNN_EXPORT TraceProfiler : public Profiler
+{
+public:
+    TraceProfiler();
+    virtual ~TraceProfiler();
+
+    virtual void layer_forward(const LayerProfile& profile);
+
+    // drop all collected profiles
+    void clear();
+
+    // number of collected profiles
+    int count() const;
+
+    // collected profile by index
+    const LayerProfile& get(int index) const;
+
+#if NCNN_STDIO
+    // write trace event json, load it in chrome://tracing or perfetto
+    // return 0 if success
+    int save(const char* path) const;
+
+    // print per layer type aggregated time, GFLOP/s and GB/s to stderr, hottest first
+    void print_summary() const;
+#endif // NCNN_STDIO
+
+private:
+    TraceProfiler(const TraceProfiler&);
+    TraceProfiler& operator=(const TraceProfiler&);
+
+private:
+    TraceProfilerPrivate* const d;
+};
+
+} // namespace ncnn
+
+#endif // NCNN_PROFILER_H
@@ -23,6 +23,73 @@
 
 namespace cv {
 
+// copy size pixels of c channels and swap the first and third channel of rgb and rgba
+static void copy_swap_rb(const uchar* src, uchar* dst, int size, int c)
+{
+    if (c == 1)
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    int i = 0;
+#if __ARM_NEON
+    if (c == 3)
+    {
+        for (; i + 15 < size; i += 16)
+        {
+            uint8x16x3_t _rgb = vld3q_u8(src);
+            uint8x16_t _t = _rgb.val[0];
+            _rgb.val[0] = _rgb.val[2];
+            _rgb.val[2] = _t;
+            vst3q_u8(dst, _rgb);
+            src += 48;
+            dst += 48;
+        }
+    }
+    if (c == 4)
+    {
+        for (; i + 15 < size; i += 16)
+        {
+            uint8x16x4_t _rgba = vld4q_u8(src);
+            uint8x16_t _t = _rgba.val[0];
+            _rgba.val[0] = _rgba.val[2];
+            _rgba.val[2] = _t;
+            vst4q_u8(dst, _rgba);
+            src += 64;
+            dst += 64;
+        }
+    }
+#elif __SSE2__
+    if (c == 4)
+    {
+        // g and a stay, r and b trade places inside each 32bit pixel
+        __m128i _mask_ga = _mm_set1_epi32(0xff00ff00);
+        __m128i _mask_b = _mm_set1_epi32(0x000000ff);
+        for (; i + 3 < size; i += 4)
+        {
+            __m128i _p = _mm_loadu_si128((const __m128i*)src);
+            __m128i _ga = _mm_and_si128(_p, _mask_ga);
+            __m128i _r = _mm_and_si128(_mm_srli_epi32(_p, 16), _mask_b);
+            __m128i _b = _mm_slli_epi32(_mm_and_si128(_p, _mask_b), 16);
+            _mm_storeu_si128((__m128i*)dst, _mm_or_si128(_ga, _mm_or_si128(_r, _b)));
+            src += 16;
+            dst += 16;
+        }
+    }
+#endif // __ARM_NEON
+    for (; i < size; i++)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        if (c == 4)
+            dst[3] = src[3];
+        src += c;
+        dst += c;
+    }
+}
+
 Mat imread(const std::string& path, int flags)
 {
     int desired_channels = 0;
@@ -80,7 +147,8 @@ Mat imread(const std::string& path, int flags)
         return Mat();
     }
 
-    memcpy(img.data, pixeldata, w * h * c);
+    // rgb to bgr while copying
+    copy_swap_rb(pixeldata, img.data, w * h, c);
 
     stbi_image_free(pixeldata);
 
@@ -104,26 +172,6 @@ Mat imread(const std::string& path, int flags)
     //         ifs.close();
     //     }
 
-    // rgb to bgr
-    if (c == 3)
-    {
-        uchar* p = img.data;
-        for (int i = 0; i < w * h; i++)
-        {
-            std::swap(p[0], p[2]);
-            p += 3;
-        }
-    }
-    if (c == 4)
-    {
-        uchar* p = img.data;
-        for (int i = 0; i < w * h; i++)
-        {
-            std::swap(p[0], p[2]);
-            p += 4;
-        }
-    }
-
     return img;
 }
 
@@ -184,30 +232,11 @@ Mat imdecode(const std::vector<uchar>& buf, int flags)
         return Mat();
     }
 
-    memcpy(img.data, pixeldata, w * h * c);
+    // rgb to bgr while copying
+    copy_swap_rb(pixeldata, img.data, w * h, c);
 
     stbi_image_free(pixeldata);
 
-    // rgb to bgr
-    if (c == 3)
-    {
-        uchar* p = img.data;
-        for (int i = 0; i < w * h; i++)
-        {
-            std::swap(p[0], p[2]);
-            p += 3;
-        }
-    }
-    if (c == 4)
-    {
-        uchar* p = img.data;
-        for (int i = 0; i < w * h; i++)
-        {
-            std::swap(p[0], p[2]);
-            p += 4;
-        }
-    }
-
     return img;
 }
 
@@ -303,8 +332,6 @@ int waitKey(int delay)
 #if NCNN_PIXEL
 void resize(const Mat& src, Mat& dst, const Size& size, float sw, float sh, int flags)
 {
-    (void)flags;
-
     int srcw = src.cols;
     int srch = src.rows;
 
@@ -330,15 +357,193 @@ void resize(const Mat& src, Mat& dst, const Size& size, float sw, float sh, int
     if (tmp.empty())
         return;
 
-    if (src.c == 1)
-        ncnn::resize_bilinear_c1(src.data, srcw, srch, tmp.data, w, h);
-    else if (src.c == 3)
-        ncnn::resize_bilinear_c3(src.data, srcw, srch, tmp.data, w, h);
-    else if (src.c == 4)
-        ncnn::resize_bilinear_c4(src.data, srcw, srch, tmp.data, w, h);
+    const int srcstride = srcw * src.c;
+    const int stride = w * src.c;
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+
+    if (flags == INTER_AREA)
+    {
+        if (src.c == 1)
+            ncnn::resize_area_c1(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+        else if (src.c == 2)
+            ncnn::resize_area_c2(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+        else if (src.c == 3)
+            ncnn::resize_area_c3(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+        else if (src.c == 4)
+            ncnn::resize_area_c4(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+    }
+    else if (flags == INTER_CUBIC)
+    {
+        if (src.c == 1)
+            ncnn::resize_bicubic_c1(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+        else if (src.c == 2)
+            ncnn::resize_bicubic_c2(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+        else if (src.c == 3)
+            ncnn::resize_bicubic_c3(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+        else if (src.c == 4)
+            ncnn::resize_bicubic_c4(src.data, srcw, srch, srcstride, tmp.data, w, h, stride, opt);
+    }
+    else
+    {
+        if (src.c == 1)
+            ncnn::resize_bilinear_c1(src.data, srcw, srch, tmp.data, w, h);
+        else if (src.c == 2)
+            ncnn::resize_bilinear_c2(src.data, srcw, srch, tmp.data, w, h);
+        else if (src.c == 3)
+            ncnn::resize_bilinear_c3(src.data, srcw, srch, tmp.data, w, h);
+        else if (src.c == 4)
+            ncnn::resize_bilinear_c4(src.data, srcw, srch, tmp.data, w, h);
+    }
 
     dst = tmp;
 }
+
+class ImageLoaderPrivate
+{
+public:
+    static void* decode_worker(void* args);
+
+    std::vector<std::string> paths;
+    int flags;
+    Size size;
+    int interpolation;
+    int capacity;
+
+    ncnn::Mutex lock;
+    ncnn::ConditionVariable condition;
+
+    int next_index;
+    // 0 = empty  1 = decoding  2 = ready
+    std::vector<int> slot_states;
+    std::vector<int> slot_indexes;
+    std::vector<Mat> slot_images;
+
+    std::vector<ncnn::Thread*> workers;
+};
+
+void* ImageLoaderPrivate::decode_worker(void* args)
+{
+    ImageLoaderPrivate* d = (ImageLoaderPrivate*)args;
+
+    const int count = (int)d->paths.size();
+
+    for (;;)
+    {
+        // claim the next index once its ring slot is free
+        d->lock.lock();
+        while (d->next_index < count && d->slot_states[d->next_index % d->capacity] != 0)
+        {
+            d->condition.wait(d->lock);
+        }
+
+        if (d->next_index >= count)
+        {
+            d->lock.unlock();
+            break;
+        }
+
+        const int index = d->next_index++;
+        const int slot = index % d->capacity;
+        d->slot_states[slot] = 1;
+        d->slot_indexes[slot] = index;
+        d->lock.unlock();
+
+        Mat img = imread(d->paths[index], d->flags);
+        if (!img.empty() && d->size.width > 0 && d->size.height > 0)
+        {
+            resize(img, img, d->size, 0.f, 0.f, d->interpolation);
+        }
+
+        d->lock.lock();
+        d->slot_images[slot] = img;
+        d->slot_states[slot] = 2;
+        d->condition.broadcast();
+        d->lock.unlock();
+    }
+
+    return 0;
+}
+
+ImageLoader::ImageLoader(const std::vector<std::string>& paths, int flags, int num_threads, int capacity, const Size& size, int interpolation)
+    : d(new ImageLoaderPrivate)
+{
+    d->paths = paths;
+    d->flags = flags;
+    d->size = size;
+    d->interpolation = interpolation;
+    d->capacity = std::max(capacity, 1);
+    d->next_index = 0;
+    d->slot_states.resize(d->capacity, 0);
+    d->slot_indexes.resize(d->capacity, -1);
+    d->slot_images.resize(d->capacity);
+
+#if NCNN_THREADS
+    for (int i = 0; i < num_threads; i++)
+    {
+        d->workers.push_back(new ncnn::Thread(ImageLoaderPrivate::decode_worker, d));
+    }
+#else
+    (void)num_threads;
+#endif
+}
+
+ImageLoader::~ImageLoader()
+{
+    // stop claiming new images and wait for the ones in flight
+    d->lock.lock();
+    d->next_index = (int)d->paths.size();
+    d->condition.broadcast();
+    d->lock.unlock();
+
+    for (size_t i = 0; i < d->workers.size(); i++)
+    {
+        d->workers[i]->join();
+        delete d->workers[i];
+    }
+
+    delete d;
+}
+
+int ImageLoader::size() const
+{
+    return (int)d->paths.size();
+}
+
+Mat ImageLoader::take(int index)
+{
+    if (index < 0 || index >= (int)d->paths.size())
+        return Mat();
+
+    if (d->workers.empty())
+    {
+        // no decode thread, decode in place
+        Mat img = imread(d->paths[index], d->flags);
+        if (!img.empty() && d->size.width > 0 && d->size.height > 0)
+        {
+            resize(img, img, d->size, 0.f, 0.f, d->interpolation);
+        }
+
+        return img;
+    }
+
+    const int slot = index % d->capacity;
+
+    d->lock.lock();
+    while (d->slot_states[slot] != 2 || d->slot_indexes[slot] != index)
+    {
+        d->condition.wait(d->lock);
+    }
+
+    Mat img = d->slot_images[slot];
+    d->slot_images[slot].release();
+    d->slot_states[slot] = 0;
+    d->condition.broadcast();
+    d->lock.unlock();
+
+    return img;
+}
 #endif // NCNN_PIXEL
 
 #if NCNN_PIXEL_DRAWING
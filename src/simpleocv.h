@@ -451,7 +451,40 @@ NCNN_EXPORT void imshow(const std::string& name, const Mat& m);
 NCNN_EXPORT int waitKey(int delay = 0);
 
 #if NCNN_PIXEL
-NCNN_EXPORT void resize(const Mat& src, Mat& dst, const Size& size, float sw = 0.f, float sh = 0.f, int flags = 0);
+enum InterpolationFlags
+{
+    INTER_NEAREST = 0,
+    INTER_LINEAR = 1,
+    INTER_CUBIC = 2,
+    INTER_AREA = 3
+};
+
+// INTER_NEAREST falls back to INTER_LINEAR
+NCNN_EXPORT void resize(const Mat& src, Mat& dst, const Size& size, float sw = 0.f, float sh = 0.f, int flags = INTER_LINEAR);
+
+class ImageLoaderPrivate;
+// decode a list of images on worker threads ahead of the consumer
+// decoded images wait in a ring of capacity slots, resized to size when size is not empty
+class NCNN_EXPORT ImageLoader
+{
+public:
+    ImageLoader(const std::vector<std::string>& paths, int flags = IMREAD_COLOR, int num_threads = 2, int capacity = 8, const Size& size = Size(), int interpolation = INTER_LINEAR);
+    ~ImageLoader();
+
+    // number of images
+    int size() const;
+
+    // block until image index is decoded and take it out of the ring, empty mat on decode failure
+    // take indexes in order, or from at most capacity consumers at once, each index exactly once
+    Mat take(int index);
+
+private:
+    ImageLoader(const ImageLoader&);
+    ImageLoader& operator=(const ImageLoader&);
+
+private:
+    ImageLoaderPrivate* const d;
+};
 #endif // NCNN_PIXEL
 
 #if NCNN_PIXEL_DRAWING
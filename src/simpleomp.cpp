@@ -6,6 +6,7 @@
 #if NCNN_SIMPLEOMP
 
 #include "simpleomp.h"
+#include "benchmark.h" // ncnn::get_current_time()
 #include "cpu.h" // ncnn::get_cpu_count()
 
 #include <stdio.h>
@@ -84,101 +85,147 @@ public:
 
     // finish status
     int* num_threads_to_wait;
-    Mutex* finish_lock;
-    ConditionVariable* finish_condition;
 };
 
-class KMPTaskQueue
+// seq_cst everywhere, the park and wake paths rely on store-load ordering
+static NCNN_FORCEINLINE int kmp_atomic_load(const int* addr)
+{
+    return __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+}
+
+static NCNN_FORCEINLINE void kmp_atomic_store(int* addr, int value)
+{
+    __atomic_store_n(addr, value, __ATOMIC_SEQ_CST);
+}
+
+static NCNN_FORCEINLINE int kmp_atomic_add(int* addr, int delta)
+{
+    return __atomic_fetch_add(addr, delta, __ATOMIC_SEQ_CST);
+}
+
+static NCNN_FORCEINLINE bool kmp_atomic_cas(int* addr, int expected, int desired)
+{
+    return __atomic_compare_exchange_n(addr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static NCNN_FORCEINLINE void kmp_cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+// one task slot per worker
+// the dispatcher claims an idle slot with cas, fills it and posts it
+// the worker spins on its own slot for blocktime and then parks on its own condition
+class KMPWorker
 {
 public:
-    KMPTaskQueue(int _max_size)
+    enum
     {
-        max_size = _max_size;
-        tasks = new KMPTask*[max_size];
-        size = 0;
-        front = 0;
-        back = 0;
-    }
+        IDLE = 0,
+        CLAIMED = 1,
+        POSTED = 2,
+        EXIT = 3
+    };
 
-    ~KMPTaskQueue()
+    KMPWorker()
     {
-        delete[] tasks;
+        state = IDLE;
+        parked = 0;
+        task = 0;
     }
 
-    void dispatch(KMPTask* v, int n)
+    bool try_post(KMPTask* v)
     {
-        lock.lock();
+        if (!kmp_atomic_cas(&state, IDLE, CLAIMED))
+            return false;
+
+        task = v;
+        kmp_atomic_store(&state, POSTED);
+
+        wake();
+        return true;
+    }
 
-        if (size + n > max_size)
+    void post_exit()
+    {
+        while (!kmp_atomic_cas(&state, IDLE, EXIT))
         {
-            lock.unlock();
+            kmp_cpu_relax();
+        }
 
-            for (int i = 0; i < n; i++)
+        wake();
+    }
+
+    // return 0 for exit
+    KMPTask* get(int blocktime)
+    {
+        int s = kmp_atomic_load(&state);
+        if (s < POSTED && blocktime > 0)
+        {
+            double deadline = 0;
+            for (int i = 1; s < POSTED; i++)
             {
-                put(&v[i]);
+                kmp_cpu_relax();
+                s = kmp_atomic_load(&state);
+
+                // check the clock once in a while
+                if (i % 1024 == 0)
+                {
+                    double now = get_current_time();
+                    if (deadline == 0)
+                        deadline = now + blocktime;
+                    else if (now > deadline)
+                        break;
+                }
             }
-            return;
         }
 
-        for (int i = 0; i < n; i++)
+        if (s < POSTED)
         {
-            tasks[back] = &v[i];
-            back++;
-            if (back == max_size)
-                back = 0;
+            lock.lock();
+            kmp_atomic_store(&parked, 1);
+            while ((s = kmp_atomic_load(&state)) < POSTED)
+            {
+                condition.wait(lock);
+            }
+            kmp_atomic_store(&parked, 0);
+            lock.unlock();
         }
 
-        size += n;
-
-        lock.unlock();
-
-        condition.signal();
+        return s == EXIT ? 0 : task;
     }
 
-    void put(KMPTask* v)
+    // accept the next task, the current one must not be touched after this
+    void done()
     {
-        lock.lock();
-        while (size >= max_size)
-        {
-            condition.wait(lock);
-        }
-        tasks[back] = v;
-        back++;
-        if (back == max_size)
-            back = 0;
-        size++;
-        lock.unlock();
-
-        condition.signal();
+        kmp_atomic_store(&state, IDLE);
     }
 
-    void get(KMPTask*& v)
+private:
+    void wake()
     {
-        lock.lock();
-        while (size == 0)
-        {
-            condition.wait(lock);
-        }
-        v = tasks[front];
-        front++;
-        if (front == max_size)
-            front = 0;
-        size--;
-        lock.unlock();
+        if (!kmp_atomic_load(&parked))
+            return;
 
+        lock.lock();
         condition.signal();
+        lock.unlock();
     }
 
 private:
+    int state;
+    int parked;
+    KMPTask* task;
+
     Mutex lock;
     ConditionVariable condition;
 
-    // ring buffer queue
-    int max_size;
-    KMPTask** tasks;
-    int size;
-    int front;
-    int back;
+    // avoid false sharing between neighbour slots
+    char padding[64];
 };
 
 class KMPGlobal
@@ -187,9 +234,11 @@ public:
     KMPGlobal()
     {
         kmp_max_threads = 0;
+        kmp_blocktime = 20;
         kmp_threads = 0;
         kmp_threads_tid = 0;
-        kmp_task_queue = 0;
+        kmp_workers = 0;
+        kmp_parked_masters = 0;
     }
 
     ~KMPGlobal()
@@ -210,10 +259,9 @@ public:
         // NCNN_LOGE("KMPGlobal init");
         kmp_max_threads = ncnn::get_cpu_count();
 
-        kmp_task_queue = new ncnn::KMPTaskQueue(std::max(kmp_max_threads * 4, 16));
-
         if (kmp_max_threads > 1)
         {
+            kmp_workers = new ncnn::KMPWorker[kmp_max_threads - 1];
             kmp_threads = new ncnn::Thread*[kmp_max_threads - 1];
             kmp_threads_tid = new int[kmp_max_threads - 1];
             for (int i = 0; i < kmp_max_threads - 1; i++)
@@ -229,28 +277,11 @@ public:
         // NCNN_LOGE("KMPGlobal deinit");
         if (kmp_max_threads > 1)
         {
-            // TODO portable stack allocation
-            ncnn::KMPTask* tasks = (ncnn::KMPTask*)alloca((kmp_max_threads - 1) * sizeof(ncnn::KMPTask));
             for (int i = 0; i < kmp_max_threads - 1; i++)
             {
-#if __clang__
-                tasks[i].fn = 0;
-                tasks[i].argc = 0;
-                tasks[i].argv = (void**)0;
-#else
-                tasks[i].fn = 0;
-                tasks[i].data = 0;
-#endif
-                tasks[i].num_threads = kmp_max_threads;
-                tasks[i].thread_num = i + 1;
-                tasks[i].num_threads_to_wait = 0;
-                tasks[i].finish_lock = 0;
-                tasks[i].finish_condition = 0;
+                kmp_workers[i].post_exit();
             }
 
-            // dispatch 1 ~ kmp_max_threads
-            kmp_task_queue->dispatch(tasks, kmp_max_threads - 1);
-
             for (int i = 0; i < kmp_max_threads - 1; i++)
             {
 #ifndef __EMSCRIPTEN__
@@ -263,16 +294,85 @@ public:
             }
             delete[] kmp_threads;
             delete[] kmp_threads_tid;
+            delete[] kmp_workers;
+        }
+
+        kmp_max_threads = 0;
+    }
+
+    // hand tasks to idle workers, return how many were taken
+    int dispatch(KMPTask* tasks, int n)
+    {
+        int posted = 0;
+        for (int i = 0; i < kmp_max_threads - 1 && posted < n; i++)
+        {
+            if (kmp_workers[i].try_post(&tasks[posted]))
+                posted++;
         }
 
-        delete kmp_task_queue;
+        return posted;
+    }
+
+    void finish(int* num_threads_to_wait)
+    {
+        if (kmp_atomic_add(num_threads_to_wait, -1) != 1)
+            return;
+
+        // only the globals are touched after the counter drops, the waiter may be gone already
+        if (kmp_atomic_load(&kmp_parked_masters) == 0)
+            return;
+
+        kmp_finish_lock.lock();
+        kmp_finish_condition.broadcast();
+        kmp_finish_lock.unlock();
+    }
+
+    void wait(int* num_threads_to_wait)
+    {
+        const int blocktime = kmp_atomic_load(&kmp_blocktime);
+
+        if (blocktime > 0)
+        {
+            double deadline = 0;
+            for (int i = 1; kmp_atomic_load(num_threads_to_wait) != 0; i++)
+            {
+                kmp_cpu_relax();
+
+                if (i % 1024 == 0)
+                {
+                    double now = get_current_time();
+                    if (deadline == 0)
+                        deadline = now + blocktime;
+                    else if (now > deadline)
+                        break;
+                }
+            }
+        }
+
+        if (kmp_atomic_load(num_threads_to_wait) == 0)
+            return;
+
+        kmp_finish_lock.lock();
+        kmp_atomic_add(&kmp_parked_masters, 1);
+        while (kmp_atomic_load(num_threads_to_wait) != 0)
+        {
+            kmp_finish_condition.wait(kmp_finish_lock);
+        }
+        kmp_atomic_add(&kmp_parked_masters, -1);
+        kmp_finish_lock.unlock();
     }
 
 public:
     int kmp_max_threads;
+    int kmp_blocktime;
     ncnn::Thread** kmp_threads;
     int* kmp_threads_tid;
-    ncnn::KMPTaskQueue* kmp_task_queue;
+    ncnn::KMPWorker* kmp_workers;
+
+    // masters sleeping for their team
+    int kmp_parked_masters;
+    ncnn::Mutex kmp_finish_lock;
+    ncnn::ConditionVariable kmp_finish_condition;
 };
 
 } // namespace ncnn
@@ -323,17 +423,19 @@ int omp_get_thread_num()
     return (int)reinterpret_cast<size_t>(tls_thread_num.get());
 }
 
-#if __clang__
 int kmp_get_blocktime()
 {
-    return 0;
+    return ncnn::kmp_atomic_load(&g_kmp_global.kmp_blocktime);
 }
 
-void kmp_set_blocktime(int /*blocktime*/)
+void kmp_set_blocktime(int blocktime)
 {
-    // always passive, ignore
+    // workers spin this many milliseconds for the next task before sleeping
+    ncnn::kmp_atomic_store(&g_kmp_global.kmp_blocktime, std::max(blocktime, 0));
 }
 
+#if __clang__
+
 static int kmp_invoke_microtask(kmpc_micro fn, int gtid, int tid, int argc, void** argv)
 {
     // fprintf(stderr, "__kmp_invoke_microtask %d %d %d\n", gtid, tid, argc);
@@ -447,20 +549,17 @@ static int kmp_invoke_microtask(kmpc_micro fn, int gtid, int tid, int argc, void
 
 static void* kmp_threadfunc(void* args)
 {
-#if __clang__
     int tid = *(int*)args;
-#else
-    (void)args;
-#endif
+
+    ncnn::KMPWorker& worker = g_kmp_global.kmp_workers[tid - 1];
 
     for (;;)
     {
-        ncnn::KMPTask* task;
-        g_kmp_global.kmp_task_queue->get(task);
+        ncnn::KMPTask* task = worker.get(kmp_get_blocktime());
 
         // fprintf(stderr, "get %d\n", tid);
 
-        if (!task->fn)
+        if (!task)
             break;
 
         tls_num_threads.set(reinterpret_cast<void*>((size_t)task->num_threads));
@@ -473,21 +572,34 @@ static void* kmp_threadfunc(void* args)
 #endif
 
         // update finished
-        {
-            task->finish_lock->lock();
-            *task->num_threads_to_wait = *task->num_threads_to_wait - 1;
-            if (*task->num_threads_to_wait == 0)
-            {
-                task->finish_condition->signal();
-            }
-            task->finish_lock->unlock();
-        }
+        int* num_threads_to_wait = task->num_threads_to_wait;
+        worker.done();
+        g_kmp_global.finish(num_threads_to_wait);
     }
 
     // fprintf(stderr, "exit\n");
     return 0;
 }
 
+// run the tasks no idle worker took on the calling thread
+static void kmp_run_remaining(ncnn::KMPTask* tasks, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        tls_thread_num.set(reinterpret_cast<void*>((size_t)tasks[i].thread_num));
+
+#if __clang__
+        kmp_invoke_microtask(tasks[i].fn, tasks[i].thread_num, 0, tasks[i].argc, tasks[i].argv);
+#else
+        tasks[i].fn(tasks[i].data);
+#endif
+
+        g_kmp_global.finish(tasks[i].num_threads_to_wait);
+    }
+
+    tls_thread_num.set(reinterpret_cast<void*>((size_t)0));
+}
+
 #if __clang__
 int32_t __kmpc_global_thread_num(void* /*loc*/)
 {
@@ -531,8 +643,6 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
     }
 
     int num_threads_to_wait = num_threads - 1;
-    ncnn::Mutex finish_lock;
-    ncnn::ConditionVariable finish_condition;
 
     // TODO portable stack allocation
     ncnn::KMPTask* tasks = (ncnn::KMPTask*)alloca((num_threads - 1) * sizeof(ncnn::KMPTask));
@@ -544,12 +654,10 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
         tasks[i].num_threads = num_threads;
         tasks[i].thread_num = i + 1;
         tasks[i].num_threads_to_wait = &num_threads_to_wait;
-        tasks[i].finish_lock = &finish_lock;
-        tasks[i].finish_condition = &finish_condition;
     }
 
     // dispatch 1 ~ num_threads
-    g_kmp_global.kmp_task_queue->dispatch(tasks, num_threads - 1);
+    int posted = g_kmp_global.dispatch(tasks, num_threads - 1);
 
     // dispatch 0
     {
@@ -559,15 +667,11 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
         kmp_invoke_microtask(fn, 0, 0, argc, argv);
     }
 
+    // all workers busy, possibly with other teams
+    kmp_run_remaining(tasks + posted, num_threads - 1 - posted);
+
     // wait for finished
-    {
-        finish_lock.lock();
-        if (num_threads_to_wait != 0)
-        {
-            finish_condition.wait(finish_lock);
-        }
-        finish_lock.unlock();
-    }
+    g_kmp_global.wait(&num_threads_to_wait);
 }
 
 void __kmpc_for_static_init_4(void* /*loc*/, int32_t gtid, int32_t /*sched*/, int32_t* last, int32_t* lower, int32_t* upper, int32_t* /*stride*/, int32_t /*incr*/, int32_t /*chunk*/)
@@ -646,8 +750,8 @@ static ncnn::ThreadLocalStorage tls_parallel_context;
 struct parallel_context
 {
     int num_threads_to_wait;
-    ncnn::Mutex finish_lock;
-    ncnn::ConditionVariable finish_condition;
+    int num_tasks;
+    int num_posted;
     ncnn::KMPTask* tasks;
 };
 
@@ -679,6 +783,7 @@ void GOMP_parallel_start(void (*fn)(void*), void* data, unsigned num_threads)
     tls_parallel_context.set(pc);
 
     pc->num_threads_to_wait = num_threads - 1;
+    pc->num_tasks = num_threads - 1;
 
     pc->tasks = new ncnn::KMPTask[num_threads - 1];
     for (unsigned i = 0; i < num_threads - 1; i++)
@@ -688,12 +793,10 @@ void GOMP_parallel_start(void (*fn)(void*), void* data, unsigned num_threads)
         pc->tasks[i].num_threads = num_threads;
         pc->tasks[i].thread_num = i + 1;
         pc->tasks[i].num_threads_to_wait = &pc->num_threads_to_wait;
-        pc->tasks[i].finish_lock = &pc->finish_lock;
-        pc->tasks[i].finish_condition = &pc->finish_condition;
     }
 
     // dispatch 1 ~ num_threads
-    g_kmp_global.kmp_task_queue->dispatch(pc->tasks, num_threads - 1);
+    pc->num_posted = g_kmp_global.dispatch(pc->tasks, num_threads - 1);
 
     // dispatch 0
     {
@@ -708,15 +811,14 @@ void GOMP_parallel_end()
     parallel_context* pc = (parallel_context*)tls_parallel_context.get();
     tls_parallel_context.set(0);
 
+    if (!pc)
+        return;
+
+    // all workers busy, possibly with other teams
+    kmp_run_remaining(pc->tasks + pc->num_posted, pc->num_tasks - pc->num_posted);
+
     // wait for finished
-    {
-        pc->finish_lock.lock();
-        if (pc->num_threads_to_wait != 0)
-        {
-            pc->finish_condition.wait(pc->finish_lock);
-        }
-        pc->finish_lock.unlock();
-    }
+    g_kmp_global.wait(&pc->num_threads_to_wait);
 
     delete[] pc->tasks;
     delete pc;
@@ -746,8 +848,6 @@ void GOMP_parallel(void (*fn)(void*), void* data, unsigned num_threads, unsigned
     }
 
     int num_threads_to_wait = num_threads - 1;
-    ncnn::Mutex finish_lock;
-    ncnn::ConditionVariable finish_condition;
 
     // TODO portable stack allocation
     ncnn::KMPTask* tasks = (ncnn::KMPTask*)alloca((num_threads - 1) * sizeof(ncnn::KMPTask));
@@ -758,12 +858,10 @@ void GOMP_parallel(void (*fn)(void*), void* data, unsigned num_threads, unsigned
         tasks[i].num_threads = num_threads;
         tasks[i].thread_num = i + 1;
         tasks[i].num_threads_to_wait = &num_threads_to_wait;
-        tasks[i].finish_lock = &finish_lock;
-        tasks[i].finish_condition = &finish_condition;
     }
 
     // dispatch 1 ~ num_threads
-    g_kmp_global.kmp_task_queue->dispatch(tasks, num_threads - 1);
+    int posted = g_kmp_global.dispatch(tasks, num_threads - 1);
 
     // dispatch 0
     {
@@ -773,15 +871,11 @@ void GOMP_parallel(void (*fn)(void*), void* data, unsigned num_threads, unsigned
         fn(data);
     }
 
+    // all workers busy, possibly with other teams
+    kmp_run_remaining(tasks + posted, num_threads - 1 - posted);
+
     // wait for finished
-    {
-        finish_lock.lock();
-        if (num_threads_to_wait != 0)
-        {
-            finish_condition.wait(finish_lock);
-        }
-        finish_lock.unlock();
-    }
+    g_kmp_global.wait(&num_threads_to_wait);
 }
 #endif // __clang__
 
@@ -0,0 +1,163 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "threadpool.h"
+
+namespace ncnn {
+
+// the pool whose lane is the calling thread
+static ThreadLocalStorage g_current_threadpool;
+
+class ThreadPoolPrivate
+{
+public:
+    CpuSet cpus;
+    int num_threads;
+
+    // one job at a time on the lane
+    Mutex run_lock;
+
+    Mutex lock;
+    ConditionVariable job_condition;
+    ConditionVariable done_condition;
+
+    // 0 = idle  1 = posted  2 = done
+    int state;
+    bool exit;
+
+    int (*func)(void*);
+    void* arg;
+    int ret;
+
+    Thread* thread;
+};
+
+static void* threadpool_lane(void* args)
+{
+    ThreadPoolPrivate* d = (ThreadPoolPrivate*)args;
+
+    g_current_threadpool.set(d);
+
+#if !NCNN_SIMPLEOMP
+    // this thread and the worker team it forks later stay on the cpu set
+    // simpleomp workers are shared by every lane and must not be repinned here
+    set_cpu_thread_affinity(d->cpus);
+#endif
+
+    set_omp_num_threads(d->num_threads);
+
+    d->lock.lock();
+    for (;;)
+    {
+        while (d->state != 1 && !d->exit)
+        {
+            d->job_condition.wait(d->lock);
+        }
+
+        if (d->state != 1)
+            break;
+
+        d->lock.unlock();
+
+        int ret = d->func(d->arg);
+
+        d->lock.lock();
+        d->ret = ret;
+        d->state = 2;
+        d->done_condition.signal();
+    }
+    d->lock.unlock();
+
+    return 0;
+}
+
+ThreadPool::ThreadPool(const CpuSet& cpus, int num_threads)
+    : d(new ThreadPoolPrivate)
+{
+    d->cpus = cpus;
+    d->num_threads = num_threads > 0 ? num_threads : cpus.num_enabled();
+    if (d->num_threads < 1)
+        d->num_threads = 1;
+
+    d->state = 0;
+    d->exit = false;
+    d->func = 0;
+    d->arg = 0;
+    d->ret = 0;
+
+#if NCNN_THREADS
+    d->thread = new Thread(threadpool_lane, (void*)d);
+#else
+    d->thread = 0;
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+    if (d->thread)
+    {
+        d->lock.lock();
+        d->exit = true;
+        d->job_condition.signal();
+        d->lock.unlock();
+
+        d->thread->join();
+        delete d->thread;
+    }
+
+    delete d;
+}
+
+ThreadPool::ThreadPool(const ThreadPool&)
+    : d(0)
+{
+}
+
+ThreadPool& ThreadPool::operator=(const ThreadPool&)
+{
+    return *this;
+}
+
+int ThreadPool::num_threads() const
+{
+    return d->num_threads;
+}
+
+const CpuSet& ThreadPool::cpus() const
+{
+    return d->cpus;
+}
+
+int ThreadPool::run(int (*func)(void*), void* arg)
+{
+    if (!d->thread || is_current())
+        return func(arg);
+
+    MutexLockGuard guard(d->run_lock);
+
+    d->lock.lock();
+
+    d->func = func;
+    d->arg = arg;
+    d->state = 1;
+    d->job_condition.signal();
+
+    while (d->state != 2)
+    {
+        d->done_condition.wait(d->lock);
+    }
+
+    int ret = d->ret;
+    d->state = 0;
+
+    d->lock.unlock();
+
+    return ret;
+}
+
+bool ThreadPool::is_current() const
+{
+    return g_current_threadpool.get() == (void*)d;
+}
+
+} // namespace ncnn
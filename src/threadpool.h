@@ -0,0 +1,47 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NCNN_THREADPOOL_H
+#define NCNN_THREADPOOL_H
+
+#include "cpu.h"
+#include "platform.h"
+
+namespace ncnn {
+
+class ThreadPoolPrivate;
+// a dedicated lane of threads pinned to a cpu set
+// work submitted with run() executes on the lane thread, so the parallel regions inside it
+// fan out to the worker team owned by that thread and never to the threads of other lanes
+// partition a large machine into several pools and bind one pool per extractor
+// with NCNN_SIMPLEOMP the worker threads are shared process wide and nothing is pinned
+class NCNN_EXPORT ThreadPool
+{
+public:
+    // num_threads 0 for one thread per enabled cpu in cpus
+    ThreadPool(const CpuSet& cpus, int num_threads = 0);
+    ~ThreadPool();
+
+    // the team size parallel regions should use on this pool
+    int num_threads() const;
+
+    const CpuSet& cpus() const;
+
+    // execute func(arg) on the lane thread and return its result
+    // concurrent callers are serialized, a call from the lane thread itself runs inline
+    int run(int (*func)(void*), void* arg);
+
+    // whether the calling thread is the lane thread of this pool
+    bool is_current() const;
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+private:
+    ThreadPoolPrivate* const d;
+};
+
+} // namespace ncnn
+
+#endif // NCNN_THREADPOOL_H
@@ -0,0 +1,351 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "benchmark.h"
+#include "datareader.h"
+#include "net.h"
+#include "platform.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+// two inputs and two outputs
+static int load_test_net(ncnn::Net& net)
+{
+    net.opt.num_threads = 1;
+
+    const char param_txt[] = "7767517\n5 6\nInput input0 0 1 data0\nInput input1 0 1 data1\nBinaryOp add 2 1 data0 data1 sum 0=0\nSplit split 1 2 sum sum0 sum1\nReLU relu 1 1 sum1 output1 0=1.000000e-01\n";
+
+    int ret = net.load_param_mem(param_txt);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+static float output0_value(int i, int k)
+{
+    return (float)(i - 3) + (float)k;
+}
+
+static float output1_value(int i, int k)
+{
+    float v = output0_value(i, k);
+    return v > 0.f ? v : v * 0.1f;
+}
+
+struct callback_state
+{
+    ncnn::Mutex lock;
+    int count;
+    int failed;
+};
+
+static void on_done(ncnn::AsyncRequest* request, void* userdata)
+{
+    callback_state* state = (callback_state*)userdata;
+
+    // outputs are ready when the callback runs
+    const bool ok = request->outputs().size() == 2 && !request->outputs()[0].empty();
+
+    state->lock.lock();
+    state->count++;
+    if (!ok)
+        state->failed++;
+    state->lock.unlock();
+}
+
+static int check_outputs(const ncnn::AsyncRequest& request, int i)
+{
+    const std::vector<ncnn::Mat>& outputs = request.outputs();
+    if (outputs.size() != 2 || outputs[0].w != 16 || outputs[1].w != 16)
+    {
+        fprintf(stderr, "test_async outputs shape mismatch for %d\n", i);
+        return -1;
+    }
+
+    for (int k = 0; k < 16; k++)
+    {
+        if (outputs[0][k] != output0_value(i, k) || outputs[1][k] != output1_value(i, k))
+        {
+            fprintf(stderr, "test_async outputs value mismatch for %d at %d  %f %f\n", i, k, outputs[0][k], outputs[1][k]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_async(int worker_count)
+{
+    ncnn::Net net;
+    net.set_async_worker_count(worker_count);
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_async load net failed\n");
+        return -1;
+    }
+
+    const int request_count = 16;
+
+    ncnn::AsyncRequest requests[request_count];
+
+    callback_state state;
+    state.count = 0;
+    state.failed = 0;
+
+    for (int r = 0; r < 2; r++)
+    {
+        // submit everything first, then collect
+        for (int i = 0; i < request_count; i++)
+        {
+            std::vector<ncnn::Mat> inputs(2);
+            inputs[0].create(16);
+            inputs[1].create(16);
+            for (int k = 0; k < 16; k++)
+            {
+                inputs[0][k] = (float)(i - 3);
+                inputs[1][k] = (float)k;
+            }
+
+            int ret = net.submit(inputs, requests[i], on_done, &state);
+            if (ret != 0)
+            {
+                fprintf(stderr, "test_async submit failed %d\n", ret);
+                return -1;
+            }
+        }
+
+        for (int i = 0; i < request_count; i++)
+        {
+            int ret = requests[i].wait();
+            if (ret != 0 || !requests[i].ready())
+            {
+                fprintf(stderr, "test_async wait failed %d\n", ret);
+                return -1;
+            }
+
+            if (check_outputs(requests[i], i) != 0)
+                return -1;
+        }
+    }
+
+    if (state.count != request_count * 2 || state.failed != 0)
+    {
+        fprintf(stderr, "test_async callback count %d failed %d\n", state.count, state.failed);
+        return -1;
+    }
+
+    // wrong input count is rejected
+    ncnn::AsyncRequest request;
+    std::vector<ncnn::Mat> inputs(1);
+    inputs[0].create(16);
+    if (net.submit(inputs, request) == 0)
+    {
+        fprintf(stderr, "test_async accepted wrong input count\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_async_1()
+{
+    // requests left in flight are finished before the net goes away
+    ncnn::AsyncRequest requests[8];
+
+    ncnn::Net net;
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_async load net failed\n");
+        return -1;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        std::vector<ncnn::Mat> inputs(2);
+        inputs[0].create(16);
+        inputs[1].create(16);
+        inputs[0].fill((float)(i - 3));
+        for (int k = 0; k < 16; k++)
+        {
+            inputs[1][k] = (float)k;
+        }
+
+        net.submit(inputs, requests[i]);
+    }
+
+    net.clear();
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (!requests[i].ready() || check_outputs(requests[i], i) != 0)
+        {
+            fprintf(stderr, "test_async request %d not finished by clear\n", i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void fill_inputs(std::vector<ncnn::Mat>& inputs, int i)
+{
+    inputs.resize(2);
+    inputs[0].create(16);
+    inputs[1].create(16);
+    inputs[0].fill((float)(i - 3));
+    for (int k = 0; k < 16; k++)
+    {
+        inputs[1][k] = (float)k;
+    }
+}
+
+static int test_async_2(int worker_count, int max_batch_size, float batch_window_ms)
+{
+    ncnn::Net net;
+    net.set_async_worker_count(worker_count);
+    net.set_async_batching(max_batch_size, batch_window_ms);
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_async load net failed\n");
+        return -1;
+    }
+
+    net.opt.num_threads = 2;
+
+    const int request_count = 19;
+
+    ncnn::AsyncRequest requests[request_count];
+
+    for (int i = 0; i < request_count; i++)
+    {
+        std::vector<ncnn::Mat> inputs;
+        fill_inputs(inputs, i);
+        net.submit(inputs, requests[i]);
+    }
+
+    for (int i = 0; i < request_count; i++)
+    {
+        int ret = requests[i].wait();
+        if (ret != 0 || check_outputs(requests[i], i) != 0)
+        {
+            fprintf(stderr, "test_async batched request %d failed %d  batch %d window %f\n", i, ret, max_batch_size, batch_window_ms);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+struct gate_state
+{
+    ncnn::Mutex lock;
+    ncnn::ConditionVariable condition;
+    bool open;
+};
+
+static void on_done_wait_gate(ncnn::AsyncRequest* /*request*/, void* userdata)
+{
+    gate_state* gate = (gate_state*)userdata;
+
+    gate->lock.lock();
+    while (!gate->open)
+    {
+        gate->condition.wait(gate->lock);
+    }
+    gate->lock.unlock();
+}
+
+static int test_async_3()
+{
+#if !NCNN_THREADS
+    // submit runs in place, nothing waits in the queue
+    return 0;
+#endif
+
+    ncnn::Net net;
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_async load net failed\n");
+        return -1;
+    }
+
+    gate_state gate;
+    gate.open = false;
+
+    ncnn::AsyncRequest requests[3];
+
+    std::vector<ncnn::Mat> inputs;
+    fill_inputs(inputs, 0);
+
+    // the only worker stays busy in the callback of the first request
+    net.submit(inputs, requests[0], on_done_wait_gate, &gate);
+
+    // so this one can not start in time
+    requests[1].set_deadline(0.001f);
+    net.submit(inputs, requests[1]);
+
+    // and this one has all the time
+    requests[2].set_deadline(60000.f);
+    net.submit(inputs, requests[2]);
+
+    const double start = ncnn::get_current_time();
+    while (ncnn::get_current_time() - start < 2.0)
+    {
+    }
+
+    gate.lock.lock();
+    gate.open = true;
+    gate.condition.broadcast();
+    gate.lock.unlock();
+
+    if (requests[0].wait() != 0 || check_outputs(requests[0], 0) != 0)
+    {
+        fprintf(stderr, "test_async request without deadline failed\n");
+        return -1;
+    }
+
+    if (requests[1].wait() != -1 || !requests[1].outputs().empty())
+    {
+        fprintf(stderr, "test_async late request was not dropped\n");
+        return -1;
+    }
+
+    if (requests[2].wait() != 0 || check_outputs(requests[2], 0) != 0)
+    {
+        fprintf(stderr, "test_async request within deadline failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main()
+{
+    return 0
+           || test_async(1)
+           || test_async(3)
+           || test_async_1()
+           || test_async_2(1, 4, 0.f)
+           || test_async_2(1, 4, 5.f)
+           || test_async_2(2, 8, 1.f)
+           || test_async_3();
+}
@@ -436,6 +436,54 @@ static int test_convolution_1_2()
 }
 #endif // NCNN_INT8
 
+static int test_convolution_schedule(int w, int h, int c, int outch, int kernel, int stride, int parallel_schedule)
+{
+    ncnn::Mat a = RandomMat(w, h, c);
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, kernel);
+    pd.set(2, 1);
+    pd.set(3, stride);
+    pd.set(4, 0);
+    pd.set(5, 1);
+    pd.set(6, outch * c * kernel * kernel);
+
+    std::vector<ncnn::Mat> weights(2);
+    weights[0] = RandomMat(outch * c * kernel * kernel);
+    weights[1] = RandomMat(outch);
+
+    // im2col gemm with enough threads and tiles for the schedule to matter
+    ncnn::Option opt;
+    opt.num_threads = 4;
+    opt.use_sgemm_convolution = true;
+    opt.use_winograd_convolution = false;
+    opt.parallel_schedule = parallel_schedule;
+
+    int ret = test_layer_opt("Convolution", pd, weights, opt, a);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_convolution_schedule failed w=%d h=%d c=%d outch=%d kernel=%d stride=%d parallel_schedule=%d\n", w, h, c, outch, kernel, stride, parallel_schedule);
+    }
+
+    return ret;
+}
+
+static int test_convolution_4()
+{
+    for (int s = 0; s < 4; s++)
+    {
+        int ret = 0
+                  || test_convolution_schedule(13, 11, 32, 100, 1, 1, s)
+                  || test_convolution_schedule(15, 9, 24, 56, 3, 2, s);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 int main()
 {
     SRAND(7767517);
@@ -445,10 +493,12 @@ int main()
            || test_convolution_1()
            || test_convolution_1_2()
            || test_convolution_2()
-           || test_convolution_3();
+           || test_convolution_3()
+           || test_convolution_4();
 #else
     return 0
            || test_convolution_2()
-           || test_convolution_3();
+           || test_convolution_3()
+           || test_convolution_4();
 #endif
 }
@@ -2,9 +2,16 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "cpu.h"
 
+#if defined __ANDROID__ || defined __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #if defined __ANDROID__ || defined __linux__ || defined __APPLE__
 
 static int test_cpu_set()
@@ -104,6 +111,104 @@ static int test_cpu_powersave()
     }
 }
 
+static int write_sysfs_file(const char* root, const char* name, const char* content)
+{
+    char path[256];
+    sprintf(path, "%s/%s", root, name);
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+        return -1;
+
+    fputs(content, fp);
+    fclose(fp);
+    return 0;
+}
+
+static int test_cpu_numa()
+{
+    if (ncnn::get_numa_node_count() < 1)
+    {
+        fprintf(stderr, "There must be at least one numa node\n");
+        return 1;
+    }
+
+    // fake dual socket machine, node 1 is memory only and node 2 holds cpus 2-3 and 6
+    char root[] = "/tmp/ncnn_test_numa_XXXXXX";
+    if (!mkdtemp(root))
+    {
+        fprintf(stderr, "mkdtemp failed\n");
+        return 1;
+    }
+
+    char path[256];
+    const char* nodes[3] = {"node0", "node1", "node2"};
+    for (int i = 0; i < 3; i++)
+    {
+        sprintf(path, "%s/%s", root, nodes[i]);
+        mkdir(path, 0755);
+    }
+
+    write_sysfs_file(root, "online", "0-2\n");
+    write_sysfs_file(root, "node0/cpulist", "0-1,4-5\n");
+    write_sysfs_file(root, "node1/cpulist", "\n");
+    write_sysfs_file(root, "node2/cpulist", "2-3,6\n");
+
+    ncnn::reload_numa_topology(root);
+
+    int ret = 0;
+    if (ncnn::get_numa_node_count() != 2)
+    {
+        fprintf(stderr, "fake numa node count %d\n", ncnn::get_numa_node_count());
+        ret = 1;
+    }
+    else
+    {
+        const ncnn::CpuSet& mask0 = ncnn::get_numa_node_affinity_mask(0);
+        const ncnn::CpuSet& mask1 = ncnn::get_numa_node_affinity_mask(1);
+        if (mask0.num_enabled() != 4 || !mask0.is_enabled(5) || mask0.is_enabled(2)
+                || mask1.num_enabled() != 3 || !mask1.is_enabled(6) || mask1.is_enabled(4))
+        {
+            fprintf(stderr, "fake numa node cpus mismatch\n");
+            ret = 1;
+        }
+
+        if (ncnn::get_cpu_numa_node(4) != 0 || ncnn::get_cpu_numa_node(3) != 1 || ncnn::get_cpu_numa_node(7) != -1)
+        {
+            fprintf(stderr, "fake numa cpu node mismatch\n");
+            ret = 1;
+        }
+    }
+
+    for (int i = 2; i >= 0; i--)
+    {
+        sprintf(path, "%s/%s/cpulist", root, nodes[i]);
+        unlink(path);
+        sprintf(path, "%s/%s", root, nodes[i]);
+        rmdir(path);
+    }
+    sprintf(path, "%s/online", root);
+    unlink(path);
+    rmdir(root);
+
+    // back to the real machine
+    ncnn::reload_numa_topology();
+
+    if (ncnn::get_numa_node_count() < 1 || ncnn::get_cpu_numa_node(0) == -1)
+    {
+        fprintf(stderr, "numa topology not restored\n");
+        ret = 1;
+    }
+
+    if (ncnn::set_numa_memory_policy(-3) != -1)
+    {
+        fprintf(stderr, "invalid numa memory policy accepted\n");
+        ret = 1;
+    }
+
+    return ret;
+}
+
 #else
 
 #if defined _WIN32
@@ -149,6 +254,11 @@ static int test_cpu_powersave()
     return 0;
 }
 
+static int test_cpu_numa()
+{
+    return ncnn::get_numa_node_count() == 1 ? 0 : 1;
+}
+
 #endif
 
 int main()
@@ -157,5 +267,6 @@ int main()
            || test_cpu_set()
            || test_cpu_info()
            || test_cpu_omp()
-           || test_cpu_powersave();
+           || test_cpu_powersave()
+           || test_cpu_numa();
 }
@@ -0,0 +1,290 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "testutil.h"
+
+#include "detection.h"
+
+#include <float.h>
+#include <math.h>
+
+static std::vector<ncnn::Detection> RandomDetections(int n, int num_class)
+{
+    std::vector<ncnn::Detection> objects(n);
+    for (int i = 0; i < n; i++)
+    {
+        ncnn::Detection& obj = objects[i];
+        obj.xmin = RandomFloat(0.f, 100.f);
+        obj.ymin = RandomFloat(0.f, 100.f);
+        obj.xmax = obj.xmin + RandomFloat(1.f, 30.f);
+        obj.ymax = obj.ymin + RandomFloat(1.f, 30.f);
+        // coarse scores so that ties happen
+        obj.score = (RAND() % 200) / 200.f;
+        obj.label = RAND() % num_class;
+    }
+
+    return objects;
+}
+
+static void nms_sorted_detections_naive(const std::vector<ncnn::Detection>& objects, std::vector<int>& picked, float iou_threshold, int class_agnostic)
+{
+    picked.clear();
+
+    for (int i = 0; i < (int)objects.size(); i++)
+    {
+        const ncnn::Detection& a = objects[i];
+
+        int keep = 1;
+        for (size_t j = 0; j < picked.size(); j++)
+        {
+            const ncnn::Detection& b = objects[picked[j]];
+            if (!class_agnostic && a.label != b.label)
+                continue;
+
+            float inter_width = std::max(std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin), 0.f);
+            float inter_height = std::max(std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin), 0.f);
+            float inter_area = inter_width * inter_height;
+            float union_area = (a.xmax - a.xmin) * (a.ymax - a.ymin) + (b.xmax - b.xmin) * (b.ymax - b.ymin) - inter_area;
+            if (inter_area / union_area > iou_threshold)
+                keep = 0;
+        }
+
+        if (keep)
+            picked.push_back(i);
+    }
+}
+
+static int test_detection_threshold(int n, int stride)
+{
+    std::vector<float> scores(n * stride);
+    for (size_t i = 0; i < scores.size(); i++)
+    {
+        scores[i] = RandomFloat(0.f, 1.f);
+    }
+
+    std::vector<int> indexes;
+    int count = ncnn::threshold_scores(scores.data(), n, stride, 0.8f, indexes);
+
+    std::vector<int> ref;
+    for (int i = 0; i < n; i++)
+    {
+        if (scores[i * stride] > 0.8f)
+            ref.push_back(i);
+    }
+
+    if (count != (int)ref.size() || indexes != ref)
+    {
+        fprintf(stderr, "test_detection_threshold failed n=%d stride=%d\n", n, stride);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_detection_argmax(int num_class, int n)
+{
+    ncnn::Mat scores(n, 1, num_class);
+    for (int q = 0; q < num_class; q++)
+    {
+        float* ptr = scores.channel(q);
+        for (int j = 0; j < n; j++)
+        {
+            // coarse scores so that the first max must win on ties
+            ptr[j] = (RAND() % 16) / 16.f;
+        }
+    }
+
+    std::vector<int> labels(n);
+    std::vector<float> max_scores(n);
+    ncnn::argmax_scores(scores, num_class, scores.cstep, n, labels.data(), max_scores.data());
+
+    for (int j = 0; j < n; j++)
+    {
+        int label = 0;
+        float max_score = -FLT_MAX;
+        for (int q = 0; q < num_class; q++)
+        {
+            const float s = scores.channel(q)[j];
+            if (s > max_score)
+            {
+                label = q;
+                max_score = s;
+            }
+        }
+
+        if (labels[j] != label || max_scores[j] != max_score)
+        {
+            fprintf(stderr, "test_detection_argmax failed num_class=%d n=%d at %d\n", num_class, n, j);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_detection_decode(int n, int variance_step)
+{
+    std::vector<float> locations(n * 4);
+    std::vector<float> priors(n * 4);
+    std::vector<float> variances(variance_step ? n * 4 : 4);
+    for (int i = 0; i < n * 4; i++)
+    {
+        locations[i] = RandomFloat(-1.f, 1.f);
+        priors[i] = RandomFloat(0.f, 0.5f) + (i % 4 >= 2 ? 0.5f : 0.f);
+    }
+    for (size_t i = 0; i < variances.size(); i++)
+    {
+        variances[i] = RandomFloat(0.1f, 0.2f);
+    }
+
+    std::vector<float> boxes(n * 4);
+    ncnn::decode_center_size(locations.data(), priors.data(), variances.data(), variance_step, n, boxes.data());
+
+    for (int i = 0; i < n; i++)
+    {
+        const float* loc = &locations[i * 4];
+        const float* pb = &priors[i * 4];
+        const float* var = &variances[i * variance_step];
+
+        const float pb_w = pb[2] - pb[0];
+        const float pb_h = pb[3] - pb[1];
+        const float cx = var[0] * loc[0] * pb_w + (pb[0] + pb[2]) * 0.5f;
+        const float cy = var[1] * loc[1] * pb_h + (pb[1] + pb[3]) * 0.5f;
+        const float w = expf(var[2] * loc[2]) * pb_w;
+        const float h = expf(var[3] * loc[3]) * pb_h;
+
+        const float ref[4] = {cx - w * 0.5f, cy - h * 0.5f, cx + w * 0.5f, cy + h * 0.5f};
+        for (int k = 0; k < 4; k++)
+        {
+            if (fabs(boxes[i * 4 + k] - ref[k]) > 1e-5)
+            {
+                fprintf(stderr, "test_detection_decode failed n=%d variance_step=%d at %d\n", n, variance_step, i);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_detection_topk(int n, int k)
+{
+    std::vector<ncnn::Detection> objects = RandomDetections(n, 3);
+
+    std::vector<ncnn::Detection> sorted = objects;
+    ncnn::sort_detections(sorted);
+
+    std::vector<ncnn::Detection> topk = objects;
+    ncnn::topk_detections(topk, k);
+
+    const int expected = std::min(k, n);
+    if ((int)topk.size() != expected)
+    {
+        fprintf(stderr, "test_detection_topk size failed n=%d k=%d\n", n, k);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (i > 0 && sorted[i].score > sorted[i - 1].score)
+        {
+            fprintf(stderr, "test_detection_topk sort failed n=%d at %d\n", n, i);
+            return -1;
+        }
+
+        // ties may come in any order, the scores must match
+        if (i < expected && topk[i].score != sorted[i].score)
+        {
+            fprintf(stderr, "test_detection_topk failed n=%d k=%d at %d\n", n, k, i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_detection_nms(int n, int num_class, float iou_threshold, int class_agnostic)
+{
+    std::vector<ncnn::Detection> objects = RandomDetections(n, num_class);
+    ncnn::sort_detections(objects);
+
+    std::vector<int> picked;
+    ncnn::nms_sorted_detections(objects, picked, iou_threshold, class_agnostic);
+
+    std::vector<int> ref;
+    nms_sorted_detections_naive(objects, ref, iou_threshold, class_agnostic);
+
+    if (picked != ref)
+    {
+        fprintf(stderr, "test_detection_nms failed n=%d num_class=%d iou_threshold=%f class_agnostic=%d\n", n, num_class, iou_threshold, class_agnostic);
+        return -1;
+    }
+
+    // max_picked stops early with the same leading picks
+    std::vector<int> picked3;
+    ncnn::nms_sorted_detections(objects, picked3, iou_threshold, class_agnostic, 3);
+    if ((int)picked3.size() != std::min((int)ref.size(), 3) || !std::equal(picked3.begin(), picked3.end(), ref.begin()))
+    {
+        fprintf(stderr, "test_detection_nms max_picked failed n=%d num_class=%d\n", n, num_class);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_detection_0()
+{
+    return 0
+           || test_detection_threshold(1, 1)
+           || test_detection_threshold(37, 1)
+           || test_detection_threshold(1000, 1)
+           || test_detection_threshold(101, 21);
+}
+
+static int test_detection_1()
+{
+    return 0
+           || test_detection_argmax(1, 5)
+           || test_detection_argmax(80, 13)
+           || test_detection_argmax(20, 64);
+}
+
+static int test_detection_2()
+{
+    return 0
+           || test_detection_decode(19, 0)
+           || test_detection_decode(19, 4);
+}
+
+static int test_detection_3()
+{
+    return 0
+           || test_detection_topk(0, 5)
+           || test_detection_topk(1, 5)
+           || test_detection_topk(100, 7)
+           || test_detection_topk(1000, 300)
+           || test_detection_topk(50, 50);
+}
+
+static int test_detection_4()
+{
+    return 0
+           || test_detection_nms(0, 1, 0.45f, 1)
+           || test_detection_nms(7, 1, 0.45f, 1)
+           || test_detection_nms(300, 1, 0.45f, 1)
+           || test_detection_nms(300, 5, 0.3f, 0)
+           || test_detection_nms(1000, 20, 0.5f, 0)
+           || test_detection_nms(1000, 20, 0.7f, 1);
+}
+
+int main()
+{
+    SRAND(7767517);
+
+    return 0
+           || test_detection_0()
+           || test_detection_1()
+           || test_detection_2()
+           || test_detection_3()
+           || test_detection_4();
+}
@@ -0,0 +1,291 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "datareader.h"
+#include "net.h"
+#include "platform.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+// relu consumes the input blob in place
+static int load_test_net(ncnn::Net& net, int use_bf16_storage)
+{
+    net.opt.num_threads = 2;
+    net.opt.use_bf16_storage = use_bf16_storage;
+
+    const char param_txt[] = "7767517\n3 3\nInput input 0 1 data\nReLU relu 1 1 data relu 0=1.000000e-01\nAbsVal absval 1 1 relu output\n";
+
+    int ret = net.load_param_mem(param_txt);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+static float reference(float v)
+{
+    return fabs(v > 0.f ? v : v * 0.1f);
+}
+
+static int test_extractor(int w, int h, int c, int cstep_pad, int use_bf16_storage)
+{
+    ncnn::Net net;
+    if (load_test_net(net, use_bf16_storage) != 0)
+    {
+        fprintf(stderr, "test_extractor load net failed\n");
+        return -1;
+    }
+
+    const float tolerance = use_bf16_storage ? 0.02f : 0.f;
+
+    // caller owned input with loose channel stride and a guard value between channels
+    const size_t cstep = (size_t)w * h + cstep_pad;
+    std::vector<float> input(cstep * c);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = (i % cstep) < (size_t)w * h ? (float)((int)(i * 7 % 23) - 11) : 1234.f;
+    }
+    const std::vector<float> input_copy = input;
+
+    std::vector<float> output(cstep * c, -1.f);
+
+    {
+        ncnn::Mat in = ncnn::Mat::from_external(input.data(), w, h, c, cstep);
+        ncnn::Mat out = ncnn::Mat::from_external(output.data(), w, h, c, cstep);
+
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input("data", in);
+
+        int ret = ex.extract_to("output", out);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_extractor extract_to failed %d\n", ret);
+            return -1;
+        }
+
+        // the mat header still points at the caller buffer
+        if (out.data != output.data() || out.cstep != cstep)
+        {
+            fprintf(stderr, "test_extractor extract_to reallocated\n");
+            return -1;
+        }
+    }
+
+    if (input != input_copy)
+    {
+        fprintf(stderr, "test_extractor input written w=%d h=%d c=%d\n", w, h, c);
+        return -1;
+    }
+
+    for (int q = 0; q < c; q++)
+    {
+        for (size_t i = 0; i < cstep; i++)
+        {
+            const float v = output[q * cstep + i];
+            if (i >= (size_t)w * h)
+            {
+                // padding untouched
+                if (v != -1.f)
+                {
+                    fprintf(stderr, "test_extractor padding written w=%d h=%d c=%d at %d %d\n", w, h, c, q, (int)i);
+                    return -1;
+                }
+                continue;
+            }
+
+            const float r = reference(input[q * cstep + i]);
+            if (fabs(v - r) > tolerance * fabs(r) + tolerance)
+            {
+                fprintf(stderr, "test_extractor value mismatch w=%d h=%d c=%d bf16=%d at %d %d  %f %f\n", w, h, c, use_bf16_storage, q, (int)i, v, r);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_extractor_0()
+{
+    return 0
+           || test_extractor(5, 7, 3, 3, 0)
+           || test_extractor(5, 7, 16, 1, 0)
+           || test_extractor(13, 1, 24, 5, 0)
+           || test_extractor(6, 6, 8, 0, 0)
+           || test_extractor(5, 7, 16, 1, 1);
+}
+
+static int test_extractor_1()
+{
+    ncnn::Net net;
+    if (load_test_net(net, 0) != 0)
+    {
+        fprintf(stderr, "test_extractor load net failed\n");
+        return -1;
+    }
+
+    // 1d blob is packed along w
+    std::vector<float> input(24);
+    for (int i = 0; i < 24; i++)
+    {
+        input[i] = (float)(i - 12);
+    }
+
+    std::vector<float> output(24);
+
+    ncnn::Mat in(24, input.data());
+    ncnn::Mat out(24, output.data());
+
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("data", in);
+
+    if (ex.extract_to("output", out) != 0)
+    {
+        fprintf(stderr, "test_extractor 1d extract_to failed\n");
+        return -1;
+    }
+
+    for (int i = 0; i < 24; i++)
+    {
+        if (output[i] != reference(input[i]))
+        {
+            fprintf(stderr, "test_extractor 1d value mismatch at %d\n", i);
+            return -1;
+        }
+    }
+
+    // wrong shape is rejected
+    std::vector<float> small(24);
+    ncnn::Mat wrong(4, 6, small.data());
+    if (ex.extract_to("output", wrong) == 0)
+    {
+        fprintf(stderr, "test_extractor accepted a wrong shape\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+struct worker_args
+{
+    const ncnn::Net* net;
+    int seed;
+    ncnn::Mat in;
+    ncnn::Mat out;
+    int ret;
+};
+
+static void* worker(void* args)
+{
+    worker_args* a = (worker_args*)args;
+
+    a->ret = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        a->in.create(8, 8, 4);
+        for (int k = 0; k < (int)a->in.total(); k++)
+        {
+            a->in[k] = (float)((k + i + a->seed) % 19 - 9);
+        }
+
+        ncnn::Extractor ex = a->net->create_extractor();
+        ex.input("data", a->in);
+
+        // a copy made before forward runs on its own
+        ncnn::Extractor ex2 = ex;
+
+        ncnn::Mat out2;
+        if (ex.extract("output", a->out) != 0 || ex2.extract("output", out2) != 0)
+        {
+            a->ret = -1;
+            break;
+        }
+
+        for (int k = 0; k < (int)a->in.total(); k++)
+        {
+            if (a->out[k] != reference(a->in[k]) || out2[k] != a->out[k])
+            {
+                a->ret = -1;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_extractor_2()
+{
+    // extractors created and destroyed concurrently reuse cached state and per thread pools
+    worker_args args[4];
+
+    {
+        ncnn::Net net;
+        if (load_test_net(net, 0) != 0)
+        {
+            fprintf(stderr, "test_extractor load net failed\n");
+            return -1;
+        }
+
+        std::vector<ncnn::Thread*> threads(4);
+        for (int i = 0; i < 4; i++)
+        {
+            args[i].net = &net;
+            args[i].seed = i * 5;
+            threads[i] = new ncnn::Thread(worker, &args[i]);
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            threads[i]->join();
+            delete threads[i];
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (args[i].ret != 0)
+        {
+            fprintf(stderr, "test_extractor concurrent worker %d failed\n", i);
+            return -1;
+        }
+
+        // outputs outlive the net and its pools
+        for (int k = 0; k < (int)args[i].in.total(); k++)
+        {
+            if (args[i].out[k] != reference(args[i].in[k]))
+            {
+                fprintf(stderr, "test_extractor output of worker %d lost after net destroyed\n", i);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main()
+{
+    return 0
+           || test_extractor_0()
+           || test_extractor_1()
+           || test_extractor_2();
+}
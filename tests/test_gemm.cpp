@@ -234,6 +234,60 @@ static int test_gemm_1(int M, int N, int K)
            || test_gemm_bias(M, N, K, RandomMat(N), 3.1f, 0.6f, 0, 1, 0, 1, 1, 1);
 }
 
+static int test_gemm_schedule(int M, int N, int K, int transA, int constantA, int parallel_schedule)
+{
+    ncnn::ParamDict pd;
+    pd.set(0, 1.f); // alpha
+    pd.set(1, 1.f); // beta
+    pd.set(2, transA);
+    pd.set(3, 0); // transB
+    pd.set(4, constantA);
+    pd.set(5, 0); // constantB
+    pd.set(6, 1);
+    pd.set(7, M);
+    pd.set(8, N);
+    pd.set(9, K);
+    pd.set(10, -1);
+
+    std::vector<ncnn::Mat> weights;
+    std::vector<ncnn::Mat> a;
+    if (constantA)
+        weights.push_back(transA ? RandomMat(M, K) : RandomMat(K, M));
+    else
+        a.push_back(transA ? RandomMat(M, K) : RandomMat(K, M));
+    a.push_back(RandomMat(N, K));
+
+    // enough threads and tiles for the schedule to matter
+    ncnn::Option opt;
+    opt.num_threads = 4;
+    opt.parallel_schedule = parallel_schedule;
+
+    int ret = test_layer_opt("Gemm", pd, weights, opt, a);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_gemm_schedule failed M=%d N=%d K=%d transA=%d constantA=%d parallel_schedule=%d\n", M, N, K, transA, constantA, parallel_schedule);
+    }
+
+    return ret;
+}
+
+static int test_gemm_2()
+{
+    for (int s = 0; s < 4; s++)
+    {
+        int ret = 0
+                  || test_gemm_schedule(97, 35, 40, 0, 0, s)
+                  || test_gemm_schedule(97, 35, 40, 1, 1, s)
+                  || test_gemm_schedule(130, 17, 9, 0, 1, s)
+                  || test_gemm_schedule(3, 64, 31, 1, 0, s);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 int main()
 {
     SRAND(7767517);
@@ -292,5 +346,5 @@ int main()
             return ret;
     }
 
-    return 0;
+    return test_gemm_2();
 }
@@ -545,6 +545,51 @@ static int test_gru_7()
 }
 #endif
 
+static int test_gru_threads(int size, int T, int outch, int direction, int num_threads)
+{
+    ncnn::Mat a = RandomMat(size, T);
+    int num_directions = direction == 2 ? 2 : 1;
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, outch * size * 3 * num_directions);
+    pd.set(2, direction);
+
+    std::vector<ncnn::Mat> weights(3);
+    weights[0] = RandomMat(outch * size * 3 * num_directions);
+    weights[1] = RandomMat(outch * 4 * num_directions);
+    weights[2] = RandomMat(outch * outch * 3 * num_directions);
+
+    // initial hidden state
+    ncnn::Mat hidden = RandomMat(outch, num_directions, -1.f, 1.f);
+
+    std::vector<ncnn::Mat> as(2);
+    as[0] = a;
+    as[1] = hidden;
+
+    // one team across all timesteps, split between directions
+    ncnn::Option opt;
+    opt.num_threads = num_threads;
+
+    int ret = test_layer_opt("GRU", pd, weights, opt, as, 2);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_gru_threads failed size=%d T=%d outch=%d direction=%d num_threads=%d\n", size, T, outch, direction, num_threads);
+    }
+
+    return ret;
+}
+
+static int test_gru_8()
+{
+    return 0
+           || test_gru_threads(16, 8, 7, 0, 4)
+           || test_gru_threads(5, 33, 16, 1, 3)
+           || test_gru_threads(19, 15, 8, 2, 2)
+           || test_gru_threads(3, 16, 17, 2, 4)
+           || test_gru_threads(2, 5, 3, 2, 5);
+}
+
 int main()
 {
     SRAND(7767517);
@@ -558,12 +603,14 @@ int main()
            || test_gru_4()
            || test_gru_5()
            || test_gru_6()
-           || test_gru_7();
+           || test_gru_7()
+           || test_gru_8();
 #else
     return 0
            || test_gru_0()
            || test_gru_1()
            || test_gru_2()
-           || test_gru_3();
+           || test_gru_3()
+           || test_gru_8();
 #endif
 }
@@ -639,6 +639,62 @@ static int test_lstm_7()
 }
 #endif
 
+static int test_lstm_threads(int size, int T, int outch, int direction, int hidden_size, int num_threads)
+{
+    ncnn::Mat a = RandomMat(size, T);
+    int num_directions = direction == 2 ? 2 : 1;
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, hidden_size * size * 4 * num_directions);
+    pd.set(2, direction);
+    pd.set(3, hidden_size);
+
+    std::vector<ncnn::Mat> weights(hidden_size == outch ? 3 : 4);
+    weights[0] = RandomMat(hidden_size * size * 4 * num_directions);
+    weights[1] = RandomMat(hidden_size * 4 * num_directions);
+    weights[2] = RandomMat(outch * hidden_size * 4 * num_directions);
+    if (hidden_size != outch)
+    {
+        weights[3] = RandomMat(hidden_size * outch * num_directions);
+    }
+
+    // initial hidden state
+    ncnn::Mat hidden = RandomMat(outch, num_directions);
+
+    // initial cell state
+    ncnn::Mat cell = RandomMat(hidden_size, num_directions);
+
+    std::vector<ncnn::Mat> as(3);
+    as[0] = a;
+    as[1] = hidden;
+    as[2] = cell;
+
+    // one team across all timesteps, split between directions
+    ncnn::Option opt;
+    opt.num_threads = num_threads;
+
+    int ret = test_layer_opt("LSTM", pd, weights, opt, as, 3);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_lstm_threads failed size=%d T=%d outch=%d direction=%d hidden_size=%d num_threads=%d\n", size, T, outch, direction, hidden_size, num_threads);
+    }
+
+    return ret;
+}
+
+static int test_lstm_8()
+{
+    return 0
+           || test_lstm_threads(16, 8, 7, 0, 7, 4)
+           || test_lstm_threads(5, 33, 16, 1, 16, 3)
+           || test_lstm_threads(19, 15, 8, 2, 8, 2)
+           || test_lstm_threads(3, 16, 17, 2, 17, 4)
+           || test_lstm_threads(8, 12, 13, 2, 19, 4)
+           || test_lstm_threads(4, 9, 16, 0, 5, 3)
+           || test_lstm_threads(2, 5, 3, 2, 3, 5);
+}
+
 int main()
 {
     SRAND(7767517);
@@ -652,12 +708,14 @@ int main()
            || test_lstm_4()
            || test_lstm_5()
            || test_lstm_6()
-           || test_lstm_7();
+           || test_lstm_7()
+           || test_lstm_8();
 #else
     return 0
            || test_lstm_0()
            || test_lstm_1()
            || test_lstm_2()
-           || test_lstm_3();
+           || test_lstm_3()
+           || test_lstm_8();
 #endif
 }
@@ -0,0 +1,164 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "testutil.h"
+
+#include <math.h>
+
+static void mean_normalize_naive(ncnn::Mat& m, const float* mean_vals, const float* norm_vals)
+{
+    for (int q = 0; q < m.c; q++)
+    {
+        float* ptr = m.channel(q);
+        for (int i = 0; i < m.w * m.h * m.d; i++)
+        {
+            if (mean_vals)
+                ptr[i] -= mean_vals[q];
+            if (norm_vals)
+                ptr[i] *= norm_vals[q];
+        }
+    }
+}
+
+static int compare(const ncnn::Mat& a, const ncnn::Mat& b)
+{
+    for (int q = 0; q < a.c; q++)
+    {
+        const float* pa = a.channel(q);
+        const float* pb = b.channel(q);
+        for (int i = 0; i < a.w * a.h * a.d; i++)
+        {
+            if (fabs(pa[i] - pb[i]) > 1e-4 * std::max(fabs(pb[i]), 1.f))
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_mat_normalize(int w, int h, int c, int elempack, int with_mean, int with_norm)
+{
+    ncnn::Mat a = RandomMat(w, h, c, 0.f, 255.f);
+
+    std::vector<float> mean_vals(c);
+    std::vector<float> norm_vals(c);
+    for (int q = 0; q < c; q++)
+    {
+        mean_vals[q] = RandomFloat(0.f, 128.f);
+        norm_vals[q] = RandomFloat(0.001f, 0.05f);
+    }
+    const float* mean_ptr = with_mean ? mean_vals.data() : 0;
+    const float* norm_ptr = with_norm ? norm_vals.data() : 0;
+
+    ncnn::Mat ref = a.clone();
+    mean_normalize_naive(ref, mean_ptr, norm_ptr);
+
+    ncnn::Option opt;
+    opt.num_threads = 2;
+
+    // packed layout through the persistent normalizer, applied twice to reused state
+    ncnn::MeanNormalizer normalizer(mean_ptr, norm_ptr, c);
+
+    ncnn::Mat b;
+    ncnn::convert_packing(a, b, elempack, opt);
+    for (int k = 0; k < 2; k++)
+    {
+        ncnn::Mat b2 = b.clone();
+        if (normalizer.apply(b2, opt) != 0)
+        {
+            fprintf(stderr, "test_mat_normalize apply failed w=%d h=%d c=%d elempack=%d\n", w, h, c, elempack);
+            return -1;
+        }
+
+        ncnn::Mat b2_unpacked;
+        ncnn::convert_packing(b2, b2_unpacked, 1, opt);
+        if (compare(b2_unpacked, ref) != 0)
+        {
+            fprintf(stderr, "test_mat_normalize failed w=%d h=%d c=%d elempack=%d mean=%d norm=%d\n", w, h, c, elempack, with_mean, with_norm);
+            return -1;
+        }
+    }
+
+    // the mat method goes through the same path
+    ncnn::Mat a2 = a.clone();
+    a2.substract_mean_normalize(mean_ptr, norm_ptr);
+    if (compare(a2, ref) != 0)
+    {
+        fprintf(stderr, "test_mat_normalize substract_mean_normalize failed w=%d h=%d c=%d mean=%d norm=%d\n", w, h, c, with_mean, with_norm);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_mat_normalize_mismatch()
+{
+    const float norm_vals[3] = {1.f, 2.f, 3.f};
+    ncnn::MeanNormalizer normalizer(0, norm_vals, 3);
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+
+    ncnn::Mat a = RandomMat(5, 7, 4);
+    if (normalizer.apply(a, opt) != -1)
+    {
+        fprintf(stderr, "test_mat_normalize_mismatch channel check failed\n");
+        return -1;
+    }
+
+    ncnn::Mat b(5, 7, 3, (size_t)2u);
+    if (normalizer.apply(b, opt) != -1)
+    {
+        fprintf(stderr, "test_mat_normalize_mismatch elemsize check failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// 1d and 2d mats are one channel for the mat method, per row or per element only through MeanNormalizer
+static int test_mat_normalize_legacy(int w, int h)
+{
+    ncnn::Mat a = h ? RandomMat(w, h, 0.f, 255.f) : RandomMat(w, 0.f, 255.f);
+
+    const float mean_vals[1] = {RandomFloat(0.f, 128.f)};
+    const float norm_vals[1] = {RandomFloat(0.001f, 0.05f)};
+
+    ncnn::Mat ref = a.clone();
+    mean_normalize_naive(ref, mean_vals, norm_vals);
+
+    ncnn::Mat b = a.clone();
+    b.substract_mean_normalize(mean_vals, norm_vals);
+    if (compare(b, ref) != 0)
+    {
+        fprintf(stderr, "test_mat_normalize_legacy failed w=%d h=%d\n", w, h);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_mat_normalize_0()
+{
+    return 0
+           || test_mat_normalize(7, 5, 3, 1, 1, 1)
+           || test_mat_normalize(7, 5, 3, 1, 1, 0)
+           || test_mat_normalize(7, 5, 3, 1, 0, 1)
+           || test_mat_normalize(224, 224, 3, 1, 1, 1)
+           || test_mat_normalize(13, 11, 4, 4, 1, 1)
+           || test_mat_normalize(13, 11, 8, 4, 0, 1)
+           || test_mat_normalize(13, 11, 8, 8, 1, 1)
+           || test_mat_normalize(9, 3, 16, 16, 1, 0)
+           || test_mat_normalize(9, 3, 32, 8, 1, 1);
+}
+
+int main()
+{
+    SRAND(7767517);
+
+    return 0
+           || test_mat_normalize_0()
+           || test_mat_normalize_legacy(17, 0)
+           || test_mat_normalize_legacy(13, 11)
+           || test_mat_normalize_mismatch();
+}
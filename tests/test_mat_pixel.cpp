@@ -4,6 +4,7 @@
 #include "mat.h"
 #include "prng.h"
 
+#include <math.h>
 #include <string.h>
 
 static struct prng_rand_t g_prng_rand_state;
@@ -359,6 +360,148 @@ static int test_mat_pixel_yuv420sp2rgb(int w, int h)
     return 0;
 }
 
+static int test_mat_pixel_preprocess(int w, int h, int type, int roix, int roiy, int roiw, int roih, int target_width, int target_height, int elempack, int elemtype)
+{
+    const int type_from = type & ncnn::Mat::PIXEL_FORMAT_MASK;
+    const int srcc = type_from == ncnn::Mat::PIXEL_GRAY ? 1 : (type_from == ncnn::Mat::PIXEL_RGB || type_from == ncnn::Mat::PIXEL_BGR) ? 3 : 4;
+    const int stride = w * srcc + 5;
+
+    ncnn::Mat a = RandomMat(stride, h, 1);
+
+    const float mean_vals[4] = {104.f, 117.f, 123.f, 111.f};
+    const float norm_vals[4] = {0.017f, 0.018f, 0.019f, 0.016f};
+
+    ncnn::PixelPreprocessOption ppopt;
+    ppopt.roix = roix;
+    ppopt.roiy = roiy;
+    ppopt.roiw = roiw;
+    ppopt.roih = roih;
+    ppopt.target_width = target_width;
+    ppopt.target_height = target_height;
+    ppopt.mean_vals = mean_vals;
+    ppopt.norm_vals = norm_vals;
+    ppopt.elempack = elempack;
+    ppopt.elemtype = elemtype;
+    ppopt.int8_scale = 60.f;
+    ppopt.num_threads = 2;
+
+    ncnn::Mat m = ncnn::Mat::from_pixels_preprocess(a, type, w, h, stride, ppopt);
+
+    // zero roi and target size fall back to the whole image and the roi size
+    const int ref_roiw = roiw ? roiw : w;
+    const int ref_roih = roih ? roih : h;
+    const int ref_target_width = target_width ? target_width : ref_roiw;
+    const int ref_target_height = target_height ? target_height : ref_roih;
+
+    ncnn::Mat ref = ncnn::Mat::from_pixels_roi_resize(a, type, w, h, stride, roix, roiy, ref_roiw, ref_roih, ref_target_width, ref_target_height);
+    ref.substract_mean_normalize(mean_vals, norm_vals);
+
+    if (m.w != ref.w || m.h != ref.h || m.c * m.elempack != ref.c || m.elempack != elempack)
+    {
+        fprintf(stderr, "test_mat_pixel_preprocess shape mismatch w=%d h=%d type=%d elempack=%d elemtype=%d\n", w, h, type, elempack, elemtype);
+        return -1;
+    }
+
+    for (int q = 0; q < ref.c; q++)
+    {
+        const ncnn::Mat refq = ref.channel(q);
+        const ncnn::Mat mq = m.channel(q / elempack);
+
+        for (int i = 0; i < ref.w * ref.h; i++)
+        {
+            const float r = refq[i];
+            const int mi = i * elempack + q % elempack;
+
+            bool ok = true;
+            if (elemtype == 0)
+                ok = fabs(((const float*)mq)[mi] - r) < 1e-4;
+            if (elemtype == 1)
+                ok = fabs(ncnn::float16_to_float32(((const unsigned short*)mq)[mi]) - r) < 1e-2;
+            if (elemtype == 2)
+                ok = fabs(ncnn::bfloat16_to_float32(((const unsigned short*)mq)[mi]) - r) < 2e-2;
+            if (elemtype == 3)
+                ok = abs(((const signed char*)mq)[mi] - std::min(std::max((int)round(r * 60.f), -127), 127)) <= 1;
+
+            if (!ok)
+            {
+                fprintf(stderr, "test_mat_pixel_preprocess failed w=%d h=%d type=%d roi=[%d %d %d %d] target=%d %d elempack=%d elemtype=%d at c=%d i=%d\n", w, h, type, roix, roiy, roiw, roih, target_width, target_height, elempack, elemtype, q, i);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_yuv420_preprocess(int w, int h, int type, int roix, int roiy, int roiw, int roih, int target_width, int target_height, int elemtype)
+{
+    ncnn::Mat nv21 = RandomMat(w, h * 3 / 2, 1);
+
+    // the same frame in nv12 and i420 layout
+    ncnn::Mat nv12 = nv21.clone();
+    ncnn::Mat i420 = nv21.clone();
+    {
+        const unsigned char* vu = (const unsigned char*)nv21.data + w * h;
+        unsigned char* uv = (unsigned char*)nv12.data + w * h;
+        unsigned char* u = (unsigned char*)i420.data + w * h;
+        unsigned char* v = u + w * h / 4;
+        for (int i = 0; i < w * h / 4; i++)
+        {
+            uv[i * 2] = vu[i * 2 + 1];
+            uv[i * 2 + 1] = vu[i * 2];
+            u[i] = vu[i * 2 + 1];
+            v[i] = vu[i * 2];
+        }
+    }
+
+    const float mean_vals[4] = {104.f, 117.f, 123.f, 111.f};
+    const float norm_vals[4] = {0.017f, 0.018f, 0.019f, 0.016f};
+
+    ncnn::PixelPreprocessOption ppopt;
+    ppopt.roix = roix;
+    ppopt.roiy = roiy;
+    ppopt.roiw = roiw;
+    ppopt.roih = roih;
+    ppopt.target_width = target_width;
+    ppopt.target_height = target_height;
+    ppopt.mean_vals = mean_vals;
+    ppopt.norm_vals = norm_vals;
+    ppopt.elemtype = elemtype;
+    ppopt.num_threads = 3;
+
+    ncnn::Mat m[3];
+    m[0] = ncnn::Mat::from_yuv420sp(nv21, w, h, type, ppopt);
+    m[1] = ncnn::Mat::from_yuv420sp_nv12(nv12, w, h, type, ppopt);
+    m[2] = ncnn::Mat::from_yuv420p(i420, w, h, type, ppopt);
+
+    // reference goes through the intermediate rgb image
+    ncnn::Mat rgb(w * 3, h, (size_t)1u, 1);
+    ncnn::yuv420sp2rgb(nv21, w, h, rgb);
+
+    const int type_rgb = type == ncnn::Mat::PIXEL_RGB ? ncnn::Mat::PIXEL_RGB : ncnn::Mat::PIXEL_RGB | (type << ncnn::Mat::PIXEL_CONVERT_SHIFT);
+    ncnn::Mat ref = ncnn::Mat::from_pixels_preprocess(rgb, type_rgb, w, h, w * 3, ppopt);
+
+    for (int k = 0; k < 3; k++)
+    {
+        if (m[k].w != ref.w || m[k].h != ref.h || m[k].c != ref.c || m[k].elemsize != ref.elemsize)
+        {
+            fprintf(stderr, "test_mat_pixel_yuv420_preprocess shape mismatch w=%d h=%d type=%d layout=%d\n", w, h, type, k);
+            return -1;
+        }
+
+        for (int q = 0; q < ref.c; q++)
+        {
+            if (memcmp(m[k].channel(q), ref.channel(q), ref.w * ref.h * ref.elemsize) != 0)
+            {
+                fprintf(stderr, "test_mat_pixel_yuv420_preprocess failed w=%d h=%d type=%d roi=[%d %d %d %d] target=%d %d elemtype=%d layout=%d c=%d\n", w, h, type, roix, roiy, roiw, roih, target_width, target_height, elemtype, k, q);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
 static int test_mat_pixel_0()
 {
     return 0
@@ -428,6 +571,186 @@ static int test_mat_pixel_6()
            || test_mat_pixel_yuv420sp2rgb(6, 6);
 }
 
+static int test_mat_pixel_7()
+{
+    return 0
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_RGB, 0, 0, 0, 0, 0, 0, 1, 0)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_BGR2RGB, 2, 1, 19, 15, 13, 11, 1, 0)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_RGBA2BGRA, 1, 3, 20, 12, 37, 29, 4, 0)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_BGRA, 0, 0, 24, 18, 7, 5, 4, 1)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_RGB2GRAY, 3, 2, 17, 13, 9, 9, 1, 2)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_GRAY2RGBA, 0, 0, 0, 0, 31, 7, 4, 3)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_RGB2BGRA, 5, 5, 11, 9, 11, 9, 4, 0)
+           || test_mat_pixel_preprocess(24, 18, ncnn::Mat::PIXEL_BGRA2GRAY, 1, 1, 22, 16, 23, 17, 1, 3);
+}
+
+static int test_mat_pixel_threads(int w, int h, int type, int srcc, int dstc)
+{
+    const int stride = w * srcc + 3;
+
+    ncnn::Mat a = RandomMat(stride, h, 1);
+
+    ncnn::Option opt;
+    opt.num_threads = 3;
+
+    ncnn::Mat m0 = ncnn::Mat::from_pixels(a, type, w, h, stride);
+    ncnn::Mat m1 = ncnn::Mat::from_pixels(a, type, w, h, stride, opt);
+
+    if (m0.w != m1.w || m0.h != m1.h || m0.c != m1.c)
+    {
+        fprintf(stderr, "test_mat_pixel_threads from_pixels shape mismatch w=%d h=%d type=%d\n", w, h, type);
+        return -1;
+    }
+
+    for (int q = 0; q < m0.c; q++)
+    {
+        if (memcmp(m0.channel(q), m1.channel(q), w * h * sizeof(float)) != 0)
+        {
+            fprintf(stderr, "test_mat_pixel_threads from_pixels failed w=%d h=%d type=%d c=%d\n", w, h, type, q);
+            return -1;
+        }
+    }
+
+    // export back to the pixel layout the mat came from
+    const int type_to = (type & ncnn::Mat::PIXEL_CONVERT_MASK) ? (type >> ncnn::Mat::PIXEL_CONVERT_SHIFT) | ((type & ncnn::Mat::PIXEL_FORMAT_MASK) << ncnn::Mat::PIXEL_CONVERT_SHIFT) : type;
+    const int dststride = w * dstc + 5;
+
+    ncnn::Mat b0 = FilledMat(dststride, h, 1, 0);
+    ncnn::Mat b1 = FilledMat(dststride, h, 1, 0);
+    m0.to_pixels(b0, type_to, dststride);
+    m0.to_pixels(b1, type_to, dststride, opt);
+
+    if (memcmp(b0, b1, dststride * h) != 0)
+    {
+        fprintf(stderr, "test_mat_pixel_threads to_pixels failed w=%d h=%d type=%d\n", w, h, type_to);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_8()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        const int w = i == 0 ? 7 : i == 1 ? 35 : 64;
+        const int h = i == 0 ? 2 : i == 1 ? 13 : 31;
+
+        int ret = 0
+                  || test_mat_pixel_threads(w, h, ncnn::Mat::PIXEL_RGB, 3, 3)
+                  || test_mat_pixel_threads(w, h, ncnn::Mat::PIXEL_BGR2RGB, 3, 3)
+                  || test_mat_pixel_threads(w, h, ncnn::Mat::PIXEL_GRAY, 1, 1)
+                  || test_mat_pixel_threads(w, h, ncnn::Mat::PIXEL_RGBA, 4, 4)
+                  || test_mat_pixel_threads(w, h, ncnn::Mat::PIXEL_RGBA2BGRA, 4, 4)
+                  || test_mat_pixel_threads(w, h, ncnn::Mat::PIXEL_RGBA2RGB, 4, 4);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_9()
+{
+    return 0
+           || test_mat_pixel_yuv420_preprocess(24, 18, ncnn::Mat::PIXEL_RGB, 0, 0, 0, 0, 0, 0, 0)
+           || test_mat_pixel_yuv420_preprocess(40, 22, ncnn::Mat::PIXEL_BGR, 3, 1, 35, 19, 0, 0, 0)
+           || test_mat_pixel_yuv420_preprocess(40, 22, ncnn::Mat::PIXEL_RGB, 1, 3, 37, 17, 21, 13, 1)
+           || test_mat_pixel_yuv420_preprocess(24, 18, ncnn::Mat::PIXEL_GRAY, 2, 2, 19, 15, 29, 23, 0)
+           || test_mat_pixel_yuv420_preprocess(66, 8, ncnn::Mat::PIXEL_RGBA, 0, 0, 0, 0, 32, 4, 0)
+           || test_mat_pixel_yuv420_preprocess(2, 2, ncnn::Mat::PIXEL_BGRA, 0, 0, 0, 0, 5, 3, 1);
+}
+
+static int test_mat_pixel_letterbox(int w, int h, int type, int target_size, int align, int elempack, int elemtype)
+{
+    const int type_from = type & ncnn::Mat::PIXEL_FORMAT_MASK;
+    const int srcc = type_from == ncnn::Mat::PIXEL_GRAY ? 1 : (type_from == ncnn::Mat::PIXEL_RGB || type_from == ncnn::Mat::PIXEL_BGR) ? 3 : 4;
+
+    ncnn::Mat a = RandomMat(w * srcc, h, 1);
+
+    const float mean_vals[4] = {104.f, 117.f, 123.f, 111.f};
+    const float norm_vals[4] = {0.017f, 0.018f, 0.019f, 0.016f};
+
+    ncnn::PixelPreprocessOption ppopt;
+    ppopt.set_letterbox(w, h, target_size, align);
+    ppopt.pad_value = 114.f;
+    ppopt.mean_vals = mean_vals;
+    ppopt.norm_vals = norm_vals;
+    ppopt.elempack = elempack;
+    ppopt.elemtype = elemtype;
+    ppopt.int8_scale = 60.f;
+    ppopt.num_threads = 3;
+
+    ncnn::Mat m = ncnn::Mat::from_pixels_preprocess(a, type, w, h, w * srcc, ppopt);
+
+    // reference is resize, pad and normalize in three passes like the yolov5 example
+    ncnn::Mat resized = ncnn::Mat::from_pixels_resize(a, type, w, h, ppopt.target_width, ppopt.target_height);
+    ncnn::Mat ref;
+    ncnn::copy_make_border(resized, ref, ppopt.pad_top, ppopt.pad_bottom, ppopt.pad_left, ppopt.pad_right, ncnn::BORDER_CONSTANT, 114.f);
+    ref.substract_mean_normalize(mean_vals, norm_vals);
+
+    const int outw = ref.w;
+    const int outh = ref.h;
+    if (align == 0 && (outw != target_size || outh != target_size))
+    {
+        fprintf(stderr, "test_mat_pixel_letterbox not square w=%d h=%d target_size=%d\n", w, h, target_size);
+        return -1;
+    }
+    if (align > 0 && (outw % align != 0 || outh % align != 0 || std::max(outw, outh) != (target_size + align - 1) / align * align))
+    {
+        fprintf(stderr, "test_mat_pixel_letterbox not aligned w=%d h=%d target_size=%d align=%d\n", w, h, target_size, align);
+        return -1;
+    }
+
+    if (m.w != ref.w || m.h != ref.h || m.c * m.elempack != ref.c || m.elempack != elempack)
+    {
+        fprintf(stderr, "test_mat_pixel_letterbox shape mismatch w=%d h=%d type=%d elempack=%d elemtype=%d\n", w, h, type, elempack, elemtype);
+        return -1;
+    }
+
+    for (int q = 0; q < ref.c; q++)
+    {
+        const ncnn::Mat refq = ref.channel(q);
+        const ncnn::Mat mq = m.channel(q / elempack);
+
+        for (int i = 0; i < ref.w * ref.h; i++)
+        {
+            const float r = refq[i];
+            const int mi = i * elempack + q % elempack;
+
+            bool ok = true;
+            if (elemtype == 0)
+                ok = fabs(((const float*)mq)[mi] - r) < 1e-4;
+            if (elemtype == 1)
+                ok = fabs(ncnn::float16_to_float32(((const unsigned short*)mq)[mi]) - r) < 1e-2;
+            if (elemtype == 2)
+                ok = fabs(ncnn::bfloat16_to_float32(((const unsigned short*)mq)[mi]) - r) < 2e-2;
+            if (elemtype == 3)
+                ok = abs(((const signed char*)mq)[mi] - std::min(std::max((int)round(r * 60.f), -127), 127)) <= 1;
+
+            if (!ok)
+            {
+                fprintf(stderr, "test_mat_pixel_letterbox failed w=%d h=%d type=%d target_size=%d align=%d elempack=%d elemtype=%d at c=%d i=%d\n", w, h, type, target_size, align, elempack, elemtype, q, i);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_10()
+{
+    return 0
+           || test_mat_pixel_letterbox(40, 22, ncnn::Mat::PIXEL_BGR2RGB, 32, 0, 1, 0)
+           || test_mat_pixel_letterbox(22, 40, ncnn::Mat::PIXEL_BGR2RGB, 32, 8, 1, 0)
+           || test_mat_pixel_letterbox(63, 37, ncnn::Mat::PIXEL_RGBA, 48, 16, 4, 0)
+           || test_mat_pixel_letterbox(37, 63, ncnn::Mat::PIXEL_RGB2BGR, 51, 0, 1, 1)
+           || test_mat_pixel_letterbox(50, 50, ncnn::Mat::PIXEL_GRAY, 24, 32, 1, 2)
+           || test_mat_pixel_letterbox(70, 31, ncnn::Mat::PIXEL_BGRA, 40, 8, 4, 3);
+}
+
 int main()
 {
     SRAND(7767517);
@@ -439,5 +762,9 @@ int main()
            || test_mat_pixel_3()
            || test_mat_pixel_4()
            || test_mat_pixel_5()
-           || test_mat_pixel_6();
+           || test_mat_pixel_6()
+           || test_mat_pixel_7()
+           || test_mat_pixel_8()
+           || test_mat_pixel_9()
+           || test_mat_pixel_10();
 }
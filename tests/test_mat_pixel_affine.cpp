@@ -5,6 +5,7 @@
 #include "prng.h"
 
 #include <string.h>
+#include <vector>
 
 static struct prng_rand_t g_prng_rand_state;
 #define SRAND(seed) prng_srand(seed, &g_prng_rand_state)
@@ -487,9 +488,79 @@ static int test_mat_pixel_affine_1()
            || test_mat_pixel_affine_yuv420sp(220, 340);
 }
 
+static int test_mat_pixel_affine_batch(int w, int h, int count)
+{
+    for (int c = 1; c <= 4; c++)
+    {
+        ncnn::Mat a0 = RandomMat(w, h, c);
+
+        std::vector<float> tms(count * 6);
+        for (int i = 0; i < count; i++)
+        {
+            ncnn::get_rotation_matrix(10.f + i * 23.f, 0.5f + i * 0.25f, w / 2 + i, h / 2 - i, &tms[i * 6]);
+        }
+
+        const int outw = w / 2 + 3;
+        const int outh = h / 2 + 1;
+
+        std::vector<ncnn::Mat> b0(count);
+        std::vector<ncnn::Mat> b1(count);
+        std::vector<unsigned char*> dsts(count);
+        for (int i = 0; i < count; i++)
+        {
+            b0[i].create(outw, outh, (size_t)c, c);
+            b1[i].create(outw, outh, (size_t)c, c);
+            dsts[i] = b1[i];
+
+            // transparent border keeps the dst content
+            memset(b0[i], 0, outw * outh * c);
+            memset(b1[i], 0, outw * outh * c);
+        }
+
+        const int type = c % 2 ? 0 : -233;
+        const unsigned int v = 0x80604020;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (c == 1)
+                ncnn::warpaffine_bilinear_c1(a0, w, h, b0[i], outw, outh, &tms[i * 6], type, v);
+            if (c == 2)
+                ncnn::warpaffine_bilinear_c2(a0, w, h, b0[i], outw, outh, &tms[i * 6], type, v);
+            if (c == 3)
+                ncnn::warpaffine_bilinear_c3(a0, w, h, b0[i], outw, outh, &tms[i * 6], type, v);
+            if (c == 4)
+                ncnn::warpaffine_bilinear_c4(a0, w, h, b0[i], outw, outh, &tms[i * 6], type, v);
+        }
+
+        ncnn::Option opt;
+        opt.num_threads = 3;
+
+        ncnn::warpaffine_bilinear_batch(a0, w, h, w * c, c, count, dsts.data(), outw, outh, outw * c, tms.data(), type, v, opt);
+
+        for (int i = 0; i < count; i++)
+        {
+            if (memcmp(b0[i], b1[i], outw * outh * c) != 0)
+            {
+                fprintf(stderr, "test_mat_pixel_affine_batch failed w=%d h=%d c=%d count=%d i=%d\n", w, h, c, count, i);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_affine_2()
+{
+    return 0
+           || test_mat_pixel_affine_batch(40, 40, 1)
+           || test_mat_pixel_affine_batch(120, 160, 2)
+           || test_mat_pixel_affine_batch(220, 130, 7);
+}
+
 int main()
 {
     SRAND(7767517);
 
-    return test_mat_pixel_affine_0() || test_mat_pixel_affine_1();
+    return test_mat_pixel_affine_0() || test_mat_pixel_affine_1() || test_mat_pixel_affine_2();
 }
@@ -4,6 +4,8 @@
 #include "mat.h"
 #include "prng.h"
 
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 static struct prng_rand_t g_prng_rand_state;
@@ -282,6 +284,169 @@ static int test_mat_pixel_roi_resize_bgra(int w, int h, int roix, int roiy, int
     return 0;
 }
 
+// naive box average over the covered source area
+static void resize_area_naive(const unsigned char* src, int w, int h, int ch, unsigned char* dst, int target_width, int target_height)
+{
+    const double scale_x = (double)w / target_width;
+    const double scale_y = (double)h / target_height;
+
+    for (int y = 0; y < target_height; y++)
+    {
+        for (int x = 0; x < target_width; x++)
+        {
+            const double fy0 = y * scale_y;
+            const double fy1 = fy0 + scale_y;
+            const double fx0 = x * scale_x;
+            const double fx1 = fx0 + scale_x;
+
+            for (int k = 0; k < ch; k++)
+            {
+                double sum = 0;
+                for (int sy = (int)floor(fy0); sy < (int)ceil(fy1) && sy < h; sy++)
+                {
+                    const double wy = std::min(fy1, sy + 1.0) - std::max(fy0, (double)sy);
+                    for (int sx = (int)floor(fx0); sx < (int)ceil(fx1) && sx < w; sx++)
+                    {
+                        const double wx = std::min(fx1, sx + 1.0) - std::max(fx0, (double)sx);
+                        sum += src[(sy * w + sx) * ch + k] * wx * wy;
+                    }
+                }
+
+                dst[(y * target_width + x) * ch + k] = (unsigned char)std::min(sum / (scale_x * scale_y) + 0.5, 255.0);
+            }
+        }
+    }
+}
+
+static void interpolate_cubic_naive(float fx, double* coeffs)
+{
+    const double A = -0.75;
+
+    double fx0 = fx + 1.0;
+    double fx1 = fx;
+    double fx2 = 1.0 - fx;
+
+    coeffs[0] = A * fx0 * fx0 * fx0 - 5 * A * fx0 * fx0 + 8 * A * fx0 - 4 * A;
+    coeffs[1] = (A + 2) * fx1 * fx1 * fx1 - (A + 3) * fx1 * fx1 + 1;
+    coeffs[2] = (A + 2) * fx2 * fx2 * fx2 - (A + 3) * fx2 * fx2 + 1;
+    coeffs[3] = 1.0 - coeffs[0] - coeffs[1] - coeffs[2];
+}
+
+// naive 4x4 bicubic with replicated border
+static void resize_bicubic_naive(const unsigned char* src, int w, int h, int ch, unsigned char* dst, int target_width, int target_height)
+{
+    for (int y = 0; y < target_height; y++)
+    {
+        float fy = (float)((y + 0.5) * h / target_height - 0.5);
+        int sy = (int)floor(fy);
+        fy -= sy;
+
+        double beta[4];
+        interpolate_cubic_naive(fy, beta);
+
+        for (int x = 0; x < target_width; x++)
+        {
+            float fx = (float)((x + 0.5) * w / target_width - 0.5);
+            int sx = (int)floor(fx);
+            fx -= sx;
+
+            double alpha[4];
+            interpolate_cubic_naive(fx, alpha);
+
+            for (int k = 0; k < ch; k++)
+            {
+                double sum = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    const int yy = std::min(std::max(sy - 1 + i, 0), h - 1);
+                    for (int j = 0; j < 4; j++)
+                    {
+                        const int xx = std::min(std::max(sx - 1 + j, 0), w - 1);
+                        sum += src[(yy * w + xx) * ch + k] * alpha[j] * beta[i];
+                    }
+                }
+
+                dst[(y * target_width + x) * ch + k] = (unsigned char)(std::min(std::max(sum, 0.0), 255.0) + 0.5);
+            }
+        }
+    }
+}
+
+static int test_mat_pixel_resize_filter(int w, int h, int ch, int target_width, int target_height, int resize_type)
+{
+    ncnn::Mat a = RandomMat(w, h, ch);
+
+    ncnn::Mat b(target_width, target_height, 1, (size_t)ch, ch);
+    ncnn::Mat c(target_width, target_height, 1, (size_t)ch, ch);
+    ncnn::Mat d(target_width, target_height, 1, (size_t)ch, ch);
+
+    ncnn::Option opt;
+    opt.num_threads = 3;
+
+    if (resize_type == ncnn::Mat::PIXEL_RESIZE_AREA)
+    {
+        if (ch == 1) resize_area_c1(a, w, h, b, target_width, target_height);
+        if (ch == 2) resize_area_c2(a, w, h, b, target_width, target_height);
+        if (ch == 3) resize_area_c3(a, w, h, b, target_width, target_height);
+        if (ch == 4) resize_area_c4(a, w, h, b, target_width, target_height);
+
+        if (ch == 1) resize_area_c1(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+        if (ch == 2) resize_area_c2(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+        if (ch == 3) resize_area_c3(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+        if (ch == 4) resize_area_c4(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+
+        resize_area_naive(a, w, h, ch, d, target_width, target_height);
+    }
+    else
+    {
+        if (ch == 1) resize_bicubic_c1(a, w, h, b, target_width, target_height);
+        if (ch == 2) resize_bicubic_c2(a, w, h, b, target_width, target_height);
+        if (ch == 3) resize_bicubic_c3(a, w, h, b, target_width, target_height);
+        if (ch == 4) resize_bicubic_c4(a, w, h, b, target_width, target_height);
+
+        if (ch == 1) resize_bicubic_c1(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+        if (ch == 2) resize_bicubic_c2(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+        if (ch == 3) resize_bicubic_c3(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+        if (ch == 4) resize_bicubic_c4(a, w, h, w * ch, c, target_width, target_height, target_width * ch, opt);
+
+        resize_bicubic_naive(a, w, h, ch, d, target_width, target_height);
+    }
+
+    if (memcmp(b, c, target_width * target_height * ch) != 0)
+    {
+        fprintf(stderr, "test_mat_pixel_resize_filter threads mismatch w=%d h=%d ch=%d target_width=%d target_height=%d resize_type=%d\n", w, h, ch, target_width, target_height, resize_type);
+        return -1;
+    }
+
+    const unsigned char* pb = b;
+    const unsigned char* pd = d;
+    for (int i = 0; i < target_width * target_height * ch; i++)
+    {
+        // float accumulation may round the other way
+        if (abs(pb[i] - pd[i]) > 1)
+        {
+            fprintf(stderr, "test_mat_pixel_resize_filter failed w=%d h=%d ch=%d target_width=%d target_height=%d resize_type=%d at %d expect %d but got %d\n", w, h, ch, target_width, target_height, resize_type, i, pd[i], pb[i]);
+            return -1;
+        }
+    }
+
+    // from_pixels_resize picks the same filter
+    const int pixel_type = ch == 1 ? ncnn::Mat::PIXEL_GRAY : ch == 3 ? ncnn::Mat::PIXEL_RGB : ch == 4 ? ncnn::Mat::PIXEL_RGBA : 0;
+    if (pixel_type != 0)
+    {
+        ncnn::Mat m = ncnn::Mat::from_pixels_resize(a, pixel_type, w, h, w * ch, target_width, target_height, resize_type, opt);
+        ncnn::Mat m2 = ncnn::Mat::from_pixels(b, pixel_type, target_width, target_height);
+
+        if (Compare(m, m2) != 0)
+        {
+            fprintf(stderr, "test_mat_pixel_resize_filter from_pixels_resize failed w=%d h=%d ch=%d target_width=%d target_height=%d resize_type=%d\n", w, h, ch, target_width, target_height, resize_type);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 static int test_mat_pixel_0()
 {
     for (int c = 1; c <= 4; c++)
@@ -320,9 +485,44 @@ static int test_mat_pixel_2()
            || test_mat_pixel_roi_resize_bgra(15, 15, 7, 3, 1, 1, 1, 1);
 }
 
+static int test_mat_pixel_3()
+{
+    for (int c = 1; c <= 4; c++)
+    {
+        int ret = 0
+                  || test_mat_pixel_resize_filter(24, 48, c, 12, 16, ncnn::Mat::PIXEL_RESIZE_AREA)
+                  || test_mat_pixel_resize_filter(64, 36, c, 16, 9, ncnn::Mat::PIXEL_RESIZE_AREA)
+                  || test_mat_pixel_resize_filter(33, 23, c, 5, 6, ncnn::Mat::PIXEL_RESIZE_AREA)
+                  || test_mat_pixel_resize_filter(123, 87, c, 19, 31, ncnn::Mat::PIXEL_RESIZE_AREA)
+                  || test_mat_pixel_resize_filter(13, 17, c, 13, 17, ncnn::Mat::PIXEL_RESIZE_AREA);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_4()
+{
+    for (int c = 1; c <= 4; c++)
+    {
+        int ret = 0
+                  || test_mat_pixel_resize_filter(24, 48, c, 12, 16, ncnn::Mat::PIXEL_RESIZE_BICUBIC)
+                  || test_mat_pixel_resize_filter(33, 23, c, 5, 6, ncnn::Mat::PIXEL_RESIZE_BICUBIC)
+                  || test_mat_pixel_resize_filter(5, 4, c, 11, 16, ncnn::Mat::PIXEL_RESIZE_BICUBIC)
+                  || test_mat_pixel_resize_filter(123, 87, c, 19, 131, ncnn::Mat::PIXEL_RESIZE_BICUBIC);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 int main()
 {
     SRAND(7767517);
 
-    return test_mat_pixel_0() || test_mat_pixel_1() || test_mat_pixel_2();
+    return test_mat_pixel_0() || test_mat_pixel_1() || test_mat_pixel_2() || test_mat_pixel_3() || test_mat_pixel_4();
 }
@@ -203,11 +203,115 @@ static int test_mat_pixel_rotate_1()
            || test_mat_pixel_rotate_yuv420sp(22, 34);
 }
 
+static int test_mat_pixel_rotate_threads(int w, int h, int c, int type)
+{
+    ncnn::Mat a0 = RandomMat(w, h, c);
+
+    const int outw = type <= 4 ? w : h;
+    const int outh = type <= 4 ? h : w;
+
+    ncnn::Mat b0(outw, outh, (size_t)c, c);
+    ncnn::Mat b1(outw, outh, (size_t)c, c);
+
+    ncnn::Option opt;
+    opt.num_threads = 3;
+
+    if (c == 1)
+    {
+        ncnn::kanna_rotate_c1(a0, w, h, w * c, b0, outw, outh, outw * c, type);
+        ncnn::kanna_rotate_c1(a0, w, h, w * c, b1, outw, outh, outw * c, type, opt);
+    }
+    if (c == 2)
+    {
+        ncnn::kanna_rotate_c2(a0, w, h, w * c, b0, outw, outh, outw * c, type);
+        ncnn::kanna_rotate_c2(a0, w, h, w * c, b1, outw, outh, outw * c, type, opt);
+    }
+    if (c == 3)
+    {
+        ncnn::kanna_rotate_c3(a0, w, h, w * c, b0, outw, outh, outw * c, type);
+        ncnn::kanna_rotate_c3(a0, w, h, w * c, b1, outw, outh, outw * c, type, opt);
+    }
+    if (c == 4)
+    {
+        ncnn::kanna_rotate_c4(a0, w, h, w * c, b0, outw, outh, outw * c, type);
+        ncnn::kanna_rotate_c4(a0, w, h, w * c, b1, outw, outh, outw * c, type, opt);
+    }
+
+    if (memcmp(b0, b1, w * h * c) != 0)
+    {
+        fprintf(stderr, "test_mat_pixel_rotate_threads failed w=%d h=%d c=%d type=%d\n", w, h, c, type);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_rotate_2()
+{
+    for (int type = 1; type <= 8; type++)
+    {
+        for (int c = 1; c <= 4; c++)
+        {
+            int ret = 0
+                      || test_mat_pixel_rotate_threads(5, 7, c, type)
+                      || test_mat_pixel_rotate_threads(24, 17, c, type)
+                      || test_mat_pixel_rotate_threads(35, 42, c, type);
+
+            if (ret != 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_rotate_yuv420sp_threads(int w, int h, int type)
+{
+    ncnn::Mat a0 = RandomMat(w, h * 3 / 2, 1);
+
+    const int outw = type <= 4 ? w : h;
+    const int outh = type <= 4 ? h : w;
+
+    ncnn::Mat b0(outw, outh * 3 / 2, (size_t)1u, 1);
+    ncnn::Mat b1(outw, outh * 3 / 2, (size_t)1u, 1);
+
+    ncnn::Option opt;
+    opt.num_threads = 3;
+
+    ncnn::kanna_rotate_yuv420sp(a0, w, h, b0, outw, outh, type);
+    ncnn::kanna_rotate_yuv420sp(a0, w, h, b1, outw, outh, type, opt);
+
+    if (memcmp(b0, b1, w * h * 3 / 2) != 0)
+    {
+        fprintf(stderr, "test_mat_pixel_rotate_yuv420sp_threads failed w=%d h=%d type=%d\n", w, h, type);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_rotate_3()
+{
+    for (int type = 1; type <= 8; type++)
+    {
+        int ret = 0
+                  || test_mat_pixel_rotate_yuv420sp_threads(6, 4, type)
+                  || test_mat_pixel_rotate_yuv420sp_threads(34, 22, type);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 int main()
 {
     SRAND(7767517);
 
     return 0
            || test_mat_pixel_rotate_0()
-           || test_mat_pixel_rotate_1();
+           || test_mat_pixel_rotate_1()
+           || test_mat_pixel_rotate_2()
+           || test_mat_pixel_rotate_3();
 }
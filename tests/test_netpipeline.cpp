@@ -0,0 +1,248 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "datareader.h"
+#include "net.h"
+#include "netpipeline.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+// out = in op_type scalar
+static int load_scalar_net(ncnn::Net& net, int op_type, float b)
+{
+    net.opt.num_threads = 1;
+
+    char param_txt[256];
+    sprintf(param_txt, "7767517\n2 2\nInput input 0 1 data\nBinaryOp op 1 1 data out 0=%d 1=1 2=%e\n", op_type, b);
+
+    int ret = net.load_param_mem(param_txt);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+static int check_value(const ncnn::Mat& m, float expect)
+{
+    for (int q = 0; q < m.c; q++)
+    {
+        const float* ptr = m.channel(q);
+        for (int i = 0; i < m.w * m.h; i++)
+        {
+            if (ptr[i] != expect)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+static std::vector<ncnn::Mat> make_input(float v)
+{
+    ncnn::Mat m(7, 5, 3);
+    m.fill(v);
+
+    return std::vector<ncnn::Mat>(1, m);
+}
+
+// the item with tag n becomes n % 3 items
+static int fan_out(ncnn::Extractor& ex, const std::vector<ncnn::Mat>& inputs, std::vector<std::vector<ncnn::Mat> >& outputs, void* /*userdata*/)
+{
+    ex.input("data", inputs[0]);
+
+    ncnn::Mat out;
+    int ret = ex.extract("out", out);
+    if (ret != 0)
+        return ret;
+
+    const int n = (int)inputs[0][0] % 3;
+    for (int i = 0; i < n; i++)
+    {
+        outputs.push_back(std::vector<ncnn::Mat>(1, out));
+    }
+
+    return 0;
+}
+
+static int test_netpipeline_0()
+{
+    ncnn::Net add1;
+    ncnn::Net mul2;
+    if (load_scalar_net(add1, 0, 1.f) != 0 || load_scalar_net(mul2, 2, 2.f) != 0)
+    {
+        fprintf(stderr, "test_netpipeline load net failed\n");
+        return -1;
+    }
+
+    const ncnn::CpuSet& cpus = ncnn::get_cpu_thread_affinity_mask(0);
+
+    // items come out in push order
+    {
+        ncnn::NetPipeline pipeline;
+        pipeline.add_stage(add1, cpus);
+        pipeline.add_stage(mul2, cpus);
+
+        for (int i = 0; i < 20; i++)
+        {
+            if (pipeline.push(make_input((float)i), i) != 0)
+            {
+                fprintf(stderr, "test_netpipeline push %d failed\n", i);
+                return -1;
+            }
+
+            // drain while pushing so that the default capacity is never exceeded
+            if (i >= 3)
+            {
+                std::vector<ncnn::Mat> outputs;
+                int tag = -1;
+                if (pipeline.pop(outputs, &tag) != 0 || tag != i - 3 || outputs.size() != 1 || check_value(outputs[0], (i - 3 + 1) * 2.f) != 0)
+                {
+                    fprintf(stderr, "test_netpipeline pop %d failed tag %d\n", i - 3, tag);
+                    return -1;
+                }
+            }
+        }
+
+        pipeline.close();
+
+        for (int i = 17; i < 20; i++)
+        {
+            std::vector<ncnn::Mat> outputs;
+            int tag = -1;
+            if (pipeline.pop(outputs, &tag) != 0 || tag != i || check_value(outputs[0], (i + 1) * 2.f) != 0)
+            {
+                fprintf(stderr, "test_netpipeline pop %d after close failed tag %d\n", i, tag);
+                return -1;
+            }
+        }
+
+        std::vector<ncnn::Mat> outputs;
+        if (pipeline.pop(outputs) != -1)
+        {
+            fprintf(stderr, "test_netpipeline pop after drained should fail\n");
+            return -1;
+        }
+
+        if (pipeline.push(make_input(0.f)) == 0)
+        {
+            fprintf(stderr, "test_netpipeline push after close should fail\n");
+            return -1;
+        }
+
+        if (pipeline.add_stage(mul2, cpus) != -1)
+        {
+            fprintf(stderr, "test_netpipeline add_stage after start should fail\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_netpipeline_1()
+{
+    ncnn::Net add1;
+    ncnn::Net mul2;
+    if (load_scalar_net(add1, 0, 1.f) != 0 || load_scalar_net(mul2, 2, 2.f) != 0)
+    {
+        fprintf(stderr, "test_netpipeline load net failed\n");
+        return -1;
+    }
+
+    const ncnn::CpuSet& cpus = ncnn::get_cpu_thread_affinity_mask(0);
+
+    // fan out with the smallest queues, the stages block on each other
+    {
+        ncnn::NetPipeline pipeline;
+        pipeline.set_queue_capacity(1);
+        pipeline.add_stage(mul2, cpus, fan_out);
+        pipeline.add_stage(add1, cpus);
+
+        int expect_count = 0;
+        int count = 0;
+        for (int i = 0; i < 12; i++)
+        {
+            if (pipeline.push(make_input((float)i), i) != 0)
+            {
+                fprintf(stderr, "test_netpipeline fan out push %d failed\n", i);
+                return -1;
+            }
+
+            expect_count += i % 3;
+
+            // pop everything of item i
+            while (count < expect_count)
+            {
+                std::vector<ncnn::Mat> outputs;
+                int tag = -1;
+                if (pipeline.pop(outputs, &tag) != 0 || tag != i || check_value(outputs[0], i * 2.f + 1.f) != 0)
+                {
+                    fprintf(stderr, "test_netpipeline fan out pop failed tag %d expect %d\n", tag, i);
+                    return -1;
+                }
+                count++;
+            }
+        }
+
+        pipeline.close();
+
+        std::vector<ncnn::Mat> outputs;
+        if (pipeline.pop(outputs) != -1)
+        {
+            fprintf(stderr, "test_netpipeline fan out has extra items\n");
+            return -1;
+        }
+    }
+
+    // items never popped are dropped with the pipeline
+    {
+        ncnn::NetPipeline pipeline;
+        pipeline.add_stage(add1, cpus);
+        pipeline.add_stage(mul2, cpus);
+
+        for (int i = 0; i < 3; i++)
+        {
+            pipeline.push(make_input((float)i), i);
+        }
+    }
+
+    // close without any push
+    {
+        ncnn::NetPipeline pipeline;
+        pipeline.add_stage(add1, cpus);
+        pipeline.close();
+
+        std::vector<ncnn::Mat> outputs;
+        if (pipeline.pop(outputs) != -1)
+        {
+            fprintf(stderr, "test_netpipeline pop on idle closed pipeline should fail\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main()
+{
+    return 0
+           || test_netpipeline_0()
+           || test_netpipeline_1();
+}
@@ -0,0 +1,228 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+
+#include "datareader.h"
+#include "net.h"
+#include "profiler.h"
+
+class DataReaderFromEmpty : public ncnn::DataReader
+{
+public:
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        memset(buf, 0, size);
+        return size;
+    }
+};
+
+static int load_test_net(ncnn::Net& net)
+{
+    net.opt.num_threads = 1;
+
+    const char param_txt[] = "7767517\n5 6\nInput input 0 1 data\nSplit splitncnn_0 1 2 data data_0 data_1\nReLU relu 1 1 data_0 relu\nAbsVal absval 1 1 data_1 absval\nEltwise add 2 1 relu absval output 0=1\n";
+
+    int ret = net.load_param_mem(param_txt);
+    if (ret != 0)
+        return ret;
+
+    DataReaderFromEmpty dr;
+    return net.load_model(dr);
+}
+
+static int test_profiler_0()
+{
+    ncnn::Net net;
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_profiler load net failed\n");
+        return -1;
+    }
+
+    ncnn::Mat in(5, 7, 16);
+    in.fill(-1.f);
+
+    ncnn::TraceProfiler profiler;
+
+    ncnn::Mat out;
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_profiler(&profiler);
+
+        ex.input("data", in);
+        int ret = ex.extract("output", out);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_profiler extract failed %d\n", ret);
+            return -1;
+        }
+    }
+
+    // every layer except input forwarded once
+    if (profiler.count() != 4)
+    {
+        fprintf(stderr, "test_profiler count failed %d != 4\n", profiler.count());
+        return -1;
+    }
+
+    for (int i = 0; i < profiler.count(); i++)
+    {
+        const ncnn::LayerProfile& profile = profiler.get(i);
+
+        if (profile.ret != 0 || !profile.layer || profile.layer != net.layers()[profile.layer_index])
+        {
+            fprintf(stderr, "test_profiler profile %d layer mismatch\n", i);
+            return -1;
+        }
+
+        if (profile.bottom_shapes.size() != profile.layer->bottoms.size() || profile.top_shapes.size() != profile.layer->tops.size())
+        {
+            fprintf(stderr, "test_profiler profile %d shape count mismatch\n", i);
+            return -1;
+        }
+
+        const ncnn::Mat& shape = profile.top_shapes[0];
+        if (shape.dims != 3 || shape.w != 5 || shape.h != 7 || shape.c * shape.elempack != 16 || shape.data)
+        {
+            fprintf(stderr, "test_profiler profile %d top shape mismatch\n", i);
+            return -1;
+        }
+    }
+
+    // the last one is the eltwise producing output and must allocate its top blob
+    const ncnn::LayerProfile& last = profiler.get(profiler.count() - 1);
+    if (last.layer_index != 4 || last.blob_allocated_bytes == 0)
+    {
+        fprintf(stderr, "test_profiler eltwise profile mismatch %d %d\n", last.layer_index, (int)last.blob_allocated_bytes);
+        return -1;
+    }
+
+    // relu + abs = 1 everywhere
+    for (int q = 0; q < out.c; q++)
+    {
+        const float* ptr = out.channel(q);
+        for (int i = 0; i < out.w * out.h; i++)
+        {
+            if (ptr[i] != 1.f)
+            {
+                fprintf(stderr, "test_profiler output value mismatch %f\n", ptr[i]);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_profiler_1()
+{
+    ncnn::Net net;
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_profiler load net failed\n");
+        return -1;
+    }
+
+    ncnn::Mat in(11, 3);
+    in.fill(2.f);
+
+    ncnn::TraceProfiler profiler;
+
+    // profiler detached, nothing recorded
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_profiler(&profiler);
+        ex.set_profiler(0);
+
+        ncnn::Mat out;
+        ex.input("data", in);
+        ex.extract("output", out);
+    }
+
+    if (profiler.count() != 0)
+    {
+        fprintf(stderr, "test_profiler detached count failed %d != 0\n", profiler.count());
+        return -1;
+    }
+
+    // output stays valid after extractor destroyed
+    ncnn::Mat out;
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_profiler(&profiler);
+
+        ex.input("data", in);
+        ex.extract("relu", out);
+    }
+
+    if (profiler.count() != 2 || out.w != 11 || out.h != 3 || out.row(2)[10] != 2.f)
+    {
+        fprintf(stderr, "test_profiler partial extract failed %d\n", profiler.count());
+        return -1;
+    }
+
+    profiler.clear();
+    if (profiler.count() != 0)
+    {
+        fprintf(stderr, "test_profiler clear failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_profiler_2()
+{
+    ncnn::Net net;
+    net.opt.num_threads = 1;
+
+    const char param_txt[] = "7767517\n3 3\nInput input 0 1 data\nConvolution conv 1 1 data conv 0=8 1=3 5=1 6=216\nReLU relu 1 1 conv output\n";
+
+    DataReaderFromEmpty dr;
+    if (net.load_param_mem(param_txt) != 0 || net.load_model(dr) != 0)
+    {
+        fprintf(stderr, "test_profiler load net failed\n");
+        return -1;
+    }
+
+    std::vector<ncnn::Mat> inputs(1);
+    inputs[0].create(6, 6, 3);
+    inputs[0].fill(1.f);
+
+    std::vector<ncnn::LayerCost> costs;
+    int ret = net.estimate_cost(inputs, costs);
+    if (ret != 0 || costs.size() != 3)
+    {
+        fprintf(stderr, "test_profiler estimate_cost failed %d\n", ret);
+        return -1;
+    }
+
+    // 4x4x8 outputs with 3x3x3 multiply-add each
+    if (costs[1].flops != 4 * 4 * 8 * 27 * 2 || costs[1].weight_bytes != 216 * 4 || costs[1].read_bytes != 6 * 6 * 3 * 4)
+    {
+        fprintf(stderr, "test_profiler conv cost mismatch %d %d %d\n", (int)costs[1].flops, (int)costs[1].weight_bytes, (int)costs[1].read_bytes);
+        return -1;
+    }
+
+    if (costs[2].flops != 4 * 4 * 8 || costs[2].weight_bytes != 0)
+    {
+        fprintf(stderr, "test_profiler relu cost mismatch %d %d\n", (int)costs[2].flops, (int)costs[2].weight_bytes);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main()
+{
+    return 0
+           || test_profiler_0()
+           || test_profiler_1()
+           || test_profiler_2();
+}
@@ -0,0 +1,306 @@
+// Copyright 2026 Tencent
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "cpu.h"
+#include "datareader.h"
+#include "net.h"
+#include "platform.h"
+#include "testutil.h"
+#include "threadpool.h"
+
+// copies out of a float buffer, so that the net keeps no reference into it
+class DataReaderFromFloats : public ncnn::DataReader
+{
+public:
+    DataReaderFromFloats(const std::vector<float>& _data)
+        : data(_data), offset(0)
+    {
+    }
+    virtual int scan(const char* format, void* p) const
+    {
+        return 0;
+    }
+    virtual size_t read(void* buf, size_t size) const
+    {
+        size = std::min(size, data.size() * sizeof(float) - offset);
+        memcpy(buf, (const unsigned char*)data.data() + offset, size);
+        offset += size;
+        return size;
+    }
+
+private:
+    const std::vector<float>& data;
+    mutable size_t offset;
+};
+
+static ncnn::CpuSet get_lane_cpus(int lane, int lane_count)
+{
+    // split the cpus into lanes, every lane gets at least cpu 0 on small machines
+    const int cpu_count = ncnn::get_cpu_count();
+    const int lane_size = std::max(cpu_count / lane_count, 1);
+
+    ncnn::CpuSet cpus;
+    cpus.disable_all();
+    for (int i = 0; i < lane_size; i++)
+    {
+        cpus.enable((lane * lane_size + i) % cpu_count);
+    }
+
+    return cpus;
+}
+
+struct run_args
+{
+    const ncnn::ThreadPool* pool;
+    int value;
+};
+
+static int run_job(void* arg)
+{
+    run_args* a = (run_args*)arg;
+
+    if (!a->pool->is_current())
+        return -1;
+
+    return a->value;
+}
+
+static int run_nested(void* arg)
+{
+    run_args* a = (run_args*)arg;
+
+    // nested run on the lane thread must not deadlock
+    return ((ncnn::ThreadPool*)a->pool)->run(run_job, arg) + 1;
+}
+
+static int test_threadpool_0()
+{
+    ncnn::ThreadPool pool(get_lane_cpus(0, 1));
+
+    if (pool.num_threads() != pool.cpus().num_enabled())
+    {
+        fprintf(stderr, "test_threadpool num_threads %d mismatch\n", pool.num_threads());
+        return -1;
+    }
+
+    if (pool.is_current())
+    {
+        fprintf(stderr, "test_threadpool caller is lane thread\n");
+        return -1;
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        run_args a;
+        a.pool = &pool;
+        a.value = i;
+
+        int ret = pool.run(i % 2 ? run_nested : run_job, &a);
+        if (ret != i + i % 2)
+        {
+            fprintf(stderr, "test_threadpool run returned %d for %d\n", ret, i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int load_test_net(ncnn::Net& net)
+{
+    net.opt.use_local_pool_allocator = false;
+
+    const char param_txt[] = "7767517\n3 3\nInput input 0 1 data\nConvolution conv 1 1 data conv 0=16 1=3 4=1 5=1 6=432\nReLU relu 1 1 conv output\n";
+
+    int ret = net.load_param_mem(param_txt);
+    if (ret != 0)
+        return ret;
+
+    // random weights so that a wrong forward shows up in the outputs, the same for every net
+    // the zero flag marks raw fp32 weight, the bias follows without flag
+    static std::vector<float> model;
+    if (model.empty())
+    {
+        ncnn::Mat weight = RandomMat(432);
+        ncnn::Mat bias = RandomMat(16);
+
+        model.resize(1 + 432 + 16, 0.f);
+        memcpy(&model[1], weight, 432 * sizeof(float));
+        memcpy(&model[1 + 432], bias, 16 * sizeof(float));
+    }
+
+    DataReaderFromFloats dr(model);
+    return net.load_model(dr);
+}
+
+struct lane_args
+{
+    const ncnn::Net* net;
+    ncnn::ThreadPool* pool;
+    const ncnn::Mat* in;
+    int ret;
+};
+
+static void* lane_extract(void* args)
+{
+    lane_args* a = (lane_args*)args;
+
+    a->ret = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        ncnn::Extractor ex = a->net->create_extractor();
+        ex.set_thread_pool(a->pool);
+        ex.input("data", *a->in);
+
+        ncnn::Mat out;
+        if (ex.extract("output", out) != 0 || out.w != a->in->w || out.h != a->in->h || out.c != 16)
+        {
+            a->ret = -1;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static int test_threadpool_1()
+{
+    ncnn::Net net;
+    if (load_test_net(net) != 0)
+    {
+        fprintf(stderr, "test_threadpool load net failed\n");
+        return -1;
+    }
+
+    ncnn::Mat in = RandomMat(32, 24, 3);
+
+    ncnn::Mat ref;
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input("data", in);
+        ex.extract("output", ref);
+    }
+
+    // the same result on a pool
+    {
+        ncnn::ThreadPool pool(get_lane_cpus(0, 1), 2);
+
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_thread_pool(&pool);
+        ex.input("data", in);
+
+        ncnn::Mat out;
+        int ret = ex.extract("output", out);
+        if (ret != 0 || out.w != ref.w || out.h != ref.h || out.c != ref.c)
+        {
+            fprintf(stderr, "test_threadpool extract on pool failed %d\n", ret);
+            return -1;
+        }
+
+        for (int q = 0; q < out.c; q++)
+        {
+            if (memcmp(out.channel(q), ref.channel(q), out.w * out.h * sizeof(float)) != 0)
+            {
+                fprintf(stderr, "test_threadpool extract on pool value mismatch\n");
+                return -1;
+            }
+        }
+    }
+
+    // concurrent extractors on separate lanes
+    {
+        ncnn::ThreadPool pool0(get_lane_cpus(0, 2));
+        ncnn::ThreadPool pool1(get_lane_cpus(1, 2));
+
+        lane_args a0 = {&net, &pool0, &in, 0};
+        lane_args a1 = {&net, &pool1, &in, 0};
+
+        ncnn::Thread t0(lane_extract, &a0);
+        ncnn::Thread t1(lane_extract, &a1);
+        t0.join();
+        t1.join();
+
+        if (a0.ret != 0 || a1.ret != 0)
+        {
+            fprintf(stderr, "test_threadpool concurrent lanes failed\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_threadpool_2()
+{
+    ncnn::Mat in = RandomMat(32, 24, 3);
+
+    ncnn::Mat ref;
+    {
+        ncnn::Net net;
+        if (load_test_net(net) != 0)
+        {
+            fprintf(stderr, "test_threadpool load net failed\n");
+            return -1;
+        }
+
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input("data", in);
+        ex.extract("output", ref);
+    }
+
+    // weights loaded by the last node and extractors running there, then interleaved weights
+    for (int i = 0; i < 2; i++)
+    {
+        const int node = ncnn::get_numa_node_count() - 1;
+
+        ncnn::Net net;
+        net.opt.numa_node = i == 0 ? node : -1;
+        net.opt.use_numa_interleave = i == 1;
+        if (load_test_net(net) != 0)
+        {
+            fprintf(stderr, "test_threadpool load net on numa node failed\n");
+            return -1;
+        }
+
+        ncnn::ThreadPool pool(ncnn::get_numa_node_affinity_mask(node));
+
+        ncnn::Extractor ex = net.create_extractor();
+        if (i == 0)
+            ex.set_thread_pool(&pool);
+        ex.input("data", in);
+
+        ncnn::Mat out;
+        int ret = ex.extract("output", out);
+        if (ret != 0 || out.w != ref.w || out.h != ref.h || out.c != ref.c)
+        {
+            fprintf(stderr, "test_threadpool extract on numa node failed %d\n", ret);
+            return -1;
+        }
+
+        for (int q = 0; q < out.c; q++)
+        {
+            if (memcmp(out.channel(q), ref.channel(q), out.w * out.h * sizeof(float)) != 0)
+            {
+                fprintf(stderr, "test_threadpool extract on numa node value mismatch\n");
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main()
+{
+    SRAND(7767517);
+
+    return 0
+           || test_threadpool_0()
+           || test_threadpool_1()
+           || test_threadpool_2();
+}
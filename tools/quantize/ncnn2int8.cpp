@@ -34,10 +34,13 @@ public:
     }
 };
 
-static bool read_int8scale_table(const char* filepath, std::map<std::string, ncnn::Mat>& blob_int8scale_table, std::map<std::string, ncnn::Mat>& weight_int8scale_table)
+static bool read_int8scale_table(const char* filepath, std::map<std::string, ncnn::Mat>& blob_int8scale_table, std::map<std::string, ncnn::Mat>& weight_int8scale_table, std::map<std::string, ncnn::Mat>& smooth_scale_table, std::map<std::string, ncnn::Mat>& equalize_scale_table, std::map<std::string, ncnn::Mat>& bias_correction_table)
 {
     blob_int8scale_table.clear();
     weight_int8scale_table.clear();
+    smooth_scale_table.clear();
+    equalize_scale_table.clear();
+    bias_correction_table.clear();
 
     FILE* fp = fopen(filepath, "rb");
     if (!fp)
@@ -92,6 +95,21 @@ static bool read_int8scale_table(const char* filepath, std::map<std::string, ncn
         {
             weight_int8scale_table[key_str] = ncnn::Mat((int)scales.size(), (void*)scales.data()).clone();
         }
+        // XYZ_smooth pattern
+        else if (key_str.size() > 7 && key_str.compare(key_str.size() - 7, 7, "_smooth") == 0)
+        {
+            smooth_scale_table[key_str.substr(0, key_str.size() - 7)] = ncnn::Mat((int)scales.size(), (void*)scales.data()).clone();
+        }
+        // XYZ_equalize pattern
+        else if (key_str.size() > 9 && key_str.compare(key_str.size() - 9, 9, "_equalize") == 0)
+        {
+            equalize_scale_table[key_str.substr(0, key_str.size() - 9)] = ncnn::Mat((int)scales.size(), (void*)scales.data()).clone();
+        }
+        // XYZ_bias_correction pattern
+        else if (key_str.size() > 16 && key_str.compare(key_str.size() - 16, 16, "_bias_correction") == 0)
+        {
+            bias_correction_table[key_str.substr(0, key_str.size() - 16)] = ncnn::Mat((int)scales.size(), (void*)scales.data()).clone();
+        }
         else
         {
             blob_int8scale_table[key_str] = ncnn::Mat((int)scales.size(), (void*)scales.data()).clone();
@@ -105,6 +123,62 @@ static bool read_int8scale_table(const char* filepath, std::map<std::string, ncn
     return true;
 }
 
+static void get_multiheadattention_qkv_blobs(const ncnn::MultiHeadAttention* mha, int& q_blob, int& k_blob, int& v_blob)
+{
+    // keep in sync with MultiHeadAttention::forward
+    const std::vector<int>& bottoms = mha->bottoms;
+    const size_t bottom_count = bottoms.size();
+    const int attn_mask = mha->attn_mask;
+
+    q_blob = bottoms[0];
+    k_blob = (bottom_count == 1 || (bottom_count == 2 && attn_mask)) ? q_blob : bottoms[1];
+    v_blob = (bottom_count == 1 || (bottom_count == 2 && attn_mask)) ? q_blob : (bottom_count == 2 || (bottom_count == 3 && attn_mask)) ? k_blob : bottoms[2];
+}
+
+// collect the layers consuming the blob directly or through Split
+static bool find_smooth_consumers(const std::vector<ncnn::Blob>& blobs, const std::vector<ncnn::Layer*>& layers, int blob_index, std::set<int>& smooth_blobs, std::set<int>& consumers)
+{
+    const int consumer = blobs[blob_index].consumer;
+    if (consumer == -1)
+        return false;
+
+    smooth_blobs.insert(blob_index);
+
+    const ncnn::Layer* layer = layers[consumer];
+    if (layer->type == "Split")
+    {
+        for (size_t i = 0; i < layer->tops.size(); i++)
+        {
+            if (!find_smooth_consumers(blobs, layers, layer->tops[i], smooth_blobs, consumers))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (layer->type != "InnerProduct" && layer->type != "Gemm" && layer->type != "MultiHeadAttention")
+        return false;
+
+    consumers.insert(consumer);
+
+    return true;
+}
+
+// weight is laid out as [outch][inch] when transpose is 0, or as [inch][outch] when transpose is 1
+static void smooth_weight(ncnn::Mat& weight, int inch, int transpose, const ncnn::Mat& smooth_scale)
+{
+    const int outch = (int)weight.total() / inch;
+
+    for (int i = 0; i < outch; i++)
+    {
+        for (int k = 0; k < inch; k++)
+        {
+            float& v = transpose ? weight[k * outch + i] : weight[i * inch + k];
+            v *= smooth_scale[k];
+        }
+    }
+}
+
 class NetQuantize : public ModelWriter
 {
 public:
@@ -112,8 +186,15 @@ public:
 
     std::map<std::string, ncnn::Mat> blob_int8scale_table;
     std::map<std::string, ncnn::Mat> weight_int8scale_table;
+    std::map<std::string, ncnn::Mat> smooth_scale_table;
+    std::map<std::string, ncnn::Mat> equalize_scale_table;
+    std::map<std::string, ncnn::Mat> bias_correction_table;
 
 public:
+    int smooth_layernorm();
+    int equalize_convolution();
+    int correct_bias();
+
     int quantize_convolution();
     int quantize_convolutiondepthwise();
     int quantize_innerproduct();
@@ -134,6 +215,287 @@ NetQuantize::NetQuantize()
 {
 }
 
+int NetQuantize::smooth_layernorm()
+{
+    const int layer_count = static_cast<int>(layers.size());
+    for (int i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "LayerNorm" && layers[i]->type != "RMSNorm")
+            continue;
+
+        std::map<std::string, ncnn::Mat>::iterator iter = smooth_scale_table.find(layers[i]->name);
+        if (iter == smooth_scale_table.end())
+            continue;
+
+        const ncnn::Mat smooth_scale = iter->second;
+        const int channels = smooth_scale.w;
+
+        std::set<int> smooth_blobs;
+        std::set<int> consumers;
+        if (!find_smooth_consumers(blobs, layers, layers[i]->tops[0], smooth_blobs, consumers))
+        {
+            fprintf(stderr, "layer %s has smooth scales, but its output is not only consumed by matmul!\n", layers[i]->name.c_str());
+            return -1;
+        }
+
+        fprintf(stderr, "smooth_layernorm %s\n", layers[i]->name.c_str());
+
+        // X / s
+        if (layers[i]->type == "LayerNorm")
+        {
+            ncnn::LayerNorm* layernorm = (ncnn::LayerNorm*)layers[i];
+            if (!layernorm->affine || layernorm->affine_size != channels)
+            {
+                fprintf(stderr, "smooth scales size mismatch for %s\n", layernorm->name.c_str());
+                return -1;
+            }
+
+            for (int k = 0; k < channels; k++)
+            {
+                layernorm->gamma_data[k] /= smooth_scale[k];
+                layernorm->beta_data[k] /= smooth_scale[k];
+            }
+        }
+        else
+        {
+            ncnn::RMSNorm* rmsnorm = (ncnn::RMSNorm*)layers[i];
+            if (!rmsnorm->affine || rmsnorm->affine_size != channels)
+            {
+                fprintf(stderr, "smooth scales size mismatch for %s\n", rmsnorm->name.c_str());
+                return -1;
+            }
+
+            for (int k = 0; k < channels; k++)
+            {
+                rmsnorm->gamma_data[k] /= smooth_scale[k];
+            }
+        }
+
+        // W * s
+        for (std::set<int>::iterator it = consumers.begin(); it != consumers.end(); it++)
+        {
+            ncnn::Layer* layer = layers[*it];
+
+            if (layer->type == "InnerProduct")
+            {
+                ncnn::InnerProduct* fc = (ncnn::InnerProduct*)layer;
+                smooth_weight(fc->weight_data, channels, 0, smooth_scale);
+            }
+
+            if (layer->type == "Gemm")
+            {
+                ncnn::Gemm* gemm = (ncnn::Gemm*)layer;
+                smooth_weight(gemm->B_data, channels, gemm->transB ? 0 : 1, smooth_scale);
+            }
+
+            if (layer->type == "MultiHeadAttention")
+            {
+                ncnn::MultiHeadAttention* mha = (ncnn::MultiHeadAttention*)layer;
+
+                int q_blob;
+                int k_blob;
+                int v_blob;
+                get_multiheadattention_qkv_blobs(mha, q_blob, k_blob, v_blob);
+
+                if (smooth_blobs.count(q_blob))
+                    smooth_weight(mha->q_weight_data, channels, 0, smooth_scale);
+                if (smooth_blobs.count(k_blob))
+                    smooth_weight(mha->k_weight_data, channels, 0, smooth_scale);
+                if (smooth_blobs.count(v_blob))
+                    smooth_weight(mha->v_weight_data, channels, 0, smooth_scale);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int NetQuantize::equalize_convolution()
+{
+    const int layer_count = static_cast<int>(layers.size());
+    for (int i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "Convolution" && layers[i]->type != "ConvolutionDepthWise")
+            continue;
+
+        std::map<std::string, ncnn::Mat>::iterator iter = equalize_scale_table.find(layers[i]->name);
+        if (iter == equalize_scale_table.end())
+            continue;
+
+        const ncnn::Mat equalize_scale = iter->second;
+        const int channels = equalize_scale.w;
+
+        // conv -> (ReLU) -> conv
+        int consumer = blobs[layers[i]->tops[0]].consumer;
+        if (consumer != -1 && layers[consumer]->type == "ReLU")
+            consumer = blobs[layers[consumer]->tops[0]].consumer;
+
+        if (consumer == -1 || (layers[consumer]->type != "Convolution" && layers[consumer]->type != "ConvolutionDepthWise"))
+        {
+            fprintf(stderr, "layer %s has equalize scales, but it is not followed by convolution!\n", layers[i]->name.c_str());
+            return -1;
+        }
+
+        // output channels of the first and input channels of the second must match the scales
+        int num_output = 0;
+        if (layers[i]->type == "Convolution")
+            num_output = ((ncnn::Convolution*)layers[i])->num_output;
+        else
+            num_output = ((ncnn::ConvolutionDepthWise*)layers[i])->num_output;
+
+        int num_input = 0;
+        if (layers[consumer]->type == "Convolution")
+        {
+            const ncnn::Convolution* convolution = (const ncnn::Convolution*)layers[consumer];
+            num_input = convolution->weight_data_size / convolution->num_output / (convolution->kernel_w * convolution->kernel_h);
+        }
+        else
+        {
+            const ncnn::ConvolutionDepthWise* convdw = (const ncnn::ConvolutionDepthWise*)layers[consumer];
+            num_input = convdw->group == convdw->num_output ? convdw->group : -1;
+        }
+
+        if (num_output != channels || num_input != channels)
+        {
+            fprintf(stderr, "equalize scales size mismatch for %s %s\n", layers[i]->name.c_str(), layers[consumer]->name.c_str());
+            return -1;
+        }
+
+        fprintf(stderr, "equalize_convolution %s %s\n", layers[i]->name.c_str(), layers[consumer]->name.c_str());
+
+        // W1 / s  B1 / s
+        if (layers[i]->type == "Convolution")
+        {
+            ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
+
+            const int weight_data_size_output = convolution->weight_data_size / channels;
+            for (int p = 0; p < channels; p++)
+            {
+                float* ptr = (float*)convolution->weight_data + weight_data_size_output * p;
+                for (int k = 0; k < weight_data_size_output; k++)
+                {
+                    ptr[k] /= equalize_scale[p];
+                }
+
+                if (convolution->bias_term)
+                    convolution->bias_data[p] /= equalize_scale[p];
+            }
+        }
+        else
+        {
+            ncnn::ConvolutionDepthWise* convdw = (ncnn::ConvolutionDepthWise*)layers[i];
+
+            const int weight_data_size_output = convdw->weight_data_size / channels;
+            for (int p = 0; p < channels; p++)
+            {
+                float* ptr = (float*)convdw->weight_data + weight_data_size_output * p;
+                for (int k = 0; k < weight_data_size_output; k++)
+                {
+                    ptr[k] /= equalize_scale[p];
+                }
+
+                if (convdw->bias_term)
+                    convdw->bias_data[p] /= equalize_scale[p];
+            }
+        }
+
+        // W2 * s
+        if (layers[consumer]->type == "Convolution")
+        {
+            ncnn::Convolution* convolution = (ncnn::Convolution*)layers[consumer];
+
+            const int maxk = convolution->kernel_w * convolution->kernel_h;
+            for (int q = 0; q < convolution->num_output; q++)
+            {
+                for (int p = 0; p < channels; p++)
+                {
+                    float* ptr = (float*)convolution->weight_data + (q * channels + p) * maxk;
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        ptr[k] *= equalize_scale[p];
+                    }
+                }
+            }
+        }
+        else
+        {
+            ncnn::ConvolutionDepthWise* convdw = (ncnn::ConvolutionDepthWise*)layers[consumer];
+
+            const int maxk = convdw->kernel_w * convdw->kernel_h;
+            for (int p = 0; p < channels; p++)
+            {
+                float* ptr = (float*)convdw->weight_data + p * maxk;
+                for (int k = 0; k < maxk; k++)
+                {
+                    ptr[k] *= equalize_scale[p];
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int NetQuantize::correct_bias()
+{
+    const int layer_count = static_cast<int>(layers.size());
+    for (int i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "Convolution" && layers[i]->type != "ConvolutionDepthWise" && layers[i]->type != "InnerProduct")
+            continue;
+
+        std::map<std::string, ncnn::Mat>::iterator iter = bias_correction_table.find(layers[i]->name);
+        if (iter == bias_correction_table.end())
+            continue;
+
+        const ncnn::Mat bias_correction = iter->second;
+
+        int num_output = 0;
+        int* bias_term = 0;
+        ncnn::Mat* bias_data = 0;
+        if (layers[i]->type == "Convolution")
+        {
+            num_output = ((ncnn::Convolution*)layers[i])->num_output;
+            bias_term = &((ncnn::Convolution*)layers[i])->bias_term;
+            bias_data = &((ncnn::Convolution*)layers[i])->bias_data;
+        }
+        if (layers[i]->type == "ConvolutionDepthWise")
+        {
+            num_output = ((ncnn::ConvolutionDepthWise*)layers[i])->num_output;
+            bias_term = &((ncnn::ConvolutionDepthWise*)layers[i])->bias_term;
+            bias_data = &((ncnn::ConvolutionDepthWise*)layers[i])->bias_data;
+        }
+        if (layers[i]->type == "InnerProduct")
+        {
+            num_output = ((ncnn::InnerProduct*)layers[i])->num_output;
+            bias_term = &((ncnn::InnerProduct*)layers[i])->bias_term;
+            bias_data = &((ncnn::InnerProduct*)layers[i])->bias_data;
+        }
+
+        if (bias_correction.w != num_output)
+        {
+            fprintf(stderr, "bias correction size mismatch for %s\n", layers[i]->name.c_str());
+            return -1;
+        }
+
+        fprintf(stderr, "correct_bias %s\n", layers[i]->name.c_str());
+
+        if (!*bias_term)
+        {
+            bias_data->create(bias_correction.w);
+            bias_data->fill(0.f);
+            *bias_term = 1;
+        }
+
+        for (int p = 0; p < bias_correction.w; p++)
+        {
+            (*bias_data)[p] += bias_correction[p];
+        }
+    }
+
+    return 0;
+}
+
 int NetQuantize::quantize_convolution()
 {
     const int layer_count = static_cast<int>(layers.size());
@@ -1065,7 +1427,7 @@ int main(int argc, char** argv)
     // parse the calibration scale table
     if (int8scale_table_path)
     {
-        bool s2 = read_int8scale_table(int8scale_table_path, quantizer.blob_int8scale_table, quantizer.weight_int8scale_table);
+        bool s2 = read_int8scale_table(int8scale_table_path, quantizer.blob_int8scale_table, quantizer.weight_int8scale_table, quantizer.smooth_scale_table, quantizer.equalize_scale_table, quantizer.bias_correction_table);
         if (!s2)
         {
             fprintf(stderr, "read_int8scale_table failed\n");
@@ -1083,6 +1445,24 @@ int main(int argc, char** argv)
     else
         quantizer.load_model(inbin);
 
+    // apply the weight transforms found by ncnn2table before quantization
+    // a malformed table entry would write a silently wrong model
+    if (quantizer.smooth_layernorm() != 0)
+    {
+        fprintf(stderr, "smooth_layernorm failed\n");
+        return -1;
+    }
+    if (quantizer.equalize_convolution() != 0)
+    {
+        fprintf(stderr, "equalize_convolution failed\n");
+        return -1;
+    }
+    if (quantizer.correct_bias() != 0)
+    {
+        fprintf(stderr, "correct_bias failed\n");
+        return -1;
+    }
+
     quantizer.quantize_convolution();
     quantizer.quantize_convolutiondepthwise();
     quantizer.quantize_innerproduct();
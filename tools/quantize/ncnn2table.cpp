@@ -23,6 +23,7 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #endif
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -37,7 +38,11 @@
 // ncnn private header
 #include "layer/convolution.h"
 #include "layer/convolutiondepthwise.h"
+#include "layer/gemm.h"
 #include "layer/innerproduct.h"
+#include "layer/layernorm.h"
+#include "layer/multiheadattention.h"
+#include "layer/rmsnorm.h"
 
 class QuantBlobStat
 {
@@ -47,6 +52,7 @@ public:
         threshold = 0.f;
         absmax = 0.f;
         total = 0;
+        histogram_absmax = 0.f;
     }
 
 public:
@@ -57,6 +63,7 @@ public:
     int total;
 
     // KL
+    float histogram_absmax;
     std::vector<uint64_t> histogram;
     std::vector<float> histogram_normed;
 };
@@ -78,13 +85,28 @@ public:
     int quantize_num_threads;
     int file_type;
 
+    // single pass calibration
+    int stream;
+    int decode_num_threads;
+    std::string checkpoint_path;
+
 public:
     int init();
     void print_quant_info() const;
     int save_table(const char* tablepath);
+    void load_inputs(int file_index, std::vector<ncnn::Mat>& inputs) const;
     int quantize_KL();
     int quantize_ACIQ();
     int quantize_EQ();
+    int quantize_SQ();
+    int equalize_weights();
+    int correct_bias();
+
+protected:
+    int compute_kl_threshold(int num_histogram_bins);
+    int build_histogram_stream(int num_histogram_bins);
+    int save_checkpoint(int file_processed) const;
+    int load_checkpoint(int num_histogram_bins);
 
 public:
     std::vector<int> input_blobs;
@@ -96,12 +118,31 @@ public:
     std::vector<QuantBlobStat> quant_blob_stats;
     std::vector<ncnn::Mat> weight_scales;
     std::vector<ncnn::Mat> bottom_blob_scales;
+
+    // smoothquant
+    float smooth_alpha;
+    std::vector<int> smooth_layers;
+    std::vector<ncnn::Mat> smooth_scales;
+
+    // cross layer equalization
+    int equalize;
+    std::vector<int> equalize_layers;
+    std::vector<ncnn::Mat> equalize_scales;
+
+    // bias correction
+    int bias_correct;
+    std::vector<ncnn::Mat> bias_corrections;
 };
 
 QuantNet::QuantNet()
     : blobs(mutable_blobs()), layers(mutable_layers())
 {
     quantize_num_threads = ncnn::get_cpu_count();
+    stream = 0;
+    decode_num_threads = 2;
+    smooth_alpha = 0.5f;
+    equalize = 0;
+    bias_correct = 0;
 }
 
 int QuantNet::init()
@@ -176,6 +217,44 @@ int QuantNet::save_table(const char* tablepath)
         fprintf(fp, "\n");
     }
 
+    for (size_t i = 0; i < smooth_layers.size(); i++)
+    {
+        const ncnn::Mat& smooth_scale = smooth_scales[i];
+
+        fprintf(fp, "%s_smooth ", layers[smooth_layers[i]]->name.c_str());
+        for (int j = 0; j < smooth_scale.w; j++)
+        {
+            fprintf(fp, "%f ", smooth_scale[j]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    for (size_t i = 0; i < equalize_layers.size(); i++)
+    {
+        const ncnn::Mat& equalize_scale = equalize_scales[i];
+
+        fprintf(fp, "%s_equalize ", layers[equalize_layers[i]]->name.c_str());
+        for (int j = 0; j < equalize_scale.w; j++)
+        {
+            fprintf(fp, "%f ", equalize_scale[j]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    for (size_t i = 0; i < bias_corrections.size(); i++)
+    {
+        const ncnn::Mat& bias_correction = bias_corrections[i];
+        if (bias_correction.empty())
+            continue;
+
+        fprintf(fp, "%s_bias_correction ", layers[conv_layers[i]]->name.c_str());
+        for (int j = 0; j < bias_correction.w; j++)
+        {
+            fprintf(fp, "%f ", bias_correction[j]);
+        }
+        fprintf(fp, "\n");
+    }
+
     fclose(fp);
 
     fprintf(stderr, "ncnn int8 calibration table create success, best wish for your int8 inference has a low accuracy loss...\\(^0^)/...233...\n");
@@ -407,6 +486,15 @@ int QuantNet::quantize_KL()
         }
     }
 
+    if (stream)
+    {
+        int ret = build_histogram_stream(num_histogram_bins);
+        if (ret != 0)
+            return ret;
+
+        return compute_kl_threshold(num_histogram_bins);
+    }
+
     // count the absmax
     #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
     for (int i = 0; i < file_count; i++)
@@ -484,6 +572,7 @@ int QuantNet::quantize_KL()
     {
         QuantBlobStat& stat = quant_blob_stats[i];
 
+        stat.histogram_absmax = stat.absmax;
         stat.histogram.resize(num_histogram_bins, 0);
         stat.histogram_normed.resize(num_histogram_bins, 0);
     }
@@ -570,6 +659,13 @@ int QuantNet::quantize_KL()
         }
     }
 
+    return compute_kl_threshold(num_histogram_bins);
+}
+
+int QuantNet::compute_kl_threshold(int num_histogram_bins)
+{
+    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+
     // using kld to find the best threshold value
     #pragma omp parallel for num_threads(quantize_num_threads)
     for (int i = 0; i < conv_bottom_blob_count; i++)
@@ -754,7 +850,7 @@ int QuantNet::quantize_KL()
             }
         }
 
-        stat.threshold = (target_threshold + 0.5f) * stat.absmax / num_histogram_bins;
+        stat.threshold = (target_threshold + 0.5f) * stat.histogram_absmax / num_histogram_bins;
         float scale = 127 / stat.threshold;
 
         bottom_blob_scales[i].create(1);
@@ -764,608 +860,1845 @@ int QuantNet::quantize_KL()
     return 0;
 }
 
-static float compute_aciq_gaussian_clip(float absmax, int N, int num_bits = 8)
-{
-    const float alpha_gaussian[8] = {0, 1.71063519, 2.15159277, 2.55913646, 2.93620062, 3.28691474, 3.6151146, 3.92403714};
-
-    const double gaussian_const = (0.5 * 0.35) * (1 + sqrt(3.14159265358979323846 * log(4)));
-
-    double std = (absmax * 2 * gaussian_const) / sqrt(2 * log(N));
-
-    return (float)(alpha_gaussian[num_bits - 1] * std);
-}
-
-int QuantNet::quantize_ACIQ()
+void QuantNet::load_inputs(int file_index, std::vector<ncnn::Mat>& inputs) const
 {
     const int input_blob_count = (int)input_blobs.size();
-    const int conv_layer_count = (int)conv_layers.size();
-    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
-    const int file_count = (int)listspaths[0].size();
 
-    std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(quantize_num_threads);
-    std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(quantize_num_threads);
+    inputs.resize(input_blob_count);
 
-    // initialize conv weight scales
-    #pragma omp parallel for num_threads(quantize_num_threads)
-    for (int i = 0; i < conv_layer_count; i++)
+    for (int j = 0; j < input_blob_count; j++)
     {
-        const ncnn::Layer* layer = layers[conv_layers[i]];
-
-        if (layer->type == "Convolution")
+        if (0 == file_type)
         {
-            const ncnn::Convolution* convolution = (const ncnn::Convolution*)layer;
-
-            const int num_output = convolution->num_output;
-            const int kernel_w = convolution->kernel_w;
-            const int kernel_h = convolution->kernel_h;
-            const int dilation_w = convolution->dilation_w;
-            const int dilation_h = convolution->dilation_h;
-            const int stride_w = convolution->stride_w;
-            const int stride_h = convolution->stride_h;
-
-            const int weight_data_size_output = convolution->weight_data_size / num_output;
-
-            // int8 winograd F43 needs weight data to use 6bit quantization
-            // TODO proper condition for winograd 3x3 int8
-            bool quant_6bit = false;
-            if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
-                quant_6bit = true;
+            const int type_to_pixel = type_to_pixels[j];
+            const std::vector<float>& mean_vals = means[j];
+            const std::vector<float>& norm_vals = norms[j];
 
-            weight_scales[i].create(num_output);
-
-            for (int n = 0; n < num_output; n++)
+            int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
+            if (type_to_pixel != pixel_convert_type)
             {
-                const ncnn::Mat weight_data_n = convolution->weight_data.range(weight_data_size_output * n, weight_data_size_output);
-
-                float absmax = 0.f;
-                for (int k = 0; k < weight_data_size_output; k++)
-                {
-                    absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-                }
-
-                if (quant_6bit)
-                {
-                    const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output, 6);
-                    weight_scales[i][n] = 31 / threshold;
-                }
-                else
-                {
-                    const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output);
-                    weight_scales[i][n] = 127 / threshold;
-                }
+                pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
             }
+            inputs[j] = read_and_resize_image(shapes[j], listspaths[j][file_index], pixel_convert_type);
+            inputs[j].substract_mean_normalize(mean_vals.data(), norm_vals.data());
         }
-
-        if (layer->type == "ConvolutionDepthWise")
+        else
         {
-            const ncnn::ConvolutionDepthWise* convolutiondepthwise = (const ncnn::ConvolutionDepthWise*)layer;
-
-            const int group = convolutiondepthwise->group;
-            const int weight_data_size_output = convolutiondepthwise->weight_data_size / group;
+            inputs[j] = read_npy(shapes[j], listspaths[j][file_index]);
+        }
+    }
+}
 
-            std::vector<float> scales;
+// decode calibration inputs ahead of inference on dedicated threads
+// inputs of file i are kept in ring slot i % capacity until taken
+class QuantInputPrefetcher
+{
+public:
+    QuantInputPrefetcher(const QuantNet* net, int file_start, int file_end, int num_threads, int capacity);
+    ~QuantInputPrefetcher();
 
-            weight_scales[i].create(group);
+    // block until the inputs of file_index are decoded
+    void take(int file_index, std::vector<ncnn::Mat>& inputs);
 
-            for (int n = 0; n < group; n++)
-            {
-                const ncnn::Mat weight_data_n = convolutiondepthwise->weight_data.range(weight_data_size_output * n, weight_data_size_output);
+protected:
+    static void* decode_worker(void* args);
 
-                float absmax = 0.f;
-                for (int k = 0; k < weight_data_size_output; k++)
-                {
-                    absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-                }
+    const QuantNet* net;
+    int file_end;
+    int capacity;
 
-                const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output);
-                weight_scales[i][n] = 127 / threshold;
-            }
-        }
+    ncnn::Mutex lock;
+    ncnn::ConditionVariable condition;
 
-        if (layer->type == "InnerProduct")
-        {
-            const ncnn::InnerProduct* innerproduct = (const ncnn::InnerProduct*)layer;
+    int next_file_index;
+    // 0 = empty  1 = decoding  2 = ready
+    std::vector<int> slot_states;
+    std::vector<int> slot_file_indexes;
+    std::vector<std::vector<ncnn::Mat> > slot_inputs;
 
-            const int num_output = innerproduct->num_output;
-            const int weight_data_size_output = innerproduct->weight_data_size / num_output;
+    std::vector<ncnn::Thread*> workers;
+};
 
-            weight_scales[i].create(num_output);
+QuantInputPrefetcher::QuantInputPrefetcher(const QuantNet* _net, int file_start, int _file_end, int num_threads, int _capacity)
+    : net(_net), file_end(_file_end), capacity(_capacity)
+{
+    next_file_index = file_start;
+    slot_states.resize(capacity, 0);
+    slot_file_indexes.resize(capacity, -1);
+    slot_inputs.resize(capacity);
 
-            for (int n = 0; n < num_output; n++)
-            {
-                const ncnn::Mat weight_data_n = innerproduct->weight_data.range(weight_data_size_output * n, weight_data_size_output);
+#if NCNN_THREADS
+    for (int i = 0; i < num_threads; i++)
+    {
+        workers.push_back(new ncnn::Thread(decode_worker, this));
+    }
+#else
+    (void)num_threads;
+#endif
+}
 
-                float absmax = 0.f;
-                for (int k = 0; k < weight_data_size_output; k++)
-                {
-                    absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-                }
+QuantInputPrefetcher::~QuantInputPrefetcher()
+{
+    lock.lock();
+    next_file_index = file_end;
+    condition.broadcast();
+    lock.unlock();
 
-                const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output);
-                weight_scales[i][n] = 127 / threshold;
-            }
-        }
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i]->join();
+        delete workers[i];
     }
+}
 
-    // count the absmax
-    #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
-    for (int i = 0; i < file_count; i++)
+void* QuantInputPrefetcher::decode_worker(void* args)
+{
+    QuantInputPrefetcher* prefetcher = (QuantInputPrefetcher*)args;
+
+    for (;;)
     {
-        if (i % 100 == 0)
+        prefetcher->lock.lock();
+        while (prefetcher->next_file_index < prefetcher->file_end && prefetcher->slot_states[prefetcher->next_file_index % prefetcher->capacity] != 0)
         {
-            fprintf(stderr, "count the absmax %.2f%% [ %d / %d ]\n", i * 100.f / file_count, i, file_count);
+            prefetcher->condition.wait(prefetcher->lock);
         }
 
-        ncnn::Extractor ex = create_extractor();
-        ex.set_light_mode(true);
+        if (prefetcher->next_file_index >= prefetcher->file_end)
+        {
+            prefetcher->lock.unlock();
+            break;
+        }
 
-        const int thread_num = ncnn::get_omp_thread_num();
-        ex.set_blob_allocator(&blob_allocators[thread_num]);
-        ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+        const int file_index = prefetcher->next_file_index++;
+        const int slot = file_index % prefetcher->capacity;
+        prefetcher->slot_states[slot] = 1;
+        prefetcher->slot_file_indexes[slot] = file_index;
+        prefetcher->lock.unlock();
 
-        for (int j = 0; j < input_blob_count; j++)
-        {
-            ncnn::Mat in;
+        std::vector<ncnn::Mat> inputs;
+        prefetcher->net->load_inputs(file_index, inputs);
 
-            if (0 == file_type)
-            {
-                const int type_to_pixel = type_to_pixels[j];
-                const std::vector<float>& mean_vals = means[j];
-                const std::vector<float>& norm_vals = norms[j];
+        prefetcher->lock.lock();
+        prefetcher->slot_inputs[slot] = inputs;
+        prefetcher->slot_states[slot] = 2;
+        prefetcher->condition.broadcast();
+        prefetcher->lock.unlock();
+    }
 
-                int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
-                if (type_to_pixel != pixel_convert_type)
-                {
-                    pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
-                }
-                in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
-                in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
-            }
-            else
-            {
-                in = read_npy(shapes[j], listspaths[j][i]);
-            }
+    return 0;
+}
 
-            ex.input(input_blobs[j], in);
-        }
+void QuantInputPrefetcher::take(int file_index, std::vector<ncnn::Mat>& inputs)
+{
+    if (workers.empty())
+    {
+        // no decode thread, decode in place
+        net->load_inputs(file_index, inputs);
+        return;
+    }
 
-        for (int j = 0; j < conv_bottom_blob_count; j++)
-        {
-            ncnn::Mat out;
-            ex.extract(conv_bottom_blobs[j], out);
+    const int slot = file_index % capacity;
 
-            // count absmax
-            {
-                float absmax = 0.f;
+    lock.lock();
+    while (slot_states[slot] != 2 || slot_file_indexes[slot] != file_index)
+    {
+        condition.wait(lock);
+    }
 
-                const int outc = out.c;
-                const int outsize = out.w * out.h;
-                for (int p = 0; p < outc; p++)
-                {
-                    const float* ptr = out.channel(p);
-                    for (int k = 0; k < outsize; k++)
-                    {
-                        absmax = std::max(absmax, (float)fabs(ptr[k]));
-                    }
-                }
+    inputs = slot_inputs[slot];
+    slot_inputs[slot].clear();
+    slot_states[slot] = 0;
+    condition.broadcast();
+    lock.unlock();
+}
 
-                #pragma omp critical
-                {
-                    QuantBlobStat& stat = quant_blob_stats[j];
-                    stat.absmax = std::max(stat.absmax, absmax);
-                    stat.total = outc * outsize;
-                }
-            }
-        }
+int QuantNet::save_checkpoint(int file_processed) const
+{
+    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+    const int file_count = (int)listspaths[0].size();
+
+    // write to a temporary file first so that a crash never leaves a broken checkpoint
+    const std::string tmppath = checkpoint_path + ".tmp";
+
+    FILE* fp = fopen(tmppath.c_str(), "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", tmppath.c_str());
+        return -1;
     }
 
-    // alpha gaussian
-    #pragma omp parallel for num_threads(quantize_num_threads)
+    const int num_histogram_bins = (int)quant_blob_stats[0].histogram.size();
+
+    const int header[4] = {file_count, file_processed, conv_bottom_blob_count, num_histogram_bins};
+    fwrite(header, sizeof(int), 4, fp);
+
     for (int i = 0; i < conv_bottom_blob_count; i++)
     {
-        QuantBlobStat& stat = quant_blob_stats[i];
+        const QuantBlobStat& stat = quant_blob_stats[i];
 
-        stat.threshold = compute_aciq_gaussian_clip(stat.absmax, stat.total);
-        float scale = 127 / stat.threshold;
+        fwrite(&stat.absmax, sizeof(float), 1, fp);
+        fwrite(&stat.histogram_absmax, sizeof(float), 1, fp);
+        fwrite(stat.histogram.data(), sizeof(uint64_t), num_histogram_bins, fp);
+    }
 
-        bottom_blob_scales[i].create(1);
-        bottom_blob_scales[i][0] = scale;
+    fclose(fp);
+
+    remove(checkpoint_path.c_str());
+    if (rename(tmppath.c_str(), checkpoint_path.c_str()) != 0)
+    {
+        fprintf(stderr, "rename %s to %s failed\n", tmppath.c_str(), checkpoint_path.c_str());
+        return -1;
     }
 
     return 0;
 }
 
-static float cosine_similarity(const ncnn::Mat& a, const ncnn::Mat& b)
+// return the number of files already processed, or 0 when there is no usable checkpoint
+int QuantNet::load_checkpoint(int num_histogram_bins)
 {
-    const int chanenls = a.c;
-    const int size = a.w * a.h;
+    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+    const int file_count = (int)listspaths[0].size();
 
-    float sa = 0;
-    float sb = 0;
-    float sum = 0;
+    FILE* fp = fopen(checkpoint_path.c_str(), "rb");
+    if (!fp)
+        return 0;
 
-    for (int p = 0; p < chanenls; p++)
+    int header[4] = {0, 0, 0, 0};
+    if (fread(header, sizeof(int), 4, fp) != 4 || header[0] != file_count || header[2] != conv_bottom_blob_count || header[3] != num_histogram_bins)
     {
-        const float* pa = a.channel(p);
-        const float* pb = b.channel(p);
+        fprintf(stderr, "checkpoint %s does not match the calibration setup, start over\n", checkpoint_path.c_str());
+        fclose(fp);
+        return 0;
+    }
 
-        for (int i = 0; i < size; i++)
+    for (int i = 0; i < conv_bottom_blob_count; i++)
+    {
+        QuantBlobStat& stat = quant_blob_stats[i];
+
+        size_t nread = 0;
+        nread += fread(&stat.absmax, sizeof(float), 1, fp);
+        nread += fread(&stat.histogram_absmax, sizeof(float), 1, fp);
+        nread += fread(stat.histogram.data(), sizeof(uint64_t), num_histogram_bins, fp);
+        if (nread != (size_t)(2 + num_histogram_bins))
         {
-            sa += pa[i] * pa[i];
-            sb += pb[i] * pb[i];
-            sum += pa[i] * pb[i];
+            fprintf(stderr, "checkpoint %s is truncated, start over\n", checkpoint_path.c_str());
+            fclose(fp);
+
+            for (int j = 0; j < conv_bottom_blob_count; j++)
+            {
+                quant_blob_stats[j].absmax = 0.f;
+                quant_blob_stats[j].histogram_absmax = 0.f;
+                std::fill(quant_blob_stats[j].histogram.begin(), quant_blob_stats[j].histogram.end(), 0);
+            }
+            return 0;
         }
     }
 
-    float sim = (float)sum / sqrt(sa) / sqrt(sb);
+    fclose(fp);
 
-    return sim;
+    fprintf(stderr, "resume from checkpoint %s [ %d / %d ]\n", checkpoint_path.c_str(), header[1], file_count);
+
+    return header[1];
 }
 
-static int get_layer_param(const ncnn::Layer* layer, ncnn::ParamDict& pd)
+// merge histogram bins pairwise until the range covers absmax
+static void grow_histogram_range(QuantBlobStat& stat, float absmax)
 {
-    if (layer->type == "Convolution")
-    {
-        ncnn::Convolution* convolution = (ncnn::Convolution*)layer;
-
-        pd.set(0, convolution->num_output);
-        pd.set(1, convolution->kernel_w);
-        pd.set(11, convolution->kernel_h);
-        pd.set(2, convolution->dilation_w);
-        pd.set(12, convolution->dilation_h);
-        pd.set(3, convolution->stride_w);
-        pd.set(13, convolution->stride_h);
-        pd.set(4, convolution->pad_left);
-        pd.set(15, convolution->pad_right);
-        pd.set(14, convolution->pad_top);
-        pd.set(16, convolution->pad_bottom);
-        pd.set(18, convolution->pad_value);
-        pd.set(5, convolution->bias_term);
-        pd.set(6, convolution->weight_data_size);
-        pd.set(8, convolution->int8_scale_term);
-        pd.set(9, convolution->activation_type);
-        pd.set(10, convolution->activation_params);
-    }
-    else if (layer->type == "ConvolutionDepthWise")
-    {
-        ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layer;
+    const int num_histogram_bins = (int)stat.histogram.size();
 
-        pd.set(0, convolutiondepthwise->num_output);
-        pd.set(1, convolutiondepthwise->kernel_w);
-        pd.set(11, convolutiondepthwise->kernel_h);
-        pd.set(2, convolutiondepthwise->dilation_w);
-        pd.set(12, convolutiondepthwise->dilation_h);
-        pd.set(3, convolutiondepthwise->stride_w);
-        pd.set(13, convolutiondepthwise->stride_h);
-        pd.set(4, convolutiondepthwise->pad_left);
-        pd.set(15, convolutiondepthwise->pad_right);
-        pd.set(14, convolutiondepthwise->pad_top);
-        pd.set(16, convolutiondepthwise->pad_bottom);
-        pd.set(18, convolutiondepthwise->pad_value);
-        pd.set(5, convolutiondepthwise->bias_term);
-        pd.set(6, convolutiondepthwise->weight_data_size);
-        pd.set(7, convolutiondepthwise->group);
-        pd.set(8, convolutiondepthwise->int8_scale_term);
-        pd.set(9, convolutiondepthwise->activation_type);
-        pd.set(10, convolutiondepthwise->activation_params);
-    }
-    else if (layer->type == "InnerProduct")
+    while (stat.histogram_absmax < absmax)
     {
-        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layer;
+        for (int k = 0; k < num_histogram_bins / 2; k++)
+        {
+            stat.histogram[k] = stat.histogram[k * 2] + stat.histogram[k * 2 + 1];
+        }
+        for (int k = num_histogram_bins / 2; k < num_histogram_bins; k++)
+        {
+            stat.histogram[k] = 0;
+        }
 
-        pd.set(0, innerproduct->num_output);
-        pd.set(1, innerproduct->bias_term);
-        pd.set(2, innerproduct->weight_data_size);
-        pd.set(8, innerproduct->int8_scale_term);
-        pd.set(9, innerproduct->activation_type);
-        pd.set(10, innerproduct->activation_params);
-    }
-    else
-    {
-        fprintf(stderr, "unexpected layer type %s in get_layer_param\n", layer->type.c_str());
-        return -1;
+        stat.histogram_absmax *= 2;
     }
-
-    return 0;
 }
 
-static int get_layer_weights(const ncnn::Layer* layer, std::vector<ncnn::Mat>& weights)
+int QuantNet::build_histogram_stream(int num_histogram_bins)
 {
-    if (layer->type == "Convolution")
-    {
-        ncnn::Convolution* convolution = (ncnn::Convolution*)layer;
-        weights.push_back(convolution->weight_data);
-        if (convolution->bias_term)
-            weights.push_back(convolution->bias_data);
-    }
-    else if (layer->type == "ConvolutionDepthWise")
+    const int input_blob_count = (int)input_blobs.size();
+    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+    const int file_count = (int)listspaths[0].size();
+
+    // save checkpoint every this many files
+    const int checkpoint_interval = 1000;
+
+    std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(quantize_num_threads);
+    std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(quantize_num_threads);
+
+    for (int i = 0; i < conv_bottom_blob_count; i++)
     {
-        ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layer;
-        weights.push_back(convolutiondepthwise->weight_data);
-        if (convolutiondepthwise->bias_term)
-            weights.push_back(convolutiondepthwise->bias_data);
+        QuantBlobStat& stat = quant_blob_stats[i];
+
+        stat.absmax = 0.f;
+        stat.histogram_absmax = 0.f;
+        stat.histogram.resize(num_histogram_bins, 0);
+        stat.histogram_normed.resize(num_histogram_bins, 0);
     }
-    else if (layer->type == "InnerProduct")
+
+    int file_start = 0;
+    if (!checkpoint_path.empty())
     {
-        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layer;
-        weights.push_back(innerproduct->weight_data);
-        if (innerproduct->bias_term)
-            weights.push_back(innerproduct->bias_data);
+        file_start = load_checkpoint(num_histogram_bins);
     }
-    else
+
+    QuantInputPrefetcher prefetcher(this, file_start, file_count, decode_num_threads, std::max(quantize_num_threads, decode_num_threads) * 4);
+
+    for (int batch_start = file_start; batch_start < file_count; batch_start += checkpoint_interval)
     {
-        fprintf(stderr, "unexpected layer type %s in get_layer_weights\n", layer->type.c_str());
-        return -1;
+        const int batch_end = std::min(batch_start + checkpoint_interval, file_count);
+
+        #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
+        for (int i = batch_start; i < batch_end; i++)
+        {
+            if (i % 100 == 0)
+            {
+                fprintf(stderr, "build histogram %.2f%% [ %d / %d ]\n", i * 100.f / file_count, i, file_count);
+            }
+
+            std::vector<ncnn::Mat> inputs;
+            prefetcher.take(i, inputs);
+
+            ncnn::Extractor ex = create_extractor();
+            ex.set_light_mode(true);
+
+            const int thread_num = ncnn::get_omp_thread_num();
+            ex.set_blob_allocator(&blob_allocators[thread_num]);
+            ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+
+            for (int j = 0; j < input_blob_count; j++)
+            {
+                ex.input(input_blobs[j], inputs[j]);
+            }
+
+            for (int j = 0; j < conv_bottom_blob_count; j++)
+            {
+                ncnn::Mat out;
+                ex.extract(conv_bottom_blobs[j], out);
+
+                const int outc = out.c;
+                const int outsize = out.w * out.h;
+
+                float absmax = 0.f;
+                for (int p = 0; p < outc; p++)
+                {
+                    const float* ptr = out.channel(p);
+                    for (int k = 0; k < outsize; k++)
+                    {
+                        absmax = std::max(absmax, (float)fabs(ptr[k]));
+                    }
+                }
+
+                if (absmax == 0.f)
+                    continue;
+
+                // the histogram range only grows by power of two, so that bins could be merged exactly
+                float histogram_absmax;
+                #pragma omp critical
+                {
+                    QuantBlobStat& stat = quant_blob_stats[j];
+
+                    stat.absmax = std::max(stat.absmax, absmax);
+
+                    if (stat.histogram_absmax == 0.f)
+                        stat.histogram_absmax = absmax;
+
+                    grow_histogram_range(stat, absmax);
+
+                    histogram_absmax = stat.histogram_absmax;
+                }
+
+                std::vector<uint64_t> histogram(num_histogram_bins, 0);
+
+                for (int p = 0; p < outc; p++)
+                {
+                    const float* ptr = out.channel(p);
+                    for (int k = 0; k < outsize; k++)
+                    {
+                        if (ptr[k] == 0.f)
+                            continue;
+
+                        const int index = std::min((int)(fabs(ptr[k]) / histogram_absmax * num_histogram_bins), (num_histogram_bins - 1));
+
+                        histogram[index] += 1;
+                    }
+                }
+
+                #pragma omp critical
+                {
+                    QuantBlobStat& stat = quant_blob_stats[j];
+
+                    // the range may have grown by other threads meanwhile
+                    int shift = 0;
+                    while ((histogram_absmax * (1 << shift)) < stat.histogram_absmax)
+                        shift++;
+
+                    for (int k = 0; k < num_histogram_bins; k++)
+                    {
+                        stat.histogram[k >> shift] += histogram[k];
+                    }
+                }
+            }
+        }
+
+        if (!checkpoint_path.empty())
+        {
+            save_checkpoint(batch_end);
+        }
     }
 
     return 0;
 }
 
-int QuantNet::quantize_EQ()
+static float compute_aciq_gaussian_clip(float absmax, int N, int num_bits = 8)
 {
-    // find the initial scale via KL
-    quantize_KL();
+    const float alpha_gaussian[8] = {0, 1.71063519, 2.15159277, 2.55913646, 2.93620062, 3.28691474, 3.6151146, 3.92403714};
 
-    print_quant_info();
+    const double gaussian_const = (0.5 * 0.35) * (1 + sqrt(3.14159265358979323846 * log(4)));
 
+    double std = (absmax * 2 * gaussian_const) / sqrt(2 * log(N));
+
+    return (float)(alpha_gaussian[num_bits - 1] * std);
+}
+
+int QuantNet::quantize_ACIQ()
+{
     const int input_blob_count = (int)input_blobs.size();
     const int conv_layer_count = (int)conv_layers.size();
     const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+    const int file_count = (int)listspaths[0].size();
 
     std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(quantize_num_threads);
     std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(quantize_num_threads);
 
-    // max 50 images for EQ
-    const int file_count = std::min((int)listspaths[0].size(), 50);
-
-    const float scale_range_lower = 0.5f;
-    const float scale_range_upper = 2.0f;
-    const int search_steps = 100;
-
+    // initialize conv weight scales
+    #pragma omp parallel for num_threads(quantize_num_threads)
     for (int i = 0; i < conv_layer_count; i++)
     {
-        ncnn::Mat& weight_scale = weight_scales[i];
-        ncnn::Mat& bottom_blob_scale = bottom_blob_scales[i];
-
         const ncnn::Layer* layer = layers[conv_layers[i]];
 
-        // search weight scale
-        for (int j = 0; j < weight_scale.w; j++)
+        if (layer->type == "Convolution")
         {
-            const float scale = weight_scale[j];
-            const float scale_lower = scale * scale_range_lower;
-            const float scale_upper = scale * scale_range_upper;
-            const float scale_step = (scale_upper - scale_lower) / search_steps;
+            const ncnn::Convolution* convolution = (const ncnn::Convolution*)layer;
 
-            std::vector<double> avgsims(search_steps, 0.0);
+            const int num_output = convolution->num_output;
+            const int kernel_w = convolution->kernel_w;
+            const int kernel_h = convolution->kernel_h;
+            const int dilation_w = convolution->dilation_w;
+            const int dilation_h = convolution->dilation_h;
+            const int stride_w = convolution->stride_w;
+            const int stride_h = convolution->stride_h;
 
-            #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
-            for (int ii = 0; ii < file_count; ii++)
-            {
-                if (ii % 100 == 0)
-                {
-                    fprintf(stderr, "search weight scale %.2f%% [ %d / %d ] for %d / %d of %d / %d\n", ii * 100.f / file_count, ii, file_count, j, weight_scale.w, i, conv_layer_count);
-                }
+            const int weight_data_size_output = convolution->weight_data_size / num_output;
 
-                ncnn::Extractor ex = create_extractor();
-                ex.set_light_mode(true);
+            // int8 winograd F43 needs weight data to use 6bit quantization
+            // TODO proper condition for winograd 3x3 int8
+            bool quant_6bit = false;
+            if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+                quant_6bit = true;
 
-                const int thread_num = ncnn::get_omp_thread_num();
-                ex.set_blob_allocator(&blob_allocators[thread_num]);
-                ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+            weight_scales[i].create(num_output);
 
-                for (int jj = 0; jj < input_blob_count; jj++)
-                {
-                    ncnn::Mat in;
+            for (int n = 0; n < num_output; n++)
+            {
+                const ncnn::Mat weight_data_n = convolution->weight_data.range(weight_data_size_output * n, weight_data_size_output);
 
-                    if (0 == file_type)
-                    {
-                        const int type_to_pixel = type_to_pixels[j];
+                float absmax = 0.f;
+                for (int k = 0; k < weight_data_size_output; k++)
+                {
+                    absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
+                }
+
+                if (quant_6bit)
+                {
+                    const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output, 6);
+                    weight_scales[i][n] = 31 / threshold;
+                }
+                else
+                {
+                    const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output);
+                    weight_scales[i][n] = 127 / threshold;
+                }
+            }
+        }
+
+        if (layer->type == "ConvolutionDepthWise")
+        {
+            const ncnn::ConvolutionDepthWise* convolutiondepthwise = (const ncnn::ConvolutionDepthWise*)layer;
+
+            const int group = convolutiondepthwise->group;
+            const int weight_data_size_output = convolutiondepthwise->weight_data_size / group;
+
+            std::vector<float> scales;
+
+            weight_scales[i].create(group);
+
+            for (int n = 0; n < group; n++)
+            {
+                const ncnn::Mat weight_data_n = convolutiondepthwise->weight_data.range(weight_data_size_output * n, weight_data_size_output);
+
+                float absmax = 0.f;
+                for (int k = 0; k < weight_data_size_output; k++)
+                {
+                    absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
+                }
+
+                const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output);
+                weight_scales[i][n] = 127 / threshold;
+            }
+        }
+
+        if (layer->type == "InnerProduct")
+        {
+            const ncnn::InnerProduct* innerproduct = (const ncnn::InnerProduct*)layer;
+
+            const int num_output = innerproduct->num_output;
+            const int weight_data_size_output = innerproduct->weight_data_size / num_output;
+
+            weight_scales[i].create(num_output);
+
+            for (int n = 0; n < num_output; n++)
+            {
+                const ncnn::Mat weight_data_n = innerproduct->weight_data.range(weight_data_size_output * n, weight_data_size_output);
+
+                float absmax = 0.f;
+                for (int k = 0; k < weight_data_size_output; k++)
+                {
+                    absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
+                }
+
+                const float threshold = compute_aciq_gaussian_clip(absmax, weight_data_size_output);
+                weight_scales[i][n] = 127 / threshold;
+            }
+        }
+    }
+
+    // count the absmax
+    #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
+    for (int i = 0; i < file_count; i++)
+    {
+        if (i % 100 == 0)
+        {
+            fprintf(stderr, "count the absmax %.2f%% [ %d / %d ]\n", i * 100.f / file_count, i, file_count);
+        }
+
+        ncnn::Extractor ex = create_extractor();
+        ex.set_light_mode(true);
+
+        const int thread_num = ncnn::get_omp_thread_num();
+        ex.set_blob_allocator(&blob_allocators[thread_num]);
+        ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+
+        for (int j = 0; j < input_blob_count; j++)
+        {
+            ncnn::Mat in;
+
+            if (0 == file_type)
+            {
+                const int type_to_pixel = type_to_pixels[j];
+                const std::vector<float>& mean_vals = means[j];
+                const std::vector<float>& norm_vals = norms[j];
+
+                int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
+                if (type_to_pixel != pixel_convert_type)
+                {
+                    pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
+                }
+                in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
+                in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
+            }
+            else
+            {
+                in = read_npy(shapes[j], listspaths[j][i]);
+            }
+
+            ex.input(input_blobs[j], in);
+        }
+
+        for (int j = 0; j < conv_bottom_blob_count; j++)
+        {
+            ncnn::Mat out;
+            ex.extract(conv_bottom_blobs[j], out);
+
+            // count absmax
+            {
+                float absmax = 0.f;
+
+                const int outc = out.c;
+                const int outsize = out.w * out.h;
+                for (int p = 0; p < outc; p++)
+                {
+                    const float* ptr = out.channel(p);
+                    for (int k = 0; k < outsize; k++)
+                    {
+                        absmax = std::max(absmax, (float)fabs(ptr[k]));
+                    }
+                }
+
+                #pragma omp critical
+                {
+                    QuantBlobStat& stat = quant_blob_stats[j];
+                    stat.absmax = std::max(stat.absmax, absmax);
+                    stat.total = outc * outsize;
+                }
+            }
+        }
+    }
+
+    // alpha gaussian
+    #pragma omp parallel for num_threads(quantize_num_threads)
+    for (int i = 0; i < conv_bottom_blob_count; i++)
+    {
+        QuantBlobStat& stat = quant_blob_stats[i];
+
+        stat.threshold = compute_aciq_gaussian_clip(stat.absmax, stat.total);
+        float scale = 127 / stat.threshold;
+
+        bottom_blob_scales[i].create(1);
+        bottom_blob_scales[i][0] = scale;
+    }
+
+    return 0;
+}
+
+static float cosine_similarity(const ncnn::Mat& a, const ncnn::Mat& b)
+{
+    const int chanenls = a.c;
+    const int size = a.w * a.h;
+
+    float sa = 0;
+    float sb = 0;
+    float sum = 0;
+
+    for (int p = 0; p < chanenls; p++)
+    {
+        const float* pa = a.channel(p);
+        const float* pb = b.channel(p);
+
+        for (int i = 0; i < size; i++)
+        {
+            sa += pa[i] * pa[i];
+            sb += pb[i] * pb[i];
+            sum += pa[i] * pb[i];
+        }
+    }
+
+    float sim = (float)sum / sqrt(sa) / sqrt(sb);
+
+    return sim;
+}
+
+static int get_layer_param(const ncnn::Layer* layer, ncnn::ParamDict& pd)
+{
+    if (layer->type == "Convolution")
+    {
+        ncnn::Convolution* convolution = (ncnn::Convolution*)layer;
+
+        pd.set(0, convolution->num_output);
+        pd.set(1, convolution->kernel_w);
+        pd.set(11, convolution->kernel_h);
+        pd.set(2, convolution->dilation_w);
+        pd.set(12, convolution->dilation_h);
+        pd.set(3, convolution->stride_w);
+        pd.set(13, convolution->stride_h);
+        pd.set(4, convolution->pad_left);
+        pd.set(15, convolution->pad_right);
+        pd.set(14, convolution->pad_top);
+        pd.set(16, convolution->pad_bottom);
+        pd.set(18, convolution->pad_value);
+        pd.set(5, convolution->bias_term);
+        pd.set(6, convolution->weight_data_size);
+        pd.set(8, convolution->int8_scale_term);
+        pd.set(9, convolution->activation_type);
+        pd.set(10, convolution->activation_params);
+    }
+    else if (layer->type == "ConvolutionDepthWise")
+    {
+        ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layer;
+
+        pd.set(0, convolutiondepthwise->num_output);
+        pd.set(1, convolutiondepthwise->kernel_w);
+        pd.set(11, convolutiondepthwise->kernel_h);
+        pd.set(2, convolutiondepthwise->dilation_w);
+        pd.set(12, convolutiondepthwise->dilation_h);
+        pd.set(3, convolutiondepthwise->stride_w);
+        pd.set(13, convolutiondepthwise->stride_h);
+        pd.set(4, convolutiondepthwise->pad_left);
+        pd.set(15, convolutiondepthwise->pad_right);
+        pd.set(14, convolutiondepthwise->pad_top);
+        pd.set(16, convolutiondepthwise->pad_bottom);
+        pd.set(18, convolutiondepthwise->pad_value);
+        pd.set(5, convolutiondepthwise->bias_term);
+        pd.set(6, convolutiondepthwise->weight_data_size);
+        pd.set(7, convolutiondepthwise->group);
+        pd.set(8, convolutiondepthwise->int8_scale_term);
+        pd.set(9, convolutiondepthwise->activation_type);
+        pd.set(10, convolutiondepthwise->activation_params);
+    }
+    else if (layer->type == "InnerProduct")
+    {
+        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layer;
+
+        pd.set(0, innerproduct->num_output);
+        pd.set(1, innerproduct->bias_term);
+        pd.set(2, innerproduct->weight_data_size);
+        pd.set(8, innerproduct->int8_scale_term);
+        pd.set(9, innerproduct->activation_type);
+        pd.set(10, innerproduct->activation_params);
+    }
+    else
+    {
+        fprintf(stderr, "unexpected layer type %s in get_layer_param\n", layer->type.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+static int get_layer_weights(const ncnn::Layer* layer, std::vector<ncnn::Mat>& weights)
+{
+    if (layer->type == "Convolution")
+    {
+        ncnn::Convolution* convolution = (ncnn::Convolution*)layer;
+        weights.push_back(convolution->weight_data);
+        if (convolution->bias_term)
+            weights.push_back(convolution->bias_data);
+    }
+    else if (layer->type == "ConvolutionDepthWise")
+    {
+        ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layer;
+        weights.push_back(convolutiondepthwise->weight_data);
+        if (convolutiondepthwise->bias_term)
+            weights.push_back(convolutiondepthwise->bias_data);
+    }
+    else if (layer->type == "InnerProduct")
+    {
+        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layer;
+        weights.push_back(innerproduct->weight_data);
+        if (innerproduct->bias_term)
+            weights.push_back(innerproduct->bias_data);
+    }
+    else
+    {
+        fprintf(stderr, "unexpected layer type %s in get_layer_weights\n", layer->type.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+int QuantNet::quantize_EQ()
+{
+    // find the initial scale via KL
+    quantize_KL();
+
+    print_quant_info();
+
+    const int input_blob_count = (int)input_blobs.size();
+    const int conv_layer_count = (int)conv_layers.size();
+    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+
+    std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(quantize_num_threads);
+    std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(quantize_num_threads);
+
+    // max 50 images for EQ
+    const int file_count = std::min((int)listspaths[0].size(), 50);
+
+    const float scale_range_lower = 0.5f;
+    const float scale_range_upper = 2.0f;
+    const int search_steps = 100;
+
+    for (int i = 0; i < conv_layer_count; i++)
+    {
+        ncnn::Mat& weight_scale = weight_scales[i];
+        ncnn::Mat& bottom_blob_scale = bottom_blob_scales[i];
+
+        const ncnn::Layer* layer = layers[conv_layers[i]];
+
+        // search weight scale
+        for (int j = 0; j < weight_scale.w; j++)
+        {
+            const float scale = weight_scale[j];
+            const float scale_lower = scale * scale_range_lower;
+            const float scale_upper = scale * scale_range_upper;
+            const float scale_step = (scale_upper - scale_lower) / search_steps;
+
+            std::vector<double> avgsims(search_steps, 0.0);
+
+            #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
+            for (int ii = 0; ii < file_count; ii++)
+            {
+                if (ii % 100 == 0)
+                {
+                    fprintf(stderr, "search weight scale %.2f%% [ %d / %d ] for %d / %d of %d / %d\n", ii * 100.f / file_count, ii, file_count, j, weight_scale.w, i, conv_layer_count);
+                }
+
+                ncnn::Extractor ex = create_extractor();
+                ex.set_light_mode(true);
+
+                const int thread_num = ncnn::get_omp_thread_num();
+                ex.set_blob_allocator(&blob_allocators[thread_num]);
+                ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+
+                for (int jj = 0; jj < input_blob_count; jj++)
+                {
+                    ncnn::Mat in;
+
+                    if (0 == file_type)
+                    {
+                        const int type_to_pixel = type_to_pixels[j];
+                        const std::vector<float>& mean_vals = means[j];
+                        const std::vector<float>& norm_vals = norms[j];
+
+                        int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
+                        if (type_to_pixel != pixel_convert_type)
+                        {
+                            pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
+                        }
+                        in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
+                        in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
+                    }
+                    else
+                    {
+                        in = read_npy(shapes[j], listspaths[j][i]);
+                    }
+
+                    ex.input(input_blobs[j], in);
+                }
+
+                ncnn::Mat in;
+                ex.extract(conv_bottom_blobs[i], in);
+
+                ncnn::Mat out;
+                ex.extract(conv_top_blobs[i], out);
+
+                ncnn::Layer* layer_int8 = ncnn::create_layer_cpu(layer->typeindex);
+
+                ncnn::ParamDict pd;
+                get_layer_param(layer, pd);
+                pd.set(8, 1); //int8_scale_term
+                layer_int8->load_param(pd);
+
+                std::vector<float> sims(search_steps);
+                for (int k = 0; k < search_steps; k++)
+                {
+                    ncnn::Mat new_weight_scale = weight_scale.clone();
+                    new_weight_scale[j] = scale_lower + k * scale_step;
+
+                    std::vector<ncnn::Mat> weights;
+                    get_layer_weights(layer, weights);
+                    weights.push_back(new_weight_scale);
+                    weights.push_back(bottom_blob_scale);
+                    layer_int8->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+
+                    ncnn::Option opt_int8;
+                    opt_int8.use_packing_layout = false;
+
+                    layer_int8->create_pipeline(opt_int8);
+
+                    ncnn::Mat out_int8;
+                    layer_int8->forward(in, out_int8, opt_int8);
+
+                    layer_int8->destroy_pipeline(opt_int8);
+
+                    sims[k] = cosine_similarity(out, out_int8);
+                }
+
+                delete layer_int8;
+
+                #pragma omp critical
+                {
+                    for (int k = 0; k < search_steps; k++)
+                    {
+                        avgsims[k] += sims[k];
+                    }
+                }
+            }
+
+            double max_avgsim = 0.0;
+            float new_scale = scale;
+
+            // find the scale with min cosine distance
+            for (int k = 0; k < search_steps; k++)
+            {
+                if (max_avgsim < avgsims[k])
+                {
+                    max_avgsim = avgsims[k];
+                    new_scale = scale_lower + k * scale_step;
+                }
+            }
+
+            fprintf(stderr, "%s w %d  = %f -> %f\n", layer->name.c_str(), j, scale, new_scale);
+            weight_scale[j] = new_scale;
+        }
+
+        // search bottom blob scale
+        for (int j = 0; j < bottom_blob_scale.w; j++)
+        {
+            const float scale = bottom_blob_scale[j];
+            const float scale_lower = scale * scale_range_lower;
+            const float scale_upper = scale * scale_range_upper;
+            const float scale_step = (scale_upper - scale_lower) / search_steps;
+
+            std::vector<double> avgsims(search_steps, 0.0);
+
+            #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
+            for (int ii = 0; ii < file_count; ii++)
+            {
+                if (ii % 100 == 0)
+                {
+                    fprintf(stderr, "search bottom blob scale %.2f%% [ %d / %d ] for %d / %d of %d / %d\n", ii * 100.f / file_count, ii, file_count, j, bottom_blob_scale.w, i, conv_layer_count);
+                }
+
+                ncnn::Extractor ex = create_extractor();
+                ex.set_light_mode(true);
+
+                const int thread_num = ncnn::get_omp_thread_num();
+                ex.set_blob_allocator(&blob_allocators[thread_num]);
+                ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+
+                for (int jj = 0; jj < input_blob_count; jj++)
+                {
+                    ncnn::Mat in;
+
+                    if (0 == file_type)
+                    {
+                        const int type_to_pixel = type_to_pixels[j];
                         const std::vector<float>& mean_vals = means[j];
                         const std::vector<float>& norm_vals = norms[j];
 
-                        int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
-                        if (type_to_pixel != pixel_convert_type)
-                        {
-                            pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
-                        }
-                        in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
-                        in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
-                    }
-                    else
+                        int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
+                        if (type_to_pixel != pixel_convert_type)
+                        {
+                            pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
+                        }
+                        in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
+                        in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
+                    }
+                    else
+                    {
+                        in = read_npy(shapes[j], listspaths[j][i]);
+                    }
+
+                    ex.input(input_blobs[j], in);
+                }
+
+                ncnn::Mat in;
+                ex.extract(conv_bottom_blobs[i], in);
+
+                ncnn::Mat out;
+                ex.extract(conv_top_blobs[i], out);
+
+                ncnn::Layer* layer_int8 = ncnn::create_layer_cpu(layer->typeindex);
+
+                ncnn::ParamDict pd;
+                get_layer_param(layer, pd);
+                pd.set(8, 1); //int8_scale_term
+                layer_int8->load_param(pd);
+
+                std::vector<float> sims(search_steps);
+                for (int k = 0; k < search_steps; k++)
+                {
+                    ncnn::Mat new_bottom_blob_scale = bottom_blob_scale.clone();
+                    new_bottom_blob_scale[j] = scale_lower + k * scale_step;
+
+                    std::vector<ncnn::Mat> weights;
+                    get_layer_weights(layer, weights);
+                    weights.push_back(weight_scale);
+                    weights.push_back(new_bottom_blob_scale);
+                    layer_int8->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+
+                    ncnn::Option opt_int8;
+                    opt_int8.use_packing_layout = false;
+
+                    layer_int8->create_pipeline(opt_int8);
+
+                    ncnn::Mat out_int8;
+                    layer_int8->forward(in, out_int8, opt_int8);
+
+                    layer_int8->destroy_pipeline(opt_int8);
+
+                    sims[k] = cosine_similarity(out, out_int8);
+                }
+
+                delete layer_int8;
+
+                #pragma omp critical
+                {
+                    for (int k = 0; k < search_steps; k++)
+                    {
+                        avgsims[k] += sims[k];
+                    }
+                }
+            }
+
+            double max_avgsim = 0.0;
+            float new_scale = scale;
+
+            // find the scale with min cosine distance
+            for (int k = 0; k < search_steps; k++)
+            {
+                if (max_avgsim < avgsims[k])
+                {
+                    max_avgsim = avgsims[k];
+                    new_scale = scale_lower + k * scale_step;
+                }
+            }
+
+            fprintf(stderr, "%s b %d  = %f -> %f\n", layer->name.c_str(), j, scale, new_scale);
+            bottom_blob_scale[j] = new_scale;
+        }
+
+        // update quant info
+        QuantBlobStat& stat = quant_blob_stats[i];
+        stat.threshold = 127 / bottom_blob_scale[0];
+    }
+
+    return 0;
+}
+
+static void get_multiheadattention_qkv_blobs(const ncnn::MultiHeadAttention* mha, int& q_blob, int& k_blob, int& v_blob)
+{
+    // keep in sync with MultiHeadAttention::forward
+    const std::vector<int>& bottoms = mha->bottoms;
+    const size_t bottom_count = bottoms.size();
+    const int attn_mask = mha->attn_mask;
+
+    q_blob = bottoms[0];
+    k_blob = (bottom_count == 1 || (bottom_count == 2 && attn_mask)) ? q_blob : bottoms[1];
+    v_blob = (bottom_count == 1 || (bottom_count == 2 && attn_mask)) ? q_blob : (bottom_count == 2 || (bottom_count == 3 && attn_mask)) ? k_blob : bottoms[2];
+}
+
+static bool is_smooth_blob(const std::vector<int>& smooth_blobs, int blob_index)
+{
+    return std::find(smooth_blobs.begin(), smooth_blobs.end(), blob_index) != smooth_blobs.end();
+}
+
+// collect the layers consuming the blob directly or through Split
+// return false if any consumer is not a fp32 matmul which could absorb the smooth scales
+static bool find_smooth_consumers(const std::vector<ncnn::Blob>& blobs, const std::vector<ncnn::Layer*>& layers, int blob_index, std::vector<int>& smooth_blobs, std::vector<int>& consumers)
+{
+    const int consumer = blobs[blob_index].consumer;
+    if (consumer == -1)
+        return false;
+
+    smooth_blobs.push_back(blob_index);
+
+    const ncnn::Layer* layer = layers[consumer];
+    if (layer->type == "Split")
+    {
+        for (size_t i = 0; i < layer->tops.size(); i++)
+        {
+            if (!find_smooth_consumers(blobs, layers, layer->tops[i], smooth_blobs, consumers))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (layer->type != "InnerProduct" && layer->type != "Gemm" && layer->type != "MultiHeadAttention")
+        return false;
+
+    if (std::find(consumers.begin(), consumers.end(), consumer) == consumers.end())
+        consumers.push_back(consumer);
+
+    return true;
+}
+
+static bool check_smooth_consumer(const ncnn::Layer* layer, const std::vector<int>& smooth_blobs, int channels)
+{
+    if (layer->type == "InnerProduct")
+    {
+        const ncnn::InnerProduct* innerproduct = (const ncnn::InnerProduct*)layer;
+
+        return innerproduct->int8_scale_term == 0 && innerproduct->weight_data_size / innerproduct->num_output == channels;
+    }
+
+    if (layer->type == "Gemm")
+    {
+        const ncnn::Gemm* gemm = (const ncnn::Gemm*)layer;
+
+        if (gemm->int8_scale_term || gemm->constantA || !gemm->constantB || gemm->transA || gemm->constantK != channels)
+            return false;
+
+        // only A could be smoothed
+        for (size_t i = 1; i < gemm->bottoms.size(); i++)
+        {
+            if (is_smooth_blob(smooth_blobs, gemm->bottoms[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (layer->type == "MultiHeadAttention")
+    {
+        const ncnn::MultiHeadAttention* mha = (const ncnn::MultiHeadAttention*)layer;
+
+        if (mha->int8_scale_term)
+            return false;
+
+        if (mha->attn_mask && is_smooth_blob(smooth_blobs, mha->bottoms.back()))
+            return false;
+
+        int q_blob;
+        int k_blob;
+        int v_blob;
+        get_multiheadattention_qkv_blobs(mha, q_blob, k_blob, v_blob);
+
+        const int qdim = mha->weight_data_size / mha->embed_dim;
+
+        if (is_smooth_blob(smooth_blobs, q_blob) && qdim != channels)
+            return false;
+        if (is_smooth_blob(smooth_blobs, k_blob) && mha->kdim != channels)
+            return false;
+        if (is_smooth_blob(smooth_blobs, v_blob) && mha->vdim != channels)
+            return false;
+
+        return true;
+    }
+
+    return false;
+}
+
+// weight is laid out as [outch][inch] when transpose is 0, or as [inch][outch] when transpose is 1
+static void update_weight_absmax(const ncnn::Mat& weight, int inch, int transpose, std::vector<float>& absmax)
+{
+    const int outch = (int)weight.total() / inch;
+
+    for (int i = 0; i < outch; i++)
+    {
+        for (int k = 0; k < inch; k++)
+        {
+            const float v = transpose ? weight[k * outch + i] : weight[i * inch + k];
+            absmax[k] = std::max(absmax[k], (float)fabs(v));
+        }
+    }
+}
+
+static void smooth_weight(ncnn::Mat& weight, int inch, int transpose, const ncnn::Mat& smooth_scale)
+{
+    const int outch = (int)weight.total() / inch;
+
+    for (int i = 0; i < outch; i++)
+    {
+        for (int k = 0; k < inch; k++)
+        {
+            float& v = transpose ? weight[k * outch + i] : weight[i * inch + k];
+            v *= smooth_scale[k];
+        }
+    }
+}
+
+static void smooth_consumer_weight(ncnn::Layer* layer, const std::vector<int>& smooth_blobs, const ncnn::Mat& smooth_scale, std::vector<float>* weight_absmax)
+{
+    const int channels = smooth_scale.w;
+
+    std::vector<ncnn::Mat*> weights;
+    std::vector<int> transposes;
+
+    if (layer->type == "InnerProduct")
+    {
+        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layer;
+        weights.push_back(&innerproduct->weight_data);
+        transposes.push_back(0);
+    }
+
+    if (layer->type == "Gemm")
+    {
+        ncnn::Gemm* gemm = (ncnn::Gemm*)layer;
+        weights.push_back(&gemm->B_data);
+        transposes.push_back(gemm->transB ? 0 : 1);
+    }
+
+    if (layer->type == "MultiHeadAttention")
+    {
+        ncnn::MultiHeadAttention* mha = (ncnn::MultiHeadAttention*)layer;
+
+        int q_blob;
+        int k_blob;
+        int v_blob;
+        get_multiheadattention_qkv_blobs(mha, q_blob, k_blob, v_blob);
+
+        if (is_smooth_blob(smooth_blobs, q_blob))
+        {
+            weights.push_back(&mha->q_weight_data);
+            transposes.push_back(0);
+        }
+        if (is_smooth_blob(smooth_blobs, k_blob))
+        {
+            weights.push_back(&mha->k_weight_data);
+            transposes.push_back(0);
+        }
+        if (is_smooth_blob(smooth_blobs, v_blob))
+        {
+            weights.push_back(&mha->v_weight_data);
+            transposes.push_back(0);
+        }
+    }
+
+    for (size_t i = 0; i < weights.size(); i++)
+    {
+        if (weight_absmax)
+        {
+            update_weight_absmax(*weights[i], channels, transposes[i], *weight_absmax);
+        }
+        else
+        {
+            smooth_weight(*weights[i], channels, transposes[i], smooth_scale);
+        }
+    }
+}
+
+int QuantNet::quantize_SQ()
+{
+    const int input_blob_count = (int)input_blobs.size();
+    const int file_count = (int)listspaths[0].size();
+
+    std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(quantize_num_threads);
+    std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(quantize_num_threads);
+
+    // find LayerNorm / RMSNorm whose output only feeds matmul weights
+    std::vector<std::vector<int> > smooth_layer_blobs;
+    std::vector<std::vector<int> > smooth_layer_consumers;
+    for (int i = 0; i < (int)layers.size(); i++)
+    {
+        const ncnn::Layer* layer = layers[i];
+
+        int affine_size = 0;
+        if (layer->type == "LayerNorm")
+        {
+            const ncnn::LayerNorm* layernorm = (const ncnn::LayerNorm*)layer;
+            affine_size = layernorm->affine ? layernorm->affine_size : 0;
+        }
+        if (layer->type == "RMSNorm")
+        {
+            const ncnn::RMSNorm* rmsnorm = (const ncnn::RMSNorm*)layer;
+            affine_size = rmsnorm->affine ? rmsnorm->affine_size : 0;
+        }
+
+        if (affine_size == 0)
+            continue;
+
+        std::vector<int> smooth_blobs;
+        std::vector<int> consumers;
+        if (!find_smooth_consumers(blobs, layers, layer->tops[0], smooth_blobs, consumers))
+            continue;
+
+        bool smoothable = true;
+        for (size_t j = 0; j < consumers.size(); j++)
+        {
+            if (!check_smooth_consumer(layers[consumers[j]], smooth_blobs, affine_size))
+            {
+                smoothable = false;
+                break;
+            }
+        }
+
+        if (!smoothable)
+            continue;
+
+        smooth_layers.push_back(i);
+        smooth_layer_blobs.push_back(smooth_blobs);
+        smooth_layer_consumers.push_back(consumers);
+    }
+
+    const int smooth_layer_count = (int)smooth_layers.size();
+
+    std::vector<std::vector<float> > activation_absmax(smooth_layer_count);
+    for (int i = 0; i < smooth_layer_count; i++)
+    {
+        const ncnn::Layer* layer = layers[smooth_layers[i]];
+        const int affine_size = layer->type == "LayerNorm" ? ((const ncnn::LayerNorm*)layer)->affine_size : ((const ncnn::RMSNorm*)layer)->affine_size;
+
+        activation_absmax[i].resize(affine_size, 0.f);
+    }
+
+    // count the per-channel absmax of normalized activation
+    #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
+    for (int i = 0; i < file_count; i++)
+    {
+        if (i % 100 == 0)
+        {
+            fprintf(stderr, "count the channel absmax %.2f%% [ %d / %d ]\n", i * 100.f / file_count, i, file_count);
+        }
+
+        ncnn::Extractor ex = create_extractor();
+        ex.set_light_mode(true);
+
+        const int thread_num = ncnn::get_omp_thread_num();
+        ex.set_blob_allocator(&blob_allocators[thread_num]);
+        ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+
+        for (int j = 0; j < input_blob_count; j++)
+        {
+            ncnn::Mat in;
+
+            if (0 == file_type)
+            {
+                const int type_to_pixel = type_to_pixels[j];
+                const std::vector<float>& mean_vals = means[j];
+                const std::vector<float>& norm_vals = norms[j];
+
+                int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
+                if (type_to_pixel != pixel_convert_type)
+                {
+                    pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
+                }
+                in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
+                in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
+            }
+            else
+            {
+                in = read_npy(shapes[j], listspaths[j][i]);
+            }
+
+            ex.input(input_blobs[j], in);
+        }
+
+        for (int j = 0; j < smooth_layer_count; j++)
+        {
+            ncnn::Mat out;
+            ex.extract(layers[smooth_layers[j]]->tops[0], out);
+
+            const int channels = (int)activation_absmax[j].size();
+
+            // normalized along w
+            if (out.w != channels)
+                continue;
+
+            std::vector<float> absmax(channels, 0.f);
+
+            for (int p = 0; p < out.c; p++)
+            {
+                for (int y = 0; y < out.h * out.d; y++)
+                {
+                    const float* ptr = out.channel(p).row(y);
+                    for (int k = 0; k < channels; k++)
                     {
-                        in = read_npy(shapes[j], listspaths[j][i]);
+                        absmax[k] = std::max(absmax[k], (float)fabs(ptr[k]));
                     }
+                }
+            }
 
-                    ex.input(input_blobs[j], in);
+            #pragma omp critical
+            {
+                std::vector<float>& stat = activation_absmax[j];
+                for (int k = 0; k < channels; k++)
+                {
+                    stat[k] = std::max(stat[k], absmax[k]);
                 }
+            }
+        }
+    }
+
+    // migrate the activation outliers into weights
+    smooth_scales.resize(smooth_layer_count);
+    for (int i = 0; i < smooth_layer_count; i++)
+    {
+        ncnn::Layer* layer = layers[smooth_layers[i]];
+        const std::vector<int>& smooth_blobs = smooth_layer_blobs[i];
+        const std::vector<int>& consumers = smooth_layer_consumers[i];
+        const int channels = (int)activation_absmax[i].size();
+
+        ncnn::Mat smooth_scale(channels);
+        smooth_scale.fill(1.f);
+
+        std::vector<float> weight_absmax(channels, 0.f);
+        for (size_t j = 0; j < consumers.size(); j++)
+        {
+            smooth_consumer_weight(layers[consumers[j]], smooth_blobs, smooth_scale, &weight_absmax);
+        }
+
+        // s = max(|X|)^alpha / max(|W|)^(1-alpha)
+        for (int k = 0; k < channels; k++)
+        {
+            const float xmax = activation_absmax[i][k];
+            const float wmax = weight_absmax[k];
+            if (xmax == 0.f || wmax == 0.f)
+                continue;
+
+            smooth_scale[k] = std::max((float)(pow(xmax, smooth_alpha) / pow(wmax, 1.f - smooth_alpha)), 1e-5f);
+        }
+
+        // X / s
+        if (layer->type == "LayerNorm")
+        {
+            ncnn::LayerNorm* layernorm = (ncnn::LayerNorm*)layer;
+            for (int k = 0; k < channels; k++)
+            {
+                layernorm->gamma_data[k] /= smooth_scale[k];
+                layernorm->beta_data[k] /= smooth_scale[k];
+            }
+        }
+        if (layer->type == "RMSNorm")
+        {
+            ncnn::RMSNorm* rmsnorm = (ncnn::RMSNorm*)layer;
+            for (int k = 0; k < channels; k++)
+            {
+                rmsnorm->gamma_data[k] /= smooth_scale[k];
+            }
+        }
+
+        // W * s
+        for (size_t j = 0; j < consumers.size(); j++)
+        {
+            ncnn::Layer* consumer = layers[consumers[j]];
+
+            smooth_consumer_weight(consumer, smooth_blobs, smooth_scale, 0);
+
+            // repack the modified weights
+            consumer->destroy_pipeline(opt);
+            consumer->create_pipeline(opt);
+        }
+
+        layer->destroy_pipeline(opt);
+        layer->create_pipeline(opt);
+
+        smooth_scales[i] = smooth_scale;
+
+        fprintf(stderr, "%-40s : smooth %d channels into %d layers\n", layer->name.c_str(), channels, (int)consumers.size());
+    }
+
+    // calibrate the smoothed model via KL
+    return quantize_KL();
+}
+
+// return true for Convolution and depthwise ConvolutionDepthWise, whose weight is laid out as [outch][inch][maxk]
+static bool get_equalize_conv_layout(const ncnn::Layer* layer, int& num_output, int& num_input, int& maxk, bool& depthwise)
+{
+    if (layer->type == "Convolution")
+    {
+        const ncnn::Convolution* convolution = (const ncnn::Convolution*)layer;
+        if (convolution->int8_scale_term)
+            return false;
+
+        num_output = convolution->num_output;
+        maxk = convolution->kernel_w * convolution->kernel_h;
+        num_input = convolution->weight_data_size / num_output / maxk;
+        depthwise = false;
+        return true;
+    }
+
+    if (layer->type == "ConvolutionDepthWise")
+    {
+        const ncnn::ConvolutionDepthWise* convolutiondepthwise = (const ncnn::ConvolutionDepthWise*)layer;
+        if (convolutiondepthwise->int8_scale_term)
+            return false;
+
+        num_output = convolutiondepthwise->num_output;
+        maxk = convolutiondepthwise->kernel_w * convolutiondepthwise->kernel_h;
+        num_input = num_output;
+        depthwise = true;
+        return convolutiondepthwise->group == num_output && convolutiondepthwise->weight_data_size == maxk * num_output;
+    }
+
+    return false;
+}
+
+// find conv -> (ReLU) -> conv pairs, the relu family is positive homogeneous so that
+// scaling the output channel of the first conv by 1/s could be compensated in the second one
+static void find_equalize_pairs(const std::vector<ncnn::Blob>& blobs, const std::vector<ncnn::Layer*>& layers, std::vector<int>& first_layers, std::vector<int>& second_layers)
+{
+    for (int i = 0; i < (int)layers.size(); i++)
+    {
+        const ncnn::Layer* layer = layers[i];
+
+        int num_output;
+        int num_input;
+        int maxk;
+        bool depthwise;
+        if (!get_equalize_conv_layout(layer, num_output, num_input, maxk, depthwise))
+            continue;
+
+        const int activation_type = layer->type == "Convolution" ? ((const ncnn::Convolution*)layer)->activation_type : ((const ncnn::ConvolutionDepthWise*)layer)->activation_type;
+
+        // none / relu / leakyrelu
+        if (activation_type != 0 && activation_type != 1 && activation_type != 2)
+            continue;
+
+        int consumer = blobs[layer->tops[0]].consumer;
+        if (consumer == -1)
+            continue;
+
+        if (activation_type == 0 && layers[consumer]->type == "ReLU")
+        {
+            consumer = blobs[layers[consumer]->tops[0]].consumer;
+            if (consumer == -1)
+                continue;
+        }
+
+        const ncnn::Layer* layer2 = layers[consumer];
+
+        int num_output2;
+        int num_input2;
+        int maxk2;
+        bool depthwise2;
+        if (!get_equalize_conv_layout(layer2, num_output2, num_input2, maxk2, depthwise2))
+            continue;
+
+        if (num_input2 != num_output)
+            continue;
+
+        // zero padding is scale invariant
+        const float pad_value2 = layer2->type == "Convolution" ? ((const ncnn::Convolution*)layer2)->pad_value : ((const ncnn::ConvolutionDepthWise*)layer2)->pad_value;
+        if (pad_value2 != 0.f)
+            continue;
 
-                ncnn::Mat in;
-                ex.extract(conv_bottom_blobs[i], in);
+        first_layers.push_back(i);
+        second_layers.push_back(consumer);
+    }
+}
 
-                ncnn::Mat out;
-                ex.extract(conv_top_blobs[i], out);
+static ncnn::Mat& get_conv_weight_data(ncnn::Layer* layer)
+{
+    if (layer->type == "Convolution")
+        return ((ncnn::Convolution*)layer)->weight_data;
 
-                ncnn::Layer* layer_int8 = ncnn::create_layer_cpu(layer->typeindex);
+    return ((ncnn::ConvolutionDepthWise*)layer)->weight_data;
+}
 
-                ncnn::ParamDict pd;
-                get_layer_param(layer, pd);
-                pd.set(8, 1); //int8_scale_term
-                layer_int8->load_param(pd);
+// scale the output channels of first layer by 1/s and the input channels of second layer by s
+static void equalize_conv_pair(ncnn::Layer* layer1, ncnn::Layer* layer2, const ncnn::Mat& equalize_scale)
+{
+    int num_output;
+    int num_input;
+    int maxk;
+    bool depthwise;
+    get_equalize_conv_layout(layer1, num_output, num_input, maxk, depthwise);
+
+    int num_output2;
+    int num_input2;
+    int maxk2;
+    bool depthwise2;
+    get_equalize_conv_layout(layer2, num_output2, num_input2, maxk2, depthwise2);
+
+    ncnn::Mat& weight_data = get_conv_weight_data(layer1);
+    const int weight_data_size_output = (int)weight_data.total() / num_output;
+    for (int p = 0; p < num_output; p++)
+    {
+        float* ptr = (float*)weight_data + weight_data_size_output * p;
+        for (int k = 0; k < weight_data_size_output; k++)
+        {
+            ptr[k] /= equalize_scale[p];
+        }
+    }
 
-                std::vector<float> sims(search_steps);
-                for (int k = 0; k < search_steps; k++)
-                {
-                    ncnn::Mat new_weight_scale = weight_scale.clone();
-                    new_weight_scale[j] = scale_lower + k * scale_step;
+    const int bias_term = layer1->type == "Convolution" ? ((ncnn::Convolution*)layer1)->bias_term : ((ncnn::ConvolutionDepthWise*)layer1)->bias_term;
+    if (bias_term)
+    {
+        ncnn::Mat& bias_data = layer1->type == "Convolution" ? ((ncnn::Convolution*)layer1)->bias_data : ((ncnn::ConvolutionDepthWise*)layer1)->bias_data;
+        for (int p = 0; p < num_output; p++)
+        {
+            bias_data[p] /= equalize_scale[p];
+        }
+    }
 
-                    std::vector<ncnn::Mat> weights;
-                    get_layer_weights(layer, weights);
-                    weights.push_back(new_weight_scale);
-                    weights.push_back(bottom_blob_scale);
-                    layer_int8->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+    ncnn::Mat& weight_data2 = get_conv_weight_data(layer2);
+    const int num_output2_ = depthwise2 ? 1 : num_output2;
+    for (int q = 0; q < num_output2_; q++)
+    {
+        for (int p = 0; p < num_input2; p++)
+        {
+            float* ptr = (float*)weight_data2 + (q * num_input2 + p) * maxk2;
+            for (int k = 0; k < maxk2; k++)
+            {
+                ptr[k] *= equalize_scale[p];
+            }
+        }
+    }
+}
 
-                    ncnn::Option opt_int8;
-                    opt_int8.use_packing_layout = false;
+int QuantNet::equalize_weights()
+{
+    std::vector<int> first_layers;
+    std::vector<int> second_layers;
+    find_equalize_pairs(blobs, layers, first_layers, second_layers);
 
-                    layer_int8->create_pipeline(opt_int8);
+    const int pair_count = (int)first_layers.size();
 
-                    ncnn::Mat out_int8;
-                    layer_int8->forward(in, out_int8, opt_int8);
+    equalize_layers = first_layers;
+    equalize_scales.resize(pair_count);
 
-                    layer_int8->destroy_pipeline(opt_int8);
+    // pairs may be chained, so iterate until the scales converge
+    const int max_iterations = 20;
 
-                    sims[k] = cosine_similarity(out, out_int8);
-                }
+    for (int i = 0; i < pair_count; i++)
+    {
+        int num_output;
+        int num_input;
+        int maxk;
+        bool depthwise;
+        get_equalize_conv_layout(layers[first_layers[i]], num_output, num_input, maxk, depthwise);
+
+        equalize_scales[i].create(num_output);
+        equalize_scales[i].fill(1.f);
+    }
 
-                delete layer_int8;
+    for (int iter = 0; iter < max_iterations; iter++)
+    {
+        float max_scale_change = 0.f;
 
-                #pragma omp critical
+        for (int i = 0; i < pair_count; i++)
+        {
+            ncnn::Layer* layer1 = layers[first_layers[i]];
+            ncnn::Layer* layer2 = layers[second_layers[i]];
+
+            int num_output;
+            int num_input;
+            int maxk;
+            bool depthwise;
+            get_equalize_conv_layout(layer1, num_output, num_input, maxk, depthwise);
+
+            int num_output2;
+            int num_input2;
+            int maxk2;
+            bool depthwise2;
+            get_equalize_conv_layout(layer2, num_output2, num_input2, maxk2, depthwise2);
+
+            // r1 = range of output channel in first layer, r2 = range of input channel in second layer
+            std::vector<float> r1(num_output, 0.f);
+            std::vector<float> r2(num_output, 0.f);
+
+            const ncnn::Mat& weight_data = get_conv_weight_data(layer1);
+            const int weight_data_size_output = (int)weight_data.total() / num_output;
+            for (int p = 0; p < num_output; p++)
+            {
+                const float* ptr = (const float*)weight_data + weight_data_size_output * p;
+                for (int k = 0; k < weight_data_size_output; k++)
                 {
-                    for (int k = 0; k < search_steps; k++)
-                    {
-                        avgsims[k] += sims[k];
-                    }
+                    r1[p] = std::max(r1[p], (float)fabs(ptr[k]));
                 }
             }
 
-            double max_avgsim = 0.0;
-            float new_scale = scale;
-
-            // find the scale with min cosine distance
-            for (int k = 0; k < search_steps; k++)
+            const ncnn::Mat& weight_data2 = get_conv_weight_data(layer2);
+            const int num_output2_ = depthwise2 ? 1 : num_output2;
+            for (int q = 0; q < num_output2_; q++)
             {
-                if (max_avgsim < avgsims[k])
+                for (int p = 0; p < num_input2; p++)
                 {
-                    max_avgsim = avgsims[k];
-                    new_scale = scale_lower + k * scale_step;
+                    const float* ptr = (const float*)weight_data2 + (q * num_input2 + p) * maxk2;
+                    for (int k = 0; k < maxk2; k++)
+                    {
+                        r2[p] = std::max(r2[p], (float)fabs(ptr[k]));
+                    }
                 }
             }
 
-            fprintf(stderr, "%s w %d  = %f -> %f\n", layer->name.c_str(), j, scale, new_scale);
-            weight_scale[j] = new_scale;
-        }
+            // s = sqrt(r1 / r2) makes r1 / s == r2 * s
+            ncnn::Mat equalize_scale(num_output);
+            for (int p = 0; p < num_output; p++)
+            {
+                equalize_scale[p] = (r1[p] == 0.f || r2[p] == 0.f) ? 1.f : sqrt(r1[p] / r2[p]);
 
-        // search bottom blob scale
-        for (int j = 0; j < bottom_blob_scale.w; j++)
-        {
-            const float scale = bottom_blob_scale[j];
-            const float scale_lower = scale * scale_range_lower;
-            const float scale_upper = scale * scale_range_upper;
-            const float scale_step = (scale_upper - scale_lower) / search_steps;
+                max_scale_change = std::max(max_scale_change, (float)fabs(equalize_scale[p] - 1.f));
 
-            std::vector<double> avgsims(search_steps, 0.0);
+                equalize_scales[i][p] *= equalize_scale[p];
+            }
 
-            #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
-            for (int ii = 0; ii < file_count; ii++)
-            {
-                if (ii % 100 == 0)
-                {
-                    fprintf(stderr, "search bottom blob scale %.2f%% [ %d / %d ] for %d / %d of %d / %d\n", ii * 100.f / file_count, ii, file_count, j, bottom_blob_scale.w, i, conv_layer_count);
-                }
+            equalize_conv_pair(layer1, layer2, equalize_scale);
+        }
 
-                ncnn::Extractor ex = create_extractor();
-                ex.set_light_mode(true);
+        if (max_scale_change < 1e-4f)
+            break;
+    }
 
-                const int thread_num = ncnn::get_omp_thread_num();
-                ex.set_blob_allocator(&blob_allocators[thread_num]);
-                ex.set_workspace_allocator(&workspace_allocators[thread_num]);
+    // repack the modified weights
+    for (int i = 0; i < pair_count; i++)
+    {
+        ncnn::Layer* layer1 = layers[first_layers[i]];
+        ncnn::Layer* layer2 = layers[second_layers[i]];
 
-                for (int jj = 0; jj < input_blob_count; jj++)
-                {
-                    ncnn::Mat in;
+        layer1->destroy_pipeline(opt);
+        layer1->create_pipeline(opt);
+        layer2->destroy_pipeline(opt);
+        layer2->create_pipeline(opt);
 
-                    if (0 == file_type)
-                    {
-                        const int type_to_pixel = type_to_pixels[j];
-                        const std::vector<float>& mean_vals = means[j];
-                        const std::vector<float>& norm_vals = norms[j];
+        fprintf(stderr, "%-40s : equalize with %s\n", layer1->name.c_str(), layer2->name.c_str());
+    }
 
-                        int pixel_convert_type = ncnn::Mat::PIXEL_BGR;
-                        if (type_to_pixel != pixel_convert_type)
-                        {
-                            pixel_convert_type = pixel_convert_type | (type_to_pixel << ncnn::Mat::PIXEL_CONVERT_SHIFT);
-                        }
-                        in = read_and_resize_image(shapes[j], listspaths[j][i], pixel_convert_type);
-                        in.substract_mean_normalize(mean_vals.data(), norm_vals.data());
-                    }
-                    else
-                    {
-                        in = read_npy(shapes[j], listspaths[j][i]);
-                    }
+    return 0;
+}
 
-                    ex.input(input_blobs[j], in);
-                }
+static inline signed char float2int8(float v)
+{
+    int int32 = static_cast<int>(round(v));
+    if (int32 > 127) return 127;
+    if (int32 < -127) return -127;
+    return (signed char)int32;
+}
 
-                ncnn::Mat in;
-                ex.extract(conv_bottom_blobs[i], in);
+int QuantNet::correct_bias()
+{
+    const int input_blob_count = (int)input_blobs.size();
+    const int conv_layer_count = (int)conv_layers.size();
+    const int conv_bottom_blob_count = (int)conv_bottom_blobs.size();
+    const int file_count = (int)listspaths[0].size();
 
-                ncnn::Mat out;
-                ex.extract(conv_top_blobs[i], out);
+    std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(quantize_num_threads);
+    std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(quantize_num_threads);
 
-                ncnn::Layer* layer_int8 = ncnn::create_layer_cpu(layer->typeindex);
+    // E[x] per input channel, or per input element for InnerProduct
+    std::vector<std::vector<double> > bottom_blob_means(conv_bottom_blob_count);
 
-                ncnn::ParamDict pd;
-                get_layer_param(layer, pd);
-                pd.set(8, 1); //int8_scale_term
-                layer_int8->load_param(pd);
+    // count the mean
+    #pragma omp parallel for num_threads(quantize_num_threads) schedule(static, 1)
+    for (int i = 0; i < file_count; i++)
+    {
+        if (i % 100 == 0)
+        {
+            fprintf(stderr, "count the mean %.2f%% [ %d / %d ]\n", i * 100.f / file_count, i, file_count);
+        }
 
-                std::vector<float> sims(search_steps);
-                for (int k = 0; k < search_steps; k++)
-                {
-                    ncnn::Mat new_bottom_blob_scale = bottom_blob_scale.clone();
-                    new_bottom_blob_scale[j] = scale_lower + k * scale_step;
+        std::vector<ncnn::Mat> inputs;
+        load_inputs(i, inputs);
 
-                    std::vector<ncnn::Mat> weights;
-                    get_layer_weights(layer, weights);
-                    weights.push_back(weight_scale);
-                    weights.push_back(new_bottom_blob_scale);
-                    layer_int8->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+        ncnn::Extractor ex = create_extractor();
+        ex.set_light_mode(true);
 
-                    ncnn::Option opt_int8;
-                    opt_int8.use_packing_layout = false;
+        const int thread_num = ncnn::get_omp_thread_num();
+        ex.set_blob_allocator(&blob_allocators[thread_num]);
+        ex.set_workspace_allocator(&workspace_allocators[thread_num]);
 
-                    layer_int8->create_pipeline(opt_int8);
+        for (int j = 0; j < input_blob_count; j++)
+        {
+            ex.input(input_blobs[j], inputs[j]);
+        }
 
-                    ncnn::Mat out_int8;
-                    layer_int8->forward(in, out_int8, opt_int8);
+        for (int j = 0; j < conv_bottom_blob_count; j++)
+        {
+            ncnn::Mat out;
+            ex.extract(conv_bottom_blobs[j], out);
 
-                    layer_int8->destroy_pipeline(opt_int8);
+            std::vector<double> mean;
 
-                    sims[k] = cosine_similarity(out, out_int8);
-                }
+            if (layers[conv_layers[j]]->type == "InnerProduct")
+            {
+                const int num_input = out.dims == 2 ? out.w : out.w * out.h * out.d * out.c;
+                const int rows = out.dims == 2 ? out.h : 1;
 
-                delete layer_int8;
+                ncnn::Mat out_flatten = out.dims == 2 ? out : out.reshape(num_input);
 
-                #pragma omp critical
+                mean.resize(num_input, 0.0);
+                for (int y = 0; y < rows; y++)
                 {
-                    for (int k = 0; k < search_steps; k++)
+                    const float* ptr = out_flatten.row(y);
+                    for (int k = 0; k < num_input; k++)
                     {
-                        avgsims[k] += sims[k];
+                        mean[k] += ptr[k] / rows;
                     }
                 }
             }
+            else
+            {
+                const int outsize = out.w * out.h;
 
-            double max_avgsim = 0.0;
-            float new_scale = scale;
+                mean.resize(out.c, 0.0);
+                for (int p = 0; p < out.c; p++)
+                {
+                    const float* ptr = out.channel(p);
+                    double sum = 0.0;
+                    for (int k = 0; k < outsize; k++)
+                    {
+                        sum += ptr[k];
+                    }
+                    mean[p] = sum / outsize;
+                }
+            }
 
-            // find the scale with min cosine distance
-            for (int k = 0; k < search_steps; k++)
+            #pragma omp critical
             {
-                if (max_avgsim < avgsims[k])
+                std::vector<double>& stat = bottom_blob_means[j];
+                if (stat.empty())
+                    stat.resize(mean.size(), 0.0);
+
+                for (size_t k = 0; k < mean.size() && k < stat.size(); k++)
                 {
-                    max_avgsim = avgsims[k];
-                    new_scale = scale_lower + k * scale_step;
+                    stat[k] += mean[k] / file_count;
                 }
             }
+        }
+    }
 
-            fprintf(stderr, "%s b %d  = %f -> %f\n", layer->name.c_str(), j, scale, new_scale);
-            bottom_blob_scale[j] = new_scale;
+    // the expected output shift caused by weight quantization error is sum((dequantize(quantize(W)) - W) * E[x])
+    bias_corrections.resize(conv_layer_count);
+
+    #pragma omp parallel for num_threads(quantize_num_threads)
+    for (int i = 0; i < conv_layer_count; i++)
+    {
+        const ncnn::Layer* layer = layers[conv_layers[i]];
+        const std::vector<double>& mean = bottom_blob_means[i];
+        const ncnn::Mat& weight_scale = weight_scales[i];
+
+        ncnn::Mat weight_data;
+        int num_output = 0;
+        int group = 1;
+        if (layer->type == "Convolution")
+        {
+            weight_data = ((const ncnn::Convolution*)layer)->weight_data;
+            num_output = ((const ncnn::Convolution*)layer)->num_output;
+        }
+        if (layer->type == "ConvolutionDepthWise")
+        {
+            weight_data = ((const ncnn::ConvolutionDepthWise*)layer)->weight_data;
+            num_output = ((const ncnn::ConvolutionDepthWise*)layer)->num_output;
+            group = ((const ncnn::ConvolutionDepthWise*)layer)->group;
+        }
+        if (layer->type == "InnerProduct")
+        {
+            weight_data = ((const ncnn::InnerProduct*)layer)->weight_data;
+            num_output = ((const ncnn::InnerProduct*)layer)->num_output;
         }
 
-        // update quant info
-        QuantBlobStat& stat = quant_blob_stats[i];
-        stat.threshold = 127 / bottom_blob_scale[0];
+        const int num_input = (int)mean.size();
+        if (num_input == 0 || num_input % group != 0)
+            continue;
+
+        // weight is laid out as [group][outch/group][inch/group][maxk]
+        const int num_output_g = num_output / group;
+        const int num_input_g = num_input / group;
+        const int maxk = (int)weight_data.total() / num_output / num_input_g;
+        if (maxk * num_output * num_input_g != (int)weight_data.total())
+            continue;
+
+        ncnn::Mat bias_correction(num_output);
+
+        for (int g = 0; g < group; g++)
+        {
+            for (int p = 0; p < num_output_g; p++)
+            {
+                const int outch = g * num_output_g + p;
+
+                // per output channel scale, or per group scale for ConvolutionDepthWise
+                const float s = group == 1 ? weight_scale[outch] : weight_scale[g];
+
+                const float* ptr = (const float*)weight_data + outch * num_input_g * maxk;
+
+                double shift = 0.0;
+                for (int q = 0; q < num_input_g; q++)
+                {
+                    double error = 0.0;
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        const float w = ptr[q * maxk + k];
+                        error += float2int8(w * s) / s - w;
+                    }
+
+                    shift += error * mean[g * num_input_g + q];
+                }
+
+                bias_correction[outch] = (float)-shift;
+            }
+        }
+
+        bias_corrections[i] = bias_correction;
     }
 
     return 0;
@@ -1666,7 +2999,13 @@ static void show_usage()
     fprintf(stderr, "  shape=[224,224,3],...[w,h,c] or [w,h] **[0,0] will not resize\n");
     fprintf(stderr, "  pixel=RAW/RGB/BGR/GRAY/RGBA/BGRA,...\n");
     fprintf(stderr, "  thread=8\n");
-    fprintf(stderr, "  method=kl/aciq/eq\n");
+    fprintf(stderr, "  method=kl/aciq/eq/sq\n");
+    fprintf(stderr, "  alpha=0.5, migration strength for sq\n");
+    fprintf(stderr, "  equalize=0/1, 1:cross layer equalization before calibration\n");
+    fprintf(stderr, "  bias_correct=0/1, 1:compensate the weight quantization error in bias\n");
+    fprintf(stderr, "  stream=0/1, 1:single pass histogram for kl/eq/sq\n");
+    fprintf(stderr, "  decode_thread=2, image decode threads for stream\n");
+    fprintf(stderr, "  checkpoint=calib.ckpt, resume stream from partial statistics\n");
     fprintf(stderr, "  type=0/1, 0:image,1:npy\n");
     fprintf(stderr, "Sample usage:\n");
     fprintf(stderr, "  ncnn2table squeezenet.param squeezenet.bin filelist.txt squeezenet.table mean=[104.0,117.0,123.0] norm=[1.0,1.0,1.0] shape=[227,227,3] pixel=BGR method=kl\n");
@@ -1747,6 +3086,18 @@ int main(int argc, char** argv)
             method = std::string(value);
         if (memcmp(key, "type", 4) == 0)
             net.file_type = atoi(value);
+        if (memcmp(key, "alpha", 5) == 0)
+            net.smooth_alpha = (float)atof(value);
+        if (memcmp(key, "equalize", 8) == 0)
+            net.equalize = atoi(value);
+        if (memcmp(key, "bias_correct", 12) == 0)
+            net.bias_correct = atoi(value);
+        if (memcmp(key, "stream", 6) == 0)
+            net.stream = atoi(value);
+        if (memcmp(key, "decode_thread", 13) == 0)
+            net.decode_num_threads = atoi(value);
+        if (memcmp(key, "checkpoint", 10) == 0)
+            net.checkpoint_path = std::string(value);
     }
 
     // sanity check
@@ -1781,6 +3132,11 @@ int main(int argc, char** argv)
         fprintf(stderr, "malformed thread %d\n", net.quantize_num_threads);
         return -1;
     }
+    if (net.decode_num_threads < 0)
+    {
+        fprintf(stderr, "malformed decode_thread %d\n", net.decode_num_threads);
+        return -1;
+    }
 
     // print quantnet config
     {
@@ -1798,9 +3154,24 @@ int main(int argc, char** argv)
         fprintf(stderr, "\n");
         fprintf(stderr, "thread = %d\n", net.quantize_num_threads);
         fprintf(stderr, "method = %s\n", method.c_str());
+        fprintf(stderr, "equalize = %d\n", net.equalize);
+        fprintf(stderr, "bias_correct = %d\n", net.bias_correct);
+        if (method == "sq")
+            fprintf(stderr, "alpha = %f\n", net.smooth_alpha);
+        if (net.stream)
+        {
+            fprintf(stderr, "stream = %d\n", net.stream);
+            fprintf(stderr, "decode_thread = %d\n", net.decode_num_threads);
+            fprintf(stderr, "checkpoint = %s\n", net.checkpoint_path.c_str());
+        }
         fprintf(stderr, "---------------------------------------\n");
     }
 
+    if (net.equalize)
+    {
+        net.equalize_weights();
+    }
+
     if (method == "kl")
     {
         net.quantize_KL();
@@ -1813,13 +3184,22 @@ int main(int argc, char** argv)
     {
         net.quantize_EQ();
     }
+    else if (method == "sq")
+    {
+        net.quantize_SQ();
+    }
     else
     {
         fprintf(stderr, "not implemented yet !\n");
-        fprintf(stderr, "unknown method %s, expect kl / aciq / eq\n", method.c_str());
+        fprintf(stderr, "unknown method %s, expect kl / aciq / eq / sq\n", method.c_str());
         return -1;
     }
 
+    if (net.bias_correct)
+    {
+        net.correct_bias();
+    }
+
     net.print_quant_info();
 
     net.save_table(outtable);